@@ -0,0 +1,1173 @@
+/*
+  Copyright (c) 2012 John-Anthony Owens
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+*/
+
+/* jsonsaxbench measures parser throughput on a handful of synthetic
+ * documents that are generated in memory, so that results do not depend on
+ * the filesystem. Each document is parsed repeatedly, in fixed-size chunks,
+ * with handlers installed for every event, and the throughput is reported
+ * in MB/s. With --threads, each document is instead split into records or
+ * array segments that are parsed on several threads at once, and the
+ * throughput is measured in wall-clock time. Refer to the usage message
+ * for options.
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "jsonsax.h"
+
+#define OPTION_HELP         "--help"
+#define OPTION_SIZE         "--size"
+#define OPTION_ITERATIONS   "--iterations"
+#define OPTION_CHUNK        "--chunk"
+#define OPTION_LAZY         "--lazy"
+#define OPTION_NATIVE       "--native"
+#define OPTION_BATCH        "--batch"
+#define OPTION_TAPE         "--tape"
+#define OPTION_MEMBERS      "--members"
+#define OPTION_ARENA        "--arena"
+#define OPTION_INTERN       "--intern"
+#define OPTION_KNOWN        "--known"
+#define OPTION_FILTER       "--filter"
+#define OPTION_THREADS      "--threads"
+
+#define DEFAULT_SIZE        (4 * 1024 * 1024)
+#define DEFAULT_ITERATIONS  10
+#define DEFAULT_CHUNK       (64 * 1024)
+#define BATCH_EVENTS        1024
+#define CHUNKS_PER_THREAD   8
+
+typedef struct tag_Buffer
+{
+    char*  pBytes;
+    size_t used;
+    size_t size;
+} Buffer;
+
+typedef void (*GenerateFunc)(Buffer* pBuffer, size_t targetSize);
+
+typedef struct tag_Workload
+{
+    const char*   pName;
+    GenerateFunc  generate;
+    JSON_Encoding encoding;
+    JSON_Boolean  multipleDocuments;
+} Workload;
+
+static unsigned long s_seed = 1;
+static JSON_Boolean s_trackLocationsLazily = JSON_False;
+static int s_useNativeNumbers = 0;
+static int s_useEventBatches = 0;
+static JSON_Event s_eventBatch[BATCH_EVENTS];
+static int s_buildTape = 0;
+static JSON_Tape s_tape = NULL;
+static JSON_Boolean s_trackObjectMembers = JSON_False;
+static int s_useArena = 0;
+static int s_internMemberNames = 0;
+static int s_skipUnknownMembers = 0;
+
+/* The members that --known extracts from the records; the rest are
+   skipped. */
+static const char* const s_knownKeys[] = { "id", "score" };
+static int s_filterPaths = 0;
+
+/* The values that --filter extracts from the records; the wildcard keeps
+   the parser from stopping early, so the whole document is scanned. */
+static const char* const s_filteredPaths[] = { "/*/id" };
+static unsigned long s_events = 0;
+
+static unsigned long Random(unsigned long range)
+{
+    s_seed = s_seed * 1103515245UL + 12345UL;
+    return ((s_seed >> 16) & 0x7FFF) % range;
+}
+
+static void Append(Buffer* pBuffer, const char* pBytes, size_t length)
+{
+    if (pBuffer->used + length > pBuffer->size)
+    {
+        size_t newSize = pBuffer->size ? pBuffer->size : 1024;
+        char* pNewBytes;
+        while (pBuffer->used + length > newSize)
+        {
+            newSize *= 2;
+        }
+        pNewBytes = (char*)realloc(pBuffer->pBytes, newSize);
+        if (!pNewBytes)
+        {
+            fprintf(stderr, "error: out of memory\n");
+            exit(1);
+        }
+        pBuffer->pBytes = pNewBytes;
+        pBuffer->size = newSize;
+    }
+    memcpy(pBuffer->pBytes + pBuffer->used, pBytes, length);
+    pBuffer->used += length;
+}
+
+static void AppendString(Buffer* pBuffer, const char* pString)
+{
+    Append(pBuffer, pString, strlen(pString));
+}
+
+static void AppendIndent(Buffer* pBuffer, int depth)
+{
+    AppendString(pBuffer, "\n");
+    while (depth--)
+    {
+        AppendString(pBuffer, "    ");
+    }
+}
+
+static void AppendNumber(Buffer* pBuffer)
+{
+    char number[32];
+    switch (Random(3))
+    {
+    case 0:
+        sprintf(number, "%lu", Random(100000));
+        break;
+    case 1:
+        sprintf(number, "-%lu.%lu", Random(1000), Random(1000));
+        break;
+    default:
+        sprintf(number, "%lu.%lue%d", Random(10), Random(100000), (int)Random(40) - 20);
+        break;
+    }
+    AppendString(pBuffer, number);
+}
+
+static void AppendText(Buffer* pBuffer, size_t length, int unicode)
+{
+    static const char* s_words[] =
+    {
+        "request", "handled", "in", "the", "server", "returned", "status",
+        "for", "user", "session", "cache", "miss", "on", "key", "<div>",
+        "</div>", "class=\\\"row\\\"", "path=\\/api\\/v1", "\\t", "ok"
+    };
+    static const char* s_unicodeWords[] =
+    {
+        "caf\xC3\xA9", "na\xC3\xAFve", "\xE2\x82\xAC" "100", "\xE6\x97\xA5\xE6\x9C\xAC",
+        "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82", "\xF0\x9F\x98\x80"
+    };
+    size_t start = pBuffer->used;
+    AppendString(pBuffer, "\"");
+    while (pBuffer->used - start < length)
+    {
+        if (unicode && Random(2))
+        {
+            AppendString(pBuffer, s_unicodeWords[Random(sizeof(s_unicodeWords) / sizeof(s_unicodeWords[0]))]);
+        }
+        else
+        {
+            AppendString(pBuffer, s_words[Random(sizeof(s_words) / sizeof(s_words[0]))]);
+        }
+        AppendString(pBuffer, " ");
+    }
+    AppendString(pBuffer, "\"");
+}
+
+static void AppendRecord(Buffer* pBuffer, int pretty, int depth)
+{
+    static const char* s_names[] =
+    {
+        "\"id\"", "\"name\"", "\"active\"", "\"score\"", "\"tags\"", "\"parent\""
+    };
+    int i;
+    AppendString(pBuffer, "{");
+    for (i = 0; i < 6; i++)
+    {
+        if (i)
+        {
+            AppendString(pBuffer, ",");
+        }
+        if (pretty)
+        {
+            AppendIndent(pBuffer, depth + 1);
+        }
+        AppendString(pBuffer, s_names[i]);
+        AppendString(pBuffer, pretty ? ": " : ":");
+        switch (i)
+        {
+        case 0:
+        case 3:
+            AppendNumber(pBuffer);
+            break;
+        case 1:
+            AppendText(pBuffer, 8 + Random(16), 0);
+            break;
+        case 2:
+            AppendString(pBuffer, Random(2) ? "true" : "false");
+            break;
+        case 4:
+            AppendString(pBuffer, "[");
+            AppendText(pBuffer, 4, 0);
+            AppendString(pBuffer, pretty ? ", " : ",");
+            AppendText(pBuffer, 6, 0);
+            AppendString(pBuffer, "]");
+            break;
+        default:
+            AppendString(pBuffer, "null");
+            break;
+        }
+    }
+    if (pretty)
+    {
+        AppendIndent(pBuffer, depth);
+    }
+    AppendString(pBuffer, "}");
+}
+
+static void GenerateRecords(Buffer* pBuffer, size_t targetSize, int pretty)
+{
+    AppendString(pBuffer, "[");
+    while (pBuffer->used < targetSize)
+    {
+        if (pBuffer->used > 1)
+        {
+            AppendString(pBuffer, ",");
+        }
+        if (pretty)
+        {
+            AppendIndent(pBuffer, 1);
+        }
+        AppendRecord(pBuffer, pretty, 1);
+    }
+    if (pretty)
+    {
+        AppendIndent(pBuffer, 0);
+    }
+    AppendString(pBuffer, "]");
+}
+
+static void GenerateCompact(Buffer* pBuffer, size_t targetSize)
+{
+    GenerateRecords(pBuffer, targetSize, 0);
+}
+
+static void GeneratePretty(Buffer* pBuffer, size_t targetSize)
+{
+    GenerateRecords(pBuffer, targetSize, 1);
+}
+
+static void GenerateTexts(Buffer* pBuffer, size_t targetSize, int unicode)
+{
+    AppendString(pBuffer, "[");
+    while (pBuffer->used < targetSize)
+    {
+        if (pBuffer->used > 1)
+        {
+            AppendString(pBuffer, ",");
+        }
+        AppendText(pBuffer, 64 + Random(1024), unicode);
+    }
+    AppendString(pBuffer, "]");
+}
+
+static void GenerateLines(Buffer* pBuffer, size_t targetSize)
+{
+    /* Newline-delimited records, parsed as a sequence of documents. */
+    while (pBuffer->used < targetSize)
+    {
+        AppendRecord(pBuffer, 0, 0);
+        AppendString(pBuffer, "\n");
+    }
+}
+
+static void GenerateStrings(Buffer* pBuffer, size_t targetSize)
+{
+    GenerateTexts(pBuffer, targetSize, 0);
+}
+
+static void GenerateUnicode(Buffer* pBuffer, size_t targetSize)
+{
+    GenerateTexts(pBuffer, targetSize, 1);
+}
+
+static void GenerateNumbers(Buffer* pBuffer, size_t targetSize)
+{
+    AppendString(pBuffer, "[");
+    while (pBuffer->used < targetSize)
+    {
+        if (pBuffer->used > 1)
+        {
+            AppendString(pBuffer, ",");
+        }
+        AppendNumber(pBuffer);
+    }
+    AppendString(pBuffer, "]");
+}
+
+/* Converts UTF-8 input to UTF-16LE in place (the generated input never
+   contains codepoints that require validation).
+ */
+static void ConvertToUTF16LE(Buffer* pBuffer)
+{
+    Buffer converted = { NULL, 0, 0 };
+    size_t i = 0;
+    while (i < pBuffer->used)
+    {
+        unsigned char b = (unsigned char)pBuffer->pBytes[i];
+        unsigned long c;
+        char units[4];
+        if (b < 0x80)
+        {
+            c = b;
+            i += 1;
+        }
+        else if (b < 0xE0)
+        {
+            c = ((unsigned long)(b & 0x1F) << 6) | ((unsigned char)pBuffer->pBytes[i + 1] & 0x3F);
+            i += 2;
+        }
+        else if (b < 0xF0)
+        {
+            c = ((unsigned long)(b & 0x0F) << 12) | ((unsigned long)((unsigned char)pBuffer->pBytes[i + 1] & 0x3F) << 6) | ((unsigned char)pBuffer->pBytes[i + 2] & 0x3F);
+            i += 3;
+        }
+        else
+        {
+            c = ((unsigned long)(b & 0x07) << 18) | ((unsigned long)((unsigned char)pBuffer->pBytes[i + 1] & 0x3F) << 12) | ((unsigned long)((unsigned char)pBuffer->pBytes[i + 2] & 0x3F) << 6) | ((unsigned char)pBuffer->pBytes[i + 3] & 0x3F);
+            i += 4;
+        }
+        if (c >= 0x10000)
+        {
+            unsigned long high = 0xD800 | ((c - 0x10000) >> 10);
+            unsigned long low = 0xDC00 | ((c - 0x10000) & 0x3FF);
+            units[0] = (char)(high & 0xFF);
+            units[1] = (char)(high >> 8);
+            units[2] = (char)(low & 0xFF);
+            units[3] = (char)(low >> 8);
+            Append(&converted, units, 4);
+        }
+        else
+        {
+            units[0] = (char)(c & 0xFF);
+            units[1] = (char)(c >> 8);
+            Append(&converted, units, 2);
+        }
+    }
+    free(pBuffer->pBytes);
+    *pBuffer = converted;
+}
+
+static void GenerateUTF16(Buffer* pBuffer, size_t targetSize)
+{
+    GenerateRecords(pBuffer, targetSize / 2, 1);
+    ConvertToUTF16LE(pBuffer);
+}
+
+static const Workload s_workloads[] =
+{
+    { "compact",  &GenerateCompact, JSON_UTF8,    JSON_False },
+    { "pretty",   &GeneratePretty,  JSON_UTF8,    JSON_False },
+    { "ndjson",   &GenerateLines,   JSON_UTF8,    JSON_True  },
+    { "strings",  &GenerateStrings, JSON_UTF8,    JSON_False },
+    { "unicode",  &GenerateUnicode, JSON_UTF8,    JSON_False },
+    { "numbers",  &GenerateNumbers, JSON_UTF8,    JSON_False },
+    { "utf16",    &GenerateUTF16,   JSON_UTF16LE, JSON_False }
+};
+
+static JSON_Parser_HandlerResult JSON_CALL OnEvent(JSON_Parser parser)
+{
+    (void)parser;
+    s_events++;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnBoolean(JSON_Parser parser, JSON_Boolean value)
+{
+    (void)parser; (void)value;
+    s_events++;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnString(JSON_Parser parser, char* pValue, size_t length, JSON_StringAttributes attributes)
+{
+    (void)parser; (void)pValue; (void)attributes;
+    s_events += length ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnNumber(JSON_Parser parser, char* pValue, size_t length, JSON_NumberAttributes attributes)
+{
+    (void)parser; (void)pValue; (void)attributes;
+    s_events += length ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnInt64(JSON_Parser parser, JSON_Int64 value, JSON_NumberAttributes attributes)
+{
+    (void)parser; (void)attributes;
+    s_events += value ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnDouble(JSON_Parser parser, double value, JSON_NumberAttributes attributes)
+{
+    (void)parser; (void)attributes;
+    s_events += (value != 0.0) ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnObjectMember(JSON_Parser parser, char* pName, size_t length, JSON_StringAttributes attributes)
+{
+    (void)parser; (void)pName; (void)attributes;
+    s_events += length ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnInternedMember(JSON_Parser parser, size_t keyId, JSON_Boolean isNewKey, const char* pName, size_t length, JSON_StringAttributes attributes)
+{
+    (void)parser; (void)isNewKey; (void)pName; (void)length; (void)attributes;
+    s_events += (keyId != JSON_NO_KEY_ID) ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnKnownMember(JSON_Parser parser, size_t keyIndex, const char* pName, size_t length, JSON_StringAttributes attributes)
+{
+    (void)parser; (void)pName; (void)length; (void)attributes;
+    s_events += (keyIndex != JSON_UNKNOWN_KEY) ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnEventBatch(JSON_Parser parser, const JSON_Event* pEvents, size_t count, const char* pArena)
+{
+    (void)parser; (void)pEvents; (void)pArena;
+    s_events += count;
+    return JSON_Parser_Continue;
+}
+
+static void ReportParseError(JSON_Parser parser)
+{
+    JSON_Location location;
+    JSON_Parser_GetErrorLocation(parser, &location);
+    fprintf(stderr, "error: %s at byte %d\n", JSON_ErrorString(JSON_Parser_GetError(parser)), (int)location.byte);
+}
+
+static int ParseOnce(JSON_Parser parser, const Buffer* pBuffer, const Workload* pWorkload, size_t chunkSize)
+{
+    size_t offset = 0;
+    JSON_Parser_Reset(parser);
+    JSON_Parser_SetInputEncoding(parser, pWorkload->encoding);
+    JSON_Parser_SetAllowMultipleDocuments(parser, pWorkload->multipleDocuments);
+    JSON_Parser_SetTrackLocationsLazily(parser, s_trackLocationsLazily);
+    JSON_Parser_SetTrackObjectMembers(parser, s_trackObjectMembers);
+    JSON_Parser_SetNullHandler(parser, &OnEvent);
+    JSON_Parser_SetBooleanHandler(parser, &OnBoolean);
+    JSON_Parser_SetStringHandler(parser, &OnString);
+    JSON_Parser_SetNumberHandler(parser, &OnNumber);
+    if (s_useNativeNumbers)
+    {
+        JSON_Parser_SetInt64Handler(parser, &OnInt64);
+        JSON_Parser_SetDoubleHandler(parser, &OnDouble);
+    }
+    JSON_Parser_SetStartObjectHandler(parser, &OnEvent);
+    JSON_Parser_SetEndObjectHandler(parser, &OnEvent);
+    JSON_Parser_SetObjectMemberHandler(parser, &OnObjectMember);
+    if (s_internMemberNames)
+    {
+        JSON_Parser_SetInternedMemberHandler(parser, &OnInternedMember);
+    }
+    if (s_skipUnknownMembers)
+    {
+        /* The known keys survive the reset, so they are only compiled
+           once per parser. */
+        if (!JSON_Parser_GetKnownKeyCount(parser))
+        {
+            JSON_Parser_SetKnownKeys(parser, s_knownKeys, NULL, sizeof(s_knownKeys) / sizeof(s_knownKeys[0]));
+        }
+        JSON_Parser_SetSkipUnknownMembers(parser, JSON_True);
+        JSON_Parser_SetKnownMemberHandler(parser, &OnKnownMember);
+    }
+    JSON_Parser_SetStartArrayHandler(parser, &OnEvent);
+    JSON_Parser_SetEndArrayHandler(parser, &OnEvent);
+    JSON_Parser_SetArrayItemHandler(parser, &OnEvent);
+    if (s_filterPaths && !JSON_Parser_GetPathFilterCount(parser))
+    {
+        JSON_Parser_SetPathFilter(parser, s_filteredPaths, sizeof(s_filteredPaths) / sizeof(s_filteredPaths[0]));
+    }
+    if (s_useEventBatches)
+    {
+        JSON_Parser_SetEventBatchHandler(parser, &OnEventBatch, s_eventBatch, BATCH_EVENTS);
+    }
+    if (s_tape)
+    {
+        JSON_Parser_SetTape(parser, s_tape);
+    }
+    do
+    {
+        size_t length = pBuffer->used - offset;
+        if (length > chunkSize)
+        {
+            length = chunkSize;
+        }
+        if (!JSON_Parser_Parse(parser, pBuffer->pBytes + offset, length, (offset + length == pBuffer->used) ? JSON_True : JSON_False))
+        {
+            ReportParseError(parser);
+            return 0;
+        }
+        offset += length;
+    } while (offset < pBuffer->used);
+    return 1;
+}
+
+static int RunWorkload(const Workload* pWorkload, size_t size, int iterations, size_t chunkSize)
+{
+    Buffer buffer = { NULL, 0, 0 };
+    JSON_Arena arena = s_useArena ? JSON_Arena_Create(NULL, 0) : NULL;
+    JSON_Parser parser = arena ? NULL : JSON_Parser_Create(NULL);
+    clock_t start;
+    double seconds;
+    int i;
+    int ok = 1;
+    s_seed = 1;
+    if (s_buildTape)
+    {
+        s_tape = JSON_Tape_Create(NULL);
+    }
+    pWorkload->generate(&buffer, size);
+    start = clock();
+    for (i = 0; ok && i < iterations; i++)
+    {
+        if (arena)
+        {
+            /* Parse each document with a new parser allocated from the
+               arena, and then reclaim all of its memory at once. */
+            parser = JSON_Parser_Create(JSON_Arena_GetMemorySuite(arena));
+        }
+        ok = ParseOnce(parser, &buffer, pWorkload, chunkSize);
+        if (arena)
+        {
+            JSON_Parser_Free(parser);
+            parser = NULL;
+            JSON_Arena_Reset(arena);
+        }
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (ok)
+    {
+        double megabytes = (double)buffer.used * iterations / (1024.0 * 1024.0);
+        printf("%-10s %10lu bytes %10.1f MB/s\n", pWorkload->pName, (unsigned long)buffer.used, seconds > 0 ? megabytes / seconds : 0.0);
+    }
+    JSON_Parser_Free(parser);
+    JSON_Arena_Free(arena);
+    if (s_tape)
+    {
+        JSON_Tape_Free(s_tape);
+        s_tape = NULL;
+    }
+    free(buffer.pBytes);
+    return ok;
+}
+
+/* A part of a document that is parsed on its own by a worker thread: some
+   of its records, or a segment of its top-level array. */
+typedef struct tag_Chunk
+{
+    const char*   pBytes;
+    size_t        length;
+    size_t        end;
+    unsigned long events;
+    unsigned long items;
+    int           depth;
+    int           closed;
+    JSON_Error    error;
+    JSON_Location errorLocation;
+} Chunk;
+
+#if defined(_WIN32)
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+#else
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+#endif
+
+typedef void (*ChunkFunc)(JSON_Parser parser, Chunk* pChunk);
+
+/* The chunks of a document, which the worker threads take in order until
+   none are left, so that a thread that finishes its chunk early takes
+   another instead of waiting for the others. */
+typedef struct tag_ChunkQueue
+{
+    JSON_Parser parser;
+    ChunkFunc   process;
+    Chunk*      pChunks;
+    size_t      count;
+    size_t      next;
+    Mutex       mutex;
+} ChunkQueue;
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkEvent(JSON_Parser parser)
+{
+    ((Chunk*)JSON_Parser_GetUserData(parser))->events++;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkBoolean(JSON_Parser parser, JSON_Boolean value)
+{
+    (void)value;
+    ((Chunk*)JSON_Parser_GetUserData(parser))->events++;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkString(JSON_Parser parser, char* pValue, size_t length, JSON_StringAttributes attributes)
+{
+    (void)pValue; (void)attributes;
+    ((Chunk*)JSON_Parser_GetUserData(parser))->events += length ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkNumber(JSON_Parser parser, char* pValue, size_t length, JSON_NumberAttributes attributes)
+{
+    (void)pValue; (void)attributes;
+    ((Chunk*)JSON_Parser_GetUserData(parser))->events += length ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkStartContainer(JSON_Parser parser)
+{
+    Chunk* pChunk = (Chunk*)JSON_Parser_GetUserData(parser);
+    pChunk->events++;
+    pChunk->depth++;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkEndContainer(JSON_Parser parser)
+{
+    Chunk* pChunk = (Chunk*)JSON_Parser_GetUserData(parser);
+    pChunk->events++;
+    pChunk->depth--;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkEndArray(JSON_Parser parser)
+{
+    /* The end of a segment of the top-level array is located at the end of
+       the segment, unless the segment ends with the array's bracket. */
+    Chunk* pChunk = (Chunk*)JSON_Parser_GetUserData(parser);
+    pChunk->events++;
+    if (!--pChunk->depth)
+    {
+        JSON_Location location;
+        JSON_Parser_GetTokenLocation(parser, &location);
+        pChunk->closed = location.byte < pChunk->length;
+    }
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkArrayItem(JSON_Parser parser)
+{
+    Chunk* pChunk = (Chunk*)JSON_Parser_GetUserData(parser);
+    pChunk->events++;
+    pChunk->items += (pChunk->depth == 1) ? 1 : 0;
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL OnChunkEndDocument(JSON_Parser parser)
+{
+    ((Chunk*)JSON_Parser_GetUserData(parser))->items++;
+    return JSON_Parser_Continue;
+}
+
+static void ParseChunk(JSON_Parser parser, Chunk* pChunk)
+{
+    /* Each chunk is parsed by a new clone, so that the chunks do not
+       depend on each other or on the thread that parses them. */
+    JSON_Parser clone = JSON_Parser_Clone(parser, NULL);
+    pChunk->events = 0;
+    pChunk->items = 0;
+    pChunk->depth = 0;
+    pChunk->closed = 0;
+    if (!clone)
+    {
+        pChunk->error = JSON_Error_OutOfMemory;
+        pChunk->errorLocation.byte = 0;
+        return;
+    }
+    JSON_Parser_SetUserData(clone, pChunk);
+    JSON_Parser_Parse(clone, pChunk->pBytes, pChunk->length, JSON_True);
+    pChunk->error = JSON_Parser_GetError(clone);
+    JSON_Parser_GetErrorLocation(clone, &pChunk->errorLocation);
+    JSON_Parser_Free(clone);
+}
+
+static Chunk* TakeChunk(ChunkQueue* pQueue)
+{
+    Chunk* pChunk = NULL;
+#if defined(_WIN32)
+    EnterCriticalSection(&pQueue->mutex);
+#else
+    pthread_mutex_lock(&pQueue->mutex);
+#endif
+    if (pQueue->next < pQueue->count)
+    {
+        pChunk = &pQueue->pChunks[pQueue->next++];
+    }
+#if defined(_WIN32)
+    LeaveCriticalSection(&pQueue->mutex);
+#else
+    pthread_mutex_unlock(&pQueue->mutex);
+#endif
+    return pChunk;
+}
+
+static void FindChunkEnd(JSON_Parser parser, Chunk* pChunk)
+{
+    /* Before the document is split, each chunk spans all of it, and its
+       end is the offset from which to look for a boundary. */
+    if (JSON_Parser_GetAllowMultipleDocuments(parser))
+    {
+        pChunk->end = JSON_FindRecordBoundary(pChunk->pBytes, pChunk->length, pChunk->end);
+    }
+    else
+    {
+        pChunk->end = JSON_FindArrayItemBoundary(pChunk->pBytes, pChunk->length, pChunk->end);
+    }
+}
+
+static void ProcessChunks(ChunkQueue* pQueue)
+{
+    Chunk* pChunk;
+    while ((pChunk = TakeChunk(pQueue)) != NULL)
+    {
+        pQueue->process(pQueue->parser, pChunk);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI RunThread(LPVOID pQueue)
+{
+    ProcessChunks((ChunkQueue*)pQueue);
+    return 0;
+}
+#else
+static void* RunThread(void* pQueue)
+{
+    ProcessChunks((ChunkQueue*)pQueue);
+    return NULL;
+}
+#endif
+
+static int ProcessChunksInParallel(ChunkQueue* pQueue, Thread* pThreads, int threads)
+{
+    /* The calling thread is one of the workers. */
+    int started = 0;
+    int ok = 1;
+    int i;
+    pQueue->next = 0;
+    for (; started < threads - 1; started++)
+    {
+#if defined(_WIN32)
+        pThreads[started] = CreateThread(NULL, 0, &RunThread, pQueue, 0, NULL);
+        if (!pThreads[started])
+#else
+        if (pthread_create(&pThreads[started], NULL, &RunThread, pQueue))
+#endif
+        {
+            fprintf(stderr, "error: could not start a thread\n");
+            ok = 0;
+            break;
+        }
+    }
+    ProcessChunks(pQueue);
+    for (i = 0; i < started; i++)
+    {
+#if defined(_WIN32)
+        WaitForSingleObject(pThreads[i], INFINITE);
+        CloseHandle(pThreads[i]);
+#else
+        pthread_join(pThreads[i], NULL);
+#endif
+    }
+    return ok;
+}
+
+static double WallClockSeconds(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+static int SplitDocument(ChunkQueue* pQueue, const Buffer* pBuffer, size_t parts, Thread* pThreads, int threads)
+{
+    /* The chunks start at the first record or item boundaries after evenly
+       spaced offsets, which the worker threads look for, since finding an
+       item boundary can mean scanning a lot of input; offsets that lead to
+       the same boundary give one chunk. */
+    Chunk* pChunks = pQueue->pChunks;
+    size_t start = 0;
+    size_t i;
+    for (i = 0; i < parts; i++)
+    {
+        pChunks[i].pBytes = pBuffer->pBytes;
+        pChunks[i].length = pBuffer->used;
+        pChunks[i].end = pBuffer->used / parts * (i + 1);
+    }
+    pQueue->process = &FindChunkEnd;
+    pQueue->count = parts - 1;
+    if (!ProcessChunksInParallel(pQueue, pThreads, threads))
+    {
+        return 0;
+    }
+    pChunks[parts - 1].end = pBuffer->used;
+    pQueue->count = 0;
+    for (i = 0; i < parts; i++)
+    {
+        size_t end = pChunks[i].end;
+        if (end > start)
+        {
+            pChunks[pQueue->count].pBytes = pBuffer->pBytes + start;
+            pChunks[pQueue->count].length = end - start;
+            pQueue->count++;
+            start = end;
+        }
+    }
+    pQueue->process = &ParseChunk;
+    return 1;
+}
+
+static size_t JoinUnterminatedSegments(JSON_Parser parser, Chunk* pChunks, size_t count, unsigned long* pJoins)
+{
+    /* Item boundaries are guessed, but the first segment that starts at a
+       wrong comma always leaves the segment before it unterminated, so
+       each unterminated segment is joined with the one after it and parsed
+       again on this thread, until it parses or is the last segment. */
+    size_t i = 0;
+    while (i + 1 < count)
+    {
+        if (pChunks[i].error == JSON_Error_IncompleteToken || pChunks[i].error == JSON_Error_ExpectedMoreTokens)
+        {
+            pChunks[i].length += pChunks[i + 1].length;
+            memmove(&pChunks[i + 1], &pChunks[i + 2], (count - i - 2) * sizeof(Chunk));
+            count--;
+            (*pJoins)++;
+            ParseChunk(parser, &pChunks[i]);
+        }
+        else
+        {
+            i++;
+        }
+    }
+    return count;
+}
+
+static int DeliverChunks(const Chunk* pChunks, size_t count, int isArray, unsigned long* pEvents, unsigned long* pItems)
+{
+    /* The results are combined in the order of the chunks, so that each
+       record or item gets its index in the whole document. */
+    size_t i;
+    *pEvents = 0;
+    *pItems = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (pChunks[i].error != JSON_Error_None)
+        {
+            fprintf(stderr, "error: %s at byte %lu\n", JSON_ErrorString(pChunks[i].error),
+                    (unsigned long)(pChunks[i].pBytes - pChunks[0].pBytes + pChunks[i].errorLocation.byte));
+            return 0;
+        }
+        *pEvents += pChunks[i].events;
+        *pItems += pChunks[i].items;
+    }
+    if (isArray)
+    {
+        if (!pChunks[count - 1].closed)
+        {
+            fprintf(stderr, "error: the array does not end with a right square bracket\n");
+            return 0;
+        }
+
+        /* Every segment but the first starts the array again, and every
+           segment but the last ends it. */
+        *pEvents -= 2 * (unsigned long)(count - 1);
+    }
+    return 1;
+}
+
+static int RunWorkloadInParallel(const Workload* pWorkload, size_t size, int iterations, int threads)
+{
+    Buffer buffer = { NULL, 0, 0 };
+    size_t parts = (size_t)threads * CHUNKS_PER_THREAD;
+    Chunk* pChunks = (Chunk*)malloc(parts * sizeof(Chunk));
+    Thread* pThreads = (Thread*)malloc((size_t)threads * sizeof(Thread));
+    ChunkQueue queue;
+    Chunk whole;
+    unsigned long events = 0;
+    unsigned long items = 0;
+    unsigned long joins = 0;
+    int isArray = !pWorkload->multipleDocuments;
+    double start;
+    double seconds;
+    int i;
+    int ok = 1;
+    if (pWorkload->encoding != JSON_UTF8)
+    {
+        /* Only UTF-8 records and arrays can be split. */
+        printf("%-10s (cannot be split)\n", pWorkload->pName);
+        free(pChunks);
+        free(pThreads);
+        return 1;
+    }
+    if (!pChunks || !pThreads)
+    {
+        fprintf(stderr, "error: out of memory\n");
+        exit(1);
+    }
+    s_seed = 1;
+    pWorkload->generate(&buffer, size);
+    queue.parser = JSON_Parser_Create(NULL);
+    queue.pChunks = pChunks;
+#if defined(_WIN32)
+    InitializeCriticalSection(&queue.mutex);
+#else
+    pthread_mutex_init(&queue.mutex, NULL);
+#endif
+    JSON_Parser_SetInputEncoding(queue.parser, JSON_UTF8);
+    JSON_Parser_SetAllowMultipleDocuments(queue.parser, pWorkload->multipleDocuments);
+    JSON_Parser_SetAllowArraySegment(queue.parser, (JSON_Boolean)isArray);
+    JSON_Parser_SetTrackLocationsLazily(queue.parser, s_trackLocationsLazily);
+    JSON_Parser_SetTrackObjectMembers(queue.parser, s_trackObjectMembers);
+    JSON_Parser_SetNullHandler(queue.parser, &OnChunkEvent);
+    JSON_Parser_SetBooleanHandler(queue.parser, &OnChunkBoolean);
+    JSON_Parser_SetStringHandler(queue.parser, &OnChunkString);
+    JSON_Parser_SetNumberHandler(queue.parser, &OnChunkNumber);
+    JSON_Parser_SetStartObjectHandler(queue.parser, &OnChunkStartContainer);
+    JSON_Parser_SetEndObjectHandler(queue.parser, &OnChunkEndContainer);
+    JSON_Parser_SetObjectMemberHandler(queue.parser, &OnChunkString);
+    JSON_Parser_SetStartArrayHandler(queue.parser, &OnChunkStartContainer);
+    JSON_Parser_SetEndArrayHandler(queue.parser, &OnChunkEndArray);
+    if (isArray)
+    {
+        JSON_Parser_SetArrayItemHandler(queue.parser, &OnChunkArrayItem);
+    }
+    else
+    {
+        JSON_Parser_SetArrayItemHandler(queue.parser, &OnChunkEvent);
+        JSON_Parser_SetEndDocumentHandler(queue.parser, &OnChunkEndDocument);
+    }
+
+    /* The whole document is parsed once on this thread, and the chunks
+       must add up to the same results. */
+    whole.pBytes = buffer.pBytes;
+    whole.length = buffer.used;
+    ParseChunk(queue.parser, &whole);
+    ok = DeliverChunks(&whole, 1, isArray, &events, &items);
+
+    start = WallClockSeconds();
+    for (i = 0; ok && i < iterations; i++)
+    {
+        unsigned long chunkEvents;
+        unsigned long chunkItems;
+        ok = SplitDocument(&queue, &buffer, parts, pThreads, threads) &&
+             ProcessChunksInParallel(&queue, pThreads, threads);
+        if (ok && isArray)
+        {
+            queue.count = JoinUnterminatedSegments(queue.parser, pChunks, queue.count, &joins);
+        }
+        ok = ok && DeliverChunks(pChunks, queue.count, isArray, &chunkEvents, &chunkItems);
+        if (ok && (chunkEvents != events || chunkItems != items))
+        {
+            fprintf(stderr, "error: the chunks of %s do not add up to the whole\n", pWorkload->pName);
+            ok = 0;
+        }
+    }
+    seconds = WallClockSeconds() - start;
+    if (ok)
+    {
+        double megabytes = (double)buffer.used * iterations / (1024.0 * 1024.0);
+        printf("%-10s %10lu bytes %10.1f MB/s %6lu items in %lu chunks, %lu joined\n", pWorkload->pName, (unsigned long)buffer.used,
+               seconds > 0 ? megabytes / seconds : 0.0, items, (unsigned long)queue.count, joins);
+    }
+#if defined(_WIN32)
+    DeleteCriticalSection(&queue.mutex);
+#else
+    pthread_mutex_destroy(&queue.mutex);
+#endif
+    JSON_Parser_Free(queue.parser);
+    free(pChunks);
+    free(pThreads);
+    free(buffer.pBytes);
+    return ok;
+}
+
+static void PrintUsage(void)
+{
+    /* The message is printed in parts, since C90 compilers only need to
+       support string literals of up to 509 characters. */
+    fprintf(stderr,
+            "Usage: jsonsaxbench [OPTIONS] [WORKLOAD...]\n"
+            "Measure parser throughput on synthetic documents.\n"
+            "\n"
+            "Options:\n"
+            "  " OPTION_HELP "            Print this message and exit.\n"
+            "  " OPTION_SIZE " N          Generate documents of about N bytes.\n"
+            "  " OPTION_ITERATIONS " N    Parse each document N times.\n"
+            "  " OPTION_CHUNK " N         Feed the parser N bytes at a time.\n");
+    fprintf(stderr,
+            "  " OPTION_LAZY "            Track line and column numbers lazily.\n"
+            "  " OPTION_NATIVE "          Receive numbers as int64s and doubles.\n"
+            "  " OPTION_BATCH "           Receive events in batches.\n"
+            "  " OPTION_TAPE "            Build a tape of each document.\n"
+            "  " OPTION_MEMBERS "         Track object members to detect duplicates.\n"
+            "  " OPTION_ARENA "           Allocate each parser from an arena.\n"
+            "  " OPTION_INTERN "          Receive object member names interned.\n"
+            "  " OPTION_KNOWN "           Skip all but a few known object members.\n");
+    fprintf(stderr,
+            "  " OPTION_FILTER "          Skip all but the ids of the records.\n"
+            "  " OPTION_THREADS " N       Split each document into parts and parse\n"
+            "                    them on N threads, measuring wall-clock time.\n"
+            "                    Only " OPTION_LAZY " and " OPTION_MEMBERS " apply, and utf16\n"
+            "                    cannot be split.\n"
+            "\n"
+            "Workloads: compact, pretty, ndjson, strings, unicode, numbers, utf16\n"
+            "(default: all).\n");
+}
+
+int main(int argc, char* argv[])
+{
+    size_t size = DEFAULT_SIZE;
+    int iterations = DEFAULT_ITERATIONS;
+    size_t chunkSize = DEFAULT_CHUNK;
+    int threads = 0;
+    int otherOptions = 0;
+    int selected = 0;
+    int ok = 1;
+    int i;
+    size_t w;
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], OPTION_SIZE) && i + 1 < argc)
+        {
+            size = (size_t)atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], OPTION_ITERATIONS) && i + 1 < argc)
+        {
+            iterations = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], OPTION_CHUNK) && i + 1 < argc)
+        {
+            chunkSize = (size_t)atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], OPTION_LAZY))
+        {
+            s_trackLocationsLazily = JSON_True;
+        }
+        else if (!strcmp(argv[i], OPTION_NATIVE))
+        {
+            s_useNativeNumbers = 1;
+        }
+        else if (!strcmp(argv[i], OPTION_BATCH))
+        {
+            s_useEventBatches = 1;
+        }
+        else if (!strcmp(argv[i], OPTION_TAPE))
+        {
+            s_buildTape = 1;
+        }
+        else if (!strcmp(argv[i], OPTION_MEMBERS))
+        {
+            s_trackObjectMembers = JSON_True;
+        }
+        else if (!strcmp(argv[i], OPTION_ARENA))
+        {
+            s_useArena = 1;
+        }
+        else if (!strcmp(argv[i], OPTION_INTERN))
+        {
+            s_internMemberNames = 1;
+        }
+        else if (!strcmp(argv[i], OPTION_KNOWN))
+        {
+            s_skipUnknownMembers = 1;
+        }
+        else if (!strcmp(argv[i], OPTION_FILTER))
+        {
+            s_filterPaths = 1;
+        }
+        else if (!strcmp(argv[i], OPTION_THREADS) && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+            if (threads <= 0)
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-' || !strcmp(argv[i], OPTION_HELP))
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            selected = 1;
+        }
+    }
+    otherOptions = s_useNativeNumbers || s_useEventBatches || s_buildTape || s_useArena ||
+                   s_internMemberNames || s_skipUnknownMembers || s_filterPaths;
+    if (!size || iterations <= 0 || !chunkSize || (threads && otherOptions))
+    {
+        PrintUsage();
+        return 1;
+    }
+    for (w = 0; ok && w < sizeof(s_workloads) / sizeof(s_workloads[0]); w++)
+    {
+        int run = !selected;
+        for (i = 1; !run && i < argc; i++)
+        {
+            if (!strcmp(argv[i], s_workloads[w].pName))
+            {
+                run = 1;
+            }
+        }
+        if (run && threads)
+        {
+            ok = RunWorkloadInParallel(&s_workloads[w], size, iterations, threads);
+        }
+        else if (run)
+        {
+            ok = RunWorkload(&s_workloads[w], size, iterations, chunkSize);
+        }
+    }
+    return ok ? 0 : 1;
+}
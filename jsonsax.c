@@ -22,6 +22,8 @@
 
 #include <stdlib.h>
 #include <memory.h>
+#include <float.h>
+#include <time.h>
 
 /* Ensure uint32_t type (compiler-dependent). */
 #if defined(_MSC_VER)
@@ -30,6 +32,47 @@ typedef unsigned __int32 uint32_t;
 #include <stdint.h>
 #endif
 
+/* Use SIMD instructions to scan input when the target supports them, unless
+   specifically disabled. */
+#if !defined(JSON_NO_SIMD)
+#if defined(__AVX2__)
+#define JSON_SIMD_AVX2
+#define JSON_SIMD_SSSE3
+#define JSON_SIMD_SSE2
+#include <immintrin.h>
+#elif defined(__SSSE3__) || defined(__AVX__)
+#define JSON_SIMD_SSSE3
+#define JSON_SIMD_SSE2
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(JSON_SIMD_SSE2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+/* Use the compiler's atomic operations to share instance pools between
+   threads, where it provides them. */
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_ATOMICS_GCC
+#elif defined(_MSC_VER)
+#define JSON_ATOMICS_MSVC
+#include <intrin.h>
+#endif
+
+/* Force the inlining of the small helpers that the specialized input loops
+   (see DEFINE_INPUT_LOOP()) pass constant encodings to, so that the
+   constants reach them. */
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_FORCE_INLINE __inline__ __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define JSON_FORCE_INLINE __forceinline
+#else
+#define JSON_FORCE_INLINE
+#endif
+
 /* Ensure SIZE_MAX defined. */
 #ifndef SIZE_MAX
 #define SIZE_MAX ((size_t)-1)
@@ -41,6 +84,7 @@ typedef unsigned __int32 uint32_t;
 
 /* Default allocation constants. */
 #define DEFAULT_TOKEN_BYTES_LENGTH 64 /* MUST be a power of 2 */
+#define DEFAULT_EVENT_ARENA_LENGTH 256
 #define DEFAULT_SYMBOL_STACK_SIZE  32 /* MUST be a power of 2 */
 
 /* Types for readability. */
@@ -55,6 +99,7 @@ typedef uint32_t Codepoint;
 #define LINE_FEED_CODEPOINT             U_(0x000A)
 #define FORM_FEED_CODEPOINT             U_(0x000C)
 #define CARRIAGE_RETURN_CODEPOINT       U_(0x000D)
+#define RECORD_SEPARATOR_CODEPOINT      U_(0x001E)
 #define FIRST_NON_CONTROL_CODEPOINT     U_(0x0020)
 #define DELETE_CODEPOINT                U_(0x007F)
 #define FIRST_NON_ASCII_CODEPOINT       U_(0x0080)
@@ -145,6 +190,456 @@ static byte* DoubleBuffer(const JSON_MemorySuite* pMemorySuite, byte* pDefaultBu
     return pBuffer;
 }
 
+/******************** Arena Memory Suite ********************/
+
+#define DEFAULT_SLAB_SIZE (64 * 1024)
+
+/* Arena blocks are aligned like the most strictly-aligned of these, which
+   on most targets matches the alignment of the blocks that malloc()
+   returns. MSVC's C library doesn't define max_align_t, but its long
+   double is the same as its double. */
+typedef union tag_ArenaAlignment
+{
+    long        l;
+    double      d;
+    long double ld;
+    void*       p;
+    size_t      s;
+    JSON_UInt64 u;
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(_MSC_VER)
+    max_align_t m;
+#endif
+} ArenaAlignment;
+
+/* The alignment of the union, which can be less than its size (max_align_t
+   is 32 bytes long on x86-64, but only needs 16-byte alignment). */
+typedef struct tag_ArenaAlignmentProbe
+{
+    char           c;
+    ArenaAlignment a;
+} ArenaAlignmentProbe;
+
+#define ARENA_ALIGNMENT offsetof(ArenaAlignmentProbe, a)
+#define ARENA_ALIGN(n) ((((n) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT)
+
+/* Marks the absence of a previous block in a slab. */
+#define NO_BLOCK SIZE_MAX
+
+/* Each slab begins with an ArenaSlab, and each block in a slab with an
+   ArenaBlock, both padded to the alignment. The blocks in a slab form a
+   stack, so that blocks freed in the reverse order of their allocation
+   can be reclaimed. */
+typedef struct tag_ArenaSlab
+{
+    struct tag_ArenaSlab* pNextSlab;
+    size_t                size;      /* including the header */
+    size_t                used;      /* including the header */
+    size_t                lastBlock; /* offset of the most recent block, or NO_BLOCK */
+} ArenaSlab;
+
+typedef struct tag_ArenaBlock
+{
+    size_t size;          /* the usable size of the block */
+    size_t previousBlock; /* offset of the block before this one, or NO_BLOCK */
+} ArenaBlock;
+
+#define SLAB_HEADER_SIZE  ARENA_ALIGN(sizeof(ArenaSlab))
+#define BLOCK_HEADER_SIZE ARENA_ALIGN(sizeof(ArenaBlock))
+
+struct JSON_Arena_Data
+{
+    JSON_MemorySuite memorySuite; /* the underlying memory suite */
+    JSON_MemorySuite arenaSuite;  /* the memory suite that allocates from the arena */
+    size_t           slabSize;
+    ArenaSlab*       pFirstSlab;
+    ArenaSlab*       pCurrentSlab;
+    size_t           bytesInUse;
+    size_t           highWaterMark;
+};
+
+static void* JSON_Arena_Allocate(JSON_Arena arena, size_t size)
+{
+    ArenaSlab* pSlab = arena->pCurrentSlab;
+    ArenaBlock* pBlock;
+    size_t blockSize;
+    if (size > SIZE_MAX - BLOCK_HEADER_SIZE - SLAB_HEADER_SIZE - ARENA_ALIGNMENT)
+    {
+        return NULL;
+    }
+    blockSize = ARENA_ALIGN(BLOCK_HEADER_SIZE + size);
+    if (!pSlab || pSlab->size - pSlab->used < blockSize)
+    {
+        /* Move on to the next slab that the block fits in, which will be
+           one that was kept when the arena was reset, or a new one. The
+           rest of the current slab goes unused until the arena is reset. */
+        ArenaSlab* pNextSlab = pSlab ? pSlab->pNextSlab : arena->pFirstSlab;
+        while (pNextSlab && pNextSlab->size - pNextSlab->used < blockSize)
+        {
+            pNextSlab = pNextSlab->pNextSlab;
+        }
+        if (!pNextSlab)
+        {
+            size_t slabSize = (SLAB_HEADER_SIZE + blockSize > arena->slabSize) ? SLAB_HEADER_SIZE + blockSize : arena->slabSize;
+            pNextSlab = (ArenaSlab*)arena->memorySuite.realloc(arena->memorySuite.userData, NULL, slabSize);
+            if (!pNextSlab)
+            {
+                return NULL;
+            }
+            pNextSlab->size = slabSize;
+            pNextSlab->used = SLAB_HEADER_SIZE;
+            pNextSlab->lastBlock = NO_BLOCK;
+            if (pSlab)
+            {
+                pNextSlab->pNextSlab = pSlab->pNextSlab;
+                pSlab->pNextSlab = pNextSlab;
+            }
+            else
+            {
+                pNextSlab->pNextSlab = arena->pFirstSlab;
+                arena->pFirstSlab = pNextSlab;
+            }
+        }
+        pSlab = arena->pCurrentSlab = pNextSlab;
+    }
+    pBlock = (ArenaBlock*)((byte*)pSlab + pSlab->used);
+    pBlock->size = blockSize - BLOCK_HEADER_SIZE;
+    pBlock->previousBlock = pSlab->lastBlock;
+    pSlab->lastBlock = pSlab->used;
+    pSlab->used += blockSize;
+    arena->bytesInUse += blockSize;
+    if (arena->bytesInUse > arena->highWaterMark)
+    {
+        arena->highWaterMark = arena->bytesInUse;
+    }
+    return (byte*)pBlock + BLOCK_HEADER_SIZE;
+}
+
+static ArenaBlock* JSON_Arena_GetLastBlock(JSON_Arena arena, void* ptr)
+{
+    /* Only the most recent block in the current slab can be reclaimed or
+       grown in place. */
+    ArenaSlab* pSlab = arena->pCurrentSlab;
+    if (pSlab && pSlab->lastBlock != NO_BLOCK && (byte*)pSlab + pSlab->lastBlock + BLOCK_HEADER_SIZE == (byte*)ptr)
+    {
+        return (ArenaBlock*)((byte*)pSlab + pSlab->lastBlock);
+    }
+    return NULL;
+}
+
+static void* JSON_CALL ArenaReallocHandler(void* userData, void* ptr, size_t size)
+{
+    JSON_Arena arena = (JSON_Arena)userData;
+    ArenaBlock* pBlock;
+    void* pNewBlock;
+    if (!ptr)
+    {
+        return JSON_Arena_Allocate(arena, size);
+    }
+    pBlock = (ArenaBlock*)((byte*)ptr - BLOCK_HEADER_SIZE);
+    if (size <= pBlock->size)
+    {
+        return ptr;
+    }
+    if (pBlock == JSON_Arena_GetLastBlock(arena, ptr))
+    {
+        ArenaSlab* pSlab = arena->pCurrentSlab;
+        size_t growth;
+        if (size <= SIZE_MAX - ARENA_ALIGNMENT)
+        {
+            growth = ARENA_ALIGN(size) - pBlock->size;
+            if (pSlab->size - pSlab->used >= growth)
+            {
+                pBlock->size += growth;
+                pSlab->used += growth;
+                arena->bytesInUse += growth;
+                if (arena->bytesInUse > arena->highWaterMark)
+                {
+                    arena->highWaterMark = arena->bytesInUse;
+                }
+                return ptr;
+            }
+        }
+    }
+    pNewBlock = JSON_Arena_Allocate(arena, size);
+    if (pNewBlock)
+    {
+        memcpy(pNewBlock, ptr, pBlock->size);
+    }
+    return pNewBlock;
+}
+
+static void JSON_CALL ArenaFreeHandler(void* userData, void* ptr)
+{
+    JSON_Arena arena = (JSON_Arena)userData;
+    ArenaBlock* pBlock = ptr ? JSON_Arena_GetLastBlock(arena, ptr) : NULL;
+    if (pBlock)
+    {
+        ArenaSlab* pSlab = arena->pCurrentSlab;
+        arena->bytesInUse -= pSlab->used - pSlab->lastBlock;
+        pSlab->used = pSlab->lastBlock;
+        pSlab->lastBlock = pBlock->previousBlock;
+    }
+}
+
+JSON_Arena JSON_CALL JSON_Arena_Create(const JSON_MemorySuite* pMemorySuite, size_t slabSize)
+{
+    JSON_Arena arena;
+    JSON_MemorySuite memorySuite;
+    if (pMemorySuite)
+    {
+        memorySuite = *pMemorySuite;
+        if (!memorySuite.realloc || !memorySuite.free)
+        {
+            /* The full memory suite must be specified. */
+            return NULL;
+        }
+    }
+    else
+    {
+        memorySuite = defaultMemorySuite;
+    }
+    arena = (JSON_Arena)memorySuite.realloc(memorySuite.userData, NULL, sizeof(struct JSON_Arena_Data));
+    if (!arena)
+    {
+        return NULL;
+    }
+    arena->memorySuite = memorySuite;
+    arena->arenaSuite.userData = arena;
+    arena->arenaSuite.realloc = &ArenaReallocHandler;
+    arena->arenaSuite.free = &ArenaFreeHandler;
+    arena->slabSize = slabSize ? slabSize : DEFAULT_SLAB_SIZE;
+    arena->pFirstSlab = NULL;
+    arena->pCurrentSlab = NULL;
+    arena->bytesInUse = 0;
+    arena->highWaterMark = 0;
+    return arena;
+}
+
+JSON_Status JSON_CALL JSON_Arena_Free(JSON_Arena arena)
+{
+    if (!arena)
+    {
+        return JSON_Failure;
+    }
+    while (arena->pFirstSlab)
+    {
+        ArenaSlab* pSlab = arena->pFirstSlab;
+        arena->pFirstSlab = pSlab->pNextSlab;
+        arena->memorySuite.free(arena->memorySuite.userData, pSlab);
+    }
+    arena->memorySuite.free(arena->memorySuite.userData, arena);
+    return JSON_Success;
+}
+
+JSON_Status JSON_CALL JSON_Arena_Reset(JSON_Arena arena)
+{
+    ArenaSlab* pSlab;
+    if (!arena)
+    {
+        return JSON_Failure;
+    }
+    for (pSlab = arena->pFirstSlab; pSlab; pSlab = pSlab->pNextSlab)
+    {
+        pSlab->used = SLAB_HEADER_SIZE;
+        pSlab->lastBlock = NO_BLOCK;
+    }
+    arena->pCurrentSlab = arena->pFirstSlab;
+    arena->bytesInUse = 0;
+    return JSON_Success;
+}
+
+const JSON_MemorySuite* JSON_CALL JSON_Arena_GetMemorySuite(JSON_Arena arena)
+{
+    return arena ? &arena->arenaSuite : NULL;
+}
+
+size_t JSON_CALL JSON_Arena_GetHighWaterMark(JSON_Arena arena)
+{
+    return arena ? arena->highWaterMark : 0;
+}
+
+/******************** Instance Pools ********************/
+
+/* Mutually-exclusive pool slot states. */
+#define SLOT_EMPTY    0 /* no instance has been created for the slot */
+#define SLOT_IDLE     1 /* the slot's instance is waiting to be acquired */
+#define SLOT_ACQUIRED 2 /* the slot is owned by the thread that acquired it */
+
+/* A pool slot. Only the thread that moved a slot to SLOT_ACQUIRED may
+   touch its instance until it moves the slot out of that state again. */
+typedef struct tag_PoolSlot
+{
+    volatile long state;
+    void*         pInstance;
+} PoolSlot;
+
+/* The part of a parser or writer pool that does not depend on the kind of
+   instance it holds. It is the first member of either kind of pool, and
+   the slots follow the pool in the same block of memory. */
+typedef struct tag_InstancePool
+{
+    JSON_MemorySuite memorySuite;
+    size_t           capacity;
+    PoolSlot*        pSlots;
+} InstancePool;
+
+#if defined(JSON_ATOMICS_GCC)
+
+static long LoadSlotState(const volatile long* pState)
+{
+    return __atomic_load_n(pState, __ATOMIC_RELAXED);
+}
+
+static int ExchangeSlotState(volatile long* pState, long expected, long desired)
+{
+    return __atomic_compare_exchange_n(pState, &expected, desired, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void StoreSlotState(volatile long* pState, long state)
+{
+    __atomic_store_n(pState, state, __ATOMIC_RELEASE);
+}
+
+#elif defined(JSON_ATOMICS_MSVC)
+
+static long LoadSlotState(const volatile long* pState)
+{
+    return *pState;
+}
+
+static int ExchangeSlotState(volatile long* pState, long expected, long desired)
+{
+    return _InterlockedCompareExchange(pState, desired, expected) == expected;
+}
+
+static void StoreSlotState(volatile long* pState, long state)
+{
+    _InterlockedExchange(pState, state);
+}
+
+#else
+
+/* Without atomic operations, pools can't be created (see
+   InstancePool_Create()), so these are never called. */
+
+static long LoadSlotState(const volatile long* pState)
+{
+    return *pState;
+}
+
+static int ExchangeSlotState(volatile long* pState, long expected, long desired)
+{
+    if (*pState != expected)
+    {
+        return 0;
+    }
+    *pState = desired;
+    return 1;
+}
+
+static void StoreSlotState(volatile long* pState, long state)
+{
+    *pState = state;
+}
+
+#endif
+
+static InstancePool* InstancePool_Create(const JSON_MemorySuite* pMemorySuite, size_t poolSize, size_t capacity)
+{
+#if defined(JSON_ATOMICS_GCC) || defined(JSON_ATOMICS_MSVC)
+    InstancePool* pPool;
+    JSON_MemorySuite memorySuite;
+    size_t i;
+    if (pMemorySuite)
+    {
+        memorySuite = *pMemorySuite;
+        if (!memorySuite.realloc || !memorySuite.free)
+        {
+            /* The full memory suite must be specified. */
+            return NULL;
+        }
+    }
+    else
+    {
+        memorySuite = defaultMemorySuite;
+    }
+    poolSize = ARENA_ALIGN(poolSize);
+    if (!capacity || capacity > (SIZE_MAX - poolSize) / sizeof(PoolSlot))
+    {
+        return NULL;
+    }
+    pPool = (InstancePool*)memorySuite.realloc(memorySuite.userData, NULL, poolSize + capacity * sizeof(PoolSlot));
+    if (!pPool)
+    {
+        return NULL;
+    }
+    pPool->memorySuite = memorySuite;
+    pPool->capacity = capacity;
+    pPool->pSlots = (PoolSlot*)((byte*)pPool + poolSize);
+    for (i = 0; i < capacity; i++)
+    {
+        pPool->pSlots[i].state = SLOT_EMPTY;
+        pPool->pSlots[i].pInstance = NULL;
+    }
+    return pPool;
+#else
+    /* Without atomic operations, a pool can't be shared safely. */
+    (void)pMemorySuite; /* unused */
+    (void)poolSize; /* unused */
+    (void)capacity; /* unused */
+    return NULL;
+#endif
+}
+
+static size_t InstancePool_AcquireSlot(InstancePool* pPool)
+{
+    /* Instances that are already created are preferred to empty slots.
+       The index of the acquired slot is returned, or the capacity if
+       every slot is already acquired. */
+    size_t i;
+    for (i = 0; i < pPool->capacity; i++)
+    {
+        if (LoadSlotState(&pPool->pSlots[i].state) == SLOT_IDLE &&
+            ExchangeSlotState(&pPool->pSlots[i].state, SLOT_IDLE, SLOT_ACQUIRED))
+        {
+            return i;
+        }
+    }
+    for (i = 0; i < pPool->capacity; i++)
+    {
+        if (LoadSlotState(&pPool->pSlots[i].state) == SLOT_EMPTY &&
+            ExchangeSlotState(&pPool->pSlots[i].state, SLOT_EMPTY, SLOT_ACQUIRED))
+        {
+            return i;
+        }
+    }
+    return pPool->capacity;
+}
+
+static void InstancePool_ReleaseSlot(InstancePool* pPool, size_t slot, void* pInstance)
+{
+    pPool->pSlots[slot].pInstance = pInstance;
+    StoreSlotState(&pPool->pSlots[slot].state, pInstance ? SLOT_IDLE : SLOT_EMPTY);
+}
+
+static int InstancePool_HasAcquiredSlots(const InstancePool* pPool)
+{
+    size_t i;
+    for (i = 0; i < pPool->capacity; i++)
+    {
+        if (LoadSlotState(&pPool->pSlots[i].state) == SLOT_ACQUIRED)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void InstancePool_Free(InstancePool* pPool)
+{
+    pPool->memorySuite.free(pPool->memorySuite.userData, pPool);
+}
+
 /******************** Unicode Decoder ********************/
 
 /* Mutually-exclusive decoder states. */
@@ -653,2532 +1148,9127 @@ static size_t EncodeCodepoint(Codepoint c, Encoding encoding, byte* pBytes)
     return length;
 }
 
-/******************** JSON Lexer States ********************/
+/******************** Byte Scanning ********************/
 
-/* Mutually-exclusive lexer states. */
-#define LEXING_WHITESPACE                                     0
-#define LEXING_LITERAL                                        1
-#define LEXING_STRING                                         2
-#define LEXING_STRING_ESCAPE                                  3
-#define LEXING_STRING_HEX_ESCAPE_BYTE_1                       4
-#define LEXING_STRING_HEX_ESCAPE_BYTE_2                       5
-#define LEXING_STRING_HEX_ESCAPE_BYTE_3                       6
-#define LEXING_STRING_HEX_ESCAPE_BYTE_4                       7
-#define LEXING_STRING_HEX_ESCAPE_BYTE_5                       8
-#define LEXING_STRING_HEX_ESCAPE_BYTE_6                       9
-#define LEXING_STRING_HEX_ESCAPE_BYTE_7                       10
-#define LEXING_STRING_HEX_ESCAPE_BYTE_8                       11
-#define LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_BACKSLASH 12
-#define LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_U         13
-#define LEXING_NUMBER_AFTER_MINUS                             14
-#define LEXING_NUMBER_AFTER_LEADING_ZERO                      15
-#define LEXING_NUMBER_AFTER_LEADING_NEGATIVE_ZERO             16
-#define LEXING_NUMBER_AFTER_X                                 17
-#define LEXING_NUMBER_HEX_DIGITS                              18
-#define LEXING_NUMBER_DECIMAL_DIGITS                          19
-#define LEXING_NUMBER_AFTER_DOT                               20
-#define LEXING_NUMBER_FRACTIONAL_DIGITS                       21
-#define LEXING_NUMBER_AFTER_E                                 22
-#define LEXING_NUMBER_AFTER_EXPONENT_SIGN                     23
-#define LEXING_NUMBER_EXPONENT_DIGITS                         24
-#define LEXING_COMMENT_AFTER_SLASH                            25
-#define LEXING_SINGLE_LINE_COMMENT                            26
-#define LEXING_MULTI_LINE_COMMENT                             27
-#define LEXING_MULTI_LINE_COMMENT_AFTER_STAR                  28
-#define LEXER_ERROR                                           255
-typedef byte LexerState;
+#ifndef JSON_NO_PARSER
 
-/******************** JSON Grammarian ********************/
+/* Scanning functions examine a run of UTF-8 input and return the length of
+   its longest prefix consisting only of bytes of a particular class. When
+   SIMD instructions are available, 16 or 32 bytes are classified at once and
+   the first non-matching byte is located from the resulting bitmask. */
 
-/* The JSON grammar comprises the following productions:
+#ifdef JSON_SIMD_SSE2
 
-   1.  VALUE => null
-   2.  VALUE => boolean
-   3.  VALUE => string
-   4.  VALUE => number
-   5.  VALUE => specialnumber
-   6.  VALUE => { MEMBERS }
-   7.  VALUE => [ ITEMS ]
-   8.  MEMBERS => MEMBER MORE_MEMBERS
-   9.  MEMBERS => e
-   10. MEMBER => string : VALUE
-   11. MORE_MEMBERS => , MEMBER MORE_MEMBERS
-   12. MORE_MEMBERS => e
-   13. ITEMS => ITEM MORE_ITEMS
-   14. ITEMS => e
-   15. ITEM => VALUE
-   16. MORE_ITEMS => , ITEM MORE_ITEMS
-   17. MORE_ITEMS => e
-
-   We implement a simple LL(1) parser based on this grammar, with events
-   emitted when certain non-terminals are replaced.
-*/
-
-/* Mutually-exclusive grammar tokens and non-terminals. The values are defined
-   so that the bottom 4 bits of a value can be used as an index into the
-   grammar production rule table. */
-#define T_NONE              0x00 /* tokens are in the form 0x0X */
-#define T_NULL              0x01
-#define T_TRUE              0x02
-#define T_FALSE             0x03
-#define T_STRING            0x04
-#define T_NUMBER            0x05
-#define T_NAN               0x06
-#define T_INFINITY          0x07
-#define T_NEGATIVE_INFINITY 0x08
-#define T_LEFT_CURLY        0x09
-#define T_RIGHT_CURLY       0x0A
-#define T_LEFT_SQUARE       0x0B
-#define T_RIGHT_SQUARE      0x0C
-#define T_COLON             0x0D
-#define T_COMMA             0x0E
-#define NT_VALUE            0x10 /* non-terminals are in the form 0x1X */
-#define NT_MEMBERS          0x11
-#define NT_MEMBER           0x12
-#define NT_MORE_MEMBERS     0x13
-#define NT_ITEMS            0x14
-#define NT_ITEM             0x15
-#define NT_MORE_ITEMS       0x16
-typedef byte Symbol;
-
-#define IS_NONTERMINAL(s) ((s) & 0x10)
-#define IS_TOKEN(s)       !IS_NONTERMINAL(s)
-
-/* Grammarian data. */
-typedef struct tag_GrammarianData
+static size_t LowestSetBit(unsigned int mask)
 {
-    Symbol* pStack; /* initially set to defaultStack */
-    size_t  stackSize;
-    size_t  stackUsed;
-    Symbol  defaultStack[DEFAULT_SYMBOL_STACK_SIZE];
-} GrammarianData;
-typedef GrammarianData* Grammarian;
-
-/* Mutually-exclusive result codes returned by the grammarian
-   after processing a token. */
-#define ACCEPTED_TOKEN    0
-#define REJECTED_TOKEN    1
-#define SYMBOL_STACK_FULL 2
-typedef uint32_t GrammarianResultCode;
+#if defined(__GNUC__)
+    return (size_t)__builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (size_t)index;
+#else
+    size_t index = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
 
-/* Events emitted by the grammarian as a result of processing a
-   token. Note that EMIT_ARRAY_ITEM always appears bitwise OR-ed
-   with one of the other values. */
-#define EMIT_NOTHING        0x00
-#define EMIT_NULL           0x01
-#define EMIT_BOOLEAN        0x02
-#define EMIT_STRING         0x03
-#define EMIT_NUMBER         0x04
-#define EMIT_SPECIAL_NUMBER 0x05
-#define EMIT_START_OBJECT   0x06
-#define EMIT_END_OBJECT     0x07
-#define EMIT_OBJECT_MEMBER  0x08
-#define EMIT_START_ARRAY    0x09
-#define EMIT_END_ARRAY      0x0A
-#define EMIT_ARRAY_ITEM     0x10 /* may be combined with other values */
-typedef byte GrammarEvent;
+static size_t HighestSetBit(unsigned int mask)
+{
+#if defined(__GNUC__)
+    return (size_t)(31 - __builtin_clz(mask));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, mask);
+    return (size_t)index;
+#else
+    size_t index = 0;
+    while (mask >>= 1)
+    {
+        index++;
+    }
+    return index;
+#endif
+}
 
-/* The bits of GrammarianOutput are layed out as follows:
+static size_t PopCount(unsigned int mask)
+{
+#if defined(__GNUC__)
+    return (size_t)__builtin_popcount(mask);
+#else
+    mask = mask - ((mask >> 1) & 0x55555555U);
+    mask = (mask & 0x33333333U) + ((mask >> 2) & 0x33333333U);
+    return (size_t)((((mask + (mask >> 4)) & 0x0F0F0F0FU) * 0x01010101U) >> 24);
+#endif
+}
 
-     -rreeeee
+#endif /* JSON_SIMD_SSE2 */
 
-     - = unused (1 bit)
-     r = result code (2 bits)
-     e = event (5 bits)
- */
-#define GRAMMARIAN_OUTPUT(r, e)   (GrammarianOutput)(((GrammarianResultCode)(r) << 5) | (GrammarEvent)(e))
-#define GRAMMARIAN_RESULT_CODE(o) (GrammarianResultCode)((GrammarianOutput)(o) >> 5)
-#define GRAMMARIAN_EVENT(o)       (GrammarEvent)((GrammarianOutput)(o) & 0x1F)
-typedef byte GrammarianOutput;
+/* Returns the length of the longest prefix of ASCII bytes (0x00 - 0x7F). */
+static size_t ScanASCIIBytes(const byte* pBytes, size_t length)
+{
+    size_t i = 0;
+#ifdef JSON_SIMD_AVX2
+    while (i + 32 <= length)
+    {
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(pBytes + i)));
+        if (mask)
+        {
+            return i + LowestSetBit(mask);
+        }
+        i += 32;
+    }
+#endif
+#ifdef JSON_SIMD_SSE2
+    while (i + 16 <= length)
+    {
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(pBytes + i)));
+        if (mask)
+        {
+            return i + LowestSetBit(mask);
+        }
+        i += 16;
+    }
+#endif
+    while (i < length && IS_UTF8_SINGLE_BYTE(pBytes[i]))
+    {
+        i++;
+    }
+    return i;
+}
 
-/* Grammar rule used by the grammarian to process a token. */
-typedef struct tag_GrammarRule
+/* The line-breaking effects of a run of whitespace: the number of lines
+   begun within the run, the offset just past the run's last CR or LF (or
+   SIZE_MAX if it contains neither), and whether the byte preceding the
+   unscanned input is a CR. A CR always begins a new line, and so does an LF
+   unless it immediately follows a CR. */
+typedef struct tag_WhitespaceScan
 {
-    Symbol       symbolToPush1;
-    Symbol       symbolToPush2;
-    byte         reprocess;
-    GrammarEvent emit;
-} GrammarRule;
+    size_t lineBreaks;
+    size_t lineStart;
+    int    afterCarriageReturn;
+} WhitespaceScan;
 
-/* Grammarian functions. */
+#ifdef JSON_SIMD_SSE2
 
-static void Grammarian_Reset(Grammarian grammarian, int isInitialized)
+/* Processes a block of up to 32 bytes classified into bitmasks (bit N
+   corresponds to the byte at offset + N) and returns the number of
+   whitespace bytes at the start of the block. */
+static size_t ScanWhitespaceBlock(WhitespaceScan* pScan, size_t offset, size_t blockLength, unsigned int stopMask, unsigned int carriageReturnMask, unsigned int lineFeedMask)
 {
-    /* When we reset the grammarian, we keep the symbol stack that has
-       already been allocated, if any. If the client wants to reclaim the
-       memory used by the that buffer, he needs to free the grammarian
-       and create a new one. */
-    if (!isInitialized)
+    size_t span = stopMask ? LowestSetBit(stopMask) : blockLength;
+    unsigned int spanMask = (span < 32) ? (1U << span) - 1U : ~0U;
+    carriageReturnMask &= spanMask;
+    lineFeedMask &= spanMask;
+    if (carriageReturnMask | lineFeedMask)
     {
-        grammarian->pStack = grammarian->defaultStack;
-        grammarian->stackSize = sizeof(grammarian->defaultStack);
+        unsigned int afterCarriageReturnMask = (carriageReturnMask << 1) | (pScan->afterCarriageReturn ? 1U : 0U);
+        pScan->lineBreaks += PopCount(carriageReturnMask) + PopCount(lineFeedMask & ~afterCarriageReturnMask);
+        pScan->lineStart = offset + HighestSetBit(carriageReturnMask | lineFeedMask) + 1;
     }
-
-    /* The grammarian always starts with NT_VALUE on the symbol stack. */
-    grammarian->pStack[0] = NT_VALUE;
-    grammarian->stackUsed = 1;
+    if (span)
+    {
+        pScan->afterCarriageReturn = (int)((carriageReturnMask >> (span - 1)) & 1U);
+    }
+    return span;
 }
 
-static void Grammarian_FreeAllocations(Grammarian grammarian, const JSON_MemorySuite* pMemorySuite)
+#endif /* JSON_SIMD_SSE2 */
+
+/* Returns the length of the longest prefix of whitespace bytes (space, tab,
+   CR and LF), accumulating its line-breaking effects into *pScan. */
+static size_t ScanWhitespaceBytes(const byte* pBytes, size_t length, WhitespaceScan* pScan)
 {
-    if (grammarian->pStack != grammarian->defaultStack)
+    size_t i = 0;
+#ifdef JSON_SIMD_AVX2
+    {
+        const __m256i spaces32 = _mm256_set1_epi8(' ');
+        const __m256i tabs32 = _mm256_set1_epi8(TAB_CODEPOINT);
+        const __m256i carriageReturns32 = _mm256_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m256i lineFeeds32 = _mm256_set1_epi8(LINE_FEED_CODEPOINT);
+        while (i + 32 <= length)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(pBytes + i));
+            __m256i carriageReturns = _mm256_cmpeq_epi8(v, carriageReturns32);
+            __m256i lineFeeds = _mm256_cmpeq_epi8(v, lineFeeds32);
+            __m256i whitespace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, spaces32), _mm256_cmpeq_epi8(v, tabs32)), _mm256_or_si256(carriageReturns, lineFeeds));
+            size_t span = ScanWhitespaceBlock(pScan, i, 32,
+                                              ~(unsigned int)_mm256_movemask_epi8(whitespace),
+                                              (unsigned int)_mm256_movemask_epi8(carriageReturns),
+                                              (unsigned int)_mm256_movemask_epi8(lineFeeds));
+            i += span;
+            if (span < 32)
+            {
+                return i;
+            }
+        }
+    }
+#endif
+#ifdef JSON_SIMD_SSE2
+    {
+        const __m128i spaces = _mm_set1_epi8(' ');
+        const __m128i tabs = _mm_set1_epi8(TAB_CODEPOINT);
+        const __m128i carriageReturns16 = _mm_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds16 = _mm_set1_epi8(LINE_FEED_CODEPOINT);
+        while (i + 16 <= length)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pBytes + i));
+            __m128i carriageReturns = _mm_cmpeq_epi8(v, carriageReturns16);
+            __m128i lineFeeds = _mm_cmpeq_epi8(v, lineFeeds16);
+            __m128i whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, spaces), _mm_cmpeq_epi8(v, tabs)), _mm_or_si128(carriageReturns, lineFeeds));
+            size_t span = ScanWhitespaceBlock(pScan, i, 16,
+                                              ~(unsigned int)_mm_movemask_epi8(whitespace) & 0xFFFFU,
+                                              (unsigned int)_mm_movemask_epi8(carriageReturns),
+                                              (unsigned int)_mm_movemask_epi8(lineFeeds));
+            i += span;
+            if (span < 16)
+            {
+                return i;
+            }
+        }
+    }
+#endif
+    while (i < length)
     {
-        pMemorySuite->free(pMemorySuite->userData, grammarian->pStack);
+        byte b = pBytes[i];
+        if (b == LINE_FEED_CODEPOINT)
+        {
+            if (!pScan->afterCarriageReturn)
+            {
+                pScan->lineBreaks++;
+            }
+            pScan->lineStart = i + 1;
+            pScan->afterCarriageReturn = 0;
+        }
+        else if (b == CARRIAGE_RETURN_CODEPOINT)
+        {
+            pScan->lineBreaks++;
+            pScan->lineStart = i + 1;
+            pScan->afterCarriageReturn = 1;
+        }
+        else if (b == ' ' || b == TAB_CODEPOINT)
+        {
+            pScan->afterCarriageReturn = 0;
+        }
+        else
+        {
+            break;
+        }
+        i++;
     }
+    return i;
 }
 
-static int Grammarian_FinishedDocument(Grammarian grammarian)
+/* Returns the length of the longest prefix of ASCII bytes, accumulating its
+   line-breaking effects into *pScan. */
+static size_t ScanASCIILineBreaks(const byte* pBytes, size_t length, WhitespaceScan* pScan)
 {
-    return !grammarian->stackUsed;
+    size_t i = 0;
+#ifdef JSON_SIMD_AVX2
+    {
+        const __m256i carriageReturns32 = _mm256_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m256i lineFeeds32 = _mm256_set1_epi8(LINE_FEED_CODEPOINT);
+        while (i + 32 <= length)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(pBytes + i));
+            size_t span = ScanWhitespaceBlock(pScan, i, 32,
+                                              (unsigned int)_mm256_movemask_epi8(v),
+                                              (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, carriageReturns32)),
+                                              (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lineFeeds32)));
+            i += span;
+            if (span < 32)
+            {
+                return i;
+            }
+        }
+    }
+#endif
+#ifdef JSON_SIMD_SSE2
+    {
+        const __m128i carriageReturns16 = _mm_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds16 = _mm_set1_epi8(LINE_FEED_CODEPOINT);
+        while (i + 16 <= length)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pBytes + i));
+            size_t span = ScanWhitespaceBlock(pScan, i, 16,
+                                              (unsigned int)_mm_movemask_epi8(v),
+                                              (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, carriageReturns16)),
+                                              (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lineFeeds16)));
+            i += span;
+            if (span < 16)
+            {
+                return i;
+            }
+        }
+    }
+#endif
+    while (i < length && IS_UTF8_SINGLE_BYTE(pBytes[i]))
+    {
+        byte b = pBytes[i];
+        if (b == CARRIAGE_RETURN_CODEPOINT || (b == LINE_FEED_CODEPOINT && !pScan->afterCarriageReturn))
+        {
+            pScan->lineBreaks++;
+        }
+        if (b == CARRIAGE_RETURN_CODEPOINT || b == LINE_FEED_CODEPOINT)
+        {
+            pScan->lineStart = i + 1;
+        }
+        pScan->afterCarriageReturn = (b == CARRIAGE_RETURN_CODEPOINT);
+        i++;
+    }
+    return i;
 }
 
-static GrammarianOutput Grammarian_ProcessToken(Grammarian grammarian, Symbol token, const JSON_MemorySuite* pMemorySuite)
+/* The codepoint counting functions below accept runs of valid input in
+   which every codepoint is complete. They count the units (bytes, or UTF-16
+   or UTF-32 code units) that do not begin a codepoint, both in total and
+   since the run's last line break, in order to convert the run's length and
+   the offset of its last line start from units to codepoints. */
+typedef struct tag_CodepointCount
 {
-    /* The order and number of the rows and columns in this table must
-       match the defined token and non-terminal symbol values.
+    size_t trailingUnits;
+    size_t trailingUnitsSinceLineStart;
+} CodepointCount;
 
-       The row index is the incoming token's Symbol value.
+#ifdef JSON_SIMD_SSE2
 
-       The column index is the bottom 4 bits of Symbol value of
-       the non-terminal at the top of the processing stack.
-       Since non-terminal Symbol values start at 0x10, taking
-       the bottom 4 bits yields a 0-based index. */
-    static const byte ruleLookup[15][7] =
+/* Processes a block of up to 32 units classified into bitmasks (bit N
+   corresponds to the unit at offset + N). */
+static void CountCodepointsBlock(WhitespaceScan* pScan, CodepointCount* pCount, size_t offset, size_t blockLength, unsigned int carriageReturnMask, unsigned int lineFeedMask, unsigned int trailingMask)
+{
+    size_t trailingUnits = trailingMask ? PopCount(trailingMask) : 0;
+    pCount->trailingUnits += trailingUnits;
+    if (carriageReturnMask | lineFeedMask)
     {
-        /*             V     MS    M     MM    IS    I     MI  */
-        /*  ----  */ { 0,    0,    0,    0,    0,    0,    0  },
-        /*  null  */ { 1,    0,    0,    0,    13,   15,   0  },
-        /*  true  */ { 2,    0,    0,    0,    13,   15,   0  },
-        /* false  */ { 2,    0,    0,    0,    13,   15,   0  },
-        /* string */ { 3,    8,    10,   0,    13,   15,   0  },
-        /* number */ { 4,    0,    0,    0,    13,   15,   0  },
-        /*  NaN   */ { 5,    0,    0,    0,    13,   15,   0  },
-        /*  Inf   */ { 5,    0,    0,    0,    13,   15,   0  },
-        /* -Inf   */ { 5,    0,    0,    0,    13,   15,   0  },
-        /*   {    */ { 6,    0,    0,    0,    13,   15,   0  },
-        /*   }    */ { 0,    9,    0,    12,   0,    0,    0  },
-        /*   [    */ { 7,    0,    0,    0,    13,   15,   0  },
-        /*   ]    */ { 0,    0,    0,    0,    14,   0,    17 },
-        /*   :    */ { 0,    0,    0,    0,    0,    0,    0  },
-        /*   ,    */ { 0,    0,    0,    11,   0,    0,    16 }
-    };
-
-    static const GrammarRule rules[17] =
+        size_t shift;
+        ScanWhitespaceBlock(pScan, offset, blockLength, 0, carriageReturnMask, lineFeedMask);
+        shift = pScan->lineStart - offset;
+        pCount->trailingUnitsSinceLineStart = (shift < 32) ? PopCount(trailingMask >> shift) : 0;
+    }
+    else
     {
-        /* 1.  */ { T_NONE,          T_NONE,      0, EMIT_NULL           },
-        /* 2.  */ { T_NONE,          T_NONE,      0, EMIT_BOOLEAN        },
-        /* 3.  */ { T_NONE,          T_NONE,      0, EMIT_STRING         },
-        /* 4.  */ { T_NONE,          T_NONE,      0, EMIT_NUMBER         },
-        /* 5.  */ { T_NONE,          T_NONE,      0, EMIT_SPECIAL_NUMBER },
-        /* 6.  */ { T_RIGHT_CURLY,   NT_MEMBERS,  0, EMIT_START_OBJECT   },
-        /* 7.  */ { T_RIGHT_SQUARE,  NT_ITEMS,    0, EMIT_START_ARRAY    },
-        /* 8.  */ { NT_MORE_MEMBERS, NT_MEMBER,   1, EMIT_NOTHING        },
-        /* 9.  */ { T_NONE,          T_NONE,      1, EMIT_END_OBJECT     },
-        /* 10. */ { NT_VALUE,        T_COLON,     0, EMIT_OBJECT_MEMBER  },
-        /* 11. */ { NT_MORE_MEMBERS, NT_MEMBER,   0, EMIT_NOTHING        },
-        /* 12. */ { T_NONE,          T_NONE,      1, EMIT_END_OBJECT     },
-        /* 13. */ { NT_MORE_ITEMS,   NT_ITEM,     1, EMIT_NOTHING        },
-        /* 14. */ { T_NONE,          T_NONE,      1, EMIT_END_ARRAY      },
-        /* 15. */ { NT_VALUE,        T_NONE,      1, EMIT_ARRAY_ITEM     },
-        /* 16. */ { NT_MORE_ITEMS,   NT_ITEM,     0, EMIT_NOTHING        },
-        /* 17. */ { T_NONE,          T_NONE,      1, EMIT_END_ARRAY      }
-    };
+        pCount->trailingUnitsSinceLineStart += trailingUnits;
+        pScan->afterCarriageReturn = 0;
+    }
+}
 
-    GrammarEvent emit = EMIT_NOTHING;
+#endif /* JSON_SIMD_SSE2 */
 
-    /* If the stack is empty, no more tokens were expected. */
-    if (Grammarian_FinishedDocument(grammarian))
+static void CountCodepointsUnit(WhitespaceScan* pScan, CodepointCount* pCount, size_t offset, Codepoint unit, int isTrailing)
+{
+    if (isTrailing)
     {
-        return GRAMMARIAN_OUTPUT(REJECTED_TOKEN, EMIT_NOTHING);
+        pCount->trailingUnits++;
+        pCount->trailingUnitsSinceLineStart++;
     }
-
-    for (;;)
+    else if (unit == CARRIAGE_RETURN_CODEPOINT || unit == LINE_FEED_CODEPOINT)
     {
-        Symbol topSymbol = grammarian->pStack[grammarian->stackUsed - 1];
-        if (IS_TOKEN(topSymbol))
+        if (unit == CARRIAGE_RETURN_CODEPOINT || !pScan->afterCarriageReturn)
         {
-            if (topSymbol != token)
-            {
-                return GRAMMARIAN_OUTPUT(REJECTED_TOKEN, EMIT_NOTHING);
-            }
-            grammarian->stackUsed--;
-            break;
-        }
-        else
-        {
-            byte ruleNumber = ruleLookup[token][BOTTOM_4_BITS(topSymbol)];
-            if (ruleNumber == 0)
-            {
-                return GRAMMARIAN_OUTPUT(REJECTED_TOKEN, EMIT_NOTHING);
-            }
-            else
-            {
-                const GrammarRule* pRule = &rules[ruleNumber - 1];
-                if (pRule->symbolToPush1 == T_NONE)
-                {
-                    /* The rule removes the top symbol and does not replace it. */
-                    grammarian->stackUsed--;
-                }
-                else
-                {
-                    /* The rule replaces the top symbol with 1 or 2 symbols. */
-                    grammarian->pStack[grammarian->stackUsed - 1] = pRule->symbolToPush1;
-                    if (pRule->symbolToPush2 != T_NONE)
-                    {
-                        /* The rule replaces the top symbol with 2 symbols.
-                           Make sure the stack has room for the second one. */
-                        if (grammarian->stackUsed == grammarian->stackSize)
-                        {
-                            Symbol* pBiggerStack = DoubleBuffer(pMemorySuite, grammarian->defaultStack, grammarian->pStack, grammarian->stackSize);
-                            if (!pBiggerStack)
-                            {
-                                return GRAMMARIAN_OUTPUT(SYMBOL_STACK_FULL, EMIT_NOTHING);
-                            }
-                            grammarian->pStack = pBiggerStack;
-                            grammarian->stackSize *= 2;
-                        }
-                        grammarian->pStack[grammarian->stackUsed] = pRule->symbolToPush2;
-                        grammarian->stackUsed++;
-                    }
-                }
-                emit |= pRule->emit;
-                if (!pRule->reprocess)
-                {
-                    break;
-                }
-            }
+            pScan->lineBreaks++;
         }
+        pScan->lineStart = offset + 1;
+        pCount->trailingUnitsSinceLineStart = 0;
     }
-
-    return GRAMMARIAN_OUTPUT(ACCEPTED_TOKEN, emit);
-}
-
-/******************** JSON Parser ********************/
-
-#ifndef JSON_NO_PARSER
-
-/* Combinable parser state flags. */
-#define PARSER_RESET                 0x00
-#define PARSER_STARTED               0x01
-#define PARSER_FINISHED              0x02
-#define PARSER_IN_PROTECTED_API      0x04
-#define PARSER_IN_TOKEN_HANDLER      0x08
-#define PARSER_AFTER_CARRIAGE_RETURN 0x10
-typedef byte ParserState;
-
-/* Combinable parser settings flags. */
-#define PARSER_DEFAULT_FLAGS         0x00
-#define PARSER_ALLOW_BOM             0x01
-#define PARSER_ALLOW_COMMENTS        0x02
-#define PARSER_ALLOW_SPECIAL_NUMBERS 0x04
-#define PARSER_ALLOW_HEX_NUMBERS     0x08
-#define PARSER_REPLACE_INVALID       0x10
-#define PARSER_TRACK_OBJECT_MEMBERS  0x20
-#define PARSER_ALLOW_CONTROL_CHARS   0x40
-#define PARSER_EMBEDDED_DOCUMENT     0x80
-typedef byte ParserFlags;
-
-/* Sentinel value for parser error location offset. */
-#define ERROR_LOCATION_IS_TOKEN_START 0xFF
-
-/* An object member name stored in an unordered, singly-linked-list, used for
-   detecting duplicate member names. Note that the name string is not null-
-   terminated. */
-typedef struct tag_MemberName
-{
-    struct tag_MemberName* pNextName;
-    size_t                 length;
-    byte                   pBytes[1]; /* variable-size buffer */
-} MemberName;
-
-/* An object's list of member names, and a pointer to the object's
-   nearest ancestor object, if any. This is used as a stack. Because arrays
-   do not have named items, they do not need to be recorded in the stack. */
-typedef struct tag_MemberNames
-{
-    struct tag_MemberNames* pAncestor;
-    MemberName*             pFirstName;
-} MemberNames;
-
-/* A parser instance. */
-struct JSON_Parser_Data
-{
-    JSON_MemorySuite                    memorySuite;
-    void*                               userData;
-    ParserState                         state;
-    ParserFlags                         flags;
-    Encoding                            inputEncoding;
-    Encoding                            stringEncoding;
-    Encoding                            numberEncoding;
-    Symbol                              token;
-    TokenAttributes                     tokenAttributes;
-    Error                               error;
-    byte                                errorOffset;
-    LexerState                          lexerState;
-    uint32_t                            lexerBits;
-    size_t                              codepointLocationByte;
-    size_t                              codepointLocationLine;
-    size_t                              codepointLocationColumn;
-    size_t                              tokenLocationByte;
-    size_t                              tokenLocationLine;
-    size_t                              tokenLocationColumn;
-    size_t                              depth;
-    byte*                               pTokenBytes;
-    size_t                              tokenBytesLength;
-    size_t                              tokenBytesUsed;
-    size_t                              maxStringLength;
-    size_t                              maxNumberLength;
-    MemberNames*                        pMemberNames;
-    DecoderData                         decoderData;
-    GrammarianData                      grammarianData;
-    JSON_Parser_EncodingDetectedHandler encodingDetectedHandler;
-    JSON_Parser_NullHandler             nullHandler;
-    JSON_Parser_BooleanHandler          booleanHandler;
-    JSON_Parser_StringHandler           stringHandler;
-    JSON_Parser_NumberHandler           numberHandler;
-    JSON_Parser_SpecialNumberHandler    specialNumberHandler;
-    JSON_Parser_StartObjectHandler      startObjectHandler;
-    JSON_Parser_EndObjectHandler        endObjectHandler;
-    JSON_Parser_ObjectMemberHandler     objectMemberHandler;
-    JSON_Parser_StartArrayHandler       startArrayHandler;
-    JSON_Parser_EndArrayHandler         endArrayHandler;
-    JSON_Parser_ArrayItemHandler        arrayItemHandler;
-    byte                                defaultTokenBytes[DEFAULT_TOKEN_BYTES_LENGTH];
-};
-
-/* Parser internal functions. */
-
-static void JSON_Parser_SetErrorAtCodepoint(JSON_Parser parser, Error error)
-{
-    parser->error = error;
-}
-
-static void JSON_Parser_SetErrorAtStringEscapeSequenceStart(JSON_Parser parser, Error error, int codepointsAgo)
-{
-    /* Note that backtracking from the current codepoint requires us to make
-       three assumptions, which are always valid in the context of a string
-       escape sequence:
-
-         1. The input encoding is not JSON_UnknownEncoding.
-
-         2 The codepoints we are backing up across are all in the range
-            U+0000 - U+007F, aka ASCII, so we can assume the number of
-            bytes comprising them based on the input encoding.
-
-         3. The codepoints we are backing up across do not include any
-            line breaks, so we can assume that the line number stays the
-            same and the column number can simply be decremented.
-    */
-    parser->error = error;
-    parser->errorOffset = (byte)codepointsAgo;
-}
-
-static void JSON_Parser_SetErrorAtToken(JSON_Parser parser, Error error)
-{
-    parser->error = error;
-    parser->errorOffset = ERROR_LOCATION_IS_TOKEN_START;
+    pScan->afterCarriageReturn = (unit == CARRIAGE_RETURN_CODEPOINT);
 }
 
-static JSON_Status JSON_Parser_PushMemberNameList(JSON_Parser parser)
+static size_t FinishCodepointCount(WhitespaceScan* pScan, const CodepointCount* pCount, size_t units)
 {
-    MemberNames* pNames = (MemberNames*)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, sizeof(MemberNames));
-    if (!pNames)
+    size_t codepoints = units - pCount->trailingUnits;
+    if (pScan->lineStart != SIZE_MAX)
     {
-        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
-        return JSON_Failure;
+        pScan->lineStart = codepoints - (units - pScan->lineStart - pCount->trailingUnitsSinceLineStart);
     }
-    pNames->pAncestor = parser->pMemberNames;
-    pNames->pFirstName = NULL;
-    parser->pMemberNames = pNames;
-    return JSON_Success;
+    return codepoints;
 }
 
-static void JSON_Parser_PopMemberNameList(JSON_Parser parser)
+/* Returns the number of codepoints in a run of valid UTF-8, accumulating
+   its line-breaking effects into *pScan, with the offset of the last line
+   start measured in codepoints. */
+static size_t CountUTF8Codepoints(const byte* pBytes, size_t length, WhitespaceScan* pScan)
 {
-    MemberNames* pAncestor = parser->pMemberNames->pAncestor;
-    while (parser->pMemberNames->pFirstName)
+    CodepointCount count = { 0, 0 };
+    size_t i = 0;
+#ifdef JSON_SIMD_AVX2
     {
-        MemberName* pNextName = parser->pMemberNames->pFirstName->pNextName;
-        parser->memorySuite.free(parser->memorySuite.userData, parser->pMemberNames->pFirstName);
-        parser->pMemberNames->pFirstName = pNextName;
+        const __m256i carriageReturns32 = _mm256_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m256i lineFeeds32 = _mm256_set1_epi8(LINE_FEED_CODEPOINT);
+        const __m256i firstNonContinuation32 = _mm256_set1_epi8((char)0xC0);
+        for (; i + 32 <= length; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(pBytes + i));
+            CountCodepointsBlock(pScan, &count, i, 32,
+                                 (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, carriageReturns32)),
+                                 (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lineFeeds32)),
+                                 (unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi8(firstNonContinuation32, v)));
+        }
     }
-    parser->memorySuite.free(parser->memorySuite.userData, parser->pMemberNames);
-    parser->pMemberNames = pAncestor;
-}
-
-static JSON_Status JSON_Parser_StartContainer(JSON_Parser parser, int isObject)
-{
-    if (isObject && GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS) &&
-        !JSON_Parser_PushMemberNameList(parser))
+#endif
+#ifdef JSON_SIMD_SSE2
     {
-        return JSON_Failure;
+        const __m128i carriageReturns16 = _mm_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds16 = _mm_set1_epi8(LINE_FEED_CODEPOINT);
+        const __m128i firstNonContinuation16 = _mm_set1_epi8((char)0xC0);
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pBytes + i));
+            CountCodepointsBlock(pScan, &count, i, 16,
+                                 (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, carriageReturns16)),
+                                 (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lineFeeds16)),
+                                 (unsigned int)_mm_movemask_epi8(_mm_cmplt_epi8(v, firstNonContinuation16)));
+        }
     }
-    parser->depth++;
-    return JSON_Success;
-}
-
-static void JSON_Parser_EndContainer(JSON_Parser parser, int isObject)
-{
-    parser->depth--;
-    if (isObject && GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS))
+#endif
+    for (; i < length; i++)
     {
-        JSON_Parser_PopMemberNameList(parser);
+        CountCodepointsUnit(pScan, &count, i, pBytes[i], IS_UTF8_CONTINUATION_BYTE(pBytes[i]));
     }
+    return FinishCodepointCount(pScan, &count, length);
 }
 
-static JSON_Status JSON_Parser_AddMemberNameToList(JSON_Parser parser)
+/* Returns the length of the longest prefix of ASCII bytes that can be copied
+   verbatim into a string token: anything except '"', '\', CR and LF, and
+   except control characters unless allowControlCharacters is true. The
+   string attributes implied by the control characters in the prefix, if
+   any, are OR-ed into *pAttributes. */
+static size_t ScanStringBytes(const byte* pBytes, size_t length, int allowControlCharacters, TokenAttributes* pAttributes)
 {
-    if (GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS))
-    {
-        MemberName* pName;
-        for (pName = parser->pMemberNames->pFirstName; pName; pName = pName->pNextName)
+    size_t i = 0;
+    unsigned int controlMask = 0;
+    unsigned int nullMask = 0;
+#ifdef JSON_SIMD_AVX2
+    const __m256i quotes32 = _mm256_set1_epi8('"');
+    const __m256i backslashes32 = _mm256_set1_epi8('\\');
+    const __m256i carriageReturns32 = _mm256_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+    const __m256i lineFeeds32 = _mm256_set1_epi8(LINE_FEED_CODEPOINT);
+    const __m256i spaces32 = _mm256_set1_epi8(' ');
+    while (i + 32 <= length)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pBytes + i));
+        /* Signed comparison: non-ASCII bytes also compare less than ' '. */
+        __m256i controls = _mm256_cmpgt_epi8(spaces32, v);
+        __m256i stops = _mm256_or_si256(_mm256_cmpeq_epi8(v, quotes32), _mm256_cmpeq_epi8(v, backslashes32));
+        unsigned int stopMask;
+        unsigned int blockControlMask = 0;
+        unsigned int blockNullMask = 0;
+        if (allowControlCharacters)
+        {
+            stops = _mm256_or_si256(stops, _mm256_or_si256(_mm256_cmpeq_epi8(v, carriageReturns32), _mm256_cmpeq_epi8(v, lineFeeds32)));
+            blockControlMask = (unsigned int)_mm256_movemask_epi8(controls);
+            blockNullMask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+            stopMask = (unsigned int)_mm256_movemask_epi8(stops) | (unsigned int)_mm256_movemask_epi8(v);
+        }
+        else
+        {
+            stopMask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(stops, controls));
+        }
+        if (stopMask)
         {
-            if (pName->length == parser->tokenBytesUsed && !memcmp(pName->pBytes, parser->pTokenBytes, pName->length))
+            unsigned int spanMask = (1U << LowestSetBit(stopMask)) - 1U;
+            controlMask |= blockControlMask & spanMask;
+            nullMask |= blockNullMask & spanMask;
+            i += LowestSetBit(stopMask);
+            goto done;
+        }
+        controlMask |= blockControlMask;
+        nullMask |= blockNullMask;
+        i += 32;
+    }
+#endif
+#ifdef JSON_SIMD_SSE2
+    {
+        const __m128i quotes = _mm_set1_epi8('"');
+        const __m128i backslashes = _mm_set1_epi8('\\');
+        const __m128i carriageReturns = _mm_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds = _mm_set1_epi8(LINE_FEED_CODEPOINT);
+        const __m128i spaces = _mm_set1_epi8(' ');
+        while (i + 16 <= length)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pBytes + i));
+            /* Signed comparison: non-ASCII bytes also compare less than ' '. */
+            __m128i controls = _mm_cmplt_epi8(v, spaces);
+            __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(v, quotes), _mm_cmpeq_epi8(v, backslashes));
+            unsigned int stopMask;
+            unsigned int blockControlMask = 0;
+            unsigned int blockNullMask = 0;
+            if (allowControlCharacters)
             {
-                JSON_Parser_SetErrorAtToken(parser, JSON_Error_DuplicateObjectMember);
-                return JSON_Failure;
+                stops = _mm_or_si128(stops, _mm_or_si128(_mm_cmpeq_epi8(v, carriageReturns), _mm_cmpeq_epi8(v, lineFeeds)));
+                blockControlMask = (unsigned int)_mm_movemask_epi8(controls);
+                blockNullMask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+                stopMask = (unsigned int)_mm_movemask_epi8(stops) | (unsigned int)_mm_movemask_epi8(v);
             }
+            else
+            {
+                stopMask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(stops, controls));
+            }
+            if (stopMask)
+            {
+                unsigned int spanMask = (1U << LowestSetBit(stopMask)) - 1U;
+                controlMask |= blockControlMask & spanMask;
+                nullMask |= blockNullMask & spanMask;
+                i += LowestSetBit(stopMask);
+                goto done;
+            }
+            controlMask |= blockControlMask;
+            nullMask |= blockNullMask;
+            i += 16;
+        }
+    }
+#endif
+    while (i < length)
+    {
+        byte b = pBytes[i];
+        if (!IS_UTF8_SINGLE_BYTE(b) || b == '"' || b == '\\')
+        {
+            break;
         }
-        pName = (MemberName*)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, sizeof(MemberName) + parser->tokenBytesUsed - 1);
-        if (!pName)
+        if (b < FIRST_NON_CONTROL_CODEPOINT)
         {
-            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
-            return JSON_Failure;
+            if (!allowControlCharacters || b == CARRIAGE_RETURN_CODEPOINT || b == LINE_FEED_CODEPOINT)
+            {
+                break;
+            }
+            controlMask = 1;
+            if (!b)
+            {
+                nullMask = 1;
+            }
         }
-        pName->pNextName = parser->pMemberNames->pFirstName;
-        pName->length = parser->tokenBytesUsed;
-        memcpy(pName->pBytes, parser->pTokenBytes, parser->tokenBytesUsed);
-        parser->pMemberNames->pFirstName = pName;
+        i++;
     }
-    return JSON_Success;
+#ifdef JSON_SIMD_SSE2
+done:
+#endif
+    if (nullMask)
+    {
+        SET_FLAGS_ON(TokenAttributes, *pAttributes, JSON_ContainsNullCharacter | JSON_ContainsControlCharacter);
+    }
+    else if (controlMask)
+    {
+        SET_FLAGS_ON(TokenAttributes, *pAttributes, JSON_ContainsControlCharacter);
+    }
+    return i;
 }
 
-static void JSON_Parser_ResetData(JSON_Parser parser, int isInitialized)
+/* Returns the length of the valid UTF-8 multi-byte sequence at the start of
+   a run, or 0 if the sequence is invalid or is cut off by the end of the
+   run. A sequence is valid under exactly the same rules that
+   Decoder_ProcessByte() applies: no overlong encodings, no surrogates, and
+   nothing above U+10FFFF. */
+static size_t ValidUTF8SequenceLength(const byte* pBytes, size_t length)
 {
-    parser->userData = NULL;
-    parser->flags = PARSER_DEFAULT_FLAGS;
-    parser->inputEncoding = JSON_UnknownEncoding;
-    parser->stringEncoding = JSON_UTF8;
-    parser->numberEncoding = JSON_UTF8;
-    parser->token = T_NONE;
-    parser->tokenAttributes = 0;
-    parser->error = JSON_Error_None;
-    parser->errorOffset = 0;
-    parser->lexerState = LEXING_WHITESPACE;
-    parser->lexerBits = 0;
-    parser->codepointLocationByte = 0;
-    parser->codepointLocationLine = 0;
-    parser->codepointLocationColumn = 0;
-    parser->tokenLocationByte = 0;
-    parser->tokenLocationLine = 0;
-    parser->tokenLocationColumn = 0;
-    parser->depth = 0;
-    if (!isInitialized)
+    byte b = pBytes[0];
+    if (IS_UTF8_FIRST_BYTE_OF_2(b))
     {
-        parser->pTokenBytes = parser->defaultTokenBytes;
-        parser->tokenBytesLength = sizeof(parser->defaultTokenBytes);
+        if (b >= 0xC2 && length >= 2 &&
+            IS_UTF8_CONTINUATION_BYTE(pBytes[1]))
+        {
+            return 2;
+        }
     }
-    else
+    else if (IS_UTF8_FIRST_BYTE_OF_3(b))
     {
-        /* When we reset the parser, we keep the output buffer and the symbol
-           stack that have already been allocated, if any. If the client wants
-           to reclaim the memory used by the those buffers, he needs to free
-           the parser and create a new one. */
+        if (length >= 3 &&
+            IS_UTF8_CONTINUATION_BYTE(pBytes[1]) && IS_UTF8_CONTINUATION_BYTE(pBytes[2]) &&
+            (b != 0xE0 || pBytes[1] >= 0xA0) && (b != 0xED || pBytes[1] < 0xA0))
+        {
+            return 3;
+        }
     }
-    parser->tokenBytesUsed = 0;
-    parser->maxStringLength = SIZE_MAX;
-    parser->maxNumberLength = SIZE_MAX;
-    if (!isInitialized)
+    else if (IS_UTF8_FIRST_BYTE_OF_4(b))
     {
-        parser->pMemberNames = NULL;
+        if (b <= 0xF4 && length >= 4 &&
+            IS_UTF8_CONTINUATION_BYTE(pBytes[1]) && IS_UTF8_CONTINUATION_BYTE(pBytes[2]) && IS_UTF8_CONTINUATION_BYTE(pBytes[3]) &&
+            (b != 0xF0 || pBytes[1] >= 0x90) && (b != 0xF4 || pBytes[1] < 0x90))
+        {
+            return 4;
+        }
     }
-    else
+    return 0;
+}
+
+#ifdef JSON_SIMD_SSSE3
+
+/* Error bits for the lookup-table UTF-8 validation algorithm described by
+   Keiser and Lemire in "Validating UTF-8 In Less Than One Instruction Per
+   Byte". Each pair of adjacent bytes is classified by looking up the high
+   and low nibbles of the first byte and the high nibble of the second in
+   three 16-entry tables, and the pair is invalid if the three results have
+   any bit in common. The third and fourth bytes of longer sequences are
+   checked separately. */
+#define UTF8_TOO_SHORT      0x01 /* 11______ 0_______ or 11______ 11______ */
+#define UTF8_TOO_LONG       0x02 /* 0_______ 10______ */
+#define UTF8_OVERLONG_3     0x04 /* 11100000 100_____ */
+#define UTF8_TOO_LARGE      0x08 /* 11110100 1001____, 11110100 101_____, 11110101+ 1001____ ... */
+#define UTF8_SURROGATE      0x10 /* 11101101 101_____ */
+#define UTF8_OVERLONG_2     0x20 /* 1100000_ 10______ */
+#define UTF8_TOO_LARGE_1000 0x40 /* 11110101+ 1000____ */
+#define UTF8_OVERLONG_4     0x40 /* 11110000 1000____ */
+#define UTF8_TWO_CONTS      0x80 /* 10______ 10______ */
+#define UTF8_CARRY          (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+#define UTF8_ENTRY(x)       ((char)(x))
+
+/* Returns a vector whose bytes are non-zero where the corresponding bytes
+   of the input are invalid, given the 16 bytes that precede the input. A
+   sequence that is cut off by the end of the input is not reported. */
+static __m128i CheckUTF8Block(__m128i input, __m128i previousInput)
+{
+    const __m128i byte1HighTable = _mm_setr_epi8(
+        /* 0_______ ________ */
+        UTF8_ENTRY(UTF8_TOO_LONG), UTF8_ENTRY(UTF8_TOO_LONG), UTF8_ENTRY(UTF8_TOO_LONG), UTF8_ENTRY(UTF8_TOO_LONG),
+        UTF8_ENTRY(UTF8_TOO_LONG), UTF8_ENTRY(UTF8_TOO_LONG), UTF8_ENTRY(UTF8_TOO_LONG), UTF8_ENTRY(UTF8_TOO_LONG),
+        /* 10______ ________ */
+        UTF8_ENTRY(UTF8_TWO_CONTS), UTF8_ENTRY(UTF8_TWO_CONTS), UTF8_ENTRY(UTF8_TWO_CONTS), UTF8_ENTRY(UTF8_TWO_CONTS),
+        /* 1100____ ________ */
+        UTF8_ENTRY(UTF8_TOO_SHORT | UTF8_OVERLONG_2),
+        /* 1101____ ________ */
+        UTF8_ENTRY(UTF8_TOO_SHORT),
+        /* 1110____ ________ */
+        UTF8_ENTRY(UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE),
+        /* 1111____ ________ */
+        UTF8_ENTRY(UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4));
+    const __m128i byte1LowTable = _mm_setr_epi8(
+        /* ____0000 ________ */
+        UTF8_ENTRY(UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4),
+        /* ____0001 ________ */
+        UTF8_ENTRY(UTF8_CARRY | UTF8_OVERLONG_2),
+        /* ____001_ ________ */
+        UTF8_ENTRY(UTF8_CARRY), UTF8_ENTRY(UTF8_CARRY),
+        /* ____0100 ________ */
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE),
+        /* ____0101 ________ and ____011_ ________ */
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        /* ____1___ ________ */
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        /* ____1101 ________ */
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+        UTF8_ENTRY(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000));
+    const __m128i byte2HighTable = _mm_setr_epi8(
+        /* ________ 0_______ */
+        UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT),
+        UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT),
+        /* ________ 1000____ */
+        UTF8_ENTRY(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4),
+        /* ________ 1001____ */
+        UTF8_ENTRY(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+        /* ________ 101_____ */
+        UTF8_ENTRY(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+        UTF8_ENTRY(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+        /* ________ 11______ */
+        UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT), UTF8_ENTRY(UTF8_TOO_SHORT));
+    const __m128i lowNibbles = _mm_set1_epi8(0x0F);
+    __m128i previous1 = _mm_alignr_epi8(input, previousInput, 15);
+    __m128i previous2 = _mm_alignr_epi8(input, previousInput, 14);
+    __m128i previous3 = _mm_alignr_epi8(input, previousInput, 13);
+    __m128i specialCases = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(byte1HighTable, _mm_and_si128(_mm_srli_epi16(previous1, 4), lowNibbles)),
+                      _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(previous1, lowNibbles))),
+        _mm_shuffle_epi8(byte2HighTable, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibbles)));
+    /* Only bytes of the form 111_____ (1111____) are left with their high
+       bit set, and the next byte but one (but two) must be a continuation
+       byte; UTF8_TWO_CONTS is set in specialCases exactly when it is. */
+    __m128i mustBeContinuation = _mm_and_si128(
+        _mm_or_si128(_mm_subs_epu8(previous2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+                     _mm_subs_epu8(previous3, _mm_set1_epi8((char)(0xF0 - 0x80)))),
+        _mm_set1_epi8(UTF8_ENTRY(0x80)));
+    return _mm_xor_si128(mustBeContinuation, specialCases);
+}
+
+#endif /* JSON_SIMD_SSSE3 */
+
+/* Returns the length of the longest prefix of valid UTF-8 input that can be
+   copied verbatim into a UTF-8 string token: ASCII characters as for
+   ScanStringBytes(), and complete, valid multi-byte sequences. The prefix
+   never ends in the middle of a sequence. The number of codepoints in the
+   prefix is stored in *pCodepoints, and the string attributes implied by the
+   prefix are OR-ed into *pAttributes. Invalid sequences are left for the
+   decoder, which knows how to replace or report them. */
+static size_t ScanUTF8StringBytes(const byte* pBytes, size_t length, int allowControlCharacters, TokenAttributes* pAttributes, size_t* pCodepoints)
+{
+    size_t i = 0;
+    size_t codepoints = 0;
+    TokenAttributes attributes = 0;
+#ifdef JSON_SIMD_SSSE3
+    {
+        /* Blocks are vouched for by the vectorized validator. The masks for
+           the last accepted block are kept apart, since the sequence at its
+           end may turn out to be invalid in the next block, in which case
+           that sequence's bytes must not be counted. */
+        const __m128i quotes = _mm_set1_epi8('"');
+        const __m128i backslashes = _mm_set1_epi8('\\');
+        const __m128i carriageReturns = _mm_set1_epi8(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds = _mm_set1_epi8(LINE_FEED_CODEPOINT);
+        const __m128i spaces = _mm_set1_epi8(' ');
+        const __m128i firstNonContinuationBytes = _mm_set1_epi8((char)0xC0);
+        const __m128i firstBytesOf4 = _mm_set1_epi8((char)0xF0);
+        __m128i previous = _mm_setzero_si128();
+        unsigned int firstByteMask = 0;
+        unsigned int nonASCIIMask = 0;
+        unsigned int nonBMPMask = 0;
+        unsigned int controlMask = 0;
+        unsigned int nullMask = 0;
+        int finished = 0;
+        while (i + 16 <= length)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pBytes + i));
+            unsigned int errorMask = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(CheckUTF8Block(v, previous), _mm_setzero_si128())) & 0xFFFFU;
+            unsigned int blockNonASCIIMask = (unsigned int)_mm_movemask_epi8(v);
+            unsigned int blockControlMask = (unsigned int)_mm_movemask_epi8(_mm_cmplt_epi8(v, spaces)) & ~blockNonASCIIMask;
+            __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(v, quotes), _mm_cmpeq_epi8(v, backslashes));
+            unsigned int stopMask;
+            size_t span;
+            unsigned int spanMask;
+            if (allowControlCharacters)
+            {
+                stopMask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(stops, _mm_or_si128(_mm_cmpeq_epi8(v, carriageReturns), _mm_cmpeq_epi8(v, lineFeeds))));
+            }
+            else
+            {
+                stopMask = (unsigned int)_mm_movemask_epi8(stops) | blockControlMask;
+            }
+            span = stopMask ? LowestSetBit(stopMask) : 16;
+            /* An error reported at the stop itself means that the stop cut
+               off a sequence. */
+            if (errorMask & ((2U << span) - 1U))
+            {
+                break;
+            }
+            spanMask = (1U << span) - 1U;
+            codepoints += PopCount(firstByteMask);
+            SET_FLAGS_ON(TokenAttributes, attributes,
+                         (nonASCIIMask ? JSON_ContainsNonASCIICharacter : 0) |
+                         (nonBMPMask ? JSON_ContainsNonBMPCharacter : 0) |
+                         (controlMask ? JSON_ContainsControlCharacter : 0) |
+                         (nullMask ? JSON_ContainsNullCharacter : 0));
+            /* Signed comparison: only continuation bytes compare less than
+               0xC0. */
+            firstByteMask = ~(unsigned int)_mm_movemask_epi8(_mm_cmplt_epi8(v, firstNonContinuationBytes)) & spanMask;
+            nonASCIIMask = blockNonASCIIMask & spanMask;
+            nonBMPMask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, firstBytesOf4), v)) & spanMask;
+            controlMask = allowControlCharacters ? blockControlMask & spanMask : 0;
+            nullMask = allowControlCharacters ? (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) & spanMask : 0;
+            i += span;
+            if (span < 16)
+            {
+                finished = 1;
+                break;
+            }
+            previous = v;
+        }
+        if (!finished && i)
+        {
+            /* Back up to the start of the sequence that the last accepted
+               block ends in the middle of, if any, so that it is checked
+               again below. */
+            size_t sequenceStart = i - 1;
+            size_t sequenceLength;
+            while (sequenceStart > 0 && i - sequenceStart < LONGEST_ENCODING_SEQUENCE && IS_UTF8_CONTINUATION_BYTE(pBytes[sequenceStart]))
+            {
+                sequenceStart--;
+            }
+            sequenceLength = IS_UTF8_FIRST_BYTE_OF_2(pBytes[sequenceStart]) ? 2 :
+                             IS_UTF8_FIRST_BYTE_OF_3(pBytes[sequenceStart]) ? 3 :
+                             IS_UTF8_FIRST_BYTE_OF_4(pBytes[sequenceStart]) ? 4 : 1;
+            if (sequenceStart + sequenceLength > i)
+            {
+                unsigned int keepMask = (1U << (16 - (i - sequenceStart))) - 1U;
+                firstByteMask &= keepMask;
+                nonASCIIMask &= keepMask;
+                nonBMPMask &= keepMask;
+                i = sequenceStart;
+            }
+        }
+        codepoints += PopCount(firstByteMask);
+        SET_FLAGS_ON(TokenAttributes, attributes,
+                     (nonASCIIMask ? JSON_ContainsNonASCIICharacter : 0) |
+                     (nonBMPMask ? JSON_ContainsNonBMPCharacter : 0) |
+                     (controlMask ? JSON_ContainsControlCharacter : 0) |
+                     (nullMask ? JSON_ContainsNullCharacter : 0));
+        if (finished)
+        {
+            goto done;
+        }
+    }
+#endif
+    while (i < length)
     {
-        while (parser->pMemberNames)
+        byte b = pBytes[i];
+        if (IS_UTF8_SINGLE_BYTE(b))
+        {
+            if (b == '"' || b == '\\')
+            {
+                break;
+            }
+            if (b < FIRST_NON_CONTROL_CODEPOINT)
+            {
+                if (!allowControlCharacters || b == CARRIAGE_RETURN_CODEPOINT || b == LINE_FEED_CODEPOINT)
+                {
+                    break;
+                }
+                SET_FLAGS_ON(TokenAttributes, attributes, b ? JSON_ContainsControlCharacter : JSON_ContainsNullCharacter | JSON_ContainsControlCharacter);
+            }
+            i++;
+        }
+        else
         {
-            JSON_Parser_PopMemberNameList(parser);
+            size_t sequenceLength = ValidUTF8SequenceLength(pBytes + i, length - i);
+            if (!sequenceLength)
+            {
+                break;
+            }
+            SET_FLAGS_ON(TokenAttributes, attributes, (sequenceLength == 4) ? JSON_ContainsNonASCIICharacter | JSON_ContainsNonBMPCharacter : JSON_ContainsNonASCIICharacter);
+            i += sequenceLength;
         }
+        codepoints++;
     }
-    Decoder_Reset(&parser->decoderData);
-    Grammarian_Reset(&parser->grammarianData, isInitialized);
-    parser->encodingDetectedHandler = NULL;
-    parser->nullHandler = NULL;
-    parser->booleanHandler = NULL;
-    parser->stringHandler = NULL;
-    parser->numberHandler = NULL;
-    parser->specialNumberHandler = NULL;
-    parser->startObjectHandler = NULL;
-    parser->endObjectHandler = NULL;
-    parser->objectMemberHandler = NULL;
-    parser->startArrayHandler = NULL;
-    parser->endArrayHandler = NULL;
-    parser->arrayItemHandler = NULL;
-    parser->state = PARSER_RESET; /* do this last! */
+#ifdef JSON_SIMD_SSSE3
+done:
+#endif
+    SET_FLAGS_ON(TokenAttributes, *pAttributes, attributes);
+    *pCodepoints = codepoints;
+    return i;
 }
 
-static void JSON_Parser_NullTerminateToken(JSON_Parser parser)
+/* The wide scanning functions are the UTF-16 and UTF-32 counterparts of the
+   functions above. They work in whole code units: the length they return
+   is a multiple of the input encoding's unit size and never ends between
+   the two halves of a surrogate pair. */
+
+static Codepoint ReadWideUnit(const byte* pBytes, Encoding encoding)
 {
-    /* Because we always ensure that there are LONGEST_ENCODING_SEQUENCE bytes
-       available at the end of the token buffer when we record codepoints, we
-       can write the null terminator to the buffer with impunity. */
-    static const byte nullTerminatorBytes[LONGEST_ENCODING_SEQUENCE] = { 0 };
-    Encoding encoding = (Encoding)((parser->token == T_NUMBER) ? parser->numberEncoding : parser->stringEncoding);
-    memcpy(parser->pTokenBytes + parser->tokenBytesUsed, nullTerminatorBytes, SHORTEST_ENCODING_SEQUENCE(encoding));
+    switch (encoding)
+    {
+    case JSON_UTF16LE:
+        return (Codepoint)pBytes[0] | ((Codepoint)pBytes[1] << 8);
+
+    case JSON_UTF16BE:
+        return ((Codepoint)pBytes[0] << 8) | (Codepoint)pBytes[1];
+
+    case JSON_UTF32LE:
+        return (Codepoint)pBytes[0] | ((Codepoint)pBytes[1] << 8) | ((Codepoint)pBytes[2] << 16) | ((Codepoint)pBytes[3] << 24);
+
+    default: /* JSON_UTF32BE */
+        return ((Codepoint)pBytes[0] << 24) | ((Codepoint)pBytes[1] << 16) | ((Codepoint)pBytes[2] << 8) | (Codepoint)pBytes[3];
+    }
 }
 
-static JSON_Status JSON_Parser_FlushParser(JSON_Parser parser)
+/* This function assumes that the run starts with a valid, complete
+   codepoint (see ScanWideCodepoints()). */
+static Codepoint ReadWideCodepoint(const byte* pBytes, Encoding encoding, size_t* pEncodedLength)
 {
-    /* The symbol stack should be empty when parsing finishes. */
-    if (!Grammarian_FinishedDocument(&parser->grammarianData))
+    Codepoint c = ReadWideUnit(pBytes, encoding);
+    if (IS_LEADING_SURROGATE(c) && SHORTEST_ENCODING_SEQUENCE(encoding) == 2)
     {
-        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_ExpectedMoreTokens);
-        return JSON_Failure;
+        c = CODEPOINT_FROM_SURROGATES((c << 16) | ReadWideUnit(pBytes + 2, encoding));
+        *pEncodedLength = 4;
     }
-    return JSON_Success;
+    else
+    {
+        *pEncodedLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+    }
+    return c;
 }
 
-typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_SimpleTokenHandler)(JSON_Parser parser);
-static JSON_Status JSON_Parser_CallSimpleTokenHandler(JSON_Parser parser, JSON_Parser_SimpleTokenHandler handler)
+#ifdef JSON_SIMD_SSE2
+
+/* Loads 16 bytes of UTF-16 or UTF-32 input as 8 16-bit or 4 32-bit lanes
+   holding the code unit values, swapping bytes if the input is big-endian. */
+static __m128i LoadWideBlock(const byte* pBytes, Encoding encoding)
 {
-    if (handler)
+    __m128i v = _mm_loadu_si128((const __m128i*)pBytes);
+    if (encoding == JSON_UTF16BE || encoding == JSON_UTF32BE)
     {
-        JSON_Parser_HandlerResult result;
-        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        result = handler(parser);
-        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        if (result != JSON_Parser_Continue)
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if (encoding == JSON_UTF32BE)
         {
-            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
-            return JSON_Failure;
+            v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
         }
     }
-    return JSON_Success;
+    return v;
 }
 
-static JSON_Status JSON_Parser_CallBooleanHandler(JSON_Parser parser)
+#endif /* JSON_SIMD_SSE2 */
+
+/* Returns the length of the longest prefix of UTF-16 or UTF-32 input that
+   consists of valid, complete codepoints: no unpaired surrogates, and
+   nothing above U+10FFFF. Anything else is left for the decoder, which
+   knows how to replace or report it. */
+static size_t ScanWideCodepoints(const byte* pBytes, size_t length, Encoding encoding)
 {
-    if (parser->booleanHandler)
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+    size_t i = 0;
+#ifdef JSON_SIMD_SSE2
+    size_t scalarEnd = 0;
+    const __m128i surrogateMask16 = _mm_set1_epi16((short)0xF800);
+    const __m128i surrogates16 = _mm_set1_epi16((short)0xD800);
+    const __m128i surrogateMask32 = _mm_set1_epi32((int)0xFFFFF800);
+    const __m128i surrogates32 = _mm_set1_epi32(0xD800);
+    const __m128i maxCodepoints = _mm_set1_epi32((int)MAX_CODEPOINT);
+#endif
+    length -= length % unitLength;
+    while (i < length)
     {
-        JSON_Parser_HandlerResult result;
-        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        result = parser->booleanHandler(parser, parser->token == T_TRUE ? JSON_True : JSON_False);
-        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        if (result != JSON_Parser_Continue)
+        Codepoint c;
+#ifdef JSON_SIMD_SSE2
+        /* Blocks without surrogates (and, for UTF-32, without out-of-range
+           values) are accepted wholesale; a block that has any is checked
+           unit by unit, after which the vectorized check resumes. */
+        if (i >= scalarEnd && i + 16 <= length)
+        {
+            __m128i v = LoadWideBlock(pBytes + i, encoding);
+            __m128i invalid;
+            if (unitLength == 2)
+            {
+                invalid = _mm_cmpeq_epi16(_mm_and_si128(v, surrogateMask16), surrogates16);
+            }
+            else
+            {
+                /* Signed comparison: values with the top bit set are
+                   negative, so they are checked separately. */
+                invalid = _mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(v, surrogateMask32), surrogates32),
+                                       _mm_or_si128(_mm_cmpgt_epi32(v, maxCodepoints), _mm_cmplt_epi32(v, _mm_setzero_si128())));
+            }
+            if (!_mm_movemask_epi8(invalid))
+            {
+                i += 16;
+                continue;
+            }
+            scalarEnd = i + 16;
+        }
+#endif
+        c = ReadWideUnit(pBytes + i, encoding);
+        if (!IS_SURROGATE(c) && c <= MAX_CODEPOINT)
         {
-            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
-            return JSON_Failure;
+            i += unitLength;
+        }
+        else if (unitLength == 2 && IS_LEADING_SURROGATE(c) && i + 4 <= length &&
+                 IS_TRAILING_SURROGATE(ReadWideUnit(pBytes + i + 2, encoding)))
+        {
+            i += 4;
+        }
+        else
+        {
+            break;
         }
     }
-    return JSON_Success;
+    return i;
 }
 
-static JSON_Status JSON_Parser_CallStringHandler(JSON_Parser parser, int isObjectMember)
+/* Returns the length of the longest prefix of valid UTF-16 or UTF-32 input
+   (see ScanWideCodepoints()) that can be recorded in a string token without
+   involving the lexer: anything except '"', '\', CR and LF, and except
+   control characters unless allowControlCharacters is true. The number of
+   codepoints in the prefix is stored in *pCodepoints, and the string
+   attributes implied by the prefix are OR-ed into *pAttributes. */
+static size_t ScanWideStringUnits(const byte* pBytes, size_t length, Encoding encoding, int allowControlCharacters, TokenAttributes* pAttributes, size_t* pCodepoints)
 {
-    JSON_Parser_StringHandler handler = isObjectMember ? parser->objectMemberHandler : parser->stringHandler;
-    if (handler)
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+    size_t i = 0;
+    size_t trailingSurrogates = 0;
+    TokenAttributes attributes = 0;
+#ifdef JSON_SIMD_SSE2
+    {
+        const __m128i quotes16 = _mm_set1_epi16('"');
+        const __m128i backslashes16 = _mm_set1_epi16('\\');
+        const __m128i carriageReturns16 = _mm_set1_epi16(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds16 = _mm_set1_epi16(LINE_FEED_CODEPOINT);
+        const __m128i lastControls16 = _mm_set1_epi16(FIRST_NON_CONTROL_CODEPOINT - 1);
+        const __m128i lastASCII16 = _mm_set1_epi16(FIRST_NON_ASCII_CODEPOINT - 1);
+        const __m128i surrogateMask16 = _mm_set1_epi16((short)0xF800);
+        const __m128i surrogates16 = _mm_set1_epi16((short)0xD800);
+        const __m128i trailingSurrogateMask16 = _mm_set1_epi16((short)0xFC00);
+        const __m128i trailingSurrogates16 = _mm_set1_epi16((short)0xDC00);
+        const __m128i quotes32 = _mm_set1_epi32('"');
+        const __m128i backslashes32 = _mm_set1_epi32('\\');
+        const __m128i carriageReturns32 = _mm_set1_epi32(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds32 = _mm_set1_epi32(LINE_FEED_CODEPOINT);
+        const __m128i nonControls32 = _mm_set1_epi32(FIRST_NON_CONTROL_CODEPOINT);
+        const __m128i nonASCII32 = _mm_set1_epi32(FIRST_NON_ASCII_CODEPOINT);
+        const __m128i lastBMP32 = _mm_set1_epi32(FIRST_NON_BMP_CODEPOINT - 1);
+        while (i + 16 <= length)
+        {
+            __m128i v = LoadWideBlock(pBytes + i, encoding);
+            __m128i stops;
+            __m128i controls;
+            __m128i nulls;
+            __m128i ascii;
+            __m128i nonBMP;
+            unsigned int stopMask;
+            unsigned int spanMask = 0xFFFF;
+            if (unitLength == 2)
+            {
+                /* Unsigned comparisons by way of saturating subtraction. */
+                stops = _mm_or_si128(_mm_cmpeq_epi16(v, quotes16), _mm_cmpeq_epi16(v, backslashes16));
+                controls = _mm_cmpeq_epi16(_mm_subs_epu16(v, lastControls16), _mm_setzero_si128());
+                nulls = _mm_cmpeq_epi16(v, _mm_setzero_si128());
+                ascii = _mm_cmpeq_epi16(_mm_subs_epu16(v, lastASCII16), _mm_setzero_si128());
+                nonBMP = _mm_cmpeq_epi16(_mm_and_si128(v, surrogateMask16), surrogates16);
+                if (allowControlCharacters)
+                {
+                    stops = _mm_or_si128(stops, _mm_or_si128(_mm_cmpeq_epi16(v, carriageReturns16), _mm_cmpeq_epi16(v, lineFeeds16)));
+                }
+            }
+            else
+            {
+                /* The values are all valid codepoints, so signed comparisons
+                   are safe. */
+                stops = _mm_or_si128(_mm_cmpeq_epi32(v, quotes32), _mm_cmpeq_epi32(v, backslashes32));
+                controls = _mm_cmplt_epi32(v, nonControls32);
+                nulls = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+                ascii = _mm_cmplt_epi32(v, nonASCII32);
+                nonBMP = _mm_cmpgt_epi32(v, lastBMP32);
+                if (allowControlCharacters)
+                {
+                    stops = _mm_or_si128(stops, _mm_or_si128(_mm_cmpeq_epi32(v, carriageReturns32), _mm_cmpeq_epi32(v, lineFeeds32)));
+                }
+            }
+            if (!allowControlCharacters)
+            {
+                stops = _mm_or_si128(stops, controls);
+            }
+            stopMask = (unsigned int)_mm_movemask_epi8(stops);
+            if (stopMask)
+            {
+                spanMask = (1U << LowestSetBit(stopMask)) - 1U;
+            }
+            if ((unsigned int)_mm_movemask_epi8(controls) & spanMask)
+            {
+                SET_FLAGS_ON(TokenAttributes, attributes, JSON_ContainsControlCharacter);
+                if ((unsigned int)_mm_movemask_epi8(nulls) & spanMask)
+                {
+                    SET_FLAGS_ON(TokenAttributes, attributes, JSON_ContainsNullCharacter);
+                }
+            }
+            if (~(unsigned int)_mm_movemask_epi8(ascii) & spanMask)
+            {
+                SET_FLAGS_ON(TokenAttributes, attributes, JSON_ContainsNonASCIICharacter);
+                if ((unsigned int)_mm_movemask_epi8(nonBMP) & spanMask)
+                {
+                    SET_FLAGS_ON(TokenAttributes, attributes, JSON_ContainsNonBMPCharacter);
+                    if (unitLength == 2)
+                    {
+                        /* Each lane accounts for 2 bits of the mask. */
+                        unsigned int trailingMask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, trailingSurrogateMask16), trailingSurrogates16)) & spanMask;
+                        trailingSurrogates += PopCount(trailingMask) / 2;
+                    }
+                }
+            }
+            if (stopMask)
+            {
+                i += LowestSetBit(stopMask);
+                goto done;
+            }
+            i += 16;
+        }
+    }
+#endif
+    while (i + unitLength <= length)
     {
-        JSON_Parser_HandlerResult result;
-        JSON_Parser_NullTerminateToken(parser);
-        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        result = handler(parser, (char*)parser->pTokenBytes, parser->tokenBytesUsed, parser->tokenAttributes);
-        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        if (result != JSON_Parser_Continue)
+        Codepoint c = ReadWideUnit(pBytes + i, encoding);
+        if (c == '"' || c == '\\')
         {
-            JSON_Parser_SetErrorAtToken(parser, (isObjectMember && result == JSON_Parser_TreatAsDuplicateObjectMember)
-                                        ? JSON_Error_DuplicateObjectMember : JSON_Error_AbortedByHandler);
-            return JSON_Failure;
+            break;
+        }
+        if (c < FIRST_NON_CONTROL_CODEPOINT)
+        {
+            if (!allowControlCharacters || c == CARRIAGE_RETURN_CODEPOINT || c == LINE_FEED_CODEPOINT)
+            {
+                break;
+            }
+            SET_FLAGS_ON(TokenAttributes, attributes, c ? JSON_ContainsControlCharacter : JSON_ContainsNullCharacter | JSON_ContainsControlCharacter);
         }
+        else if (c >= FIRST_NON_ASCII_CODEPOINT)
+        {
+            SET_FLAGS_ON(TokenAttributes, attributes, JSON_ContainsNonASCIICharacter);
+            if (c >= FIRST_NON_BMP_CODEPOINT || IS_SURROGATE(c))
+            {
+                SET_FLAGS_ON(TokenAttributes, attributes, JSON_ContainsNonBMPCharacter);
+                if (IS_TRAILING_SURROGATE(c))
+                {
+                    trailingSurrogates++;
+                }
+            }
+        }
+        i += unitLength;
     }
-    return JSON_Success;
+#ifdef JSON_SIMD_SSE2
+done:
+#endif
+    /* Don't split a surrogate pair at the end of the prefix. */
+    if (unitLength == 2 && i && IS_LEADING_SURROGATE(ReadWideUnit(pBytes + i - 2, encoding)))
+    {
+        i -= 2;
+    }
+    SET_FLAGS_ON(TokenAttributes, *pAttributes, attributes);
+    *pCodepoints = i / unitLength - trailingSurrogates;
+    return i;
 }
 
-static JSON_Status JSON_Parser_CallNumberHandler(JSON_Parser parser)
+#define WIDE_WHITESPACE_CHUNK_UNITS 64
+
+/* Narrows a run of UTF-16 or UTF-32 code units to one byte each, so that
+   the UTF-8 scanning functions can be applied to them. Units above U+00FF
+   become 0xFF, which none of those functions accept. */
+static void NarrowWideUnits(const byte* pBytes, size_t units, Encoding encoding, byte* pDest)
 {
-    if (parser->numberHandler)
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+    size_t i = 0;
+#ifdef JSON_SIMD_SSE2
+    const __m128i saturate = _mm_set1_epi16((short)0xFF00);
+    while (i + 8 <= units)
     {
-        JSON_Parser_HandlerResult result;
-        JSON_Parser_NullTerminateToken(parser);
-        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        result = parser->numberHandler(parser, (char*)parser->pTokenBytes, parser->tokenBytesUsed, parser->tokenAttributes);
-        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        if (result != JSON_Parser_Continue)
+        __m128i narrowed;
+        if (unitLength == 2)
         {
-            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
-            return JSON_Failure;
+            narrowed = LoadWideBlock(pBytes + i * 2, encoding);
         }
+        else
+        {
+            /* The values can't be negative, so the signed saturation of
+               the first step doesn't interfere with the second. */
+            narrowed = _mm_packs_epi32(LoadWideBlock(pBytes + i * 4, encoding), LoadWideBlock(pBytes + i * 4 + 16, encoding));
+        }
+        /* Clamp the 16-bit values to 0xFF without going through the signed
+           saturation of _mm_packus_epi16(), which would turn 0x8000 and
+           above into 0x00. */
+        narrowed = _mm_subs_epu16(_mm_adds_epu16(narrowed, saturate), saturate);
+        _mm_storel_epi64((__m128i*)(pDest + i), _mm_packus_epi16(narrowed, narrowed));
+        i += 8;
+    }
+#endif
+    for (; i < units; i++)
+    {
+        Codepoint c = ReadWideUnit(pBytes + i * unitLength, encoding);
+        pDest[i] = (byte)((c > 0xFF) ? 0xFF : c);
     }
-    return JSON_Success;
 }
 
-static JSON_Status JSON_Parser_CallSpecialNumberHandler(JSON_Parser parser)
+/* Returns the number of codepoints in a run of valid UTF-16 or UTF-32 input
+   (see ScanWideCodepoints()), accumulating its line-breaking effects into
+   *pScan, with the offset of the last line start measured in codepoints. */
+static size_t CountWideCodepoints(const byte* pBytes, size_t length, Encoding encoding, WhitespaceScan* pScan)
 {
-    if (parser->specialNumberHandler)
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+    size_t units = length / unitLength;
+    CodepointCount count = { 0, 0 };
+    size_t i = 0;
+#ifdef JSON_SIMD_SSE2
+    if (unitLength == 2)
+    {
+        /* The lane masks are narrowed to 8 bits per unit before being
+           extracted. */
+        const __m128i carriageReturns16 = _mm_set1_epi16(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds16 = _mm_set1_epi16(LINE_FEED_CODEPOINT);
+        const __m128i surrogateBits = _mm_set1_epi16((short)0xFC00);
+        const __m128i trailingSurrogates = _mm_set1_epi16((short)0xDC00);
+        for (; i + 8 <= units; i += 8)
+        {
+            __m128i v = LoadWideBlock(pBytes + i * 2, encoding);
+            __m128i carriageReturnLanes = _mm_cmpeq_epi16(v, carriageReturns16);
+            __m128i lineFeedLanes = _mm_cmpeq_epi16(v, lineFeeds16);
+            __m128i trailingLanes = _mm_cmpeq_epi16(_mm_and_si128(v, surrogateBits), trailingSurrogates);
+            CountCodepointsBlock(pScan, &count, i, 8,
+                                 (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(carriageReturnLanes, carriageReturnLanes)) & 0xFFU,
+                                 (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(lineFeedLanes, lineFeedLanes)) & 0xFFU,
+                                 (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(trailingLanes, trailingLanes)) & 0xFFU);
+        }
+    }
+    else
     {
-        JSON_Parser_HandlerResult result;
-        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        result = parser->specialNumberHandler(parser, parser->token == T_NAN ? JSON_NaN :
-                                              (parser->token == T_INFINITY ? JSON_Infinity : JSON_NegativeInfinity));
-        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
-        if (result != JSON_Parser_Continue)
+        /* The CR and LF lane masks are narrowed together, into the low and
+           high 4 bits of an 8-bit mask. */
+        const __m128i carriageReturns32 = _mm_set1_epi32(CARRIAGE_RETURN_CODEPOINT);
+        const __m128i lineFeeds32 = _mm_set1_epi32(LINE_FEED_CODEPOINT);
+        for (; i + 4 <= units; i += 4)
         {
-            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
-            return JSON_Failure;
+            __m128i v = LoadWideBlock(pBytes + i * 4, encoding);
+            __m128i lineBreakLanes = _mm_packs_epi32(_mm_cmpeq_epi32(v, carriageReturns32), _mm_cmpeq_epi32(v, lineFeeds32));
+            unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(lineBreakLanes, lineBreakLanes));
+            CountCodepointsBlock(pScan, &count, i, 4, mask & 0xFU, (mask >> 4) & 0xFU, 0);
         }
     }
-    return JSON_Success;
+#endif
+    for (; i < units; i++)
+    {
+        Codepoint c = ReadWideUnit(pBytes + i * unitLength, encoding);
+        CountCodepointsUnit(pScan, &count, i, c, unitLength == 2 && IS_TRAILING_SURROGATE(c));
+    }
+    return FinishCodepointCount(pScan, &count, units);
 }
 
-static JSON_Status JSON_Parser_HandleGrammarEvents(JSON_Parser parser, byte emit)
+/* Transcodes a run of valid UTF-16 or UTF-32 input (see
+   ScanWideCodepoints()) to the specified encoding, and returns the number of
+   bytes written. */
+static size_t TranscodeWideCodepoints(const byte* pBytes, size_t length, Encoding inputEncoding, Encoding outputEncoding, byte* pDest)
 {
-    if (GET_FLAGS(emit, EMIT_ARRAY_ITEM))
+    size_t i = 0;
+    size_t written = 0;
+    if (inputEncoding == outputEncoding)
     {
-        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->arrayItemHandler))
+        memcpy(pDest, pBytes, length);
+        return length;
+    }
+#ifdef JSON_SIMD_SSE2
+    if (outputEncoding == JSON_UTF8)
+    {
+        /* Narrow 8 units at a time for as long as they are all ASCII. */
+        size_t unitLength = SHORTEST_ENCODING_SEQUENCE(inputEncoding);
+        const __m128i lastASCII16 = _mm_set1_epi16(FIRST_NON_ASCII_CODEPOINT - 1);
+        const __m128i lastASCII32 = _mm_set1_epi32(FIRST_NON_ASCII_CODEPOINT - 1);
+        while (i + 8 * unitLength <= length)
         {
-            return JSON_Failure;
+            __m128i narrowed;
+            if (unitLength == 2)
+            {
+                narrowed = LoadWideBlock(pBytes + i, inputEncoding);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(narrowed, lastASCII16), _mm_setzero_si128())) != 0xFFFF)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                __m128i v0 = LoadWideBlock(pBytes + i, inputEncoding);
+                __m128i v1 = LoadWideBlock(pBytes + i + 16, inputEncoding);
+                if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi32(v0, lastASCII32), _mm_cmpgt_epi32(v1, lastASCII32))))
+                {
+                    break;
+                }
+                narrowed = _mm_packs_epi32(v0, v1);
+            }
+            _mm_storel_epi64((__m128i*)(pDest + written), _mm_packus_epi16(narrowed, narrowed));
+            written += 8;
+            i += 8 * unitLength;
         }
-        SET_FLAGS_OFF(byte, emit, EMIT_ARRAY_ITEM);
     }
-    switch (emit)
+#endif
+    while (i < length)
     {
-    case EMIT_NULL:
-        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->nullHandler))
+        size_t encodedLength;
+        Codepoint c = ReadWideCodepoint(pBytes + i, inputEncoding, &encodedLength);
+        if (outputEncoding == JSON_UTF8 && c < FIRST_NON_ASCII_CODEPOINT)
         {
-            return JSON_Failure;
+            pDest[written++] = (byte)c;
         }
-        break;
-
-    case EMIT_BOOLEAN:
-        if (!JSON_Parser_CallBooleanHandler(parser))
+        else
         {
-            return JSON_Failure;
+            written += EncodeCodepoint(c, outputEncoding, pDest + written);
         }
-        break;
+        i += encodedLength;
+    }
+    return written;
+}
 
-    case EMIT_STRING:
-        if (!JSON_Parser_CallStringHandler(parser, 0/* isObjectMember */))
-        {
-            return JSON_Failure;
-        }
-        break;
+#endif /* JSON_NO_PARSER */
 
-    case EMIT_NUMBER:
-        if (!JSON_Parser_CallNumberHandler(parser))
-        {
-            return JSON_Failure;
-        }
-        break;
+/******************** JSON Lexer States ********************/
 
-    case EMIT_SPECIAL_NUMBER:
-        if (!JSON_Parser_CallSpecialNumberHandler(parser))
-        {
-            return JSON_Failure;
-        }
-        break;
+/* Mutually-exclusive lexer states. */
+#define LEXING_WHITESPACE                                     0
+#define LEXING_LITERAL                                        1
+#define LEXING_STRING                                         2
+#define LEXING_STRING_ESCAPE                                  3
+#define LEXING_STRING_HEX_ESCAPE_BYTE_1                       4
+#define LEXING_STRING_HEX_ESCAPE_BYTE_2                       5
+#define LEXING_STRING_HEX_ESCAPE_BYTE_3                       6
+#define LEXING_STRING_HEX_ESCAPE_BYTE_4                       7
+#define LEXING_STRING_HEX_ESCAPE_BYTE_5                       8
+#define LEXING_STRING_HEX_ESCAPE_BYTE_6                       9
+#define LEXING_STRING_HEX_ESCAPE_BYTE_7                       10
+#define LEXING_STRING_HEX_ESCAPE_BYTE_8                       11
+#define LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_BACKSLASH 12
+#define LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_U         13
+#define LEXING_NUMBER_AFTER_MINUS                             14
+#define LEXING_NUMBER_AFTER_LEADING_ZERO                      15
+#define LEXING_NUMBER_AFTER_LEADING_NEGATIVE_ZERO             16
+#define LEXING_NUMBER_AFTER_X                                 17
+#define LEXING_NUMBER_HEX_DIGITS                              18
+#define LEXING_NUMBER_DECIMAL_DIGITS                          19
+#define LEXING_NUMBER_AFTER_DOT                               20
+#define LEXING_NUMBER_FRACTIONAL_DIGITS                       21
+#define LEXING_NUMBER_AFTER_E                                 22
+#define LEXING_NUMBER_AFTER_EXPONENT_SIGN                     23
+#define LEXING_NUMBER_EXPONENT_DIGITS                         24
+#define LEXING_COMMENT_AFTER_SLASH                            25
+#define LEXING_SINGLE_LINE_COMMENT                            26
+#define LEXING_MULTI_LINE_COMMENT                             27
+#define LEXING_MULTI_LINE_COMMENT_AFTER_STAR                  28
+#define LEXER_ERROR                                           255
+typedef byte LexerState;
 
-    case EMIT_START_OBJECT:
-        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->startObjectHandler) ||
-            !JSON_Parser_StartContainer(parser, 1/*isObject*/))
-        {
-            return JSON_Failure;
-        }
-        break;
+/******************** JSON Grammarian ********************/
 
-    case EMIT_END_OBJECT:
-        JSON_Parser_EndContainer(parser, 1/*isObject*/);
-        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->endObjectHandler))
-        {
-            return JSON_Failure;
-        }
-        break;
+/* The JSON grammar comprises the following productions:
 
-    case EMIT_OBJECT_MEMBER:
-        if (!JSON_Parser_AddMemberNameToList(parser) || /* will fail if member is duplicate */
-            !JSON_Parser_CallStringHandler(parser, 1 /* isObjectMember */))
-        {
-            return JSON_Failure;
-        }
-        break;
+   1.  VALUE => null
+   2.  VALUE => boolean
+   3.  VALUE => string
+   4.  VALUE => number
+   5.  VALUE => specialnumber
+   6.  VALUE => { MEMBERS }
+   7.  VALUE => [ ITEMS ]
+   8.  MEMBERS => MEMBER MORE_MEMBERS
+   9.  MEMBERS => e
+   10. MEMBER => string : VALUE
+   11. MORE_MEMBERS => , MEMBER MORE_MEMBERS
+   12. MORE_MEMBERS => e
+   13. ITEMS => ITEM MORE_ITEMS
+   14. ITEMS => e
+   15. ITEM => VALUE
+   16. MORE_ITEMS => , ITEM MORE_ITEMS
+   17. MORE_ITEMS => e
 
-    case EMIT_START_ARRAY:
-        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->startArrayHandler) ||
-            !JSON_Parser_StartContainer(parser, 0/*isObject*/))
-        {
-            return JSON_Failure;
-        }
-        break;
+   We implement a simple LL(1) parser based on this grammar, with events
+   emitted when certain non-terminals are replaced.
+*/
 
-    case EMIT_END_ARRAY:
-        JSON_Parser_EndContainer(parser, 0/*isObject*/);
-        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->endArrayHandler))
-        {
-            return JSON_Failure;
-        }
-        break;
+/* Mutually-exclusive grammar tokens and non-terminals. The values are defined
+   so that the bottom 4 bits of a value can be used as an index into the
+   grammar production rule table. */
+#define T_NONE              0x00 /* tokens are in the form 0x0X */
+#define T_NULL              0x01
+#define T_TRUE              0x02
+#define T_FALSE             0x03
+#define T_STRING            0x04
+#define T_NUMBER            0x05
+#define T_NAN               0x06
+#define T_INFINITY          0x07
+#define T_NEGATIVE_INFINITY 0x08
+#define T_LEFT_CURLY        0x09
+#define T_RIGHT_CURLY       0x0A
+#define T_LEFT_SQUARE       0x0B
+#define T_RIGHT_SQUARE      0x0C
+#define T_COLON             0x0D
+#define T_COMMA             0x0E
+#define NT_VALUE            0x10 /* non-terminals are in the form 0x1X */
+#define NT_MEMBERS          0x11
+#define NT_MEMBER           0x12
+#define NT_MORE_MEMBERS     0x13
+#define NT_ITEMS            0x14
+#define NT_ITEM             0x15
+#define NT_MORE_ITEMS       0x16
+typedef byte Symbol;
+
+#define IS_NONTERMINAL(s) ((s) & 0x10)
+#define IS_TOKEN(s)       !IS_NONTERMINAL(s)
+
+/* Grammarian data. */
+typedef struct tag_GrammarianData
+{
+    Symbol* pStack; /* initially set to defaultStack */
+    size_t  stackSize;
+    size_t  stackUsed;
+    Symbol  defaultStack[DEFAULT_SYMBOL_STACK_SIZE];
+} GrammarianData;
+typedef GrammarianData* Grammarian;
+
+/* Mutually-exclusive result codes returned by the grammarian
+   after processing a token. */
+#define ACCEPTED_TOKEN    0
+#define REJECTED_TOKEN    1
+#define SYMBOL_STACK_FULL 2
+typedef uint32_t GrammarianResultCode;
+
+/* Events emitted by the grammarian as a result of processing a
+   token. Note that EMIT_ARRAY_ITEM always appears bitwise OR-ed
+   with one of the other values. */
+#define EMIT_NOTHING        0x00
+#define EMIT_NULL           0x01
+#define EMIT_BOOLEAN        0x02
+#define EMIT_STRING         0x03
+#define EMIT_NUMBER         0x04
+#define EMIT_SPECIAL_NUMBER 0x05
+#define EMIT_START_OBJECT   0x06
+#define EMIT_END_OBJECT     0x07
+#define EMIT_OBJECT_MEMBER  0x08
+#define EMIT_START_ARRAY    0x09
+#define EMIT_END_ARRAY      0x0A
+#define EMIT_ARRAY_ITEM     0x10 /* may be combined with other values */
+typedef byte GrammarEvent;
+
+/* The bits of GrammarianOutput are layed out as follows:
+
+     -rreeeee
+
+     - = unused (1 bit)
+     r = result code (2 bits)
+     e = event (5 bits)
+ */
+#define GRAMMARIAN_OUTPUT(r, e)   (GrammarianOutput)(((GrammarianResultCode)(r) << 5) | (GrammarEvent)(e))
+#define GRAMMARIAN_RESULT_CODE(o) (GrammarianResultCode)((GrammarianOutput)(o) >> 5)
+#define GRAMMARIAN_EVENT(o)       (GrammarEvent)((GrammarianOutput)(o) & 0x1F)
+typedef byte GrammarianOutput;
+
+/* Grammar rule used by the grammarian to process a token. */
+typedef struct tag_GrammarRule
+{
+    Symbol       symbolToPush1;
+    Symbol       symbolToPush2;
+    byte         reprocess;
+    GrammarEvent emit;
+} GrammarRule;
+
+/* Grammarian functions. */
+
+static void Grammarian_Reset(Grammarian grammarian, int isInitialized)
+{
+    /* When we reset the grammarian, we keep the symbol stack that has
+       already been allocated, if any. If the client wants to reclaim the
+       memory used by the that buffer, he needs to free the grammarian
+       and create a new one. */
+    if (!isInitialized)
+    {
+        grammarian->pStack = grammarian->defaultStack;
+        grammarian->stackSize = sizeof(grammarian->defaultStack);
     }
-    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT))
+
+    /* The grammarian always starts with NT_VALUE on the symbol stack. */
+    grammarian->pStack[0] = NT_VALUE;
+    grammarian->stackUsed = 1;
+}
+
+static void Grammarian_FreeAllocations(Grammarian grammarian, const JSON_MemorySuite* pMemorySuite)
+{
+    if (grammarian->pStack != grammarian->defaultStack)
     {
-        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_StoppedAfterEmbeddedDocument);
-        return JSON_Failure;
+        pMemorySuite->free(pMemorySuite->userData, grammarian->pStack);
     }
-    return JSON_Success;
 }
 
-static JSON_Status JSON_Parser_ProcessToken(JSON_Parser parser)
+#ifndef JSON_NO_PARSER
+
+static int Grammarian_ResizeStack(Grammarian grammarian, const JSON_MemorySuite* pMemorySuite, size_t newSize)
 {
-    GrammarianOutput output;
-    output = Grammarian_ProcessToken(&parser->grammarianData, parser->token, &parser->memorySuite);
-    switch (GRAMMARIAN_RESULT_CODE(output))
+    /* Like the parser's token buffer, the stack moves between the built-in
+       buffer and the heap as needed. */
+    Symbol* pNewStack;
+    if (newSize <= sizeof(grammarian->defaultStack))
     {
-    case ACCEPTED_TOKEN:
-        if (!JSON_Parser_HandleGrammarEvents(parser, GRAMMARIAN_EVENT(output)))
+        if (grammarian->pStack != grammarian->defaultStack)
         {
-            return JSON_Failure;
+            memcpy(grammarian->defaultStack, grammarian->pStack, grammarian->stackUsed);
+            pMemorySuite->free(pMemorySuite->userData, grammarian->pStack);
+            grammarian->pStack = grammarian->defaultStack;
+            grammarian->stackSize = sizeof(grammarian->defaultStack);
         }
-        break;
-
-    case REJECTED_TOKEN:
-        JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnexpectedToken);
-        return JSON_Failure;
-
-    case SYMBOL_STACK_FULL:
-        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
-        return JSON_Failure;
+        return 1;
     }
-
-    /* Reset the lexer to prepare for the next token. */
-    parser->lexerState = LEXING_WHITESPACE;
-    parser->lexerBits = 0;
-    parser->token = T_NONE;
-    parser->tokenAttributes = 0;
-    parser->tokenBytesUsed = 0;
-    return JSON_Success;
+    if (grammarian->pStack == grammarian->defaultStack)
+    {
+        pNewStack = (Symbol*)pMemorySuite->realloc(pMemorySuite->userData, NULL, newSize);
+        if (pNewStack)
+        {
+            memcpy(pNewStack, grammarian->defaultStack, grammarian->stackUsed);
+        }
+    }
+    else
+    {
+        pNewStack = (Symbol*)pMemorySuite->realloc(pMemorySuite->userData, grammarian->pStack, newSize);
+    }
+    if (!pNewStack)
+    {
+        return 0;
+    }
+    grammarian->pStack = pNewStack;
+    grammarian->stackSize = newSize;
+    return 1;
 }
 
-/* Lexer functions. */
+#endif /* JSON_NO_PARSER */
 
-static const byte expectedLiteralChars[] = { 'u', 'l', 'l', 0, 'r', 'u', 'e', 0, 'a', 'l', 's', 'e', 0, 'a', 'N', 0, 'n', 'f', 'i', 'n', 'i', 't', 'y', 0  };
+static int Grammarian_FinishedDocument(Grammarian grammarian)
+{
+    return !grammarian->stackUsed;
+}
 
-#define NULL_LITERAL_EXPECTED_CHARS_START_INDEX     0
-#define TRUE_LITERAL_EXPECTED_CHARS_START_INDEX     4
-#define FALSE_LITERAL_EXPECTED_CHARS_START_INDEX    8
-#define NAN_LITERAL_EXPECTED_CHARS_START_INDEX      13
-#define INFINITY_LITERAL_EXPECTED_CHARS_START_INDEX 16
+static GrammarianOutput Grammarian_ProcessToken(Grammarian grammarian, Symbol token, const JSON_MemorySuite* pMemorySuite)
+{
+    /* The order and number of the rows and columns in this table must
+       match the defined token and non-terminal symbol values.
 
-/* Forward declaration. */
-static JSON_Status JSON_Parser_FlushLexer(JSON_Parser parser);
-static JSON_Status JSON_Parser_ProcessCodepoint(JSON_Parser parser, Codepoint c, size_t encodedLength);
+       The row index is the incoming token's Symbol value.
 
-static JSON_Status JSON_Parser_HandleInvalidEncodingSequence(JSON_Parser parser, size_t encodedLength) {
-    if (parser->token == T_STRING && GET_FLAGS(parser->flags, PARSER_REPLACE_INVALID))
+       The column index is the bottom 4 bits of Symbol value of
+       the non-terminal at the top of the processing stack.
+       Since non-terminal Symbol values start at 0x10, taking
+       the bottom 4 bits yields a 0-based index. */
+    static const byte ruleLookup[15][7] =
     {
-        /* Since we're inside a string token, replacing the invalid sequence
-           with the Unicode replacement character as requested by the client
-           is a viable way to avoid a parse failure. Outside a string token,
-           such a replacement would simply trigger JSON_Error_UnknownToken
-           when we tried to process the replacement character, so it's less
-           confusing to stick with JSON_Error_InvalidEncodingSequence in that
-           case. */
-        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsReplacedCharacter);
-        return JSON_Parser_ProcessCodepoint(parser, REPLACEMENT_CHARACTER_CODEPOINT, encodedLength);
+        /*             V     MS    M     MM    IS    I     MI  */
+        /*  ----  */ { 0,    0,    0,    0,    0,    0,    0  },
+        /*  null  */ { 1,    0,    0,    0,    13,   15,   0  },
+        /*  true  */ { 2,    0,    0,    0,    13,   15,   0  },
+        /* false  */ { 2,    0,    0,    0,    13,   15,   0  },
+        /* string */ { 3,    8,    10,   0,    13,   15,   0  },
+        /* number */ { 4,    0,    0,    0,    13,   15,   0  },
+        /*  NaN   */ { 5,    0,    0,    0,    13,   15,   0  },
+        /*  Inf   */ { 5,    0,    0,    0,    13,   15,   0  },
+        /* -Inf   */ { 5,    0,    0,    0,    13,   15,   0  },
+        /*   {    */ { 6,    0,    0,    0,    13,   15,   0  },
+        /*   }    */ { 0,    9,    0,    12,   0,    0,    0  },
+        /*   [    */ { 7,    0,    0,    0,    13,   15,   0  },
+        /*   ]    */ { 0,    0,    0,    0,    14,   0,    17 },
+        /*   :    */ { 0,    0,    0,    0,    0,    0,    0  },
+        /*   ,    */ { 0,    0,    0,    11,   0,    0,    16 }
+    };
+
+    static const GrammarRule rules[17] =
+    {
+        /* 1.  */ { T_NONE,          T_NONE,      0, EMIT_NULL           },
+        /* 2.  */ { T_NONE,          T_NONE,      0, EMIT_BOOLEAN        },
+        /* 3.  */ { T_NONE,          T_NONE,      0, EMIT_STRING         },
+        /* 4.  */ { T_NONE,          T_NONE,      0, EMIT_NUMBER         },
+        /* 5.  */ { T_NONE,          T_NONE,      0, EMIT_SPECIAL_NUMBER },
+        /* 6.  */ { T_RIGHT_CURLY,   NT_MEMBERS,  0, EMIT_START_OBJECT   },
+        /* 7.  */ { T_RIGHT_SQUARE,  NT_ITEMS,    0, EMIT_START_ARRAY    },
+        /* 8.  */ { NT_MORE_MEMBERS, NT_MEMBER,   1, EMIT_NOTHING        },
+        /* 9.  */ { T_NONE,          T_NONE,      1, EMIT_END_OBJECT     },
+        /* 10. */ { NT_VALUE,        T_COLON,     0, EMIT_OBJECT_MEMBER  },
+        /* 11. */ { NT_MORE_MEMBERS, NT_MEMBER,   0, EMIT_NOTHING        },
+        /* 12. */ { T_NONE,          T_NONE,      1, EMIT_END_OBJECT     },
+        /* 13. */ { NT_MORE_ITEMS,   NT_ITEM,     1, EMIT_NOTHING        },
+        /* 14. */ { T_NONE,          T_NONE,      1, EMIT_END_ARRAY      },
+        /* 15. */ { NT_VALUE,        T_NONE,      1, EMIT_ARRAY_ITEM     },
+        /* 16. */ { NT_MORE_ITEMS,   NT_ITEM,     0, EMIT_NOTHING        },
+        /* 17. */ { T_NONE,          T_NONE,      1, EMIT_END_ARRAY      }
+    };
+
+    GrammarEvent emit = EMIT_NOTHING;
+
+    /* If the stack is empty, no more tokens were expected. */
+    if (Grammarian_FinishedDocument(grammarian))
+    {
+        return GRAMMARIAN_OUTPUT(REJECTED_TOKEN, EMIT_NOTHING);
     }
-    else if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT))
+
+    for (;;)
     {
-        /* Since we're parsing the top-level value of an embedded
-           document, assume that the invalid encoding sequence we've
-           encountered does not actually belong to the document, and
-           finish parsing by pretending that we've encountered EOF
-           instead of an invalid sequence. If the content is valid,
-           this will fail with JSON_Error_StoppedAfterEmbeddedDocument;
-           otherwise, it will fail with an appropriate error. */
-        return JSON_Parser_FlushLexer(parser) && JSON_Parser_FlushParser(parser);
+        Symbol topSymbol = grammarian->pStack[grammarian->stackUsed - 1];
+        if (IS_TOKEN(topSymbol))
+        {
+            if (topSymbol != token)
+            {
+                return GRAMMARIAN_OUTPUT(REJECTED_TOKEN, EMIT_NOTHING);
+            }
+            grammarian->stackUsed--;
+            break;
+        }
+        else
+        {
+            byte ruleNumber = ruleLookup[token][BOTTOM_4_BITS(topSymbol)];
+            if (ruleNumber == 0)
+            {
+                return GRAMMARIAN_OUTPUT(REJECTED_TOKEN, EMIT_NOTHING);
+            }
+            else
+            {
+                const GrammarRule* pRule = &rules[ruleNumber - 1];
+                if (pRule->symbolToPush1 == T_NONE)
+                {
+                    /* The rule removes the top symbol and does not replace it. */
+                    grammarian->stackUsed--;
+                }
+                else
+                {
+                    /* The rule replaces the top symbol with 1 or 2 symbols. */
+                    grammarian->pStack[grammarian->stackUsed - 1] = pRule->symbolToPush1;
+                    if (pRule->symbolToPush2 != T_NONE)
+                    {
+                        /* The rule replaces the top symbol with 2 symbols.
+                           Make sure the stack has room for the second one. */
+                        if (grammarian->stackUsed == grammarian->stackSize)
+                        {
+                            Symbol* pBiggerStack = DoubleBuffer(pMemorySuite, grammarian->defaultStack, grammarian->pStack, grammarian->stackSize);
+                            if (!pBiggerStack)
+                            {
+                                return GRAMMARIAN_OUTPUT(SYMBOL_STACK_FULL, EMIT_NOTHING);
+                            }
+                            grammarian->pStack = pBiggerStack;
+                            grammarian->stackSize *= 2;
+                        }
+                        grammarian->pStack[grammarian->stackUsed] = pRule->symbolToPush2;
+                        grammarian->stackUsed++;
+                    }
+                }
+                emit |= pRule->emit;
+                if (!pRule->reprocess)
+                {
+                    break;
+                }
+            }
+        }
     }
-    JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_InvalidEncodingSequence);
-    return JSON_Failure;
+
+    return GRAMMARIAN_OUTPUT(ACCEPTED_TOKEN, emit);
 }
 
-static JSON_Status JSON_Parser_HandleInvalidNumber(JSON_Parser parser, Codepoint c, int codepointsSinceValidNumber, TokenAttributes attributesToRemove)
-{
-    SET_FLAGS_OFF(TokenAttributes, parser->tokenAttributes, attributesToRemove);
-    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT))
-    {
-        /* The invalid number is the top-level value of an embedded document,
-           and it has a prefix that can be interpreted as a valid number.
-           We want to backtrack so that we are at the end of that prefix,
-           and then process the valid token.
+/******************** JSON Parser ********************/
 
-           Note that backtracking requires us to make three assumptions, which
-           are always valid in the context of a number token:
+#ifndef JSON_NO_PARSER
 
-           1. The input encoding is not JSON_UnknownEncoding.
+/* Combinable parser state flags. */
+#define PARSER_RESET                 0x00
+#define PARSER_STARTED               0x01
+#define PARSER_FINISHED              0x02
+#define PARSER_IN_PROTECTED_API      0x04
+#define PARSER_IN_TOKEN_HANDLER      0x08
+#define PARSER_AFTER_CARRIAGE_RETURN 0x10
+#define PARSER_LAZY_AFTER_CR         0x20
+#define PARSER_SKIPPING_VALUE        0x40
+#define PARSER_MATCHED_ALL_PATHS     0x80
+#define PARSER_FILTERING_PATHS       0x100
+#define PARSER_OUTSIDE_MATCHED_VALUE 0x200
+#define PARSER_SUSPENDED             0x400
+#define PARSER_REPLAYING_DETECTION   0x800
+typedef unsigned short ParserState;
 
-           2 The codepoints we are backing up across are all in the range
-           U+0000 - U+007F, aka ASCII, so we can assume the number of
-           bytes comprising them based on the input encoding.
+/* Combinable parser settings flags. */
+#define PARSER_DEFAULT_FLAGS         0x00
+#define PARSER_ALLOW_BOM             0x01
+#define PARSER_ALLOW_COMMENTS        0x02
+#define PARSER_ALLOW_SPECIAL_NUMBERS 0x04
+#define PARSER_ALLOW_HEX_NUMBERS     0x08
+#define PARSER_REPLACE_INVALID       0x10
+#define PARSER_TRACK_OBJECT_MEMBERS  0x20
+#define PARSER_ALLOW_CONTROL_CHARS   0x40
+#define PARSER_EMBEDDED_DOCUMENT     0x80
+#define PARSER_LAZY_LOCATIONS        0x100
+#define PARSER_SKIP_UNKNOWN_MEMBERS  0x200
+#define PARSER_MULTIPLE_DOCUMENTS    0x400
+#define PARSER_ARRAY_SEGMENT         0x800
+typedef unsigned short ParserFlags;
 
-           3. The codepoints we are backing up across do not include any
-           line breaks, so we can assume that the line number stays the
-           same and the column number can simply be decremented.
+/* Sentinel value for parser error location offset. */
+#define ERROR_LOCATION_IS_TOKEN_START 0xFF
 
-           For example:
+/* Combinable scanned number flags. */
+#define NUMBER_TRUNCATED             0x01 /* a nonzero digit was dropped */
+#define NUMBER_OVERFLOWED            0x02 /* too big for any native type */
+typedef byte NumberFlags;
 
-               "01"     => "0"
-               "123.!"  => "123"
-               "123e!"  => "123"
-               "123e+!" => "123"
-               "123e-!" => "123"
-               "1.2e!"  => "1.2"
-               "1.2e+!" => "1.2"
-               "1.2e-!" => "1.2"
-        */
-        parser->codepointLocationByte -= (size_t)codepointsSinceValidNumber * SHORTEST_ENCODING_SEQUENCE(parser->inputEncoding);
-        parser->codepointLocationColumn -= (size_t)codepointsSinceValidNumber;
-        parser->tokenBytesUsed -= (size_t)codepointsSinceValidNumber * SHORTEST_ENCODING_SEQUENCE(parser->numberEncoding);
-        return JSON_Parser_ProcessToken(parser); /* always fails */
-    }
-    else if (c == EOF_CODEPOINT)
+/* The largest mantissa that another decimal digit can always be appended
+   to, and the largest digit that can be appended to it. */
+#define MAX_MANTISSA_BEFORE_DIGIT    (~(JSON_UInt64)0 / 10)
+#define MAX_LAST_MANTISSA_DIGIT      ((unsigned int)(~(JSON_UInt64)0 % 10))
+
+/* The magnitude of decimal exponents past which a number is certainly not
+   representable as a double, used to keep the exponents from overflowing. */
+#define MAX_NUMBER_EXPONENT          100000000
+
+static size_t GetGrownLength(size_t length, size_t defaultLength, size_t neededLength)
+{
+    /* Double the length until it is big enough, without overflowing. */
+    size_t newLength = length ? length : defaultLength;
+    while (newLength < neededLength)
     {
-        /* Allow JSON_Parser_FlushLexer() to fail. */
-        return JSON_Success;
+        if (newLength > SIZE_MAX / 2)
+        {
+            return neededLength;
+        }
+        newLength *= 2;
     }
-    JSON_Parser_SetErrorAtToken(parser, JSON_Error_InvalidNumber);
-    return JSON_Failure;
+    return newLength;
 }
 
-static void JSON_Parser_StartToken(JSON_Parser parser, Symbol token)
+/* A slot in an object's hash set of member names, used for detecting
+   duplicate member names. The name's bytes are stored, not null-terminated,
+   in the parser's member name buffer at nameOffset. */
+typedef struct tag_MemberName
 {
-    parser->token = token;
-    parser->tokenLocationByte = parser->codepointLocationByte;
-    parser->tokenLocationLine = parser->codepointLocationLine;
-    parser->tokenLocationColumn = parser->codepointLocationColumn;
-}
+    size_t hash;
+    size_t nameOffset; /* EMPTY_MEMBER_NAME_SLOT if the slot is unused */
+    size_t length;
+} MemberName;
 
-static JSON_Status JSON_Parser_ProcessCodepoint(JSON_Parser parser, Codepoint c, size_t encodedLength)
+#define EMPTY_MEMBER_NAME_SLOT   SIZE_MAX
+
+/* The initial number of slots in an object's hash set. This must be a power
+   of 2; sets are kept at most three-quarters full. */
+#define DEFAULT_MEMBER_NAME_SLOTS  8
+
+/* The initial depth of the stack of open objects' hash sets. */
+#define DEFAULT_MEMBER_NAMES_DEPTH 8
+
+/* The initial length of the buffer that holds the open objects' member
+   names. */
+#define DEFAULT_MEMBER_NAME_BYTES  256
+
+/* An open object's hash set of member names. The sets of all the open
+   objects are stored one after another, innermost last, in the parser's
+   slot buffer, and their names likewise in the parser's member name buffer.
+   An object can only gain members while none of its descendants are open,
+   so its set is always the last one when it needs to grow. Because arrays
+   do not have named items, they do not need to be recorded. */
+typedef struct tag_MemberNames
 {
-    Codepoint codepointToRecord = EOF_CODEPOINT;
-    Encoding tokenEncoding;
-    size_t maxTokenLength;
-    int tokenFinished = 0;
+    size_t firstSlot;
+    size_t slotCount; /* 0 until the object's first member is added */
+    size_t nameCount;
+    size_t firstNameByte;
+} MemberNames;
 
-    /* If the previous codepoint was U+000D (CARRIAGE RETURN), and the current
-       codepoint is U+000A (LINE FEED), then treat the 2 codepoints as a single
-       line break. */
-    if (GET_FLAGS(parser->state, PARSER_AFTER_CARRIAGE_RETURN))
-    {
-        if (c == LINE_FEED_CODEPOINT)
-        {
-            parser->codepointLocationLine--;
-        }
-        SET_FLAGS_OFF(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN);
-    }
+/* A member name in the parser's table of interned names. The name is
+   allocated separately, so that the pointer passed to the client stays put
+   for as long as the name stays in the table. */
+typedef struct tag_InternedKey
+{
+    byte*  pName; /* null-terminated */
+    size_t length;
+    size_t hash;
+    byte   isRecentlyUsed;
+} InternedKey;
 
-reprocess:
+#define DEFAULT_INTERNED_KEY_CAPACITY 1024
 
-    switch (parser->lexerState)
-    {
-    case LEXING_WHITESPACE:
-        if (c == '{')
-        {
-            JSON_Parser_StartToken(parser, T_LEFT_CURLY);
-            tokenFinished = 1;
-        }
-        else if (c == '}')
-        {
-            JSON_Parser_StartToken(parser, T_RIGHT_CURLY);
-            tokenFinished = 1;
+/* Marks an empty slot in the index of interned names. */
+#define NO_INTERNED_KEY               JSON_NO_KEY_ID
+
+/* A member name passed to JSON_Parser_SetKnownKeys(). */
+typedef struct tag_KnownKey
+{
+    size_t offset; /* of the name in the known keys' byte buffer */
+    size_t length;
+} KnownKey;
+
+/* The names passed to JSON_Parser_SetKnownKeys(), compiled into a perfect
+   hash table using the "hash, displace and compress" scheme: a name's hash
+   selects a bucket, and the bucket's displacement selects the name's slot
+   in the table. The displacements are chosen so that no two names share a
+   slot, so looking up a name takes one comparison. Everything is stored in
+   a single allocation, after the structure itself. */
+typedef struct tag_KnownKeys
+{
+    size_t      size; /* of the whole allocation */
+    JSON_UInt64 seed;
+    size_t      keyCount;
+    size_t      bucketMask;
+    size_t      slotMask;
+    size_t*     pDisplacements;
+    size_t*     pSlots;
+    KnownKey*   pKeys;
+    byte*       pBytes;
+} KnownKeys;
+
+/* The number of times to try to compile the known names with different
+   seeds before giving the table more slots. */
+#define KNOWN_KEY_SEEDS_PER_SIZE 4
+
+/* A reference token of a path passed to JSON_Parser_SetPathFilter(). */
+typedef struct tag_PathSegment
+{
+    size_t offset;     /* of the unescaped name in the filter's byte buffer */
+    size_t length;
+    size_t index;      /* the array index that the name spells, if any */
+    byte   isWildcard;
+} PathSegment;
+
+/* Marks a segment whose name is not an array index. */
+#define NOT_AN_ARRAY_INDEX SIZE_MAX
+
+/* A path passed to JSON_Parser_SetPathFilter(). A path without wildcards
+   can match at most one value per document. */
+typedef struct tag_FilterPath
+{
+    size_t firstSegment;
+    size_t segmentCount;
+    byte   hasWildcard;
+    byte   isMatched;  /* in the current document */
+} FilterPath;
+
+/* The paths passed to JSON_Parser_SetPathFilter(), stored, like the known
+   names, in a single allocation after the structure itself. */
+typedef struct tag_PathFilter
+{
+    size_t       size; /* of the whole allocation */
+    size_t       pathCount;
+    size_t       wildcardPathCount;
+    size_t       matchedPathCount; /* without wildcards, in the current document */
+    FilterPath*  pPaths;
+    PathSegment* pSegments;
+    byte*        pBytes;
+} PathFilter;
+
+/* An open container whose descendants may match a filter path. The indexes
+   of the paths that the container's own path is a prefix of are stored in
+   the parser's live path buffer, innermost container last, followed by
+   those of the paths that the container's pending child may match. */
+typedef struct tag_PathFrame
+{
+    size_t firstLivePath;
+    size_t livePathCount;
+    size_t itemCount;     /* so far, if the container is an array */
+} PathFrame;
+
+#define DEFAULT_PATH_FRAMES 8
+#define DEFAULT_LIVE_PATHS  16
+
+/* Marks the absence of a matched value. */
+#define NO_MATCHED_VALUE SIZE_MAX
+
+/* A parser instance. */
+struct JSON_Parser_Data
+{
+    JSON_MemorySuite                    memorySuite;
+    void*                               userData;
+    ParserState                         state;
+    ParserFlags                         flags;
+    Encoding                            inputEncoding;
+    Encoding                            stringEncoding;
+    Encoding                            numberEncoding;
+    Symbol                              token;
+    TokenAttributes                     tokenAttributes;
+    Error                               error;
+    byte                                errorOffset;
+    LexerState                          lexerState;
+    uint32_t                            lexerBits;
+    size_t                              codepointLocationByte;
+    size_t                              codepointLocationLine;
+    size_t                              codepointLocationColumn;
+    size_t                              tokenLocationByte;
+    size_t                              tokenLocationLine;
+    size_t                              tokenLocationColumn;
+    size_t                              lazyLocationByte;
+    size_t                              lazyLocationLine;
+    size_t                              lazyLocationColumn;
+    DecoderData                         lazyLocationDecoderData;
+    const byte*                         pLazyLocationWindow;
+    size_t                              lazyLocationWindowByte;
+    size_t                              lazyLocationWindowLength;
+    size_t                              depth;
+    size_t                              depthHighWaterMark;
+    byte*                               pTokenBytes;
+    size_t                              tokenBytesLength;
+    size_t                              tokenBytesUsed;
+    size_t                              tokenBytesHighWaterMark;
+    const byte*                         pTokenRef;
+    const byte*                         pCodepointBytes;
+    size_t                              maxStringLength;
+    size_t                              maxNumberLength;
+    JSON_BufferGrowthPolicy             bufferGrowthPolicy;
+    MemberNames*                        pMemberNames;
+    size_t                              memberNamesLength;
+    size_t                              memberNamesUsed;
+    MemberName*                         pMemberNameSlots;
+    size_t                              memberNameSlotsLength;
+    size_t                              memberNameSlotsUsed;
+    byte*                               pMemberNameBytes;
+    size_t                              memberNameBytesLength;
+    size_t                              memberNameBytesUsed;
+    JSON_UInt64                         memberNameHashKey[2];
+    InternedKey*                        pInternedKeys;
+    size_t*                             pInternedKeyIndex;
+    size_t                              internedKeyIndexLength;
+    size_t                              internedKeyCapacity;
+    size_t                              internedKeyCount;
+    size_t                              internedKeyClockHand;
+    JSON_KeyEvictionPolicy              keyEvictionPolicy;
+    KnownKeys*                          pKnownKeys;
+    size_t                              skippedValueDepth;
+    DecoderData                         decoderData;
+    GrammarianData                      grammarianData;
+    JSON_Parser_EncodingDetectedHandler encodingDetectedHandler;
+    JSON_Parser_NullHandler             nullHandler;
+    JSON_Parser_BooleanHandler          booleanHandler;
+    JSON_Parser_StringHandler           stringHandler;
+    JSON_Parser_NumberHandler           numberHandler;
+    JSON_Parser_SpecialNumberHandler    specialNumberHandler;
+    JSON_Parser_StartObjectHandler      startObjectHandler;
+    JSON_Parser_EndObjectHandler        endObjectHandler;
+    JSON_Parser_ObjectMemberHandler     objectMemberHandler;
+    JSON_Parser_StartArrayHandler       startArrayHandler;
+    JSON_Parser_EndArrayHandler         endArrayHandler;
+    JSON_Parser_ArrayItemHandler        arrayItemHandler;
+    JSON_Parser_StartDocumentHandler    startDocumentHandler;
+    JSON_Parser_EndDocumentHandler      endDocumentHandler;
+    JSON_Parser_StringRefHandler        stringRefHandler;
+    JSON_Parser_NumberRefHandler        numberRefHandler;
+    JSON_Parser_ObjectMemberRefHandler  objectMemberRefHandler;
+    JSON_Parser_InternedMemberHandler   internedMemberHandler;
+    JSON_Parser_KnownMemberHandler      knownMemberHandler;
+    JSON_Parser_PathMatchHandler        pathMatchHandler;
+    JSON_Parser_Int64Handler            int64Handler;
+    JSON_Parser_UInt64Handler           uint64Handler;
+    JSON_Parser_DoubleHandler           doubleHandler;
+    JSON_Parser_EventBatchHandler       eventBatchHandler;
+    JSON_Event*                         pEvents;
+    size_t                              maxEvents;
+    size_t                              eventCount;
+    byte*                               pEventArena;
+    size_t                              eventArenaLength;
+    size_t                              eventArenaUsed;
+    JSON_Tape                           tape;
+    JSON_Reader                         reader;
+    PathFilter*                         pPathFilter;
+    PathFrame*                          pPathFrames;
+    size_t                              pathFramesLength;
+    size_t                              pathFramesUsed;
+    size_t*                             pLivePaths;
+    size_t                              livePathsLength;
+    size_t                              pendingLivePathCount;
+    size_t                              matchedValueDepth;
+    JSON_ParserConfig                   config;
+    InstancePool*                       pPool;
+    size_t                              poolSlot;
+    byte                                defaultTokenBytes[DEFAULT_TOKEN_BYTES_LENGTH];
+};
+
+/* A parser configuration instance. Its template parser holds the settings
+   and handlers, and is never used to parse. */
+struct JSON_ParserConfig_Data
+{
+    JSON_Parser templateParser;
+};
+
+/* A parser pool instance. */
+struct JSON_ParserPool_Data
+{
+    InstancePool      base;
+    JSON_ParserConfig config;
+};
+
+/* Parser internal functions. */
+
+static void JSON_Parser_SetErrorAtCodepoint(JSON_Parser parser, Error error)
+{
+    parser->error = error;
+}
+
+static void JSON_Parser_SetErrorAtStringEscapeSequenceStart(JSON_Parser parser, Error error, int codepointsAgo)
+{
+    /* Note that backtracking from the current codepoint requires us to make
+       three assumptions, which are always valid in the context of a string
+       escape sequence:
+
+         1. The input encoding is not JSON_UnknownEncoding.
+
+         2 The codepoints we are backing up across are all in the range
+            U+0000 - U+007F, aka ASCII, so we can assume the number of
+            bytes comprising them based on the input encoding.
+
+         3. The codepoints we are backing up across do not include any
+            line breaks, so we can assume that the line number stays the
+            same and the column number can simply be decremented.
+    */
+    parser->error = error;
+    parser->errorOffset = (byte)codepointsAgo;
+}
+
+static void JSON_Parser_SetErrorAtToken(JSON_Parser parser, Error error)
+{
+    parser->error = error;
+    parser->errorOffset = ERROR_LOCATION_IS_TOKEN_START;
+}
+
+/* Builds a 64-bit constant from its high and low 32 bits, since ANSI C has
+   no 64-bit integer literals. */
+#define UINT64_FROM_HALVES(high, low) (((JSON_UInt64)(high) << 32) | (JSON_UInt64)(low))
+
+#define ROTATE_LEFT_64(x, bits) (((x) << (bits)) | ((x) >> (64 - (bits))))
+
+static void SipRound(JSON_UInt64* v)
+{
+    v[0] += v[1]; v[1] = ROTATE_LEFT_64(v[1], 13); v[1] ^= v[0]; v[0] = ROTATE_LEFT_64(v[0], 32);
+    v[2] += v[3]; v[3] = ROTATE_LEFT_64(v[3], 16); v[3] ^= v[2];
+    v[0] += v[3]; v[3] = ROTATE_LEFT_64(v[3], 21); v[3] ^= v[0];
+    v[2] += v[1]; v[1] = ROTATE_LEFT_64(v[1], 17); v[1] ^= v[2]; v[2] = ROTATE_LEFT_64(v[2], 32);
+}
+
+/* Hashes a member name with SipHash-1-3. Because the hash is keyed with a
+   secret chosen per parser, input crafted to make many member names land in
+   the same slots cannot turn duplicate detection back into a quadratic
+   scan. */
+static size_t HashMemberName(const JSON_UInt64* pKey, const byte* pBytes, size_t length)
+{
+    JSON_UInt64 v[4];
+    JSON_UInt64 m;
+    size_t i;
+    size_t j;
+    v[0] = pKey[0] ^ UINT64_FROM_HALVES(0x736F6D65, 0x70736575);
+    v[1] = pKey[1] ^ UINT64_FROM_HALVES(0x646F7261, 0x6E646F6D);
+    v[2] = pKey[0] ^ UINT64_FROM_HALVES(0x6C796765, 0x6E657261);
+    v[3] = pKey[1] ^ UINT64_FROM_HALVES(0x74656462, 0x79746573);
+    for (i = 0; length - i >= 8; i += 8)
+    {
+        m = 0;
+        for (j = 0; j < 8; j++)
+        {
+            m |= (JSON_UInt64)pBytes[i + j] << (j * 8);
         }
-        else if (c == '[')
+        v[3] ^= m;
+        SipRound(v);
+        v[0] ^= m;
+    }
+    m = (JSON_UInt64)length << 56;
+    for (j = 0; i + j < length; j++)
+    {
+        m |= (JSON_UInt64)pBytes[i + j] << (j * 8);
+    }
+    v[3] ^= m;
+    SipRound(v);
+    v[0] ^= m;
+    v[2] ^= 0xFF;
+    SipRound(v);
+    SipRound(v);
+    SipRound(v);
+    return (size_t)(v[0] ^ v[1] ^ v[2] ^ v[3]);
+}
+
+/* Scrambles the bits of a 64-bit value (the SplitMix64 finalizer). */
+static JSON_UInt64 MixBits(JSON_UInt64 x)
+{
+    x ^= x >> 30;
+    x *= UINT64_FROM_HALVES(0xBF58476D, 0x1CE4E5B9);
+    x ^= x >> 27;
+    x *= UINT64_FROM_HALVES(0x94D049BB, 0x133111EB);
+    x ^= x >> 31;
+    return x;
+}
+
+static void JSON_Parser_SeedMemberNameHash(JSON_Parser parser)
+{
+    /* The key only has to be unpredictable to whoever writes the input, so
+       it is drawn from the addresses of the parser and of the stack, which
+       address space layout randomization varies from run to run, and from
+       the processor time used so far. The key is chosen the first time it
+       is needed, and kept for the life of the parser. */
+    if (!parser->memberNameHashKey[0] && !parser->memberNameHashKey[1])
+    {
+        int local = 0;
+        JSON_UInt64 seed = MixBits((JSON_UInt64)(size_t)parser);
+        seed = MixBits(seed ^ (JSON_UInt64)(size_t)&local);
+        parser->memberNameHashKey[0] = seed;
+        parser->memberNameHashKey[1] = MixBits(seed ^ (JSON_UInt64)clock());
+    }
+}
+
+static JSON_Status JSON_Parser_PushMemberNameList(JSON_Parser parser)
+{
+    MemberNames* pNames;
+    if (parser->memberNamesUsed == parser->memberNamesLength)
+    {
+        size_t newLength = GetGrownLength(parser->memberNamesLength, DEFAULT_MEMBER_NAMES_DEPTH, parser->memberNamesUsed + 1);
+        MemberNames* pNewNames = NULL;
+        if (newLength <= SIZE_MAX / sizeof(MemberNames))
         {
-            JSON_Parser_StartToken(parser, T_LEFT_SQUARE);
-            tokenFinished = 1;
+            pNewNames = (MemberNames*)parser->memorySuite.realloc(parser->memorySuite.userData, parser->pMemberNames, newLength * sizeof(MemberNames));
         }
-        else if (c == ']')
+        if (!pNewNames)
         {
-            JSON_Parser_StartToken(parser, T_RIGHT_SQUARE);
-            tokenFinished = 1;
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
         }
-        else if (c == ':')
+        JSON_Parser_SeedMemberNameHash(parser);
+        parser->pMemberNames = pNewNames;
+        parser->memberNamesLength = newLength;
+    }
+    pNames = &parser->pMemberNames[parser->memberNamesUsed];
+    pNames->firstSlot = parser->memberNameSlotsUsed;
+    pNames->slotCount = 0;
+    pNames->nameCount = 0;
+    pNames->firstNameByte = parser->memberNameBytesUsed;
+    parser->memberNamesUsed++;
+    return JSON_Success;
+}
+
+static void JSON_Parser_PopMemberNameList(JSON_Parser parser)
+{
+    /* The object's set and names are the last ones in their buffers, so
+       discarding them is just a matter of truncating the buffers. */
+    const MemberNames* pNames = &parser->pMemberNames[--parser->memberNamesUsed];
+    parser->memberNameSlotsUsed = pNames->firstSlot;
+    parser->memberNameBytesUsed = pNames->firstNameByte;
+}
+
+static void JSON_Parser_FreeMemberNameLists(JSON_Parser parser)
+{
+    if (parser->pMemberNames)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pMemberNames);
+    }
+    if (parser->pMemberNameSlots)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pMemberNameSlots);
+    }
+    if (parser->pMemberNameBytes)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pMemberNameBytes);
+    }
+}
+
+static JSON_Status JSON_Parser_StartContainer(JSON_Parser parser, int isObject)
+{
+    if (isObject && GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS) &&
+        !JSON_Parser_PushMemberNameList(parser))
+    {
+        return JSON_Failure;
+    }
+    if (++parser->depth > parser->depthHighWaterMark)
+    {
+        parser->depthHighWaterMark = parser->depth;
+    }
+    return JSON_Success;
+}
+
+static void JSON_Parser_EndContainer(JSON_Parser parser, int isObject)
+{
+    parser->depth--;
+    if (isObject && GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS))
+    {
+        JSON_Parser_PopMemberNameList(parser);
+    }
+}
+
+static const byte* JSON_Parser_GetTokenBytes(JSON_Parser parser)
+{
+    /* The bytes of the current token may still be in the client's input
+       buffer rather than in the token buffer; see
+       JSON_Parser_IsTokenRefEligible(). */
+    return parser->pTokenRef ? parser->pTokenRef : parser->pTokenBytes;
+}
+
+static JSON_Status JSON_Parser_GrowMemberNameSet(JSON_Parser parser, MemberNames* pNames)
+{
+    size_t newSlotCount = pNames->slotCount ? pNames->slotCount * 2 : DEFAULT_MEMBER_NAME_SLOTS;
+    size_t neededSlots;
+    MemberName* pOldSlots;
+    MemberName* pNewSlots;
+    size_t mask = newSlotCount - 1;
+    size_t i;
+
+    /* The new set is built just past the old one, which is the last set in
+       the slot buffer, and then moved down into its place. */
+    if (newSlotCount > SIZE_MAX / sizeof(MemberName) - parser->memberNameSlotsUsed)
+    {
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+        return JSON_Failure;
+    }
+    neededSlots = parser->memberNameSlotsUsed + newSlotCount;
+    if (neededSlots > parser->memberNameSlotsLength)
+    {
+        size_t newLength = GetGrownLength(parser->memberNameSlotsLength, DEFAULT_MEMBER_NAME_SLOTS * 4, neededSlots);
+        MemberName* pBiggerSlots;
+        if (newLength > SIZE_MAX / sizeof(MemberName))
         {
-            JSON_Parser_StartToken(parser, T_COLON);
-            tokenFinished = 1;
+            newLength = neededSlots;
         }
-        else if (c == ',')
+        pBiggerSlots = (MemberName*)parser->memorySuite.realloc(parser->memorySuite.userData, parser->pMemberNameSlots, newLength * sizeof(MemberName));
+        if (!pBiggerSlots)
         {
-            JSON_Parser_StartToken(parser, T_COMMA);
-            tokenFinished = 1;
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
         }
-        else if (c == 'n')
+        parser->pMemberNameSlots = pBiggerSlots;
+        parser->memberNameSlotsLength = newLength;
+    }
+    pOldSlots = parser->pMemberNameSlots + pNames->firstSlot;
+    pNewSlots = pOldSlots + pNames->slotCount;
+    for (i = 0; i < newSlotCount; i++)
+    {
+        pNewSlots[i].nameOffset = EMPTY_MEMBER_NAME_SLOT;
+    }
+    for (i = 0; i < pNames->slotCount; i++)
+    {
+        if (pOldSlots[i].nameOffset != EMPTY_MEMBER_NAME_SLOT)
         {
-            JSON_Parser_StartToken(parser, T_NULL);
-            parser->lexerBits = NULL_LITERAL_EXPECTED_CHARS_START_INDEX;
-            parser->lexerState = LEXING_LITERAL;
+            size_t slot = pOldSlots[i].hash & mask;
+            while (pNewSlots[slot].nameOffset != EMPTY_MEMBER_NAME_SLOT)
+            {
+                slot = (slot + 1) & mask;
+            }
+            pNewSlots[slot] = pOldSlots[i];
         }
-        else if (c == 't')
+    }
+    memmove(pOldSlots, pNewSlots, newSlotCount * sizeof(MemberName));
+    pNames->slotCount = newSlotCount;
+    parser->memberNameSlotsUsed = pNames->firstSlot + newSlotCount;
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_AddMemberName(JSON_Parser parser, const byte* pName, size_t length)
+{
+    MemberNames* pNames = &parser->pMemberNames[parser->memberNamesUsed - 1];
+    size_t hash = HashMemberName(parser->memberNameHashKey, pName, length);
+    MemberName* pSlots;
+    size_t mask;
+    size_t slot;
+    if (pNames->slotCount)
+    {
+        pSlots = parser->pMemberNameSlots + pNames->firstSlot;
+        mask = pNames->slotCount - 1;
+        for (slot = hash & mask; pSlots[slot].nameOffset != EMPTY_MEMBER_NAME_SLOT; slot = (slot + 1) & mask)
         {
-            JSON_Parser_StartToken(parser, T_TRUE);
-            parser->lexerBits = TRUE_LITERAL_EXPECTED_CHARS_START_INDEX;
-            parser->lexerState = LEXING_LITERAL;
+            if (pSlots[slot].hash == hash && pSlots[slot].length == length &&
+                !memcmp(parser->pMemberNameBytes + pSlots[slot].nameOffset, pName, length))
+            {
+                JSON_Parser_SetErrorAtToken(parser, JSON_Error_DuplicateObjectMember);
+                return JSON_Failure;
+            }
         }
-        else if (c == 'f')
+    }
+    if ((pNames->nameCount + 1) * 4 > pNames->slotCount * 3 &&
+        !JSON_Parser_GrowMemberNameSet(parser, pNames))
+    {
+        return JSON_Failure;
+    }
+    if (!parser->pMemberNameBytes || length > parser->memberNameBytesLength - parser->memberNameBytesUsed)
+    {
+        byte* pBiggerBytes = NULL;
+        if (length <= SIZE_MAX - parser->memberNameBytesUsed)
         {
-            JSON_Parser_StartToken(parser, T_FALSE);
-            parser->lexerBits = FALSE_LITERAL_EXPECTED_CHARS_START_INDEX;
-            parser->lexerState = LEXING_LITERAL;
+            size_t newLength = GetGrownLength(parser->memberNameBytesLength, DEFAULT_MEMBER_NAME_BYTES, parser->memberNameBytesUsed + length);
+            pBiggerBytes = (byte*)parser->memorySuite.realloc(parser->memorySuite.userData, parser->pMemberNameBytes, newLength);
+            if (pBiggerBytes)
+            {
+                parser->memberNameBytesLength = newLength;
+            }
         }
-        else if (c == '"')
+        if (!pBiggerBytes)
         {
-            JSON_Parser_StartToken(parser, T_STRING);
-            parser->lexerState = LEXING_STRING;
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
         }
-        else if (c == '-')
+        parser->pMemberNameBytes = pBiggerBytes;
+    }
+    memcpy(parser->pMemberNameBytes + parser->memberNameBytesUsed, pName, length);
+    pSlots = parser->pMemberNameSlots + pNames->firstSlot;
+    mask = pNames->slotCount - 1;
+    slot = hash & mask;
+    while (pSlots[slot].nameOffset != EMPTY_MEMBER_NAME_SLOT)
+    {
+        slot = (slot + 1) & mask;
+    }
+    pSlots[slot].hash = hash;
+    pSlots[slot].nameOffset = parser->memberNameBytesUsed;
+    pSlots[slot].length = length;
+    pNames->nameCount++;
+    parser->memberNameBytesUsed += length;
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_AddMemberNameToList(JSON_Parser parser)
+{
+    return GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS)
+        ? JSON_Parser_AddMemberName(parser, JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed)
+        : JSON_Success;
+}
+
+static void JSON_Parser_FreeInternedKeys(JSON_Parser parser)
+{
+    if (parser->pInternedKeys)
+    {
+        size_t keyId;
+        for (keyId = 0; keyId < parser->internedKeyCount; keyId++)
         {
-            JSON_Parser_StartToken(parser, T_NUMBER);
-            parser->tokenAttributes = JSON_IsNegative;
-            codepointToRecord = '-';
-            parser->lexerState = LEXING_NUMBER_AFTER_MINUS;
-            goto recordNumberCodepointAndAdvance;
+            parser->memorySuite.free(parser->memorySuite.userData, parser->pInternedKeys[keyId].pName);
         }
-        else if (c == '0')
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pInternedKeys);
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pInternedKeyIndex);
+        parser->pInternedKeys = NULL;
+        parser->pInternedKeyIndex = NULL;
+    }
+    parser->internedKeyIndexLength = 0;
+    parser->internedKeyCount = 0;
+    parser->internedKeyClockHand = 0;
+}
+
+static JSON_Status JSON_Parser_AllocateInternedKeys(JSON_Parser parser)
+{
+    /* The index is kept at most half full, so that probe sequences stay
+       short even when the table itself is full. */
+    size_t indexLength = GetGrownLength(0, 16, parser->internedKeyCapacity);
+    size_t slot;
+    if (indexLength > SIZE_MAX / 2 / sizeof(size_t) || parser->internedKeyCapacity > SIZE_MAX / sizeof(InternedKey))
+    {
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+        return JSON_Failure;
+    }
+    indexLength *= 2;
+    parser->pInternedKeys = (InternedKey*)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, parser->internedKeyCapacity * sizeof(InternedKey));
+    parser->pInternedKeyIndex = (size_t*)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, indexLength * sizeof(size_t));
+    if (!parser->pInternedKeys || !parser->pInternedKeyIndex)
+    {
+        if (parser->pInternedKeys)
         {
-            JSON_Parser_StartToken(parser, T_NUMBER);
-            codepointToRecord = '0';
-            parser->lexerState = LEXING_NUMBER_AFTER_LEADING_ZERO;
-            goto recordNumberCodepointAndAdvance;
+            parser->memorySuite.free(parser->memorySuite.userData, parser->pInternedKeys);
+            parser->pInternedKeys = NULL;
         }
-        else if (c >= '1' && c <= '9')
+        if (parser->pInternedKeyIndex)
         {
-            JSON_Parser_StartToken(parser, T_NUMBER);
-            codepointToRecord = c;
-            parser->lexerState = LEXING_NUMBER_DECIMAL_DIGITS;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (c == ' ' || c == TAB_CODEPOINT || c == LINE_FEED_CODEPOINT ||
-                 c == CARRIAGE_RETURN_CODEPOINT || c == EOF_CODEPOINT)
-        {
-            /* Ignore whitespace between tokens. */
-        }
-        else if (c == BOM_CODEPOINT && parser->codepointLocationByte == 0)
-        {
-            if (GET_FLAGS(parser->flags, PARSER_ALLOW_BOM))
-            {
-                /* OK, we'll allow the BOM. */
-            }
-            else
-            {
-                JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_BOMNotAllowed);
-                return JSON_Failure;
-            }
+            parser->memorySuite.free(parser->memorySuite.userData, parser->pInternedKeyIndex);
+            parser->pInternedKeyIndex = NULL;
         }
-        else if (c == '/' && GET_FLAGS(parser->flags, PARSER_ALLOW_COMMENTS))
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+        return JSON_Failure;
+    }
+    for (slot = 0; slot < indexLength; slot++)
+    {
+        parser->pInternedKeyIndex[slot] = NO_INTERNED_KEY;
+    }
+    parser->internedKeyIndexLength = indexLength;
+    JSON_Parser_SeedMemberNameHash(parser);
+    return JSON_Success;
+}
+
+static void JSON_Parser_EvictInternedKey(JSON_Parser parser, size_t keyId)
+{
+    /* Remove the key from the index by shifting back any later entries in
+       its probe sequence that would otherwise become unreachable. */
+    size_t mask = parser->internedKeyIndexLength - 1;
+    size_t hole = parser->pInternedKeys[keyId].hash & mask;
+    size_t slot;
+    while (parser->pInternedKeyIndex[hole] != keyId)
+    {
+        hole = (hole + 1) & mask;
+    }
+    for (slot = (hole + 1) & mask; parser->pInternedKeyIndex[slot] != NO_INTERNED_KEY; slot = (slot + 1) & mask)
+    {
+        size_t home = parser->pInternedKeys[parser->pInternedKeyIndex[slot]].hash & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
         {
-            /* Comments are not real tokens, but we save the location
-               of the comment as the token location in case of an error. */
-            parser->tokenLocationByte = parser->codepointLocationByte;
-            parser->tokenLocationLine = parser->codepointLocationLine;
-            parser->tokenLocationColumn = parser->codepointLocationColumn;
-            parser->lexerState = LEXING_COMMENT_AFTER_SLASH;
+            parser->pInternedKeyIndex[hole] = parser->pInternedKeyIndex[slot];
+            hole = slot;
         }
-        else if (c == 'N' && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS))
+    }
+    parser->pInternedKeyIndex[hole] = NO_INTERNED_KEY;
+    parser->memorySuite.free(parser->memorySuite.userData, parser->pInternedKeys[keyId].pName);
+}
+
+static size_t JSON_Parser_ChooseKeyToEvict(JSON_Parser parser)
+{
+    /* Sweep the keys like the hand of a clock, giving each key that has
+       been used since the hand last passed it a second chance. */
+    for (;;)
+    {
+        InternedKey* pKey = &parser->pInternedKeys[parser->internedKeyClockHand];
+        size_t keyId = parser->internedKeyClockHand;
+        parser->internedKeyClockHand = (keyId + 1 == parser->internedKeyCount) ? 0 : keyId + 1;
+        if (!pKey->isRecentlyUsed)
         {
-            JSON_Parser_StartToken(parser, T_NAN);
-            parser->lexerBits = NAN_LITERAL_EXPECTED_CHARS_START_INDEX;
-            parser->lexerState = LEXING_LITERAL;
+            return keyId;
         }
-        else if (c == 'I' && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS))
+        pKey->isRecentlyUsed = 0;
+    }
+}
+
+static JSON_Status JSON_Parser_InternMemberName(JSON_Parser parser, size_t* pKeyId, int* pIsNewKey)
+{
+    const byte* pTokenBytes = JSON_Parser_GetTokenBytes(parser);
+    size_t length = parser->tokenBytesUsed;
+    size_t nullTerminatorLength = SHORTEST_ENCODING_SEQUENCE(parser->stringEncoding);
+    size_t hash;
+    size_t mask;
+    size_t slot;
+    size_t keyId;
+    byte* pName;
+    *pKeyId = NO_INTERNED_KEY;
+    *pIsNewKey = 0;
+    if (!parser->internedKeyCapacity)
+    {
+        return JSON_Success;
+    }
+    if (!parser->pInternedKeys && !JSON_Parser_AllocateInternedKeys(parser))
+    {
+        return JSON_Failure;
+    }
+    hash = HashMemberName(parser->memberNameHashKey, pTokenBytes, length);
+    mask = parser->internedKeyIndexLength - 1;
+    for (slot = hash & mask; (keyId = parser->pInternedKeyIndex[slot]) != NO_INTERNED_KEY; slot = (slot + 1) & mask)
+    {
+        InternedKey* pKey = &parser->pInternedKeys[keyId];
+        if (pKey->hash == hash && pKey->length == length && !memcmp(pKey->pName, pTokenBytes, length))
         {
-            JSON_Parser_StartToken(parser, T_INFINITY);
-            parser->lexerBits = INFINITY_LITERAL_EXPECTED_CHARS_START_INDEX;
-            parser->lexerState = LEXING_LITERAL;
+            pKey->isRecentlyUsed = 1;
+            *pKeyId = keyId;
+            return JSON_Success;
         }
-        else
+    }
+    if (parser->internedKeyCount == parser->internedKeyCapacity && parser->keyEvictionPolicy == JSON_EvictNone)
+    {
+        return JSON_Success;
+    }
+    pName = NULL;
+    if (length <= SIZE_MAX - nullTerminatorLength)
+    {
+        pName = (byte*)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, length + nullTerminatorLength);
+    }
+    if (!pName)
+    {
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+        return JSON_Failure;
+    }
+    memcpy(pName, pTokenBytes, length);
+    memset(pName + length, 0, nullTerminatorLength);
+    if (parser->internedKeyCount < parser->internedKeyCapacity)
+    {
+        keyId = parser->internedKeyCount++;
+    }
+    else
+    {
+        keyId = JSON_Parser_ChooseKeyToEvict(parser);
+        JSON_Parser_EvictInternedKey(parser, keyId);
+    }
+    slot = hash & mask;
+    while (parser->pInternedKeyIndex[slot] != NO_INTERNED_KEY)
+    {
+        slot = (slot + 1) & mask;
+    }
+    parser->pInternedKeyIndex[slot] = keyId;
+    parser->pInternedKeys[keyId].pName = pName;
+    parser->pInternedKeys[keyId].length = length;
+    parser->pInternedKeys[keyId].hash = hash;
+    parser->pInternedKeys[keyId].isRecentlyUsed = 0;
+    *pKeyId = keyId;
+    *pIsNewKey = 1;
+    return JSON_Success;
+}
+
+static JSON_UInt64 HashKnownKey(JSON_UInt64 seed, const byte* pBytes, size_t length)
+{
+    /* FNV-1a, finished off with a mix so that every bit of the result
+       depends on every byte. The names to be looked up can't make lookups
+       any slower, so there's no need for a keyed hash here. */
+    JSON_UInt64 hash = seed ^ UINT64_FROM_HALVES(0xCBF29CE4, 0x84222325);
+    size_t i;
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ pBytes[i]) * UINT64_FROM_HALVES(0x00000100, 0x000001B3);
+    }
+    return MixBits(hash ^ (JSON_UInt64)length);
+}
+
+#define KNOWN_KEY_BUCKET(hash, mask)          ((size_t)(hash) & (mask))
+#define KNOWN_KEY_SLOT(hash, displacement, mask) \
+    (((size_t)((hash) >> 32) + (displacement) * ((size_t)((hash) >> 16) | 1)) & (mask))
+
+static size_t LookUpKnownKey(const KnownKeys* pKnownKeys, const byte* pBytes, size_t length)
+{
+    JSON_UInt64 hash = HashKnownKey(pKnownKeys->seed, pBytes, length);
+    size_t displacement = pKnownKeys->pDisplacements[KNOWN_KEY_BUCKET(hash, pKnownKeys->bucketMask)];
+    size_t keyIndex = pKnownKeys->pSlots[KNOWN_KEY_SLOT(hash, displacement, pKnownKeys->slotMask)];
+    if (keyIndex != JSON_UNKNOWN_KEY &&
+        pKnownKeys->pKeys[keyIndex].length == length &&
+        !memcmp(pKnownKeys->pBytes + pKnownKeys->pKeys[keyIndex].offset, pBytes, length))
+    {
+        return keyIndex;
+    }
+    return JSON_UNKNOWN_KEY;
+}
+
+/* Outcomes of trying to compile the known names with a given seed. */
+#define COMPILED_KNOWN_KEYS 0
+#define SEED_DID_NOT_WORK   1
+#define DUPLICATE_KNOWN_KEY 2
+
+static int TryToCompileKnownKeys(KnownKeys* pKnownKeys, JSON_UInt64* pHashes, size_t* pBucketStarts, size_t* pBucketKeys)
+{
+    size_t bucketCount = pKnownKeys->bucketMask + 1;
+    size_t slotCount = pKnownKeys->slotMask + 1;
+    size_t maxBucketSize = 0;
+    size_t bucketSize;
+    size_t bucket;
+    size_t i;
+
+    /* Sort the names by bucket. */
+    for (bucket = 0; bucket <= bucketCount; bucket++)
+    {
+        pBucketStarts[bucket] = 0;
+    }
+    for (i = 0; i < pKnownKeys->keyCount; i++)
+    {
+        pHashes[i] = HashKnownKey(pKnownKeys->seed, pKnownKeys->pBytes + pKnownKeys->pKeys[i].offset, pKnownKeys->pKeys[i].length);
+        pBucketStarts[KNOWN_KEY_BUCKET(pHashes[i], pKnownKeys->bucketMask) + 1]++;
+    }
+    for (bucket = 0; bucket < bucketCount; bucket++)
+    {
+        if (pBucketStarts[bucket + 1] > maxBucketSize)
         {
-            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_UnknownToken);
-            return JSON_Failure;
+            maxBucketSize = pBucketStarts[bucket + 1];
         }
-        goto advance;
+        pBucketStarts[bucket + 1] += pBucketStarts[bucket];
+    }
+    for (i = 0; i < pKnownKeys->keyCount; i++)
+    {
+        bucket = KNOWN_KEY_BUCKET(pHashes[i], pKnownKeys->bucketMask);
+        pBucketKeys[pBucketStarts[bucket]++] = i;
+    }
+    for (bucket = bucketCount; bucket > 0; bucket--)
+    {
+        pBucketStarts[bucket] = pBucketStarts[bucket - 1];
+    }
+    pBucketStarts[0] = 0;
 
-    case LEXING_LITERAL:
-        /* While lexing a literal we store an index into expectedLiteralChars
-           in lexerBits. */
-        if (expectedLiteralChars[parser->lexerBits])
+    /* Place the biggest buckets first, while the table is emptiest. */
+    for (i = 0; i < slotCount; i++)
+    {
+        pKnownKeys->pSlots[i] = JSON_UNKNOWN_KEY;
+    }
+    for (bucketSize = maxBucketSize; bucketSize > 0; bucketSize--)
+    {
+        for (bucket = 0; bucket < bucketCount; bucket++)
         {
-            /* The codepoint should match the next character in the literal. */
-            if (c != expectedLiteralChars[parser->lexerBits])
-            {
-                JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
-                return JSON_Failure;
-            }
-            parser->lexerBits++;
-
-            /* If the literal is the top-level value of an embedded document,
-               process it as soon as we consume its last expected codepoint.
-               Normally we defer processing until the following codepoint
-               has been examined, so that we can treat sequences like "nullx"
-               as a single, unknown token rather than a null literal followed
-               by an unknown token. */
-            if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT) &&
-                !expectedLiteralChars[parser->lexerBits])
+            size_t first = pBucketStarts[bucket];
+            size_t displacement;
+            if (pBucketStarts[bucket + 1] - first != bucketSize)
             {
-                tokenFinished = 1;
+                continue;
             }
-        }
-        else
-        {
-            /* The literal should be finished, so the codepoint should not be
-               a plausible JSON literal character, but rather EOF, whitespace,
-               or the first character of the next token. */
-            if ((c >= 'A' && c <= 'Z') ||
-                (c >= 'a' && c <= 'z') ||
-                (c >= '0' && c <= '9') ||
-                (c == '_'))
+            for (displacement = 0; displacement < slotCount; displacement++)
             {
-                JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
-                return JSON_Failure;
+                size_t placed;
+                for (placed = 0; placed < bucketSize; placed++)
+                {
+                    size_t keyIndex = pBucketKeys[first + placed];
+                    size_t slot = KNOWN_KEY_SLOT(pHashes[keyIndex], displacement, pKnownKeys->slotMask);
+                    size_t otherKeyIndex = pKnownKeys->pSlots[slot];
+                    if (otherKeyIndex != JSON_UNKNOWN_KEY)
+                    {
+                        if (pHashes[otherKeyIndex] == pHashes[keyIndex] &&
+                            pKnownKeys->pKeys[otherKeyIndex].length == pKnownKeys->pKeys[keyIndex].length &&
+                            !memcmp(pKnownKeys->pBytes + pKnownKeys->pKeys[otherKeyIndex].offset,
+                                    pKnownKeys->pBytes + pKnownKeys->pKeys[keyIndex].offset,
+                                    pKnownKeys->pKeys[keyIndex].length))
+                        {
+                            return DUPLICATE_KNOWN_KEY;
+                        }
+                        break;
+                    }
+                    pKnownKeys->pSlots[slot] = keyIndex;
+                }
+                if (placed == bucketSize)
+                {
+                    break;
+                }
+                while (placed > 0)
+                {
+                    size_t keyIndex = pBucketKeys[first + --placed];
+                    pKnownKeys->pSlots[KNOWN_KEY_SLOT(pHashes[keyIndex], displacement, pKnownKeys->slotMask)] = JSON_UNKNOWN_KEY;
+                }
             }
-            if (!JSON_Parser_ProcessToken(parser))
+            if (displacement == slotCount)
             {
-                return JSON_Failure;
+                return SEED_DID_NOT_WORK;
             }
-            goto reprocess;
+            pKnownKeys->pDisplacements[bucket] = displacement;
         }
-        goto advance;
+    }
+    return COMPILED_KNOWN_KEYS;
+}
 
-    case LEXING_STRING:
-        if (c == EOF_CODEPOINT)
-        {
-            /* Allow JSON_Parser_FlushLexer() to fail. */
-        }
-        else if (c == '"')
-        {
-            tokenFinished = 1;
-        }
-        else if (c == '\\')
+static KnownKeys* CompileKnownKeys(const JSON_MemorySuite* pMemorySuite, const char* const* ppKeys, const size_t* pLengths, size_t keyCount)
+{
+    /* Each name is followed by a null terminator that is long enough for
+       any encoding. */
+    const size_t nullTerminatorLength = LONGEST_ENCODING_SEQUENCE;
+    size_t totalKeyBytes = 0;
+    size_t bucketCount = GetGrownLength(0, 1, keyCount / 4 + 1);
+    size_t slotCount = GetGrownLength(0, 2, keyCount * 2);
+    KnownKeys* pKnownKeys = NULL;
+    void* pScratch;
+    size_t i;
+    int attempt;
+    int outcome = SEED_DID_NOT_WORK;
+
+    for (i = 0; i < keyCount; i++)
+    {
+        size_t length = pLengths ? pLengths[i] : strlen(ppKeys[i]);
+        if (length > SIZE_MAX - nullTerminatorLength - totalKeyBytes)
         {
-            parser->lexerState = LEXING_STRING_ESCAPE;
+            return NULL;
         }
-        else if (c < 0x20 && !GET_FLAGS(parser->flags, PARSER_ALLOW_CONTROL_CHARS))
+        totalKeyBytes += length + nullTerminatorLength;
+    }
+    if (keyCount > SIZE_MAX / 4 / sizeof(size_t) ||
+        totalKeyBytes > SIZE_MAX / 2 - keyCount * 4 * sizeof(size_t))
+    {
+        return NULL;
+    }
+
+    /* The scratch space holds each name's hash, the start of each bucket's
+       names in the sorted list, and the sorted list itself. */
+    pScratch = pMemorySuite->realloc(pMemorySuite->userData, NULL, keyCount * sizeof(JSON_UInt64) + (keyCount + 2 * bucketCount + 1) * sizeof(size_t));
+    if (!pScratch)
+    {
+        return NULL;
+    }
+    for (attempt = 0; outcome == SEED_DID_NOT_WORK; attempt++)
+    {
+        if (!pKnownKeys || !(attempt % KNOWN_KEY_SEEDS_PER_SIZE))
         {
-            /* ASCII control characters (U+0000 - U+001F) are not allowed to
-               appear unescaped in string values unless specifically allowed. */
-            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_UnescapedControlCharacter);
-            return JSON_Failure;
+            size_t pos = 0;
+            size_t size;
+            if (pKnownKeys)
+            {
+                pMemorySuite->free(pMemorySuite->userData, pKnownKeys);
+                if (slotCount > SIZE_MAX / 4 / sizeof(size_t))
+                {
+                    pKnownKeys = NULL;
+                    break;
+                }
+                slotCount *= 2;
+            }
+            size = sizeof(KnownKeys) + (bucketCount + slotCount) * sizeof(size_t) + keyCount * sizeof(KnownKey) + totalKeyBytes;
+            pKnownKeys = (KnownKeys*)pMemorySuite->realloc(pMemorySuite->userData, NULL, size);
+            if (!pKnownKeys)
+            {
+                break;
+            }
+            pKnownKeys->size = size;
+            pKnownKeys->keyCount = keyCount;
+            pKnownKeys->bucketMask = bucketCount - 1;
+            pKnownKeys->slotMask = slotCount - 1;
+            pKnownKeys->pDisplacements = (size_t*)(pKnownKeys + 1);
+            pKnownKeys->pSlots = pKnownKeys->pDisplacements + bucketCount;
+            pKnownKeys->pKeys = (KnownKey*)(pKnownKeys->pSlots + slotCount);
+            pKnownKeys->pBytes = (byte*)(pKnownKeys->pKeys + keyCount);
+            for (i = 0; i < keyCount; i++)
+            {
+                size_t length = pLengths ? pLengths[i] : strlen(ppKeys[i]);
+                pKnownKeys->pKeys[i].offset = pos;
+                pKnownKeys->pKeys[i].length = length;
+                memcpy(pKnownKeys->pBytes + pos, ppKeys[i], length);
+                memset(pKnownKeys->pBytes + pos + length, 0, nullTerminatorLength);
+                pos += length + nullTerminatorLength;
+            }
         }
-        else
+        pKnownKeys->seed = MixBits((JSON_UInt64)(attempt + 1));
+        outcome = TryToCompileKnownKeys(pKnownKeys, (JSON_UInt64*)pScratch,
+                                        (size_t*)((JSON_UInt64*)pScratch + keyCount),
+                                        (size_t*)((JSON_UInt64*)pScratch + keyCount) + bucketCount + 1);
+    }
+    pMemorySuite->free(pMemorySuite->userData, pScratch);
+    if (pKnownKeys && outcome != COMPILED_KNOWN_KEYS)
+    {
+        pMemorySuite->free(pMemorySuite->userData, pKnownKeys);
+        pKnownKeys = NULL;
+    }
+    return pKnownKeys;
+}
+
+static KnownKeys* CloneKnownKeys(const JSON_MemorySuite* pMemorySuite, const KnownKeys* pKnownKeys)
+{
+    /* The compiled keys live in a single allocation, so a copy of it only
+       needs its internal pointers moved over to the new block. */
+    KnownKeys* pClone = (KnownKeys*)pMemorySuite->realloc(pMemorySuite->userData, NULL, pKnownKeys->size);
+    if (pClone)
+    {
+        memcpy(pClone, pKnownKeys, pKnownKeys->size);
+        pClone->pDisplacements = (size_t*)((byte*)pClone + ((const byte*)pKnownKeys->pDisplacements - (const byte*)pKnownKeys));
+        pClone->pSlots = (size_t*)((byte*)pClone + ((const byte*)pKnownKeys->pSlots - (const byte*)pKnownKeys));
+        pClone->pKeys = (KnownKey*)((byte*)pClone + ((const byte*)pKnownKeys->pKeys - (const byte*)pKnownKeys));
+        pClone->pBytes = (byte*)pClone + (pKnownKeys->pBytes - (const byte*)pKnownKeys);
+    }
+    return pClone;
+}
+
+static size_t ParseArrayIndex(const byte* pBytes, size_t length)
+{
+    /* An array index is a decimal number without leading zeros. */
+    size_t index = 0;
+    size_t i;
+    if (!length || (length > 1 && pBytes[0] == '0'))
+    {
+        return NOT_AN_ARRAY_INDEX;
+    }
+    for (i = 0; i < length; i++)
+    {
+        if (pBytes[i] < '0' || pBytes[i] > '9' || index > (SIZE_MAX - 10) / 10)
         {
-            codepointToRecord = c;
-            goto recordStringCodepointAndAdvance;
+            return NOT_AN_ARRAY_INDEX;
         }
-        goto advance;
+        index = index * 10 + (size_t)(pBytes[i] - '0');
+    }
+    return index;
+}
 
-    case LEXING_STRING_ESCAPE:
-        if (c == EOF_CODEPOINT)
+static PathFilter* CompilePathFilter(const JSON_MemorySuite* pMemorySuite, const char* const* ppPaths, size_t pathCount)
+{
+    PathFilter* pFilter;
+    size_t segmentCount = 0;
+    size_t byteCount = 0;
+    size_t size;
+    size_t i;
+
+    /* Validate the paths and measure them. Unescaping never makes a name
+       longer, so the escaped length is enough room for it. */
+    for (i = 0; i < pathCount; i++)
+    {
+        const char* pPath = ppPaths[i];
+        if (!pPath || (*pPath && *pPath != '/'))
         {
-            /* Allow JSON_Parser_FlushLexer() to fail. */
+            return NULL;
         }
-        else
+        for (; *pPath; pPath++)
         {
-            if (c == 'u')
+            if (*pPath == '/')
             {
-                parser->lexerState = LEXING_STRING_HEX_ESCAPE_BYTE_1;
+                segmentCount++;
+            }
+            else if (*pPath == '~' && pPath[1] != '0' && pPath[1] != '1')
+            {
+                return NULL;
             }
             else
             {
-                if (c == '"' || c == '\\' || c == '/')
-                {
-                    codepointToRecord = c;
-                }
-                else if (c == 'b')
+                byteCount++;
+            }
+        }
+    }
+    size = sizeof(PathFilter) + pathCount * sizeof(FilterPath) + segmentCount * sizeof(PathSegment) + byteCount;
+    pFilter = (PathFilter*)pMemorySuite->realloc(pMemorySuite->userData, NULL, size);
+    if (!pFilter)
+    {
+        return NULL;
+    }
+    pFilter->size = size;
+    pFilter->pathCount = pathCount;
+    pFilter->wildcardPathCount = 0;
+    pFilter->matchedPathCount = 0;
+    pFilter->pPaths = (FilterPath*)(pFilter + 1);
+    pFilter->pSegments = (PathSegment*)(pFilter->pPaths + pathCount);
+    pFilter->pBytes = (byte*)(pFilter->pSegments + segmentCount);
+
+    /* Split the paths into segments and unescape their names. */
+    segmentCount = 0;
+    byteCount = 0;
+    for (i = 0; i < pathCount; i++)
+    {
+        FilterPath* pFilterPath = &pFilter->pPaths[i];
+        const char* pPath = ppPaths[i];
+        pFilterPath->firstSegment = segmentCount;
+        pFilterPath->hasWildcard = 0;
+        pFilterPath->isMatched = 0;
+        while (*pPath)
+        {
+            PathSegment* pSegment = &pFilter->pSegments[segmentCount++];
+            const byte* pName = pFilter->pBytes + byteCount;
+            pSegment->offset = byteCount;
+            for (pPath++; *pPath && *pPath != '/'; pPath++)
+            {
+                byte b = (byte)*pPath;
+                if (b == '~')
                 {
-                    codepointToRecord = BACKSPACE_CODEPOINT;
+                    pPath++;
+                    b = (byte)((*pPath == '0') ? '~' : '/');
                 }
-                else if (c == 't')
-                {
-                    codepointToRecord = TAB_CODEPOINT;
-                }
-                else if (c == 'n')
-                {
-                    codepointToRecord = LINE_FEED_CODEPOINT;
-                }
-                else if (c == 'f')
-                {
-                    codepointToRecord = FORM_FEED_CODEPOINT;
-                }
-                else if (c == 'r')
-                {
-                    codepointToRecord = CARRIAGE_RETURN_CODEPOINT;
-                }
-                else
-                {
-                    /* The current codepoint location is the first character after
-                       the backslash that started the escape sequence. The error
-                       location should be the beginning of the escape sequence, 1
-                       character earlier. */
-                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_InvalidEscapeSequence, 1);
-                    return JSON_Failure;
-                }
-                parser->lexerState = LEXING_STRING;
-                goto recordStringCodepointAndAdvance;
-            }
-        }
-        goto advance;
-
-    case LEXING_STRING_HEX_ESCAPE_BYTE_1:
-    case LEXING_STRING_HEX_ESCAPE_BYTE_2:
-    case LEXING_STRING_HEX_ESCAPE_BYTE_3:
-    case LEXING_STRING_HEX_ESCAPE_BYTE_4:
-    case LEXING_STRING_HEX_ESCAPE_BYTE_5:
-    case LEXING_STRING_HEX_ESCAPE_BYTE_6:
-    case LEXING_STRING_HEX_ESCAPE_BYTE_7:
-    case LEXING_STRING_HEX_ESCAPE_BYTE_8:
-        if (c == EOF_CODEPOINT)
-        {
-            /* Allow JSON_Parser_FlushLexer() to fail. */
-        }
-        else
-        {
-            /* While lexing a string hex escape sequence we store the bytes
-               of the escaped codepoint in the low 2 bytes of lexerBits. If
-               the escape sequence represents a leading surrogate, we shift
-               the leading surrogate into the high 2 bytes and lex a second
-               hex escape sequence (which should be a trailing surrogate). */
-            int byteNumber = (parser->lexerState - LEXING_STRING_HEX_ESCAPE_BYTE_1) & 0x3;
-            uint32_t nibble;
-            if (c >= '0' && c <= '9')
-            {
-                nibble = c - '0';
-            }
-            else if (c >= 'A' && c <= 'F')
-            {
-                nibble = c - 'A' + 10;
-            }
-            else if (c >= 'a' && c <= 'f')
-            {
-                nibble = c - 'a' + 10;
-            }
-            else
-            {
-                /* The current codepoint location is one of the 4 hex digit
-                   character slots in the hex escape sequence. The error
-                   location should be the beginning of the hex escape
-                   sequence, between 2 and 5 bytes earlier. */
-                int codepointsAgo = 2 /* for "\u" */ + byteNumber;
-                JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_InvalidEscapeSequence, codepointsAgo);
-                return JSON_Failure;
-            }
-            /* Store the hex digit's bits in the appropriate byte of lexerBits. */
-            nibble <<= (3 - byteNumber) * 4 /* shift left by 12, 8, 4, 0 */ ;
-            parser->lexerBits |= nibble;
-            if (parser->lexerState == LEXING_STRING_HEX_ESCAPE_BYTE_4)
-            {
-                /* The escape sequence is complete. We need to check whether
-                   it represents a leading surrogate (which implies that it
-                   will be immediately followed by a hex-escaped trailing
-                   surrogate), a trailing surrogate (which is invalid), or a
-                   valid codepoint (which should simply be appended to the
-                   string token value). */
-                if (IS_LEADING_SURROGATE(parser->lexerBits))
-                {
-                    /* Shift the leading surrogate into the high 2 bytes of
-                       lexerBits so that the trailing surrogate can be stored
-                       in the low 2 bytes. */
-                    parser->lexerBits <<= 16;
-                    parser->lexerState = LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_BACKSLASH;
-                }
-                else if (IS_TRAILING_SURROGATE(parser->lexerBits))
-                {
-                    /* The current codepoint location is the last hex digit
-                       of the hex escape sequence. The error location should
-                       be the beginning of the hex escape sequence, 5
-                       characters earlier. */
-                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 5);
-                    return JSON_Failure;
-                }
-                else
-                {
-                    /* The escape sequence represents a BMP codepoint. */
-                    codepointToRecord = parser->lexerBits;
-                    parser->lexerBits = 0;
-                    parser->lexerState = LEXING_STRING;
-                    goto recordStringCodepointAndAdvance;
-                }
-            }
-            else if (parser->lexerState == LEXING_STRING_HEX_ESCAPE_BYTE_8)
-            {
-                /* The second hex escape sequence is complete. We need to
-                   check whether it represents a trailing surrogate as
-                   expected. If so, the surrogate pair represents a single
-                   non-BMP codepoint. */
-                if (!IS_TRAILING_SURROGATE(parser->lexerBits & 0xFFFF))
-                {
-                    /* The current codepoint location is the last hex digit of
-                       the second hex escape sequence. The error location
-                       should be the beginning of the leading surrogate
-                       hex escape sequence, 11 characters earlier. */
-                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 11);
-                    return JSON_Failure;
-                }
-                /* The escape sequence represents a non-BMP codepoint. */
-                codepointToRecord = CODEPOINT_FROM_SURROGATES(parser->lexerBits);
-                parser->lexerBits = 0;
-                parser->lexerState = LEXING_STRING;
-                goto recordStringCodepointAndAdvance;
+                pFilter->pBytes[byteCount++] = b;
             }
-            else
+            pSegment->length = byteCount - pSegment->offset;
+            pSegment->index = ParseArrayIndex(pName, pSegment->length);
+            pSegment->isWildcard = (byte)(pSegment->length == 1 && pName[0] == '*');
+            if (pSegment->isWildcard)
             {
-                parser->lexerState++;
+                pFilterPath->hasWildcard = 1;
             }
         }
-        goto advance;
-
-    case LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_BACKSLASH:
-        if (c == EOF_CODEPOINT)
-        {
-            /* Allow JSON_Parser_FlushLexer() to fail. */
-        }
-        else
+        pFilterPath->segmentCount = segmentCount - pFilterPath->firstSegment;
+        if (pFilterPath->hasWildcard)
         {
-            if (c != '\\')
-            {
-                /* The current codepoint location is the first character after
-                   the leading surrogate hex escape sequence. The error
-                   location should be the beginning of the leading surrogate
-                   hex escape sequence, 6 characters earlier. */
-                JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 6);
-                return JSON_Failure;
-            }
-            parser->lexerState = LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_U;
+            pFilter->wildcardPathCount++;
         }
-        goto advance;
+    }
+    return pFilter;
+}
 
-    case LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_U:
-        if (c == EOF_CODEPOINT)
+static void ResetPathFilterMatches(PathFilter* pFilter)
+{
+    size_t i;
+    for (i = 0; i < pFilter->pathCount; i++)
+    {
+        pFilter->pPaths[i].isMatched = 0;
+    }
+    pFilter->matchedPathCount = 0;
+}
+
+static PathFilter* ClonePathFilter(const JSON_MemorySuite* pMemorySuite, const PathFilter* pFilter)
+{
+    PathFilter* pClone = (PathFilter*)pMemorySuite->realloc(pMemorySuite->userData, NULL, pFilter->size);
+    if (pClone)
+    {
+        memcpy(pClone, pFilter, pFilter->size);
+        pClone->pPaths = (FilterPath*)((byte*)pClone + ((const byte*)pFilter->pPaths - (const byte*)pFilter));
+        pClone->pSegments = (PathSegment*)((byte*)pClone + ((const byte*)pFilter->pSegments - (const byte*)pFilter));
+        pClone->pBytes = (byte*)pClone + (pFilter->pBytes - (const byte*)pFilter);
+        ResetPathFilterMatches(pClone);
+    }
+    return pClone;
+}
+
+static int PathSegmentMatches(const PathFilter* pFilter, const PathSegment* pSegment, const byte* pName, size_t length, size_t index)
+{
+    /* A member is identified by its name, and an array item by its index. */
+    if (pSegment->isWildcard)
+    {
+        return 1;
+    }
+    if (pName)
+    {
+        return pSegment->length == length && !memcmp(pFilter->pBytes + pSegment->offset, pName, length);
+    }
+    return pSegment->index == index;
+}
+
+static void JSON_Parser_StartSkippingValue(JSON_Parser parser, size_t depth)
+{
+    /* The skip ends when a value completes at the given depth. */
+    SET_FLAGS_ON(ParserState, parser->state, PARSER_SKIPPING_VALUE);
+    parser->skippedValueDepth = depth;
+}
+
+/* Document boundaries are handled in the event batch section, since the
+   events recorded before a document handler is called are flushed first. */
+static JSON_Status JSON_Parser_EndDocument(JSON_Parser parser);
+
+static JSON_Status JSON_Parser_FinishMatchedValue(JSON_Parser parser)
+{
+    if (parser->depth == parser->matchedValueDepth)
+    {
+        PathFilter* pFilter = parser->pPathFilter;
+        parser->matchedValueDepth = NO_MATCHED_VALUE;
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_OUTSIDE_MATCHED_VALUE);
+        if (!pFilter->wildcardPathCount && pFilter->matchedPathCount == pFilter->pathCount &&
+            !GET_FLAGS(parser->flags, PARSER_MULTIPLE_DOCUMENTS))
         {
-            /* Allow JSON_Parser_FlushLexer() to fail. */
+            /* Nothing else can match, so there is no point in going on.
+               JSON_Parser_ParseInput() reports this as success. The next
+               document, if any, could match again. */
+            SET_FLAGS_ON(ParserState, parser->state, PARSER_MATCHED_ALL_PATHS);
+            return JSON_Failure;
         }
-        else
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_CompleteValue(JSON_Parser parser)
+{
+    /* Called when a value whose events were not all passed to the handlers
+       has been parsed, and so has not been checked for the things that
+       JSON_Parser_HandleGrammarEvents() checks for. */
+    if (!JSON_Parser_FinishMatchedValue(parser))
+    {
+        return JSON_Failure;
+    }
+    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT | PARSER_MULTIPLE_DOCUMENTS))
+    {
+        return JSON_Parser_EndDocument(parser);
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_HandleSkippedGrammarEvents(JSON_Parser parser, byte emit)
+{
+    /* A skipped value is still parsed in full, so that skipping it never
+       changes whether the input is accepted, but only the bookkeeping that
+       the parser itself needs is done for it. */
+    SET_FLAGS_OFF(byte, emit, EMIT_ARRAY_ITEM);
+    switch (emit)
+    {
+    case EMIT_START_OBJECT:
+        if (!JSON_Parser_StartContainer(parser, 1/*isObject*/))
         {
-            if (c != 'u')
-            {
-                /* Distinguish between a totally bogus escape sequence
-                   and a valid one that just isn't the hex escape kind
-                   that we require for a trailing surrogate. The current
-                   codepoint location is the first character after the
-                   backslash that should have introduced the trailing
-                   surrogate hex escape sequence. */
-                if (c == '"' || c == '\\' || c == '/' || c == 'b' ||
-                    c == 't' || c == 'n' || c == 'f' || c == 'r')
-                {
-                    /* The error location should be at that beginning of the
-                       leading surrogate's hex escape sequence, 7 characters
-                       earlier. */
-                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 7);
-                }
-                else
-                {
-                    /* The error location should be at that backslash, 1
-                       character earlier. */
-                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_InvalidEscapeSequence, 1);
-                }
-                return JSON_Failure;
-            }
-            parser->lexerState = LEXING_STRING_HEX_ESCAPE_BYTE_5;
+            return JSON_Failure;
         }
-        goto advance;
+        break;
 
-    case LEXING_NUMBER_AFTER_MINUS:
-        if (c == EOF_CODEPOINT)
+    case EMIT_END_OBJECT:
+        JSON_Parser_EndContainer(parser, 1/*isObject*/);
+        break;
+
+    case EMIT_OBJECT_MEMBER:
+        if (!JSON_Parser_AddMemberNameToList(parser)) /* will fail if member is duplicate */
         {
-            /* Allow JSON_Parser_FlushLexer() to fail. */
+            return JSON_Failure;
         }
-        else if (c == 'I' && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS))
+        break;
+
+    case EMIT_START_ARRAY:
+        if (!JSON_Parser_StartContainer(parser, 0/*isObject*/))
         {
-            parser->token = T_NEGATIVE_INFINITY; /* changing horses mid-stream, so to speak */
-            parser->lexerBits = INFINITY_LITERAL_EXPECTED_CHARS_START_INDEX;
-            parser->lexerState = LEXING_LITERAL;
+            return JSON_Failure;
         }
-        else
-        {
-            if (c == '0')
-            {
-                codepointToRecord = '0';
-                parser->lexerState = LEXING_NUMBER_AFTER_LEADING_NEGATIVE_ZERO;
-                goto recordNumberCodepointAndAdvance;
-            }
-            else if (c >= '1' && c <= '9')
-            {
-                codepointToRecord = c;
-                parser->lexerState = LEXING_NUMBER_DECIMAL_DIGITS;
-                goto recordNumberCodepointAndAdvance;
-            }
-            else
-            {
-                /* We trigger an unknown token error rather than an invalid number
-                   error so that "Foo" and "-Foo" trigger the same error. */
-                JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
-                return JSON_Failure;
-            }
+        break;
+
+    case EMIT_END_ARRAY:
+        JSON_Parser_EndContainer(parser, 0/*isObject*/);
+        break;
+    }
+    if (emit != EMIT_NOTHING && emit != EMIT_OBJECT_MEMBER && parser->depth == parser->skippedValueDepth)
+    {
+        /* The skipped value is complete. */
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_SKIPPING_VALUE);
+        return JSON_Parser_CompleteValue(parser);
+    }
+    return JSON_Success;
+}
+
+static void JSON_Parser_ResetData(JSON_Parser parser, int isInitialized)
+{
+    parser->userData = NULL;
+    parser->flags = PARSER_DEFAULT_FLAGS;
+    parser->inputEncoding = JSON_UnknownEncoding;
+    parser->stringEncoding = JSON_UTF8;
+    parser->numberEncoding = JSON_UTF8;
+    parser->token = T_NONE;
+    parser->tokenAttributes = 0;
+    parser->error = JSON_Error_None;
+    parser->errorOffset = 0;
+    parser->lexerState = LEXING_WHITESPACE;
+    parser->lexerBits = 0;
+    parser->codepointLocationByte = 0;
+    parser->codepointLocationLine = 0;
+    parser->codepointLocationColumn = 0;
+    parser->tokenLocationByte = 0;
+    parser->tokenLocationLine = 0;
+    parser->tokenLocationColumn = 0;
+    parser->lazyLocationByte = 0;
+    parser->lazyLocationLine = 0;
+    parser->lazyLocationColumn = 0;
+    Decoder_Reset(&parser->lazyLocationDecoderData);
+    parser->pLazyLocationWindow = NULL;
+    parser->lazyLocationWindowByte = 0;
+    parser->lazyLocationWindowLength = 0;
+    parser->depth = 0;
+    parser->skippedValueDepth = 0;
+    if (!isInitialized)
+    {
+        parser->pTokenBytes = parser->defaultTokenBytes;
+        parser->tokenBytesLength = sizeof(parser->defaultTokenBytes);
+        parser->tokenBytesHighWaterMark = 0;
+        parser->depthHighWaterMark = 0;
+    }
+    else
+    {
+        /* When we reset the parser, we keep the output buffer, the symbol
+           stack and the member name buffers that have already been
+           allocated, if any. If the client wants
+           to reclaim the memory used by the those buffers, he needs to free
+           the parser and create a new one. */
+    }
+    parser->tokenBytesUsed = 0;
+    parser->pTokenRef = NULL;
+    parser->pCodepointBytes = NULL;
+    parser->maxStringLength = SIZE_MAX;
+    parser->maxNumberLength = SIZE_MAX;
+    parser->bufferGrowthPolicy = JSON_GrowByDoubling;
+    if (!isInitialized)
+    {
+        parser->pMemberNames = NULL;
+        parser->memberNamesLength = 0;
+        parser->pMemberNameSlots = NULL;
+        parser->memberNameSlotsLength = 0;
+        parser->pMemberNameBytes = NULL;
+        parser->memberNameBytesLength = 0;
+        parser->memberNameHashKey[0] = 0;
+        parser->memberNameHashKey[1] = 0;
+        parser->pInternedKeys = NULL;
+        parser->pInternedKeyIndex = NULL;
+        parser->internedKeyIndexLength = 0;
+        parser->internedKeyCapacity = DEFAULT_INTERNED_KEY_CAPACITY;
+        parser->internedKeyCount = 0;
+        parser->internedKeyClockHand = 0;
+        parser->keyEvictionPolicy = JSON_EvictLeastRecentlyUsed;
+        parser->pKnownKeys = NULL;
+        parser->pPathFilter = NULL;
+        parser->pPathFrames = NULL;
+        parser->pathFramesLength = 0;
+        parser->pLivePaths = NULL;
+        parser->livePathsLength = 0;
+        parser->config = NULL;
+        parser->pPool = NULL;
+        parser->poolSlot = 0;
+        parser->reader = NULL;
+    }
+    else if (parser->pPathFilter)
+    {
+        ResetPathFilterMatches(parser->pPathFilter);
+    }
+    parser->pathFramesUsed = 0;
+    parser->pendingLivePathCount = 0;
+    parser->matchedValueDepth = NO_MATCHED_VALUE;
+    parser->memberNamesUsed = 0;
+    parser->memberNameSlotsUsed = 0;
+    parser->memberNameBytesUsed = 0;
+    Decoder_Reset(&parser->decoderData);
+    Grammarian_Reset(&parser->grammarianData, isInitialized);
+    parser->encodingDetectedHandler = NULL;
+    parser->nullHandler = NULL;
+    parser->booleanHandler = NULL;
+    parser->stringHandler = NULL;
+    parser->numberHandler = NULL;
+    parser->specialNumberHandler = NULL;
+    parser->startObjectHandler = NULL;
+    parser->endObjectHandler = NULL;
+    parser->objectMemberHandler = NULL;
+    parser->startArrayHandler = NULL;
+    parser->endArrayHandler = NULL;
+    parser->arrayItemHandler = NULL;
+    parser->startDocumentHandler = NULL;
+    parser->endDocumentHandler = NULL;
+    parser->stringRefHandler = NULL;
+    parser->numberRefHandler = NULL;
+    parser->objectMemberRefHandler = NULL;
+    parser->internedMemberHandler = NULL;
+    parser->knownMemberHandler = NULL;
+    parser->pathMatchHandler = NULL;
+    parser->int64Handler = NULL;
+    parser->uint64Handler = NULL;
+    parser->doubleHandler = NULL;
+    parser->eventBatchHandler = NULL;
+    parser->pEvents = NULL;
+    parser->maxEvents = 0;
+    parser->eventCount = 0;
+    if (!isInitialized)
+    {
+        parser->pEventArena = NULL;
+        parser->eventArenaLength = 0;
+    }
+    parser->eventArenaUsed = 0;
+    parser->tape = NULL;
+    parser->state = parser->pPathFilter ? (PARSER_FILTERING_PATHS | PARSER_OUTSIDE_MATCHED_VALUE) : PARSER_RESET; /* do this last! */
+}
+
+static int JSON_Parser_IsTokenRefEligible(JSON_Parser parser, Encoding tokenEncoding)
+{
+    /* When the client has set a handler that accepts a reference to the
+       current kind of token, and the token is encoded the same way as the
+       input, the codepoints that appear verbatim in the input don't need to
+       be copied to the token buffer. Instead, as long as they are
+       contiguous, pTokenRef points to the first of them in the input buffer
+       and tokenBytesUsed counts them. The token is copied to the token
+       buffer (see JSON_Parser_MaterializeTokenRef()) as soon as a codepoint
+       is recorded that breaks the run (an escape sequence or a replacement
+       character), before a handler that requires a writable buffer is
+       called, and before the input buffer goes out of scope. */
+    if (tokenEncoding != parser->inputEncoding)
+    {
+        return 0;
+    }
+    if (parser->eventBatchHandler || parser->tape || parser->reader)
+    {
+        /* In batch mode, values are copied straight to the event arena, and
+           likewise to the tape's arena when building a tape. A reader
+           passes them by reference wherever it can (see
+           JSON_Parser_QueueReaderEvents()). */
+        return 1;
+    }
+    if (GET_FLAGS(parser->state, PARSER_SKIPPING_VALUE | PARSER_OUTSIDE_MATCHED_VALUE))
+    {
+        /* The tokens inside a skipped value, or outside the values that
+           match the path filter, are never passed to handlers. */
+        return 1;
+    }
+    if (parser->token == T_NUMBER)
+    {
+        /* The native number handlers only need the token's text when the
+           number can't be converted without it, so they don't need a copy
+           either. */
+        return parser->numberRefHandler || parser->int64Handler || parser->uint64Handler || parser->doubleHandler;
+    }
+    return parser->stringRefHandler || parser->objectMemberRefHandler || parser->internedMemberHandler ||
+           parser->knownMemberHandler || GET_FLAGS(parser->flags, PARSER_SKIP_UNKNOWN_MEMBERS);
+}
+
+static JSON_Status JSON_Parser_ResizeTokenBytes(JSON_Parser parser, size_t newLength)
+{
+    /* The buffer moves between the parser's built-in buffer and the heap as
+       needed; the bytes of the current token, if any, move with it. */
+    byte* pNewBytes;
+    if (newLength <= sizeof(parser->defaultTokenBytes))
+    {
+        if (parser->pTokenBytes != parser->defaultTokenBytes)
+        {
+            memcpy(parser->defaultTokenBytes, parser->pTokenBytes, parser->tokenBytesUsed);
+            parser->memorySuite.free(parser->memorySuite.userData, parser->pTokenBytes);
+            parser->pTokenBytes = parser->defaultTokenBytes;
+            parser->tokenBytesLength = sizeof(parser->defaultTokenBytes);
         }
-        goto advance;
+        return JSON_Success;
+    }
+    if (parser->pTokenBytes == parser->defaultTokenBytes)
+    {
+        pNewBytes = (byte*)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, newLength);
+        if (pNewBytes)
+        {
+            memcpy(pNewBytes, parser->defaultTokenBytes, parser->tokenBytesUsed);
+        }
+    }
+    else
+    {
+        pNewBytes = (byte*)parser->memorySuite.realloc(parser->memorySuite.userData, parser->pTokenBytes, newLength);
+    }
+    if (!pNewBytes)
+    {
+        return JSON_Failure;
+    }
+    parser->pTokenBytes = pNewBytes;
+    parser->tokenBytesLength = newLength;
+    return JSON_Success;
+}
 
-    case LEXING_NUMBER_AFTER_LEADING_ZERO:
-    case LEXING_NUMBER_AFTER_LEADING_NEGATIVE_ZERO:
-        if (c == '.')
+static JSON_Status JSON_Parser_GrowTokenBytes(JSON_Parser parser, size_t neededLength)
+{
+    /* Grows the buffer, according to the growth policy, until it can hold
+       neededLength bytes with room to spare for one more codepoint. */
+    size_t newLength = parser->tokenBytesLength;
+    if (neededLength > SIZE_MAX - LONGEST_ENCODING_SEQUENCE)
+    {
+        return JSON_Failure;
+    }
+    neededLength += LONGEST_ENCODING_SEQUENCE;
+    while (newLength < neededLength)
+    {
+        size_t increment = (parser->bufferGrowthPolicy == JSON_GrowByHalf) ? newLength / 2 : newLength;
+        if (increment > SIZE_MAX - newLength)
         {
-            codepointToRecord = '.';
-            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsDecimalPoint);
-            parser->lexerState = LEXING_NUMBER_AFTER_DOT;
-            goto recordNumberCodepointAndAdvance;
+            newLength = neededLength;
+            break;
         }
-        else if (c == 'e' || c == 'E')
+        newLength += increment;
+    }
+    return (newLength == parser->tokenBytesLength) ? JSON_Success : JSON_Parser_ResizeTokenBytes(parser, newLength);
+}
+
+static JSON_Status JSON_Parser_MaterializeTokenRef(JSON_Parser parser)
+{
+    if (parser->pTokenRef)
+    {
+        /* The token's bytes are in the input, not in the buffer, so the
+           buffer has no contents to carry over when it grows. */
+        size_t tokenBytesUsed = parser->tokenBytesUsed;
+        parser->tokenBytesUsed = 0;
+        if (!JSON_Parser_GrowTokenBytes(parser, tokenBytesUsed))
         {
-            codepointToRecord = c;
-            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsExponent);
-            parser->lexerState = LEXING_NUMBER_AFTER_E;
-            goto recordNumberCodepointAndAdvance;
+            parser->tokenBytesUsed = tokenBytesUsed;
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
         }
-        else if (c >= '0' && c <= '9')
+        parser->tokenBytesUsed = tokenBytesUsed;
+        memcpy(parser->pTokenBytes, parser->pTokenRef, parser->tokenBytesUsed);
+        parser->pTokenRef = NULL;
+    }
+    return JSON_Success;
+}
+
+static void JSON_Parser_NullTerminateToken(JSON_Parser parser)
+{
+    /* Because we always ensure that there are LONGEST_ENCODING_SEQUENCE bytes
+       available at the end of the token buffer when we record codepoints, we
+       can write the null terminator to the buffer with impunity. */
+    static const byte nullTerminatorBytes[LONGEST_ENCODING_SEQUENCE] = { 0 };
+    Encoding encoding = (Encoding)((parser->token == T_NUMBER) ? parser->numberEncoding : parser->stringEncoding);
+    memcpy(parser->pTokenBytes + parser->tokenBytesUsed, nullTerminatorBytes, SHORTEST_ENCODING_SEQUENCE(encoding));
+}
+
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_SimpleTokenHandler)(JSON_Parser parser);
+static JSON_Status JSON_Parser_CallSimpleTokenHandler(JSON_Parser parser, JSON_Parser_SimpleTokenHandler handler)
+{
+    if (handler)
+    {
+        JSON_Parser_HandlerResult result;
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        result = handler(parser);
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (result != JSON_Parser_Continue)
         {
-            /* JSON does not allow the integer part of a number to have any
-               digits after a leading zero. */
-            if (!JSON_Parser_HandleInvalidNumber(parser, c, 0, 0))
-            {
-                return JSON_Failure;
-            }
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+            return JSON_Failure;
         }
-        else if ((c == 'x' || c == 'X') &&
-                 parser->lexerState == LEXING_NUMBER_AFTER_LEADING_ZERO &&
-                 GET_FLAGS(parser->flags, PARSER_ALLOW_HEX_NUMBERS))
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_StartContainerWithHandler(JSON_Parser parser, JSON_Parser_SimpleTokenHandler handler, int isObject)
+{
+    JSON_Parser_HandlerResult result = JSON_Parser_Continue;
+    if (handler)
+    {
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        result = handler(parser);
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (result != JSON_Parser_Continue && result != JSON_Parser_SkipValue)
         {
-            codepointToRecord = c;
-            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_IsHex);
-            parser->lexerState = LEXING_NUMBER_AFTER_X;
-            goto recordNumberCodepointAndAdvance;
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+            return JSON_Failure;
         }
-        else
+    }
+    if (!JSON_Parser_StartContainer(parser, isObject))
+    {
+        return JSON_Failure;
+    }
+    if (result == JSON_Parser_SkipValue)
+    {
+        /* The container has been entered, so the skip ends when it does. */
+        JSON_Parser_StartSkippingValue(parser, parser->depth - 1);
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_HandleObjectMemberResult(JSON_Parser parser, JSON_Parser_HandlerResult result)
+{
+    switch (result)
+    {
+    case JSON_Parser_Continue:
+        return JSON_Success;
+
+    case JSON_Parser_SkipValue:
+        JSON_Parser_StartSkippingValue(parser, parser->depth);
+        return JSON_Success;
+
+    case JSON_Parser_TreatAsDuplicateObjectMember:
+        JSON_Parser_SetErrorAtToken(parser, JSON_Error_DuplicateObjectMember);
+        return JSON_Failure;
+
+    default:
+        JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+        return JSON_Failure;
+    }
+}
+
+static JSON_Status JSON_Parser_CallBooleanHandler(JSON_Parser parser)
+{
+    if (parser->booleanHandler)
+    {
+        JSON_Parser_HandlerResult result;
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        result = parser->booleanHandler(parser, parser->token == T_TRUE ? JSON_True : JSON_False);
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (result != JSON_Parser_Continue)
         {
-            /* The number is finished. */
-            if (!JSON_Parser_ProcessToken(parser))
-            {
-                return JSON_Failure;
-            }
-            goto reprocess;
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+            return JSON_Failure;
         }
-        goto advance;
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_CallInternedMemberHandler(JSON_Parser parser)
+{
+    JSON_Parser_HandlerResult result;
+    size_t keyId;
+    int isNewKey;
+    const byte* pName;
+    if (!JSON_Parser_InternMemberName(parser, &keyId, &isNewKey))
+    {
+        return JSON_Failure;
+    }
+    if (keyId != NO_INTERNED_KEY)
+    {
+        pName = parser->pInternedKeys[keyId].pName;
+    }
+    else
+    {
+        if (!JSON_Parser_MaterializeTokenRef(parser))
+        {
+            return JSON_Failure;
+        }
+        JSON_Parser_NullTerminateToken(parser);
+        pName = parser->pTokenBytes;
+    }
+    SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+    result = parser->internedMemberHandler(parser, keyId, isNewKey ? JSON_True : JSON_False, (const char*)pName, parser->tokenBytesUsed, parser->tokenAttributes);
+    SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+    return JSON_Parser_HandleObjectMemberResult(parser, result);
+}
+
+static JSON_Status JSON_Parser_CallKnownMemberHandler(JSON_Parser parser, size_t keyIndex)
+{
+    JSON_Parser_HandlerResult result;
+    const byte* pName;
+    if (keyIndex != JSON_UNKNOWN_KEY)
+    {
+        pName = parser->pKnownKeys->pBytes + parser->pKnownKeys->pKeys[keyIndex].offset;
+    }
+    else
+    {
+        if (!JSON_Parser_MaterializeTokenRef(parser))
+        {
+            return JSON_Failure;
+        }
+        JSON_Parser_NullTerminateToken(parser);
+        pName = parser->pTokenBytes;
+    }
+    SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+    result = parser->knownMemberHandler(parser, keyIndex, (const char*)pName, parser->tokenBytesUsed, parser->tokenAttributes);
+    SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+    return JSON_Parser_HandleObjectMemberResult(parser, result);
+}
+
+static JSON_Status JSON_Parser_CallStringHandler(JSON_Parser parser, int isObjectMember)
+{
+    JSON_Parser_StringRefHandler refHandler = isObjectMember ? parser->objectMemberRefHandler : parser->stringRefHandler;
+    JSON_Parser_StringHandler handler = isObjectMember ? parser->objectMemberHandler : parser->stringHandler;
+    if (isObjectMember && (parser->knownMemberHandler || GET_FLAGS(parser->flags, PARSER_SKIP_UNKNOWN_MEMBERS)))
+    {
+        size_t keyIndex = parser->pKnownKeys
+            ? LookUpKnownKey(parser->pKnownKeys, JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed)
+            : JSON_UNKNOWN_KEY;
+        if (keyIndex == JSON_UNKNOWN_KEY && GET_FLAGS(parser->flags, PARSER_SKIP_UNKNOWN_MEMBERS))
+        {
+            JSON_Parser_StartSkippingValue(parser, parser->depth);
+            return JSON_Success;
+        }
+        if (parser->knownMemberHandler)
+        {
+            return JSON_Parser_CallKnownMemberHandler(parser, keyIndex);
+        }
+    }
+    if (isObjectMember && parser->internedMemberHandler)
+    {
+        return JSON_Parser_CallInternedMemberHandler(parser);
+    }
+    if (refHandler || handler)
+    {
+        JSON_Parser_HandlerResult result;
+        if (!refHandler)
+        {
+            if (!JSON_Parser_MaterializeTokenRef(parser))
+            {
+                return JSON_Failure;
+            }
+            JSON_Parser_NullTerminateToken(parser);
+        }
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (refHandler)
+        {
+            result = refHandler(parser, (const char*)JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed, parser->tokenAttributes);
+        }
+        else
+        {
+            result = handler(parser, (char*)parser->pTokenBytes, parser->tokenBytesUsed, parser->tokenAttributes);
+        }
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (isObjectMember)
+        {
+            return JSON_Parser_HandleObjectMemberResult(parser, result);
+        }
+        if (result != JSON_Parser_Continue)
+        {
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+            return JSON_Failure;
+        }
+    }
+    return JSON_Success;
+}
+
+/* Clinger's fast path only rounds correctly if double arithmetic isn't
+   carried out at a higher precision, as it is on the x87 FPU. An
+   evaluation method of 16 only promotes _Float16 arithmetic to float,
+   which leaves double arithmetic exact. */
+#if (!defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 16) && \
+    (!defined(__FLT_EVAL_METHOD__) || __FLT_EVAL_METHOD__ == 0 || __FLT_EVAL_METHOD__ == 16)
+#define EXACT_DOUBLE_ARITHMETIC
+#endif
+
+#ifdef EXACT_DOUBLE_ARITHMETIC
+
+/* Powers of ten that are exactly representable as doubles. */
+static const double s_exactPowersOfTen[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define MAX_EXACT_POWER_OF_TEN 22
+#define MAX_EXACT_DOUBLE_DIGITS 15
+#define MAX_EXACT_DOUBLE_MANTISSA ((JSON_UInt64)1 << 53)
+
+#endif /* EXACT_DOUBLE_ARITHMETIC */
+
+static int ConvertDecimalToDoubleQuickly(JSON_UInt64 mantissa, int exponent, double* pValue)
+{
+    /* When the mantissa and the power of ten are both exactly representable
+       as doubles, a single multiplication or division rounds correctly.
+       This covers the overwhelming majority of numbers that appear in
+       real-world JSON. */
+    if (!mantissa)
+    {
+        *pValue = 0.0;
+        return 1;
+    }
+#ifdef EXACT_DOUBLE_ARITHMETIC
+    if (mantissa <= MAX_EXACT_DOUBLE_MANTISSA)
+    {
+        if (exponent >= 0 && exponent <= MAX_EXACT_POWER_OF_TEN)
+        {
+            *pValue = (double)mantissa * s_exactPowersOfTen[exponent];
+            return 1;
+        }
+        if (exponent < 0 && exponent >= -MAX_EXACT_POWER_OF_TEN)
+        {
+            *pValue = (double)mantissa / s_exactPowersOfTen[-exponent];
+            return 1;
+        }
+        if (exponent > MAX_EXACT_POWER_OF_TEN && exponent <= MAX_EXACT_POWER_OF_TEN + MAX_EXACT_DOUBLE_DIGITS)
+        {
+            /* Numbers like 123e30 can be handled by moving some of the
+               exponent into the mantissa, as long as it stays exact. */
+            double scaled = (double)mantissa * s_exactPowersOfTen[exponent - MAX_EXACT_POWER_OF_TEN];
+            if (scaled <= (double)MAX_EXACT_DOUBLE_MANTISSA)
+            {
+                *pValue = scaled * s_exactPowersOfTen[MAX_EXACT_POWER_OF_TEN];
+                return 1;
+            }
+        }
+    }
+#else
+    (void)exponent;
+#endif
+    return 0;
+}
+
+static size_t FormatDecimalExponent(char* pBuffer, long exponent)
+{
+    /* Formats "e<exponent>" without depending on the C library. */
+    char digits[24];
+    size_t digitCount = 0;
+    size_t length = 0;
+    unsigned long magnitude = (exponent < 0) ? 0UL - (unsigned long)exponent : (unsigned long)exponent;
+    pBuffer[length++] = 'e';
+    if (exponent < 0)
+    {
+        pBuffer[length++] = '-';
+    }
+    do
+    {
+        digits[digitCount++] = (char)('0' + (int)(magnitude % 10));
+        magnitude /= 10;
+    } while (magnitude);
+    while (digitCount)
+    {
+        pBuffer[length++] = digits[--digitCount];
+    }
+    pBuffer[length] = 0;
+    return length;
+}
+
+static double ConvertDecimalToDouble(JSON_UInt64 mantissa, int exponent)
+{
+    /* The slow path formats the number as "<digits>e<exponent>", which,
+       unlike the original text, contains no decimal point and so can be
+       converted by strtod() regardless of the current locale. */
+    char buffer[48];
+    char digits[24];
+    size_t digitCount = 0;
+    size_t length = 0;
+    double value;
+    if (ConvertDecimalToDoubleQuickly(mantissa, exponent, &value))
+    {
+        return value;
+    }
+    do
+    {
+        digits[digitCount++] = (char)('0' + (int)(mantissa % 10));
+        mantissa /= 10;
+    } while (mantissa);
+    while (digitCount)
+    {
+        buffer[length++] = digits[--digitCount];
+    }
+    FormatDecimalExponent(buffer + length, exponent);
+    return strtod(buffer, NULL);
+}
+
+/* A number token's value, decomposed so that it can be converted to a
+   native type. */
+typedef struct tag_ScannedNumber
+{
+    JSON_UInt64 mantissa;         /* as many leading digits as fit */
+    int         exponent;         /* power of ten to multiply the mantissa by */
+    int         explicitExponent; /* the exponent that appears in the text */
+    NumberFlags flags;
+} ScannedNumber;
+
+static void ScanNumber(const byte* pBytes, size_t length, Encoding encoding, TokenAttributes attributes, ScannedNumber* pNumber)
+{
+    /* The number's characters are all ASCII, so we just need to pick out
+       the low-order byte of each one, whatever the number encoding. This
+       is done only when a native value is actually needed, so that the
+       lexer doesn't pay for it otherwise. */
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+    size_t i = (encoding == JSON_UTF16BE) ? 1 : ((encoding == JSON_UTF32BE) ? 3 : 0);
+    int isMantissaFull = 0;
+    int isFractional = 0;
+    pNumber->mantissa = 0;
+    pNumber->exponent = 0;
+    pNumber->explicitExponent = 0;
+    pNumber->flags = 0;
+    if (GET_FLAGS(attributes, JSON_IsHex))
+    {
+        for (i += 2 * unitLength; i < length; i += unitLength)
+        {
+            byte b = pBytes[i];
+            if (pNumber->mantissa >> 60)
+            {
+                SET_FLAGS_ON(NumberFlags, pNumber->flags, NUMBER_OVERFLOWED);
+                break;
+            }
+            pNumber->mantissa = (pNumber->mantissa << 4) | (unsigned int)((b <= '9') ? (b - '0') : ((b | 0x20) - 'a' + 10));
+        }
+        return;
+    }
+    for (; i < length; i += unitLength)
+    {
+        byte b = pBytes[i];
+        if (b >= '0' && b <= '9')
+        {
+            unsigned int digit = (unsigned int)(b - '0');
+            if (!isMantissaFull &&
+                (pNumber->mantissa < MAX_MANTISSA_BEFORE_DIGIT ||
+                 (pNumber->mantissa == MAX_MANTISSA_BEFORE_DIGIT && digit <= MAX_LAST_MANTISSA_DIGIT)))
+            {
+                pNumber->mantissa = pNumber->mantissa * 10 + digit;
+                pNumber->exponent -= isFractional;
+            }
+            else
+            {
+                /* The mantissa holds as many of the leading significant
+                   digits as fit in 64 bits; the rest only affect the
+                   exponent, or make the mantissa inexact if they aren't
+                   zero. */
+                isMantissaFull = 1;
+                if (digit)
+                {
+                    SET_FLAGS_ON(NumberFlags, pNumber->flags, NUMBER_TRUNCATED);
+                }
+                pNumber->exponent += !isFractional;
+            }
+            if (pNumber->exponent <= -MAX_NUMBER_EXPONENT || pNumber->exponent >= MAX_NUMBER_EXPONENT)
+            {
+                SET_FLAGS_ON(NumberFlags, pNumber->flags, NUMBER_OVERFLOWED);
+                return;
+            }
+        }
+        else if (b == '.')
+        {
+            isFractional = 1;
+        }
+        else if (b == 'e' || b == 'E')
+        {
+            break;
+        }
+    }
+    for (; i < length; i += unitLength)
+    {
+        byte b = pBytes[i];
+        if (b >= '0' && b <= '9')
+        {
+            if (pNumber->explicitExponent >= MAX_NUMBER_EXPONENT)
+            {
+                SET_FLAGS_ON(NumberFlags, pNumber->flags, NUMBER_OVERFLOWED);
+                return;
+            }
+            pNumber->explicitExponent = pNumber->explicitExponent * 10 + (b - '0');
+        }
+    }
+    if (GET_FLAGS(attributes, JSON_ContainsNegativeExponent))
+    {
+        pNumber->explicitExponent = -pNumber->explicitExponent;
+    }
+    pNumber->exponent += pNumber->explicitExponent;
+}
+
+static int ScannedNumberToInt64(const ScannedNumber* pNumber, TokenAttributes attributes, JSON_Int64* pValue)
+{
+    int isNegative = GET_FLAGS(attributes, JSON_IsNegative);
+    JSON_UInt64 maxMagnitude = ((JSON_UInt64)1 << 63) - (isNegative ? 0 : 1);
+    if (GET_FLAGS(attributes, JSON_ContainsDecimalPoint | JSON_ContainsExponent) ||
+        GET_FLAGS(pNumber->flags, NUMBER_TRUNCATED | NUMBER_OVERFLOWED) ||
+        pNumber->exponent || pNumber->mantissa > maxMagnitude)
+    {
+        return 0;
+    }
+    /* Negate via the magnitude minus one, so that the most negative value
+       doesn't overflow. */
+    *pValue = (isNegative && pNumber->mantissa) ? -(JSON_Int64)(pNumber->mantissa - 1) - 1 : (JSON_Int64)pNumber->mantissa;
+    return 1;
+}
+
+static int ScannedNumberToUInt64(const ScannedNumber* pNumber, TokenAttributes attributes, JSON_UInt64* pValue)
+{
+    if (GET_FLAGS(attributes, JSON_IsNegative | JSON_ContainsDecimalPoint | JSON_ContainsExponent) ||
+        GET_FLAGS(pNumber->flags, NUMBER_TRUNCATED | NUMBER_OVERFLOWED) ||
+        pNumber->exponent)
+    {
+        return 0;
+    }
+    *pValue = pNumber->mantissa;
+    return 1;
+}
+
+static JSON_Status ConvertNumberTextToDouble(const JSON_MemorySuite* pMemorySuite, const byte* pBytes, size_t length, Encoding encoding, int explicitExponent, double* pValue)
+{
+    /* When the number has too many significant digits to fit in the
+       mantissa, and the dropped ones aren't all zeros, the only way to round
+       correctly is to convert all of them. As in ConvertDecimalToDouble(),
+       the decimal point is removed and the exponent adjusted to match. */
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+    size_t i = (encoding == JSON_UTF16BE) ? 1 : ((encoding == JSON_UTF32BE) ? 3 : 0);
+    size_t digitCount = 0;
+    long fractionalDigitCount = 0;
+    int isFractional = 0;
+    char* pBuffer = (char*)pMemorySuite->realloc(pMemorySuite->userData, NULL, length / unitLength + 24);
+    if (!pBuffer)
+    {
+        return JSON_Failure;
+    }
+    for (; i < length; i += unitLength)
+    {
+        byte b = pBytes[i];
+        if (b >= '0' && b <= '9')
+        {
+            pBuffer[digitCount++] = (char)b;
+            fractionalDigitCount += isFractional;
+        }
+        else if (b == '.')
+        {
+            isFractional = 1;
+        }
+        else if (b == 'e' || b == 'E')
+        {
+            break;
+        }
+    }
+    FormatDecimalExponent(pBuffer + digitCount, (long)explicitExponent - fractionalDigitCount);
+    *pValue = strtod(pBuffer, NULL);
+    pMemorySuite->free(pMemorySuite->userData, pBuffer);
+    return JSON_Success;
+}
+
+static JSON_Status ScannedNumberToDouble(const ScannedNumber* pNumber, const JSON_MemorySuite* pMemorySuite, const byte* pBytes, size_t length, Encoding encoding, TokenAttributes attributes, double* pValue, int* pInRange)
+{
+    /* This function only fails if it runs out of memory; a number whose
+       magnitude is too large or too small to represent is reported through
+       pInRange instead. */
+    double value;
+    *pInRange = 0;
+    if (GET_FLAGS(pNumber->flags, NUMBER_OVERFLOWED))
+    {
+        return JSON_Success;
+    }
+    if (GET_FLAGS(attributes, JSON_IsHex))
+    {
+        value = (double)pNumber->mantissa;
+    }
+    else if (GET_FLAGS(pNumber->flags, NUMBER_TRUNCATED))
+    {
+        if (!ConvertNumberTextToDouble(pMemorySuite, pBytes, length, encoding, pNumber->explicitExponent, &value))
+        {
+            return JSON_Failure;
+        }
+    }
+    else
+    {
+        value = ConvertDecimalToDouble(pNumber->mantissa, pNumber->exponent);
+    }
+    if (value > DBL_MAX || (value == 0.0 && pNumber->mantissa))
+    {
+        return JSON_Success;
+    }
+    *pValue = GET_FLAGS(attributes, JSON_IsNegative) ? -value : value;
+    *pInRange = 1;
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_CallNativeNumberHandler(JSON_Parser parser, int* pHandled)
+{
+    JSON_Parser_HandlerResult result;
+    TokenAttributes attributes = parser->tokenAttributes;
+    const byte* pBytes = JSON_Parser_GetTokenBytes(parser);
+    ScannedNumber number;
+    JSON_Int64 intValue;
+    JSON_UInt64 uintValue;
+    double value;
+    int inRange;
+    *pHandled = 0;
+    ScanNumber(pBytes, parser->tokenBytesUsed, parser->numberEncoding, attributes, &number);
+    if (parser->int64Handler && ScannedNumberToInt64(&number, attributes, &intValue))
+    {
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        result = parser->int64Handler(parser, intValue, attributes);
+    }
+    else if (parser->uint64Handler && ScannedNumberToUInt64(&number, attributes, &uintValue))
+    {
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        result = parser->uint64Handler(parser, uintValue, attributes);
+    }
+    else if (parser->doubleHandler)
+    {
+        if (!ScannedNumberToDouble(&number, &parser->memorySuite, pBytes, parser->tokenBytesUsed, parser->numberEncoding, attributes, &value, &inRange))
+        {
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
+        }
+        if (!inRange)
+        {
+            /* The number overflowed or underflowed. */
+            return JSON_Success;
+        }
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        result = parser->doubleHandler(parser, value, attributes);
+    }
+    else
+    {
+        return JSON_Success;
+    }
+    SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+    *pHandled = 1;
+    if (result != JSON_Parser_Continue)
+    {
+        JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_CallNumberHandler(JSON_Parser parser)
+{
+    if (parser->int64Handler || parser->uint64Handler || parser->doubleHandler)
+    {
+        int handled;
+        if (!JSON_Parser_CallNativeNumberHandler(parser, &handled))
+        {
+            return JSON_Failure;
+        }
+        if (handled)
+        {
+            return JSON_Success;
+        }
+    }
+    if (parser->numberRefHandler || parser->numberHandler)
+    {
+        JSON_Parser_HandlerResult result;
+        if (!parser->numberRefHandler)
+        {
+            if (!JSON_Parser_MaterializeTokenRef(parser))
+            {
+                return JSON_Failure;
+            }
+            JSON_Parser_NullTerminateToken(parser);
+        }
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (parser->numberRefHandler)
+        {
+            result = parser->numberRefHandler(parser, (const char*)JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed, parser->tokenAttributes);
+        }
+        else
+        {
+            result = parser->numberHandler(parser, (char*)parser->pTokenBytes, parser->tokenBytesUsed, parser->tokenAttributes);
+        }
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (result != JSON_Parser_Continue)
+        {
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+            return JSON_Failure;
+        }
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_CallSpecialNumberHandler(JSON_Parser parser)
+{
+    if (parser->specialNumberHandler)
+    {
+        JSON_Parser_HandlerResult result;
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        result = parser->specialNumberHandler(parser, parser->token == T_NAN ? JSON_NaN :
+                                              (parser->token == T_INFINITY ? JSON_Infinity : JSON_NegativeInfinity));
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+        if (result != JSON_Parser_Continue)
+        {
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+            return JSON_Failure;
+        }
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_FlushEvents(JSON_Parser parser)
+{
+    JSON_Parser_HandlerResult result;
+    size_t count = parser->eventCount;
+    parser->eventCount = 0;
+    parser->eventArenaUsed = 0;
+    result = parser->eventBatchHandler(parser, parser->pEvents, count, (const char*)parser->pEventArena);
+    if (result != JSON_Parser_Continue)
+    {
+        /* Don't hide an error that occurred before the batch was flushed. */
+        if (parser->error == JSON_Error_None)
+        {
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_AbortedByHandler);
+        }
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+/* Tape building is implemented in the JSON Tape section. */
+static void JSON_Tape_ResetData(JSON_Tape tape);
+static JSON_Status JSON_Parser_RecordTapeEvents(JSON_Parser parser, byte emit);
+static void JSON_Parser_FinishTape(JSON_Parser parser, JSON_Status status);
+
+/* Event queueing for readers is implemented in the JSON Reader section. */
+static JSON_Status JSON_Parser_QueueReaderEvent(JSON_Parser parser, JSON_EventType type, byte attributes, int hasValue);
+static JSON_Status JSON_Parser_QueueReaderEvents(JSON_Parser parser, byte emit);
+
+static JSON_Status JSON_Parser_CallDocumentHandler(JSON_Parser parser, JSON_Parser_SimpleTokenHandler handler, JSON_EventType readerEventType)
+{
+    /* The events recorded in batch mode are delivered first, and a reader
+       queues an event behind the ones it has already queued, so that the
+       document boundaries are seen in order. */
+    if (parser->reader)
+    {
+        return JSON_Parser_QueueReaderEvent(parser, readerEventType, 0, 0);
+    }
+    if (handler && parser->eventCount && !JSON_Parser_FlushEvents(parser))
+    {
+        return JSON_Failure;
+    }
+    return JSON_Parser_CallSimpleTokenHandler(parser, handler);
+}
+
+static JSON_Status JSON_Parser_EndDocument(JSON_Parser parser)
+{
+    /* Called when the top-level value of a document has been parsed in
+       multi-document mode or when stopping after an embedded document. */
+    if (GET_FLAGS(parser->flags, PARSER_MULTIPLE_DOCUMENTS))
+    {
+        if (parser->tape)
+        {
+            JSON_Parser_FinishTape(parser, JSON_Success);
+        }
+        if (!JSON_Parser_CallDocumentHandler(parser, parser->endDocumentHandler, JSON_Event_EndDocument))
+        {
+            return JSON_Failure;
+        }
+    }
+    if (GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT))
+    {
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_StoppedAfterEmbeddedDocument);
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_RecordEvent(JSON_Parser parser, JSON_EventType type, byte attributes, int hasValue)
+{
+    JSON_Event* pEvent = &parser->pEvents[parser->eventCount];
+    pEvent->type = (unsigned char)type;
+    pEvent->attributes = attributes;
+    pEvent->depth = (unsigned int)parser->depth;
+    pEvent->valueOffset = 0;
+    pEvent->valueLength = 0;
+    if (hasValue)
+    {
+        Encoding encoding = (Encoding)((parser->token == T_NUMBER) ? parser->numberEncoding : parser->stringEncoding);
+        size_t nullTerminatorLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+        size_t valueBytes = parser->tokenBytesUsed + nullTerminatorLength;
+        if (parser->eventArenaLength - parser->eventArenaUsed < valueBytes)
+        {
+            size_t newLength = parser->eventArenaLength ? parser->eventArenaLength : DEFAULT_EVENT_ARENA_LENGTH;
+            byte* pNewArena;
+            while (newLength - parser->eventArenaUsed < valueBytes)
+            {
+                if (newLength > SIZE_MAX / 2)
+                {
+                    newLength = parser->eventArenaUsed + valueBytes;
+                    break;
+                }
+                newLength *= 2;
+            }
+            pNewArena = (byte*)parser->memorySuite.realloc(parser->memorySuite.userData, parser->pEventArena, newLength);
+            if (!pNewArena)
+            {
+                JSON_Parser_SetErrorAtToken(parser, JSON_Error_OutOfMemory);
+                return JSON_Failure;
+            }
+            parser->pEventArena = pNewArena;
+            parser->eventArenaLength = newLength;
+        }
+        memcpy(parser->pEventArena + parser->eventArenaUsed, JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed);
+        memset(parser->pEventArena + parser->eventArenaUsed + parser->tokenBytesUsed, 0, nullTerminatorLength);
+        pEvent->valueOffset = parser->eventArenaUsed;
+        pEvent->valueLength = parser->tokenBytesUsed;
+        parser->eventArenaUsed += valueBytes;
+    }
+    if (++parser->eventCount == parser->maxEvents)
+    {
+        return JSON_Parser_FlushEvents(parser);
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_RecordGrammarEvents(JSON_Parser parser, byte emit)
+{
+    /* Array items aren't recorded; see JSON_Parser_SetEventBatchHandler(). */
+    SET_FLAGS_OFF(byte, emit, EMIT_ARRAY_ITEM);
+    switch (emit)
+    {
+    case EMIT_NULL:
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_Null, 0, 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_BOOLEAN:
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_Boolean, (byte)(parser->token == T_TRUE ? JSON_True : JSON_False), 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_STRING:
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_String, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_NUMBER:
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_Number, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_SPECIAL_NUMBER:
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_SpecialNumber, (byte)(parser->token == T_NAN ? JSON_NaN :
+                                     (parser->token == T_INFINITY ? JSON_Infinity : JSON_NegativeInfinity)), 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_OBJECT:
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_StartObject, 0, 0) ||
+            !JSON_Parser_StartContainer(parser, 1/*isObject*/))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_OBJECT:
+        JSON_Parser_EndContainer(parser, 1/*isObject*/);
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_EndObject, 0, 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_OBJECT_MEMBER:
+        if (!JSON_Parser_AddMemberNameToList(parser) || /* will fail if member is duplicate */
+            !JSON_Parser_RecordEvent(parser, JSON_Event_ObjectMember, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_ARRAY:
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_StartArray, 0, 0) ||
+            !JSON_Parser_StartContainer(parser, 0/*isObject*/))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_ARRAY:
+        JSON_Parser_EndContainer(parser, 0/*isObject*/);
+        if (!JSON_Parser_RecordEvent(parser, JSON_Event_EndArray, 0, 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+    }
+    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT | PARSER_MULTIPLE_DOCUMENTS))
+    {
+        return JSON_Parser_EndDocument(parser);
+    }
+    return JSON_Success;
+}
+
+/* Path filtering is implemented after JSON_Parser_HandleGrammarEvents(),
+   which it uses to pass the events inside matched values to the handlers. */
+static JSON_Status JSON_Parser_HandleFilteredGrammarEvents(JSON_Parser parser, byte emit);
+
+static JSON_Status JSON_Parser_HandleGrammarEvents(JSON_Parser parser, byte emit)
+{
+    if (parser->reader)
+    {
+        return JSON_Parser_QueueReaderEvents(parser, emit);
+    }
+    if (parser->tape)
+    {
+        return JSON_Parser_RecordTapeEvents(parser, emit);
+    }
+    if (parser->eventBatchHandler)
+    {
+        return JSON_Parser_RecordGrammarEvents(parser, emit);
+    }
+    if (GET_FLAGS(parser->state, PARSER_SKIPPING_VALUE | PARSER_FILTERING_PATHS))
+    {
+        /* Skipping takes precedence over filtering, since the filter does
+           not see the events inside skipped values. */
+        return GET_FLAGS(parser->state, PARSER_SKIPPING_VALUE)
+            ? JSON_Parser_HandleSkippedGrammarEvents(parser, emit)
+            : JSON_Parser_HandleFilteredGrammarEvents(parser, emit);
+    }
+    if (GET_FLAGS(emit, EMIT_ARRAY_ITEM))
+    {
+        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->arrayItemHandler))
+        {
+            return JSON_Failure;
+        }
+        SET_FLAGS_OFF(byte, emit, EMIT_ARRAY_ITEM);
+    }
+    switch (emit)
+    {
+    case EMIT_NULL:
+        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->nullHandler))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_BOOLEAN:
+        if (!JSON_Parser_CallBooleanHandler(parser))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_STRING:
+        if (!JSON_Parser_CallStringHandler(parser, 0/* isObjectMember */))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_NUMBER:
+        if (!JSON_Parser_CallNumberHandler(parser))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_SPECIAL_NUMBER:
+        if (!JSON_Parser_CallSpecialNumberHandler(parser))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_OBJECT:
+        if (!JSON_Parser_StartContainerWithHandler(parser, parser->startObjectHandler, 1/*isObject*/))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_OBJECT:
+        JSON_Parser_EndContainer(parser, 1/*isObject*/);
+        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->endObjectHandler))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_OBJECT_MEMBER:
+        if (!JSON_Parser_AddMemberNameToList(parser) || /* will fail if member is duplicate */
+            !JSON_Parser_CallStringHandler(parser, 1 /* isObjectMember */))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_ARRAY:
+        if (!JSON_Parser_StartContainerWithHandler(parser, parser->startArrayHandler, 0/*isObject*/))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_ARRAY:
+        JSON_Parser_EndContainer(parser, 0/*isObject*/);
+        if (!JSON_Parser_CallSimpleTokenHandler(parser, parser->endArrayHandler))
+        {
+            return JSON_Failure;
+        }
+        break;
+    }
+    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT | PARSER_MULTIPLE_DOCUMENTS))
+    {
+        return JSON_Parser_EndDocument(parser);
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_ReserveLivePaths(JSON_Parser parser, size_t neededLength)
+{
+    if (neededLength > parser->livePathsLength)
+    {
+        size_t newLength = GetGrownLength(parser->livePathsLength, DEFAULT_LIVE_PATHS, neededLength);
+        size_t* pNewLivePaths = NULL;
+        if (newLength <= SIZE_MAX / sizeof(size_t))
+        {
+            pNewLivePaths = (size_t*)parser->memorySuite.realloc(parser->memorySuite.userData, parser->pLivePaths, newLength * sizeof(size_t));
+        }
+        if (!pNewLivePaths)
+        {
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
+        }
+        parser->pLivePaths = pNewLivePaths;
+        parser->livePathsLength = newLength;
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_PushPathFrame(JSON_Parser parser, size_t firstLivePath, size_t livePathCount)
+{
+    PathFrame* pFrame;
+    if (parser->pathFramesUsed == parser->pathFramesLength)
+    {
+        size_t newLength = GetGrownLength(parser->pathFramesLength, DEFAULT_PATH_FRAMES, parser->pathFramesUsed + 1);
+        PathFrame* pNewFrames = NULL;
+        if (newLength <= SIZE_MAX / sizeof(PathFrame))
+        {
+            pNewFrames = (PathFrame*)parser->memorySuite.realloc(parser->memorySuite.userData, parser->pPathFrames, newLength * sizeof(PathFrame));
+        }
+        if (!pNewFrames)
+        {
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
+        }
+        parser->pPathFrames = pNewFrames;
+        parser->pathFramesLength = newLength;
+    }
+    pFrame = &parser->pPathFrames[parser->pathFramesUsed++];
+    pFrame->firstLivePath = firstLivePath;
+    pFrame->livePathCount = livePathCount;
+    pFrame->itemCount = 0;
+    return JSON_Success;
+}
+
+static size_t JSON_Parser_GetPendingLivePathsStart(JSON_Parser parser)
+{
+    const PathFrame* pFrame;
+    if (!parser->pathFramesUsed)
+    {
+        return 0;
+    }
+    pFrame = &parser->pPathFrames[parser->pathFramesUsed - 1];
+    return pFrame->firstLivePath + pFrame->livePathCount;
+}
+
+static JSON_Status JSON_Parser_SelectChildPaths(JSON_Parser parser, const byte* pName, size_t length, size_t index)
+{
+    /* Selects, from the paths that the innermost open container's path is
+       a prefix of, those that its next child's path is also a prefix of.
+       Every container that the filter sees has a frame, so the child's
+       segment in each path is the one at the current depth. */
+    const PathFilter* pFilter = parser->pPathFilter;
+    const PathFrame* pFrame = &parser->pPathFrames[parser->pathFramesUsed - 1];
+    size_t pendingStart = pFrame->firstLivePath + pFrame->livePathCount;
+    size_t i;
+    parser->pendingLivePathCount = 0;
+    if (!pFrame->livePathCount)
+    {
+        return JSON_Success;
+    }
+    if (!JSON_Parser_ReserveLivePaths(parser, pendingStart + pFrame->livePathCount))
+    {
+        return JSON_Failure;
+    }
+    for (i = 0; i < pFrame->livePathCount; i++)
+    {
+        size_t pathIndex = parser->pLivePaths[pFrame->firstLivePath + i];
+        const FilterPath* pPath = &pFilter->pPaths[pathIndex];
+        if (PathSegmentMatches(pFilter, &pFilter->pSegments[pPath->firstSegment + parser->depth - 1], pName, length, index))
+        {
+            parser->pLivePaths[pendingStart + parser->pendingLivePathCount++] = pathIndex;
+        }
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_MatchFilteredValue(JSON_Parser parser, byte* pEmit, size_t firstLivePath, size_t* pLivePathCount, int* pSkip)
+{
+    /* Of the paths that the value's path is a prefix of, the ones that end
+       here match the value, and the others stay live for its children, if
+       it has any. */
+    PathFilter* pFilter = parser->pPathFilter;
+    size_t livePathCount = 0;
+    size_t i;
+    if (!parser->depth)
+    {
+        /* Every path is a candidate for the root value. */
+        if (!JSON_Parser_ReserveLivePaths(parser, pFilter->pathCount))
+        {
+            return JSON_Failure;
+        }
+        for (i = 0; i < pFilter->pathCount; i++)
+        {
+            parser->pLivePaths[i] = i;
+        }
+        parser->pendingLivePathCount = pFilter->pathCount;
+    }
+    for (i = 0; i < parser->pendingLivePathCount; i++)
+    {
+        size_t pathIndex = parser->pLivePaths[firstLivePath + i];
+        FilterPath* pPath = &pFilter->pPaths[pathIndex];
+        if (pPath->segmentCount != parser->depth)
+        {
+            parser->pLivePaths[firstLivePath + livePathCount++] = pathIndex;
+            continue;
+        }
+        if (!pPath->hasWildcard && !pPath->isMatched)
+        {
+            pPath->isMatched = 1;
+            pFilter->matchedPathCount++;
+        }
+        if (parser->matchedValueDepth == NO_MATCHED_VALUE)
+        {
+            /* The array item event belongs to the value's container, which
+               does not match. */
+            parser->matchedValueDepth = parser->depth;
+            SET_FLAGS_OFF(ParserState, parser->state, PARSER_OUTSIDE_MATCHED_VALUE);
+            SET_FLAGS_OFF(byte, *pEmit, EMIT_ARRAY_ITEM);
+        }
+        if (parser->pathMatchHandler)
+        {
+            JSON_Parser_HandlerResult result;
+            SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+            result = parser->pathMatchHandler(parser, pathIndex);
+            SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_TOKEN_HANDLER);
+            if (result == JSON_Parser_SkipValue)
+            {
+                *pSkip = 1;
+            }
+            else if (result != JSON_Parser_Continue)
+            {
+                JSON_Parser_SetErrorAtToken(parser, JSON_Error_AbortedByHandler);
+                return JSON_Failure;
+            }
+        }
+    }
+    parser->pendingLivePathCount = 0;
+    *pLivePathCount = livePathCount;
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_HandleFilteredGrammarEvents(JSON_Parser parser, byte emit)
+{
+    /* Only the events inside the values that match the path filter are
+       passed to the handlers; the values that no path can match are
+       skipped. */
+    byte event = emit;
+    size_t firstLivePath = 0;
+    size_t livePathCount = 0;
+    int skip = 0;
+    int passedToHandlers;
+    SET_FLAGS_OFF(byte, event, EMIT_ARRAY_ITEM);
+    if (GET_FLAGS(emit, EMIT_ARRAY_ITEM) &&
+        !JSON_Parser_SelectChildPaths(parser, NULL, 0, parser->pPathFrames[parser->pathFramesUsed - 1].itemCount++))
+    {
+        return JSON_Failure;
+    }
+    switch (event)
+    {
+    case EMIT_NOTHING:
+        return JSON_Success;
+
+    case EMIT_OBJECT_MEMBER:
+        if (!JSON_Parser_SelectChildPaths(parser, JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed, NOT_AN_ARRAY_INDEX))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_OBJECT:
+    case EMIT_END_ARRAY:
+        parser->pathFramesUsed--;
+        break;
+
+    default:
+        firstLivePath = JSON_Parser_GetPendingLivePathsStart(parser);
+        if (!JSON_Parser_MatchFilteredValue(parser, &emit, firstLivePath, &livePathCount, &skip))
+        {
+            return JSON_Failure;
+        }
+        break;
+    }
+
+    passedToHandlers = (parser->matchedValueDepth != NO_MATCHED_VALUE && !skip);
+    if (passedToHandlers)
+    {
+        /* Pass the events to the handlers as if there were no filter. */
+        JSON_Status status;
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_FILTERING_PATHS);
+        status = JSON_Parser_HandleGrammarEvents(parser, emit);
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_FILTERING_PATHS);
+        if (!status)
+        {
+            return JSON_Failure;
+        }
+    }
+    else
+    {
+        /* Only do the bookkeeping that the parser itself needs. */
+        switch (event)
+        {
+        case EMIT_OBJECT_MEMBER:
+            if (!JSON_Parser_AddMemberNameToList(parser)) /* will fail if member is duplicate */
+            {
+                return JSON_Failure;
+            }
+            if (!parser->pendingLivePathCount)
+            {
+                JSON_Parser_StartSkippingValue(parser, parser->depth);
+            }
+            break;
+
+        case EMIT_END_OBJECT:
+        case EMIT_END_ARRAY:
+            JSON_Parser_EndContainer(parser, event == EMIT_END_OBJECT);
+            break;
+
+        case EMIT_START_OBJECT:
+        case EMIT_START_ARRAY:
+            if (!JSON_Parser_StartContainer(parser, event == EMIT_START_OBJECT))
+            {
+                return JSON_Failure;
+            }
+            if (skip || !livePathCount)
+            {
+                JSON_Parser_StartSkippingValue(parser, parser->depth - 1);
+            }
+            break;
+        }
+    }
+
+    switch (event)
+    {
+    case EMIT_OBJECT_MEMBER:
+        return JSON_Success;
+
+    case EMIT_START_OBJECT:
+    case EMIT_START_ARRAY:
+        /* The filter sees the events inside the container unless it is
+           being skipped. */
+        return GET_FLAGS(parser->state, PARSER_SKIPPING_VALUE)
+            ? JSON_Success
+            : JSON_Parser_PushPathFrame(parser, firstLivePath, livePathCount);
+
+    default:
+        /* JSON_Parser_HandleGrammarEvents() has already checked whether the
+           events that were passed to the handlers ended the document. */
+        return passedToHandlers ? JSON_Parser_FinishMatchedValue(parser) : JSON_Parser_CompleteValue(parser);
+    }
+}
+
+static JSON_Status JSON_Parser_StartDocument(JSON_Parser parser)
+{
+    /* Called in multi-document mode when the grammarian, having finished
+       the previous document (or not having started any), rejects a token.
+       The token starts the next document, so the state that belongs to a
+       single document is reset, and the token is processed again. */
+    GrammarianOutput output;
+    Grammarian_Reset(&parser->grammarianData, 1/*isInitialized*/);
+    if (parser->pPathFilter)
+    {
+        ResetPathFilterMatches(parser->pPathFilter);
+    }
+    if (parser->tape)
+    {
+        JSON_Tape_ResetData(parser->tape);
+    }
+
+    /* The symbol stack has room for the symbols that the first token of a
+       document pushes, so the token can only be rejected outright, and
+       then no document has started. */
+    output = Grammarian_ProcessToken(&parser->grammarianData, parser->token, &parser->memorySuite);
+    if (GRAMMARIAN_RESULT_CODE(output) != ACCEPTED_TOKEN)
+    {
+        JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnexpectedToken);
+        return JSON_Failure;
+    }
+    if (!JSON_Parser_CallDocumentHandler(parser, parser->startDocumentHandler, JSON_Event_StartDocument))
+    {
+        return JSON_Failure;
+    }
+    return JSON_Parser_HandleGrammarEvents(parser, GRAMMARIAN_EVENT(output));
+}
+
+static JSON_Status JSON_Parser_StartArraySegment(JSON_Parser parser)
+{
+    /* Called when the first token of a segment of a top-level array is the
+       comma after an item in a previous segment. The array is started as
+       if the segment began with its left square bracket, the grammarian is
+       moved past the items that are not in the segment, and the comma is
+       processed again. The symbol stack has room for all of this. */
+    GrammarianOutput output;
+    output = Grammarian_ProcessToken(&parser->grammarianData, T_LEFT_SQUARE, &parser->memorySuite);
+    parser->grammarianData.pStack[parser->grammarianData.stackUsed - 1] = NT_MORE_ITEMS;
+    if (!JSON_Parser_HandleGrammarEvents(parser, GRAMMARIAN_EVENT(output)))
+    {
+        return JSON_Failure;
+    }
+    output = Grammarian_ProcessToken(&parser->grammarianData, parser->token, &parser->memorySuite);
+    return JSON_Parser_HandleGrammarEvents(parser, GRAMMARIAN_EVENT(output));
+}
+
+static JSON_Status JSON_Parser_ProcessToken(JSON_Parser parser)
+{
+    GrammarianOutput output;
+    output = Grammarian_ProcessToken(&parser->grammarianData, parser->token, &parser->memorySuite);
+    switch (GRAMMARIAN_RESULT_CODE(output))
+    {
+    case ACCEPTED_TOKEN:
+        if (!JSON_Parser_HandleGrammarEvents(parser, GRAMMARIAN_EVENT(output)))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case REJECTED_TOKEN:
+        if (GET_FLAGS(parser->flags, PARSER_MULTIPLE_DOCUMENTS) && Grammarian_FinishedDocument(&parser->grammarianData))
+        {
+            if (!JSON_Parser_StartDocument(parser))
+            {
+                return JSON_Failure;
+            }
+            break;
+        }
+        if (GET_FLAGS(parser->flags, PARSER_ARRAY_SEGMENT) && parser->token == T_COMMA &&
+            parser->grammarianData.stackUsed == 1 && parser->grammarianData.pStack[0] == NT_VALUE)
+        {
+            if (!JSON_Parser_StartArraySegment(parser))
+            {
+                return JSON_Failure;
+            }
+            break;
+        }
+        JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnexpectedToken);
+        return JSON_Failure;
+
+    case SYMBOL_STACK_FULL:
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+        return JSON_Failure;
+    }
+
+    /* Tokens that were passed to the handlers by reference never needed
+       the token buffer. */
+    if (!parser->pTokenRef && parser->tokenBytesUsed > parser->tokenBytesHighWaterMark)
+    {
+        parser->tokenBytesHighWaterMark = parser->tokenBytesUsed;
+    }
+
+    /* Reset the lexer to prepare for the next token. */
+    parser->lexerState = LEXING_WHITESPACE;
+    parser->lexerBits = 0;
+    parser->token = T_NONE;
+    parser->tokenAttributes = 0;
+    parser->tokenBytesUsed = 0;
+    parser->pTokenRef = NULL;
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_FlushParser(JSON_Parser parser)
+{
+    /* The symbol stack should be empty when parsing finishes. In
+       multi-document mode, it is also empty between documents. */
+    if (!Grammarian_FinishedDocument(&parser->grammarianData))
+    {
+        if (GET_FLAGS(parser->flags, PARSER_ARRAY_SEGMENT) &&
+            parser->grammarianData.stackUsed == 2 && parser->grammarianData.pStack[1] == NT_MORE_ITEMS)
+        {
+            /* The segment ends right after an item of the top-level array,
+               whose other items are in the segments that follow, so the
+               array is ended here as if by its right square bracket. */
+            parser->token = T_RIGHT_SQUARE;
+            parser->tokenLocationByte = parser->codepointLocationByte;
+            parser->tokenLocationLine = parser->codepointLocationLine;
+            parser->tokenLocationColumn = parser->codepointLocationColumn;
+            return JSON_Parser_ProcessToken(parser);
+        }
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_ExpectedMoreTokens);
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+/* Lexer functions. */
+
+static const byte expectedLiteralChars[] = { 'u', 'l', 'l', 0, 'r', 'u', 'e', 0, 'a', 'l', 's', 'e', 0, 'a', 'N', 0, 'n', 'f', 'i', 'n', 'i', 't', 'y', 0  };
+
+#define NULL_LITERAL_EXPECTED_CHARS_START_INDEX     0
+#define TRUE_LITERAL_EXPECTED_CHARS_START_INDEX     4
+#define FALSE_LITERAL_EXPECTED_CHARS_START_INDEX    8
+#define NAN_LITERAL_EXPECTED_CHARS_START_INDEX      13
+#define INFINITY_LITERAL_EXPECTED_CHARS_START_INDEX 16
+
+/* Forward declaration. */
+static JSON_Status JSON_Parser_FlushLexer(JSON_Parser parser);
+static JSON_Status JSON_Parser_ProcessCodepoint(JSON_Parser parser, Codepoint c, size_t encodedLength);
+
+static JSON_Status JSON_Parser_HandleInvalidEncodingSequence(JSON_Parser parser, size_t encodedLength) {
+    if (parser->token == T_STRING && GET_FLAGS(parser->flags, PARSER_REPLACE_INVALID))
+    {
+        /* Since we're inside a string token, replacing the invalid sequence
+           with the Unicode replacement character as requested by the client
+           is a viable way to avoid a parse failure. Outside a string token,
+           such a replacement would simply trigger JSON_Error_UnknownToken
+           when we tried to process the replacement character, so it's less
+           confusing to stick with JSON_Error_InvalidEncodingSequence in that
+           case. */
+        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsReplacedCharacter);
+        return JSON_Parser_ProcessCodepoint(parser, REPLACEMENT_CHARACTER_CODEPOINT, encodedLength);
+    }
+    else if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT))
+    {
+        /* Since we're parsing the top-level value of an embedded
+           document, assume that the invalid encoding sequence we've
+           encountered does not actually belong to the document, and
+           finish parsing by pretending that we've encountered EOF
+           instead of an invalid sequence. If the content is valid,
+           this will fail with JSON_Error_StoppedAfterEmbeddedDocument;
+           otherwise, it will fail with an appropriate error. */
+        return JSON_Parser_FlushLexer(parser) && JSON_Parser_FlushParser(parser);
+    }
+    JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_InvalidEncodingSequence);
+    return JSON_Failure;
+}
+
+static JSON_Status JSON_Parser_HandleInvalidNumber(JSON_Parser parser, Codepoint c, int codepointsSinceValidNumber, TokenAttributes attributesToRemove)
+{
+    SET_FLAGS_OFF(TokenAttributes, parser->tokenAttributes, attributesToRemove);
+    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT))
+    {
+        /* The invalid number is the top-level value of an embedded document,
+           and it has a prefix that can be interpreted as a valid number.
+           We want to backtrack so that we are at the end of that prefix,
+           and then process the valid token.
+
+           Note that backtracking requires us to make three assumptions, which
+           are always valid in the context of a number token:
+
+           1. The input encoding is not JSON_UnknownEncoding.
+
+           2 The codepoints we are backing up across are all in the range
+           U+0000 - U+007F, aka ASCII, so we can assume the number of
+           bytes comprising them based on the input encoding.
+
+           3. The codepoints we are backing up across do not include any
+           line breaks, so we can assume that the line number stays the
+           same and the column number can simply be decremented.
+
+           For example:
+
+               "01"     => "0"
+               "123.!"  => "123"
+               "123e!"  => "123"
+               "123e+!" => "123"
+               "123e-!" => "123"
+               "1.2e!"  => "1.2"
+               "1.2e+!" => "1.2"
+               "1.2e-!" => "1.2"
+        */
+        parser->codepointLocationByte -= (size_t)codepointsSinceValidNumber * SHORTEST_ENCODING_SEQUENCE(parser->inputEncoding);
+        parser->codepointLocationColumn -= (size_t)codepointsSinceValidNumber;
+        parser->tokenBytesUsed -= (size_t)codepointsSinceValidNumber * SHORTEST_ENCODING_SEQUENCE(parser->numberEncoding);
+        return JSON_Parser_ProcessToken(parser); /* always fails */
+    }
+    else if (c == EOF_CODEPOINT)
+    {
+        /* Allow JSON_Parser_FlushLexer() to fail. */
+        return JSON_Success;
+    }
+    JSON_Parser_SetErrorAtToken(parser, JSON_Error_InvalidNumber);
+    return JSON_Failure;
+}
+
+static void JSON_Parser_StartToken(JSON_Parser parser, Symbol token)
+{
+    parser->token = token;
+    parser->tokenLocationByte = parser->codepointLocationByte;
+    parser->tokenLocationLine = parser->codepointLocationLine;
+    parser->tokenLocationColumn = parser->codepointLocationColumn;
+}
+
+static JSON_Status JSON_Parser_ProcessCodepoint(JSON_Parser parser, Codepoint c, size_t encodedLength)
+{
+    Codepoint codepointToRecord = EOF_CODEPOINT;
+    Encoding tokenEncoding;
+    size_t maxTokenLength;
+    int tokenFinished = 0;
+
+    /* If the previous codepoint was U+000D (CARRIAGE RETURN), and the current
+       codepoint is U+000A (LINE FEED), then treat the 2 codepoints as a single
+       line break. */
+    if (GET_FLAGS(parser->state, PARSER_AFTER_CARRIAGE_RETURN))
+    {
+        if (c == LINE_FEED_CODEPOINT)
+        {
+            parser->codepointLocationLine--;
+        }
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN);
+    }
+
+reprocess:
+
+    switch (parser->lexerState)
+    {
+    case LEXING_WHITESPACE:
+        if (c == '{')
+        {
+            JSON_Parser_StartToken(parser, T_LEFT_CURLY);
+            tokenFinished = 1;
+        }
+        else if (c == '}')
+        {
+            JSON_Parser_StartToken(parser, T_RIGHT_CURLY);
+            tokenFinished = 1;
+        }
+        else if (c == '[')
+        {
+            JSON_Parser_StartToken(parser, T_LEFT_SQUARE);
+            tokenFinished = 1;
+        }
+        else if (c == ']')
+        {
+            JSON_Parser_StartToken(parser, T_RIGHT_SQUARE);
+            tokenFinished = 1;
+        }
+        else if (c == ':')
+        {
+            JSON_Parser_StartToken(parser, T_COLON);
+            tokenFinished = 1;
+        }
+        else if (c == ',')
+        {
+            JSON_Parser_StartToken(parser, T_COMMA);
+            tokenFinished = 1;
+        }
+        else if (c == 'n')
+        {
+            JSON_Parser_StartToken(parser, T_NULL);
+            parser->lexerBits = NULL_LITERAL_EXPECTED_CHARS_START_INDEX;
+            parser->lexerState = LEXING_LITERAL;
+        }
+        else if (c == 't')
+        {
+            JSON_Parser_StartToken(parser, T_TRUE);
+            parser->lexerBits = TRUE_LITERAL_EXPECTED_CHARS_START_INDEX;
+            parser->lexerState = LEXING_LITERAL;
+        }
+        else if (c == 'f')
+        {
+            JSON_Parser_StartToken(parser, T_FALSE);
+            parser->lexerBits = FALSE_LITERAL_EXPECTED_CHARS_START_INDEX;
+            parser->lexerState = LEXING_LITERAL;
+        }
+        else if (c == '"')
+        {
+            JSON_Parser_StartToken(parser, T_STRING);
+            parser->lexerState = LEXING_STRING;
+        }
+        else if (c == '-')
+        {
+            JSON_Parser_StartToken(parser, T_NUMBER);
+            parser->tokenAttributes = JSON_IsNegative;
+            codepointToRecord = '-';
+            parser->lexerState = LEXING_NUMBER_AFTER_MINUS;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c == '0')
+        {
+            JSON_Parser_StartToken(parser, T_NUMBER);
+            codepointToRecord = '0';
+            parser->lexerState = LEXING_NUMBER_AFTER_LEADING_ZERO;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c >= '1' && c <= '9')
+        {
+            JSON_Parser_StartToken(parser, T_NUMBER);
+            codepointToRecord = c;
+            parser->lexerState = LEXING_NUMBER_DECIMAL_DIGITS;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c == ' ' || c == TAB_CODEPOINT || c == LINE_FEED_CODEPOINT ||
+                 c == CARRIAGE_RETURN_CODEPOINT || c == EOF_CODEPOINT)
+        {
+            /* Ignore whitespace between tokens. */
+        }
+        else if (c == RECORD_SEPARATOR_CODEPOINT && !parser->depth && GET_FLAGS(parser->flags, PARSER_MULTIPLE_DOCUMENTS))
+        {
+            /* Ignore the record separators between the documents of an
+               RFC 7464 JSON text sequence. */
+        }
+        else if (c == BOM_CODEPOINT && parser->codepointLocationByte == 0)
+        {
+            if (GET_FLAGS(parser->flags, PARSER_ALLOW_BOM))
+            {
+                /* OK, we'll allow the BOM. */
+            }
+            else
+            {
+                JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_BOMNotAllowed);
+                return JSON_Failure;
+            }
+        }
+        else if (c == '/' && GET_FLAGS(parser->flags, PARSER_ALLOW_COMMENTS))
+        {
+            /* Comments are not real tokens, but we save the location
+               of the comment as the token location in case of an error. */
+            parser->tokenLocationByte = parser->codepointLocationByte;
+            parser->tokenLocationLine = parser->codepointLocationLine;
+            parser->tokenLocationColumn = parser->codepointLocationColumn;
+            parser->lexerState = LEXING_COMMENT_AFTER_SLASH;
+        }
+        else if (c == 'N' && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS))
+        {
+            JSON_Parser_StartToken(parser, T_NAN);
+            parser->lexerBits = NAN_LITERAL_EXPECTED_CHARS_START_INDEX;
+            parser->lexerState = LEXING_LITERAL;
+        }
+        else if (c == 'I' && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS))
+        {
+            JSON_Parser_StartToken(parser, T_INFINITY);
+            parser->lexerBits = INFINITY_LITERAL_EXPECTED_CHARS_START_INDEX;
+            parser->lexerState = LEXING_LITERAL;
+        }
+        else
+        {
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_UnknownToken);
+            return JSON_Failure;
+        }
+        goto advance;
+
+    case LEXING_LITERAL:
+        /* While lexing a literal we store an index into expectedLiteralChars
+           in lexerBits. */
+        if (expectedLiteralChars[parser->lexerBits])
+        {
+            /* The codepoint should match the next character in the literal. */
+            if (c != expectedLiteralChars[parser->lexerBits])
+            {
+                JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
+                return JSON_Failure;
+            }
+            parser->lexerBits++;
+
+            /* If the literal is the top-level value of an embedded document,
+               process it as soon as we consume its last expected codepoint.
+               Normally we defer processing until the following codepoint
+               has been examined, so that we can treat sequences like "nullx"
+               as a single, unknown token rather than a null literal followed
+               by an unknown token. */
+            if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT) &&
+                !expectedLiteralChars[parser->lexerBits])
+            {
+                tokenFinished = 1;
+            }
+        }
+        else
+        {
+            /* The literal should be finished, so the codepoint should not be
+               a plausible JSON literal character, but rather EOF, whitespace,
+               or the first character of the next token. */
+            if ((c >= 'A' && c <= 'Z') ||
+                (c >= 'a' && c <= 'z') ||
+                (c >= '0' && c <= '9') ||
+                (c == '_'))
+            {
+                JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
+                return JSON_Failure;
+            }
+            if (!JSON_Parser_ProcessToken(parser))
+            {
+                return JSON_Failure;
+            }
+            goto reprocess;
+        }
+        goto advance;
+
+    case LEXING_STRING:
+        if (c == EOF_CODEPOINT)
+        {
+            /* Allow JSON_Parser_FlushLexer() to fail. */
+        }
+        else if (c == '"')
+        {
+            tokenFinished = 1;
+        }
+        else if (c == '\\')
+        {
+            parser->lexerState = LEXING_STRING_ESCAPE;
+        }
+        else if (c < 0x20 && !GET_FLAGS(parser->flags, PARSER_ALLOW_CONTROL_CHARS))
+        {
+            /* ASCII control characters (U+0000 - U+001F) are not allowed to
+               appear unescaped in string values unless specifically allowed. */
+            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_UnescapedControlCharacter);
+            return JSON_Failure;
+        }
+        else
+        {
+            codepointToRecord = c;
+            goto recordStringCodepointAndAdvance;
+        }
+        goto advance;
+
+    case LEXING_STRING_ESCAPE:
+        if (c == EOF_CODEPOINT)
+        {
+            /* Allow JSON_Parser_FlushLexer() to fail. */
+        }
+        else
+        {
+            if (c == 'u')
+            {
+                parser->lexerState = LEXING_STRING_HEX_ESCAPE_BYTE_1;
+            }
+            else
+            {
+                if (c == '"' || c == '\\' || c == '/')
+                {
+                    codepointToRecord = c;
+                }
+                else if (c == 'b')
+                {
+                    codepointToRecord = BACKSPACE_CODEPOINT;
+                }
+                else if (c == 't')
+                {
+                    codepointToRecord = TAB_CODEPOINT;
+                }
+                else if (c == 'n')
+                {
+                    codepointToRecord = LINE_FEED_CODEPOINT;
+                }
+                else if (c == 'f')
+                {
+                    codepointToRecord = FORM_FEED_CODEPOINT;
+                }
+                else if (c == 'r')
+                {
+                    codepointToRecord = CARRIAGE_RETURN_CODEPOINT;
+                }
+                else
+                {
+                    /* The current codepoint location is the first character after
+                       the backslash that started the escape sequence. The error
+                       location should be the beginning of the escape sequence, 1
+                       character earlier. */
+                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_InvalidEscapeSequence, 1);
+                    return JSON_Failure;
+                }
+                parser->lexerState = LEXING_STRING;
+                goto recordStringCodepointAndAdvance;
+            }
+        }
+        goto advance;
+
+    case LEXING_STRING_HEX_ESCAPE_BYTE_1:
+    case LEXING_STRING_HEX_ESCAPE_BYTE_2:
+    case LEXING_STRING_HEX_ESCAPE_BYTE_3:
+    case LEXING_STRING_HEX_ESCAPE_BYTE_4:
+    case LEXING_STRING_HEX_ESCAPE_BYTE_5:
+    case LEXING_STRING_HEX_ESCAPE_BYTE_6:
+    case LEXING_STRING_HEX_ESCAPE_BYTE_7:
+    case LEXING_STRING_HEX_ESCAPE_BYTE_8:
+        if (c == EOF_CODEPOINT)
+        {
+            /* Allow JSON_Parser_FlushLexer() to fail. */
+        }
+        else
+        {
+            /* While lexing a string hex escape sequence we store the bytes
+               of the escaped codepoint in the low 2 bytes of lexerBits. If
+               the escape sequence represents a leading surrogate, we shift
+               the leading surrogate into the high 2 bytes and lex a second
+               hex escape sequence (which should be a trailing surrogate). */
+            int byteNumber = (parser->lexerState - LEXING_STRING_HEX_ESCAPE_BYTE_1) & 0x3;
+            uint32_t nibble;
+            if (c >= '0' && c <= '9')
+            {
+                nibble = c - '0';
+            }
+            else if (c >= 'A' && c <= 'F')
+            {
+                nibble = c - 'A' + 10;
+            }
+            else if (c >= 'a' && c <= 'f')
+            {
+                nibble = c - 'a' + 10;
+            }
+            else
+            {
+                /* The current codepoint location is one of the 4 hex digit
+                   character slots in the hex escape sequence. The error
+                   location should be the beginning of the hex escape
+                   sequence, between 2 and 5 bytes earlier. */
+                int codepointsAgo = 2 /* for "\u" */ + byteNumber;
+                JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_InvalidEscapeSequence, codepointsAgo);
+                return JSON_Failure;
+            }
+            /* Store the hex digit's bits in the appropriate byte of lexerBits. */
+            nibble <<= (3 - byteNumber) * 4 /* shift left by 12, 8, 4, 0 */ ;
+            parser->lexerBits |= nibble;
+            if (parser->lexerState == LEXING_STRING_HEX_ESCAPE_BYTE_4)
+            {
+                /* The escape sequence is complete. We need to check whether
+                   it represents a leading surrogate (which implies that it
+                   will be immediately followed by a hex-escaped trailing
+                   surrogate), a trailing surrogate (which is invalid), or a
+                   valid codepoint (which should simply be appended to the
+                   string token value). */
+                if (IS_LEADING_SURROGATE(parser->lexerBits))
+                {
+                    /* Shift the leading surrogate into the high 2 bytes of
+                       lexerBits so that the trailing surrogate can be stored
+                       in the low 2 bytes. */
+                    parser->lexerBits <<= 16;
+                    parser->lexerState = LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_BACKSLASH;
+                }
+                else if (IS_TRAILING_SURROGATE(parser->lexerBits))
+                {
+                    /* The current codepoint location is the last hex digit
+                       of the hex escape sequence. The error location should
+                       be the beginning of the hex escape sequence, 5
+                       characters earlier. */
+                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 5);
+                    return JSON_Failure;
+                }
+                else
+                {
+                    /* The escape sequence represents a BMP codepoint. */
+                    codepointToRecord = parser->lexerBits;
+                    parser->lexerBits = 0;
+                    parser->lexerState = LEXING_STRING;
+                    goto recordStringCodepointAndAdvance;
+                }
+            }
+            else if (parser->lexerState == LEXING_STRING_HEX_ESCAPE_BYTE_8)
+            {
+                /* The second hex escape sequence is complete. We need to
+                   check whether it represents a trailing surrogate as
+                   expected. If so, the surrogate pair represents a single
+                   non-BMP codepoint. */
+                if (!IS_TRAILING_SURROGATE(parser->lexerBits & 0xFFFF))
+                {
+                    /* The current codepoint location is the last hex digit of
+                       the second hex escape sequence. The error location
+                       should be the beginning of the leading surrogate
+                       hex escape sequence, 11 characters earlier. */
+                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 11);
+                    return JSON_Failure;
+                }
+                /* The escape sequence represents a non-BMP codepoint. */
+                codepointToRecord = CODEPOINT_FROM_SURROGATES(parser->lexerBits);
+                parser->lexerBits = 0;
+                parser->lexerState = LEXING_STRING;
+                goto recordStringCodepointAndAdvance;
+            }
+            else
+            {
+                parser->lexerState++;
+            }
+        }
+        goto advance;
+
+    case LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_BACKSLASH:
+        if (c == EOF_CODEPOINT)
+        {
+            /* Allow JSON_Parser_FlushLexer() to fail. */
+        }
+        else
+        {
+            if (c != '\\')
+            {
+                /* The current codepoint location is the first character after
+                   the leading surrogate hex escape sequence. The error
+                   location should be the beginning of the leading surrogate
+                   hex escape sequence, 6 characters earlier. */
+                JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 6);
+                return JSON_Failure;
+            }
+            parser->lexerState = LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_U;
+        }
+        goto advance;
+
+    case LEXING_STRING_TRAILING_SURROGATE_HEX_ESCAPE_U:
+        if (c == EOF_CODEPOINT)
+        {
+            /* Allow JSON_Parser_FlushLexer() to fail. */
+        }
+        else
+        {
+            if (c != 'u')
+            {
+                /* Distinguish between a totally bogus escape sequence
+                   and a valid one that just isn't the hex escape kind
+                   that we require for a trailing surrogate. The current
+                   codepoint location is the first character after the
+                   backslash that should have introduced the trailing
+                   surrogate hex escape sequence. */
+                if (c == '"' || c == '\\' || c == '/' || c == 'b' ||
+                    c == 't' || c == 'n' || c == 'f' || c == 'r')
+                {
+                    /* The error location should be at that beginning of the
+                       leading surrogate's hex escape sequence, 7 characters
+                       earlier. */
+                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_UnpairedSurrogateEscapeSequence, 7);
+                }
+                else
+                {
+                    /* The error location should be at that backslash, 1
+                       character earlier. */
+                    JSON_Parser_SetErrorAtStringEscapeSequenceStart(parser, JSON_Error_InvalidEscapeSequence, 1);
+                }
+                return JSON_Failure;
+            }
+            parser->lexerState = LEXING_STRING_HEX_ESCAPE_BYTE_5;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_AFTER_MINUS:
+        if (c == EOF_CODEPOINT)
+        {
+            /* Allow JSON_Parser_FlushLexer() to fail. */
+        }
+        else if (c == 'I' && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS))
+        {
+            parser->token = T_NEGATIVE_INFINITY; /* changing horses mid-stream, so to speak */
+            parser->lexerBits = INFINITY_LITERAL_EXPECTED_CHARS_START_INDEX;
+            parser->lexerState = LEXING_LITERAL;
+        }
+        else
+        {
+            if (c == '0')
+            {
+                codepointToRecord = '0';
+                parser->lexerState = LEXING_NUMBER_AFTER_LEADING_NEGATIVE_ZERO;
+                goto recordNumberCodepointAndAdvance;
+            }
+            else if (c >= '1' && c <= '9')
+            {
+                codepointToRecord = c;
+                parser->lexerState = LEXING_NUMBER_DECIMAL_DIGITS;
+                goto recordNumberCodepointAndAdvance;
+            }
+            else
+            {
+                /* We trigger an unknown token error rather than an invalid number
+                   error so that "Foo" and "-Foo" trigger the same error. */
+                JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
+                return JSON_Failure;
+            }
+        }
+        goto advance;
+
+    case LEXING_NUMBER_AFTER_LEADING_ZERO:
+    case LEXING_NUMBER_AFTER_LEADING_NEGATIVE_ZERO:
+        if (c == '.')
+        {
+            codepointToRecord = '.';
+            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsDecimalPoint);
+            parser->lexerState = LEXING_NUMBER_AFTER_DOT;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c == 'e' || c == 'E')
+        {
+            codepointToRecord = c;
+            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsExponent);
+            parser->lexerState = LEXING_NUMBER_AFTER_E;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            /* JSON does not allow the integer part of a number to have any
+               digits after a leading zero. */
+            if (!JSON_Parser_HandleInvalidNumber(parser, c, 0, 0))
+            {
+                return JSON_Failure;
+            }
+        }
+        else if ((c == 'x' || c == 'X') &&
+                 parser->lexerState == LEXING_NUMBER_AFTER_LEADING_ZERO &&
+                 GET_FLAGS(parser->flags, PARSER_ALLOW_HEX_NUMBERS))
+        {
+            codepointToRecord = c;
+            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_IsHex);
+            parser->lexerState = LEXING_NUMBER_AFTER_X;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else
+        {
+            /* The number is finished. */
+            if (!JSON_Parser_ProcessToken(parser))
+            {
+                return JSON_Failure;
+            }
+            goto reprocess;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_AFTER_X:
+        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))
+        {
+            codepointToRecord = c;
+            parser->lexerState = LEXING_NUMBER_HEX_DIGITS;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 1, JSON_IsHex))
+        {
+            return JSON_Failure;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_HEX_DIGITS:
+        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))
+        {
+            codepointToRecord = c;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else
+        {
+            /* The number is finished. */
+            if (!JSON_Parser_ProcessToken(parser))
+            {
+                return JSON_Failure;
+            }
+            goto reprocess;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_DECIMAL_DIGITS:
+        if (c >= '0' && c <= '9')
+        {
+            codepointToRecord = c;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c == '.')
+        {
+            codepointToRecord = '.';
+            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsDecimalPoint);
+            parser->lexerState = LEXING_NUMBER_AFTER_DOT;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c == 'e' || c == 'E')
+        {
+            codepointToRecord = c;
+            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsExponent);
+            parser->lexerState = LEXING_NUMBER_AFTER_E;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else
+        {
+            /* The number is finished. */
+            if (!JSON_Parser_ProcessToken(parser))
+            {
+                return JSON_Failure;
+            }
+            goto reprocess;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_AFTER_DOT:
+        if (c >= '0' && c <= '9')
+        {
+            codepointToRecord = c;
+            parser->lexerState = LEXING_NUMBER_FRACTIONAL_DIGITS;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 1, JSON_ContainsDecimalPoint))
+        {
+            return JSON_Failure;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_FRACTIONAL_DIGITS:
+        if (c >= '0' && c <= '9')
+        {
+            codepointToRecord = c;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c == 'e' || c == 'E')
+        {
+            codepointToRecord = c;
+            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsExponent);
+            parser->lexerState = LEXING_NUMBER_AFTER_E;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else
+        {
+            /* The number is finished. */
+            if (!JSON_Parser_ProcessToken(parser))
+            {
+                return JSON_Failure;
+            }
+            goto reprocess;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_AFTER_E:
+        if (c == '+')
+        {
+            codepointToRecord = c;
+            parser->lexerState = LEXING_NUMBER_AFTER_EXPONENT_SIGN;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c == '-')
+        {
+            codepointToRecord = c;
+            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNegativeExponent);
+            parser->lexerState = LEXING_NUMBER_AFTER_EXPONENT_SIGN;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            codepointToRecord = c;
+            parser->lexerState = LEXING_NUMBER_EXPONENT_DIGITS;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 1, JSON_ContainsExponent))
+        {
+            return JSON_Failure;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_AFTER_EXPONENT_SIGN:
+        if (c >= '0' && c <= '9')
+        {
+            codepointToRecord = c;
+            parser->lexerState = LEXING_NUMBER_EXPONENT_DIGITS;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 2, JSON_ContainsExponent | JSON_ContainsNegativeExponent))
+        {
+            return JSON_Failure;
+        }
+        goto advance;
+
+    case LEXING_NUMBER_EXPONENT_DIGITS:
+        if (c >= '0' && c <= '9')
+        {
+            codepointToRecord = c;
+            goto recordNumberCodepointAndAdvance;
+        }
+        else
+        {
+            /* The number is finished. */
+            if (!JSON_Parser_ProcessToken(parser))
+            {
+                return JSON_Failure;
+            }
+            goto reprocess;
+        }
+        goto advance;
+
+    case LEXING_COMMENT_AFTER_SLASH:
+        if (c == '/')
+        {
+            parser->lexerState = LEXING_SINGLE_LINE_COMMENT;
+        }
+        else if (c == '*')
+        {
+            parser->lexerState = LEXING_MULTI_LINE_COMMENT;
+        }
+        else
+        {
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
+            return JSON_Failure;
+        }
+        goto advance;
+
+    case LEXING_SINGLE_LINE_COMMENT:
+        if (c == CARRIAGE_RETURN_CODEPOINT || c == LINE_FEED_CODEPOINT || c == EOF_CODEPOINT)
+        {
+            parser->lexerState = LEXING_WHITESPACE;
+        }
+        goto advance;
+
+    case LEXING_MULTI_LINE_COMMENT:
+        if (c == '*')
+        {
+            parser->lexerState = LEXING_MULTI_LINE_COMMENT_AFTER_STAR;
+        }
+        goto advance;
+
+    case LEXING_MULTI_LINE_COMMENT_AFTER_STAR:
+        if (c == '/')
+        {
+            parser->lexerState = LEXING_WHITESPACE;
+        }
+        else if (c != '*')
+        {
+            parser->lexerState = LEXING_MULTI_LINE_COMMENT;
+        }
+        goto advance;
+    }
+
+recordStringCodepointAndAdvance:
+
+    tokenEncoding = parser->stringEncoding;
+    maxTokenLength = parser->maxStringLength;
+    if (!codepointToRecord)
+    {
+        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNullCharacter | JSON_ContainsControlCharacter);
+    }
+    else if (codepointToRecord < FIRST_NON_CONTROL_CODEPOINT)
+    {
+        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsControlCharacter);
+    }
+    else if (codepointToRecord >= FIRST_NON_BMP_CODEPOINT)
+    {
+        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNonASCIICharacter | JSON_ContainsNonBMPCharacter);
+    }
+    else if (codepointToRecord >= FIRST_NON_ASCII_CODEPOINT)
+    {
+        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNonASCIICharacter);
+    }
+    goto recordCodepointAndAdvance;
+
+recordNumberCodepointAndAdvance:
+
+    tokenEncoding = parser->numberEncoding;
+    maxTokenLength = parser->maxNumberLength;
+    goto recordCodepointAndAdvance;
+
+recordCodepointAndAdvance:
+
+    /* A codepoint that is recorded exactly as it appears in the input can
+       extend a reference to the token's bytes in the input buffer instead
+       of being copied (see JSON_Parser_IsTokenRefEligible()). */
+    if (parser->pCodepointBytes && codepointToRecord == c && JSON_Parser_IsTokenRefEligible(parser, tokenEncoding))
+    {
+        if (!parser->tokenBytesUsed)
+        {
+            parser->pTokenRef = parser->pCodepointBytes;
+        }
+        if (parser->pTokenRef && parser->pTokenRef + parser->tokenBytesUsed == parser->pCodepointBytes)
+        {
+            parser->tokenBytesUsed += encodedLength;
+            if (parser->tokenBytesUsed > maxTokenLength)
+            {
+                JSON_Parser_SetErrorAtToken(parser, parser->token == T_NUMBER ? JSON_Error_TooLongNumber : JSON_Error_TooLongString);
+                return JSON_Failure;
+            }
+            goto advance;
+        }
+    }
+    if (!JSON_Parser_MaterializeTokenRef(parser))
+    {
+        return JSON_Failure;
+    }
+
+    /* We always ensure that there are LONGEST_ENCODING_SEQUENCE bytes
+       available in the buffer for the next codepoint, so we don't have to
+       check whether there is room when we decode a new codepoint, and if
+       there isn't another codepoint, we have space already allocated for
+       the encoded null terminator.*/
+    parser->tokenBytesUsed += EncodeCodepoint(codepointToRecord, tokenEncoding, parser->pTokenBytes + parser->tokenBytesUsed);
+    if (parser->tokenBytesUsed > maxTokenLength)
+    {
+        JSON_Parser_SetErrorAtToken(parser, parser->token == T_NUMBER ? JSON_Error_TooLongNumber : JSON_Error_TooLongString);
+        return JSON_Failure;
+    }
+    if (parser->tokenBytesUsed > parser->tokenBytesLength - LONGEST_ENCODING_SEQUENCE &&
+        !JSON_Parser_GrowTokenBytes(parser, parser->tokenBytesUsed))
+    {
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
+        return JSON_Failure;
+    }
+    goto advance;
+
+advance:
+
+    /* The current codepoint has been accepted, so advance the codepoint
+       location counters accordingly. Note that the one time we don't
+       do this is when the codepoint is EOF, which doesn't actually
+       appear in the input stream. */
+    if (c == CARRIAGE_RETURN_CODEPOINT)
+    {
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN);
+    }
+    if (c != EOF_CODEPOINT)
+    {
+        parser->codepointLocationByte += encodedLength;
+        if (GET_FLAGS(parser->flags, PARSER_LAZY_LOCATIONS))
+        {
+            /* The line and column will be reconstructed on demand. */
+        }
+        else if (c == CARRIAGE_RETURN_CODEPOINT || c == LINE_FEED_CODEPOINT)
+        {
+            /* The next character will begin a new line. */
+            parser->codepointLocationLine++;
+            parser->codepointLocationColumn = 0;
+        }
+        else
+        {
+            /* The next character will be on the same line. */
+            parser->codepointLocationColumn++;
+        }
+    }
+
+    if (tokenFinished && !JSON_Parser_ProcessToken(parser))
+    {
+        return JSON_Failure;
+    }
+
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_FlushLexer(JSON_Parser parser)
+{
+    /* Push the EOF codepoint to the lexer so that it can finish the pending
+       token, if any. The EOF codepoint is never emitted by the decoder
+       itself, since it is outside the Unicode range and therefore cannot
+       be encoded in any of the possible input encodings. */
+    if (!JSON_Parser_ProcessCodepoint(parser, EOF_CODEPOINT, 0))
+    {
+        return JSON_Failure;
+    }
+
+    /* The lexer should be idle when parsing finishes. */
+    if (parser->lexerState != LEXING_WHITESPACE)
+    {
+        JSON_Parser_SetErrorAtToken(parser, JSON_Error_IncompleteToken);
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+/* Parser's decoder functions. */
+
+static JSON_Status JSON_Parser_CallEncodingDetectedHandler(JSON_Parser parser)
+{
+    if (parser->encodingDetectedHandler && parser->encodingDetectedHandler(parser) != JSON_Parser_Continue)
+    {
+        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_AbortedByHandler);
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+/* Forward declaration. */
+/* Parser's lazy location tracking functions. */
+
+static void JSON_Parser_AdvanceLazyLocation(JSON_Parser parser, Codepoint c, size_t encodedLength)
+{
+    if (c == CARRIAGE_RETURN_CODEPOINT ||
+        (c == LINE_FEED_CODEPOINT && !GET_FLAGS(parser->state, PARSER_LAZY_AFTER_CR)))
+    {
+        parser->lazyLocationLine++;
+        parser->lazyLocationColumn = 0;
+    }
+    else if (c != LINE_FEED_CODEPOINT)
+    {
+        parser->lazyLocationColumn++;
+    }
+    SET_FLAGS(ParserState, parser->state, PARSER_LAZY_AFTER_CR, c == CARRIAGE_RETURN_CODEPOINT);
+    parser->lazyLocationByte += encodedLength;
+}
+
+static void JSON_Parser_AdvanceLazyLocationOverRun(JSON_Parser parser, size_t byteCount, size_t codepointCount, const WhitespaceScan* pScan)
+{
+    parser->lazyLocationByte += byteCount;
+    parser->lazyLocationLine += pScan->lineBreaks;
+    if (pScan->lineStart == SIZE_MAX)
+    {
+        parser->lazyLocationColumn += codepointCount;
+    }
+    else
+    {
+        parser->lazyLocationColumn = codepointCount - pScan->lineStart;
+    }
+    SET_FLAGS(ParserState, parser->state, PARSER_LAZY_AFTER_CR, pScan->afterCarriageReturn);
+}
+
+static void JSON_Parser_RescanLazyLocation(JSON_Parser parser, size_t targetByte)
+{
+    /* The tracker counts runs of valid codepoints in bulk, and decodes
+       anything else exactly as the parser did, with its own decoder, so that
+       invalid sequences account for the same number of bytes and columns.
+       It stops at targetByte or at the end of the input that is in scope,
+       whichever comes first. */
+    Encoding encoding = parser->inputEncoding;
+    size_t windowEnd = parser->lazyLocationWindowByte + parser->lazyLocationWindowLength;
+    while (parser->lazyLocationByte < targetByte)
+    {
+        size_t fedByte = parser->lazyLocationByte + DECODER_STATE_BYTES(parser->lazyLocationDecoderData.state);
+        const byte* pBytes;
+        size_t length;
+        DecoderOutput output;
+        if (fedByte >= windowEnd)
+        {
+            break;
+        }
+        pBytes = parser->pLazyLocationWindow + (fedByte - parser->lazyLocationWindowByte);
+        length = windowEnd - fedByte;
+        if (!Decoder_SequencePending(&parser->lazyLocationDecoderData))
+        {
+            size_t validByte = (targetByte < parser->codepointLocationByte) ? targetByte : parser->codepointLocationByte;
+            WhitespaceScan scan;
+            size_t count;
+            if (length > targetByte - fedByte)
+            {
+                length = targetByte - fedByte;
+            }
+            scan.lineBreaks = 0;
+            scan.lineStart = SIZE_MAX;
+            scan.afterCarriageReturn = GET_FLAGS(parser->state, PARSER_LAZY_AFTER_CR) != 0;
+            if (fedByte < validByte && !GET_FLAGS(parser->flags, PARSER_REPLACE_INVALID))
+            {
+                /* Unless the parser replaces invalid encoding sequences,
+                   everything it has decoded is known to be valid. */
+                if (length > validByte - fedByte)
+                {
+                    length = validByte - fedByte;
+                }
+            }
+            else if (encoding == JSON_UTF8)
+            {
+                length = ScanASCIILineBreaks(pBytes, length, &scan);
+                if (length)
+                {
+                    JSON_Parser_AdvanceLazyLocationOverRun(parser, length, length, &scan);
+                    continue;
+                }
+                length = ValidUTF8SequenceLength(pBytes, windowEnd - fedByte);
+            }
+            else
+            {
+                length = ScanWideCodepoints(pBytes, length, encoding);
+            }
+            if (length)
+            {
+                count = (encoding == JSON_UTF8) ? CountUTF8Codepoints(pBytes, length, &scan) : CountWideCodepoints(pBytes, length, encoding, &scan);
+                JSON_Parser_AdvanceLazyLocationOverRun(parser, length, count, &scan);
+                continue;
+            }
+        }
+        output = Decoder_ProcessByte(&parser->lazyLocationDecoderData, encoding, *pBytes);
+        switch (DECODER_RESULT_CODE(output))
+        {
+        case SEQUENCE_PENDING:
+            break;
+
+        case SEQUENCE_COMPLETE:
+            JSON_Parser_AdvanceLazyLocation(parser, DECODER_CODEPOINT(output), DECODER_SEQUENCE_LENGTH(output));
+            break;
+
+        default: /* SEQUENCE_INVALID_INCLUSIVE or SEQUENCE_INVALID_EXCLUSIVE */
+            JSON_Parser_AdvanceLazyLocation(parser, REPLACEMENT_CHARACTER_CODEPOINT, DECODER_SEQUENCE_LENGTH(output));
+            break;
+        }
+    }
+}
+
+static void JSON_Parser_UpdateLazyLocation(JSON_Parser parser, size_t targetByte)
+{
+    /* When the client asks the parser to track locations lazily, only the
+       byte offsets of the current codepoint and token are maintained while
+       parsing. Their line and column numbers are reconstructed here, by
+       advancing a separate tracker through the input that is in scope
+       (see JSON_Parser_SetLazyLocationWindow()). Since the parser never
+       moves backwards, except to back up across the trailing characters of
+       an invalid number, the tracker only ever needs to rescan each byte of
+       input once. Passing SIZE_MAX as targetByte consumes all the input that
+       is in scope, so that it can go out of scope. */
+    if (parser->inputEncoding == JSON_UnknownEncoding)
+    {
+        /* Nothing has been decoded yet, so all locations are zero. */
+        return;
+    }
+    if (parser->lazyLocationByte <= parser->tokenLocationByte && parser->tokenLocationByte <= targetByte)
+    {
+        JSON_Parser_RescanLazyLocation(parser, parser->tokenLocationByte);
+        parser->tokenLocationLine = parser->lazyLocationLine;
+        parser->tokenLocationColumn = parser->lazyLocationColumn;
+    }
+    JSON_Parser_RescanLazyLocation(parser, targetByte);
+    if (targetByte != SIZE_MAX)
+    {
+        if (parser->lazyLocationByte > targetByte)
+        {
+            /* The parser backed up across characters that the tracker has
+               already consumed; see JSON_Parser_HandleInvalidNumber() for
+               why we can simply decrement the column number. */
+            parser->lazyLocationColumn -= (parser->lazyLocationByte - targetByte) / SHORTEST_ENCODING_SEQUENCE(parser->inputEncoding);
+            parser->lazyLocationByte = targetByte;
+            SET_FLAGS_OFF(ParserState, parser->state, PARSER_LAZY_AFTER_CR);
+        }
+        else if (parser->lazyLocationByte < targetByte && Decoder_SequencePending(&parser->lazyLocationDecoderData))
+        {
+            /* The parser replaced the truncated sequence at the end of the
+               input with a replacement character. */
+            JSON_Parser_AdvanceLazyLocation(parser, REPLACEMENT_CHARACTER_CODEPOINT, DECODER_STATE_BYTES(parser->lazyLocationDecoderData.state));
+            Decoder_Reset(&parser->lazyLocationDecoderData);
+        }
+        parser->codepointLocationLine = parser->lazyLocationLine;
+        parser->codepointLocationColumn = parser->lazyLocationColumn;
+    }
+}
+
+static void JSON_Parser_SetLazyLocationWindow(JSON_Parser parser, const byte* pBytes, size_t length, size_t windowByte)
+{
+    /* The window is the input that is in scope: the buffer passed to
+       JSON_Parser_Parse(), or the local buffer that holds the bytes that
+       were recorded while the input encoding was being detected. Its first
+       byte is at offset windowByte in the input stream. */
+    parser->pLazyLocationWindow = pBytes;
+    parser->lazyLocationWindowLength = length;
+    parser->lazyLocationWindowByte = windowByte;
+}
+
+static void JSON_Parser_SyncLazyLocation(JSON_Parser parser, JSON_Status status)
+{
+    /* Before the window goes out of scope, the tracker consumes the rest of
+       it, or if parsing failed, catches up with the error location. */
+    if (GET_FLAGS(parser->flags, PARSER_LAZY_LOCATIONS))
+    {
+        JSON_Parser_UpdateLazyLocation(parser, status ? SIZE_MAX : parser->codepointLocationByte);
+    }
+}
+
+static JSON_Status JSON_Parser_ProcessInputBytes(JSON_Parser parser, const byte* pBytes, size_t length);
+
+static JSON_Status JSON_Parser_ProcessDetectionBytes(JSON_Parser parser, const byte* pBytes, size_t length)
+{
+    /* The bytes that were recorded while the input encoding was being
+       detected are reprocessed from a local buffer, so any token that refers
+       to them must be copied, and the lazy location tracker must consume
+       them, before we return. For the same reason, a reader can't suspend
+       parsing until they have all been processed. */
+    const byte* pWindow = parser->pLazyLocationWindow;
+    size_t windowLength = parser->lazyLocationWindowLength;
+    size_t windowByte = parser->lazyLocationWindowByte;
+    JSON_Status status;
+    Decoder_Reset(&parser->decoderData);
+    JSON_Parser_SetLazyLocationWindow(parser, pBytes, length, 0);
+    SET_FLAGS_ON(ParserState, parser->state, PARSER_REPLAYING_DETECTION);
+    status = (JSON_Parser_ProcessInputBytes(parser, pBytes, length) && JSON_Parser_MaterializeTokenRef(parser)) ? JSON_Success : JSON_Failure;
+    SET_FLAGS_OFF(ParserState, parser->state, PARSER_REPLAYING_DETECTION);
+    JSON_Parser_SyncLazyLocation(parser, status);
+    JSON_Parser_SetLazyLocationWindow(parser, pWindow, windowLength, windowByte);
+    return status;
+}
+
+static JSON_Status JSON_Parser_ProcessUnknownByte(JSON_Parser parser, byte b)
+{
+    /* When the input encoding is unknown, the first 4 bytes of input are
+       recorded in decoder.bits. */
+
+    byte bytes[LONGEST_ENCODING_SEQUENCE];
+    switch (parser->decoderData.state)
+    {
+    case DECODER_RESET:
+        parser->decoderData.state = DECODED_1_OF_4;
+        parser->decoderData.bits = (uint32_t)b << 24;
+        break;
+
+    case DECODED_1_OF_4:
+        parser->decoderData.state = DECODED_2_OF_4;
+        parser->decoderData.bits |= (uint32_t)b << 16;
+        break;
+
+    case DECODED_2_OF_4:
+        parser->decoderData.state = DECODED_3_OF_4;
+        parser->decoderData.bits |= (uint32_t)b << 8;
+        break;
+
+    case DECODED_3_OF_4:
+        bytes[0] = (byte)(parser->decoderData.bits >> 24);
+        bytes[1] = (byte)(parser->decoderData.bits >> 16);
+        bytes[2] = (byte)(parser->decoderData.bits >> 8);
+        bytes[3] = (byte)(b);
+
+        /* We try to match the following patterns in order, where .. is any
+           byte value and nz is any non-zero byte value:
+              EF BB BF .. => UTF-8 with BOM
+              FF FE 00 00 => UTF-32LE with BOM
+              FF FE nz 00 => UTF-16LE with BOM
+              00 00 FE FF -> UTF-32BE with BOM
+              FE FF .. .. => UTF-16BE with BOM
+              nz nz .. .. => UTF-8
+              nz 00 nz .. => UTF-16LE
+              nz 00 00 00 => UTF-32LE
+              00 nz .. .. => UTF-16BE
+              00 00 00 nz => UTF-32BE
+              .. .. .. .. => unknown encoding */
+        if (bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF)
+        {
+            /* EF BB BF .. */
+            parser->inputEncoding = JSON_UTF8;
+        }
+        else if (bytes[0] == 0xFF && bytes[1] == 0xFE && bytes[3] == 0x00)
+        {
+            /* FF FE 00 00 or
+               FF FE nz 00 */
+            parser->inputEncoding = (bytes[2] == 0x00) ? JSON_UTF32LE : JSON_UTF16LE;
+        }
+        else if (bytes[0] == 0x00 && bytes[1] == 0x00 && bytes[2] == 0xFE && bytes[3] == 0xFF)
+        {
+            /* 00 00 FE FF */
+            parser->inputEncoding = JSON_UTF32BE;
+        }
+        else if (bytes[0] == 0xFE && bytes[1] == 0xFF)
+        {
+            /* FE FF .. .. */
+            parser->inputEncoding = JSON_UTF16BE;
+        }
+        else if (bytes[0] != 0x00)
+        {
+            /* nz .. .. .. */
+            if (bytes[1] != 0x00)
+            {
+                /* nz nz .. .. */
+                parser->inputEncoding = JSON_UTF8;
+            }
+            else if (bytes[2] != 0x00)
+            {
+                /* nz 00 nz .. */
+                parser->inputEncoding = JSON_UTF16LE;
+            }
+            else if (bytes[3] == 0x00)
+            {
+                /* nz 00 00 00 */
+                parser->inputEncoding = JSON_UTF32LE;
+            }
+            else
+            {
+                /* nz 00 00 nz => error */
+            }
+        }
+        else if (bytes[1] != 0x00)
+        {
+            /* 00 nz .. .. */
+            parser->inputEncoding = JSON_UTF16BE;
+        }
+        else if (bytes[2] == 0x00 && bytes[3] != 0x00)
+        {
+            /* 00 00 00 nz */
+            parser->inputEncoding = JSON_UTF32BE;
+        }
+        else
+        {
+            /* 00 00 nz .. or
+               00 00 00 00 => error */
+        }
+
+        if (parser->inputEncoding == JSON_UnknownEncoding)
+        {
+            return JSON_Parser_HandleInvalidEncodingSequence(parser, 4);
+        }
+
+        if (!JSON_Parser_CallEncodingDetectedHandler(parser))
+        {
+            return JSON_Failure;
+        }
+
+        /* Reset the decoder before reprocessing the bytes. */
+        return JSON_Parser_ProcessDetectionBytes(parser, bytes, 4);
+    }
+
+    /* We don't have 4 bytes yet. */
+    return JSON_Success;
+}
+
+/* Parser's bulk ASCII functions. */
+
+static JSON_FORCE_INLINE size_t JSON_Parser_GetTokenRunRoom(JSON_Parser parser, const byte* pBytes, Encoding tokenEncoding, size_t maxTokenLength)
+{
+    /* Returns the number of bytes that a run of string or number characters
+       starting at pBytes can add to the token: as many as fit in the token
+       buffer (leaving LONGEST_ENCODING_SEQUENCE bytes free) without
+       exceeding the maximum token length. The codepoint that doesn't fit is
+       left for JSON_Parser_ProcessCodepoint(), which grows the buffer or
+       triggers the appropriate error exactly as if the whole run had been
+       processed one codepoint at a time. If the token is being referenced
+       in the input buffer rather than copied, the run simply extends the
+       reference, and only the maximum token length applies. */
+    size_t maxLengthRoom = maxTokenLength - parser->tokenBytesUsed;
+    size_t room;
+    if (parser->pTokenRef)
+    {
+        if (parser->pTokenRef + parser->tokenBytesUsed != pBytes)
+        {
+            return 0;
+        }
+        return maxLengthRoom;
+    }
+    if (!parser->tokenBytesUsed && JSON_Parser_IsTokenRefEligible(parser, tokenEncoding))
+    {
+        parser->pTokenRef = pBytes;
+        return maxLengthRoom;
+    }
+    room = parser->tokenBytesLength - LONGEST_ENCODING_SEQUENCE - parser->tokenBytesUsed;
+    return (room > maxLengthRoom) ? maxLengthRoom : room;
+}
+
+static JSON_FORCE_INLINE size_t JSON_Parser_LimitPlainStringRun(JSON_Parser parser, const byte* pBytes, size_t length, Encoding stringEncoding)
+{
+    /* Plain string characters (ASCII characters other than '"', '\\', and
+       control characters, or any control characters other than CR and LF if
+       they are allowed) are appended to the token as-is: they never break
+       lines or finish the token, and the only attributes they can imply are
+       those for control characters, which the scan accumulates for the whole
+       run. Each of them takes up one shortest encoding sequence. */
+    size_t maxChars = JSON_Parser_GetTokenRunRoom(parser, pBytes, stringEncoding, parser->maxStringLength) / SHORTEST_ENCODING_SEQUENCE(stringEncoding);
+    return (length > maxChars) ? maxChars : length;
+}
+
+static JSON_FORCE_INLINE void JSON_Parser_AppendASCIIRun(JSON_Parser parser, const byte* pBytes, size_t count, Encoding tokenEncoding)
+{
+    /* Appends ASCII characters that don't break lines to the token. */
+    size_t bytesPerChar = SHORTEST_ENCODING_SEQUENCE(tokenEncoding);
+    byte* pDest = parser->pTokenBytes + parser->tokenBytesUsed;
+    size_t i;
+    if (!parser->pTokenRef)
+    {
+        switch (tokenEncoding)
+        {
+        case JSON_UTF8:
+            memcpy(pDest, pBytes, count);
+            break;
+
+        case JSON_UTF16LE:
+            for (i = 0; i < count; i++, pDest += 2)
+            {
+                pDest[0] = pBytes[i];
+                pDest[1] = 0;
+            }
+            break;
+
+        case JSON_UTF16BE:
+            for (i = 0; i < count; i++, pDest += 2)
+            {
+                pDest[0] = 0;
+                pDest[1] = pBytes[i];
+            }
+            break;
+
+        case JSON_UTF32LE:
+            for (i = 0; i < count; i++, pDest += 4)
+            {
+                pDest[0] = pBytes[i];
+                pDest[1] = pDest[2] = pDest[3] = 0;
+            }
+            break;
+
+        case JSON_UTF32BE:
+            for (i = 0; i < count; i++, pDest += 4)
+            {
+                pDest[0] = pDest[1] = pDest[2] = 0;
+                pDest[3] = pBytes[i];
+            }
+            break;
+        }
+    }
+    parser->tokenBytesUsed += count * bytesPerChar;
+    parser->codepointLocationByte += count;
+    parser->codepointLocationColumn += count;
+    SET_FLAGS_OFF(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN);
+}
+
+static JSON_FORCE_INLINE size_t JSON_Parser_RecordPlainStringRun(JSON_Parser parser, const byte* pBytes, size_t length, Encoding stringEncoding, int allowControlChars)
+{
+    size_t count = ScanStringBytes(pBytes, JSON_Parser_LimitPlainStringRun(parser, pBytes, length, stringEncoding), allowControlChars, &parser->tokenAttributes);
+    if (count)
+    {
+        JSON_Parser_AppendASCIIRun(parser, pBytes, count, stringEncoding);
+    }
+    return count;
+}
+
+static JSON_FORCE_INLINE size_t JSON_Parser_RecordDigitRun(JSON_Parser parser, const byte* pBytes, size_t length, Encoding numberEncoding)
+{
+    /* In the states where a number's decimal digits can go on, each digit
+       is appended to the token and leaves the lexer in the same state, so a
+       run of them is appended at once, subject to the same limits as a run
+       of plain string characters. */
+    size_t maxDigits = JSON_Parser_GetTokenRunRoom(parser, pBytes, numberEncoding, parser->maxNumberLength) / SHORTEST_ENCODING_SEQUENCE(numberEncoding);
+    size_t count = 0;
+    if (length > maxDigits)
+    {
+        length = maxDigits;
+    }
+    while (count < length && pBytes[count] >= '0' && pBytes[count] <= '9')
+    {
+        count++;
+    }
+    if (count)
+    {
+        JSON_Parser_AppendASCIIRun(parser, pBytes, count, numberEncoding);
+    }
+    return count;
+}
+
+static JSON_FORCE_INLINE size_t JSON_Parser_RecordUTF8StringRun(JSON_Parser parser, const byte* pBytes, size_t length, int allowControlChars)
+{
+    /* When the input and string encodings are both UTF-8, string content
+       that is valid UTF-8 -- multi-byte sequences included -- is appended
+       to the token as-is, so the decoder only sees the sequences that are
+       invalid or are cut off by the end of the buffer, and can replace or
+       report them exactly as before. The same limits apply as for plain
+       ASCII runs; since the bytes are copied verbatim, a character that
+       doesn't fit is simply left for the decoder. */
+    size_t codepoints = 0;
+    size_t count = ScanUTF8StringBytes(pBytes, JSON_Parser_LimitPlainStringRun(parser, pBytes, length, JSON_UTF8), allowControlChars, &parser->tokenAttributes, &codepoints);
+    if (count)
+    {
+        if (!parser->pTokenRef)
+        {
+            memcpy(parser->pTokenBytes + parser->tokenBytesUsed, pBytes, count);
+        }
+        parser->tokenBytesUsed += count;
+        parser->codepointLocationByte += count;
+        parser->codepointLocationColumn += codepoints;
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN);
+    }
+    return count;
+}
+
+static size_t JSON_Parser_RecordWideStringRun(JSON_Parser parser, const byte* pBytes, size_t length)
+{
+    /* When the input encoding is UTF-16 or UTF-32, a run of valid string
+       content is transcoded straight into the string encoding, without
+       being decoded and re-encoded one codepoint at a time. The room in the
+       token is converted to a number of input bytes assuming the worst case
+       for the pair of encodings (e.g. a UTF-16 unit can take up to 3 bytes
+       in UTF-8); near the limit, the run stops short and the remaining
+       codepoints go through JSON_Parser_ProcessCodepoint(). */
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(parser->inputEncoding);
+    size_t maxUnitOutput = (parser->stringEncoding == JSON_UTF8) ? 3 : SHORTEST_ENCODING_SEQUENCE(parser->stringEncoding);
+    size_t room = JSON_Parser_GetTokenRunRoom(parser, pBytes, parser->stringEncoding, parser->maxStringLength);
+    size_t codepoints = 0;
+    size_t count;
+    if (maxUnitOutput < unitLength || parser->pTokenRef)
+    {
+        maxUnitOutput = unitLength;
+    }
+    room = room / maxUnitOutput * unitLength;
+    count = ScanWideStringUnits(pBytes, (length > room) ? room : length, parser->inputEncoding, GET_FLAGS(parser->flags, PARSER_ALLOW_CONTROL_CHARS), &parser->tokenAttributes, &codepoints);
+    if (count)
+    {
+        if (parser->pTokenRef)
+        {
+            parser->tokenBytesUsed += count;
+        }
+        else
+        {
+            parser->tokenBytesUsed += TranscodeWideCodepoints(pBytes, count, parser->inputEncoding, parser->stringEncoding, parser->pTokenBytes + parser->tokenBytesUsed);
+        }
+        parser->codepointLocationByte += count;
+        parser->codepointLocationColumn += codepoints;
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN);
+    }
+    return count;
+}
+
+static void JSON_Parser_InitWhitespaceScan(JSON_Parser parser, WhitespaceScan* pScan)
+{
+    pScan->lineBreaks = 0;
+    pScan->lineStart = SIZE_MAX;
+    pScan->afterCarriageReturn = GET_FLAGS(parser->state, PARSER_AFTER_CARRIAGE_RETURN) != 0;
+}
+
+static void JSON_Parser_ApplyWhitespaceScan(JSON_Parser parser, size_t count, const WhitespaceScan* pScan)
+{
+    /* Whitespace between tokens is skipped without involving the lexer at
+       all. The location counters are updated once for the whole run,
+       following the same line-breaking rules as the lexer; the CR state
+       carries over from the previous run, even across calls to
+       JSON_Parser_Parse(). */
+    parser->codepointLocationByte += count;
+    parser->codepointLocationLine += pScan->lineBreaks;
+    if (pScan->lineStart == SIZE_MAX)
+    {
+        parser->codepointLocationColumn += count;
+    }
+    else
+    {
+        parser->codepointLocationColumn = count - pScan->lineStart;
+    }
+    SET_FLAGS(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN, pScan->afterCarriageReturn);
+}
+
+static size_t JSON_Parser_SkipWhitespaceRun(JSON_Parser parser, const byte* pBytes, size_t length)
+{
+    WhitespaceScan scan;
+    size_t count;
+    JSON_Parser_InitWhitespaceScan(parser, &scan);
+    count = ScanWhitespaceBytes(pBytes, length, &scan);
+    if (count)
+    {
+        JSON_Parser_ApplyWhitespaceScan(parser, count, &scan);
+    }
+    return count;
+}
+
+static size_t JSON_Parser_SkipWideWhitespaceRun(JSON_Parser parser, const byte* pBytes, size_t length)
+{
+    /* UTF-16 and UTF-32 whitespace is narrowed a chunk at a time and
+       skipped exactly like UTF-8 whitespace, except that each character
+       accounts for a whole code unit of input. */
+    size_t unitLength = SHORTEST_ENCODING_SEQUENCE(parser->inputEncoding);
+    byte narrowed[WIDE_WHITESPACE_CHUNK_UNITS];
+    size_t i = 0;
+    while (i < length)
+    {
+        size_t units = (length - i) / unitLength;
+        size_t count;
+        if (units > WIDE_WHITESPACE_CHUNK_UNITS)
+        {
+            units = WIDE_WHITESPACE_CHUNK_UNITS;
+        }
+        NarrowWideUnits(pBytes + i, units, parser->inputEncoding, narrowed);
+        count = JSON_Parser_SkipWhitespaceRun(parser, narrowed, units);
+        parser->codepointLocationByte += count * (unitLength - 1);
+        i += count * unitLength;
+        if (count < units)
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+static JSON_Status JSON_Parser_ProcessWideRun(JSON_Parser parser, const byte* pBytes, size_t length)
+{
+    /* Every codepoint in the run is valid and complete (see
+       ScanWideCodepoints()), so the decoder can be bypassed entirely.
+       Whitespace between tokens and plain characters inside strings are
+       consumed a run at a time; any other codepoint is read directly from
+       the input and fed to the lexer. */
+    size_t i = 0;
+    while (i < length)
+    {
+        size_t runLength = 0;
+        if (parser->lexerState == LEXING_STRING)
+        {
+            runLength = JSON_Parser_RecordWideStringRun(parser, pBytes + i, length - i);
+        }
+        else if (parser->lexerState == LEXING_WHITESPACE)
+        {
+            runLength = JSON_Parser_SkipWideWhitespaceRun(parser, pBytes + i, length - i);
+        }
+        if (runLength)
+        {
+            i += runLength;
+        }
+        else
+        {
+            size_t encodedLength;
+            Codepoint c = ReadWideCodepoint(pBytes + i, parser->inputEncoding, &encodedLength);
+            parser->pCodepointBytes = pBytes + i;
+            if (!JSON_Parser_ProcessCodepoint(parser, c, encodedLength))
+            {
+                return JSON_Failure;
+            }
+            if (GET_FLAGS(parser->state, PARSER_SUSPENDED))
+            {
+                break;
+            }
+            i += encodedLength;
+        }
+    }
+    return JSON_Success;
+}
+
+/* The input loop is instantiated by DEFINE_INPUT_LOOP() once for the
+   general case, which reads the encodings and the settings from the
+   parser, and once for UTF-8 input, strings and numbers without control
+   characters allowed in strings, which is by far the most common case.
+   Passing constants for the encodings and the setting lets the compiler
+   drop the branches and the transcoding that can't happen in that case.
+   JSON_Parser_ProcessInputBytes() picks the instance once per call, since
+   none of these can change while the input is being parsed (except the
+   input encoding, when it is detected, which the general case handles).
+   Only the general case can be suspended after a codepoint to let a reader
+   hand out the events it produced (see JSON_Reader_Next()), so readers
+   always use it.
+
+   In the ASCII run loop, every byte is a complete UTF-8 sequence by
+   itself, so the decoder can be bypassed entirely. Whitespace between
+   tokens, plain characters inside strings and the decimal digits of
+   numbers are consumed a run at a time; any other byte is fed to the
+   lexer directly. In the input loop, ASCII runs, valid UTF-8 string
+   content (when strings are UTF-8) and valid UTF-16 or UTF-32 runs are
+   handed to their bulk functions, and anything else goes through the
+   decoder. */
+#define DEFINE_INPUT_LOOP(suffix, inputEncoding, stringEncoding, numberEncoding, allowControlChars, canSuspend) \
+static JSON_Status JSON_Parser_ProcessASCIIRun##suffix(JSON_Parser parser, const byte* pBytes, size_t length) \
+{ \
+    size_t i = 0; \
+    while (i < length) \
+    { \
+        size_t runLength = 0; \
+        if (parser->lexerState == LEXING_STRING) \
+        { \
+            runLength = JSON_Parser_RecordPlainStringRun(parser, pBytes + i, length - i, (stringEncoding), (allowControlChars)); \
+        } \
+        else if (parser->lexerState == LEXING_WHITESPACE) \
+        { \
+            runLength = JSON_Parser_SkipWhitespaceRun(parser, pBytes + i, length - i); \
+        } \
+        else if (parser->lexerState == LEXING_NUMBER_DECIMAL_DIGITS || parser->lexerState == LEXING_NUMBER_FRACTIONAL_DIGITS || \
+                 parser->lexerState == LEXING_NUMBER_EXPONENT_DIGITS) \
+        { \
+            runLength = JSON_Parser_RecordDigitRun(parser, pBytes + i, length - i, (numberEncoding)); \
+        } \
+        if (runLength) \
+        { \
+            i += runLength; \
+        } \
+        else \
+        { \
+            parser->pCodepointBytes = pBytes + i; \
+            if (!JSON_Parser_ProcessCodepoint(parser, pBytes[i], 1)) \
+            { \
+                return JSON_Failure; \
+            } \
+            if ((canSuspend) && GET_FLAGS(parser->state, PARSER_SUSPENDED)) \
+            { \
+                break; \
+            } \
+            i++; \
+        } \
+    } \
+    return JSON_Success; \
+} \
+\
+static JSON_Status JSON_Parser_ProcessInputBytes##suffix(JSON_Parser parser, const byte* pBytes, size_t length) \
+{ \
+    size_t i = 0; \
+    while ((inputEncoding) == JSON_UnknownEncoding && i < length) \
+    { \
+        if (!JSON_Parser_ProcessUnknownByte(parser, pBytes[i])) \
+        { \
+            return JSON_Failure; \
+        } \
+        i++; \
+    } \
+    while (i < length) \
+    { \
+        DecoderOutput output; \
+        DecoderResultCode result; \
+        if ((inputEncoding) == JSON_UTF8 && !Decoder_SequencePending(&parser->decoderData) && \
+            IS_UTF8_SINGLE_BYTE(pBytes[i])) \
+        { \
+            size_t runEnd = i + 1 + ScanASCIIBytes(pBytes + i + 1, length - i - 1); \
+            if (!JSON_Parser_ProcessASCIIRun##suffix(parser, pBytes + i, runEnd - i)) \
+            { \
+                return JSON_Failure; \
+            } \
+            if ((canSuspend) && GET_FLAGS(parser->state, PARSER_SUSPENDED)) \
+            { \
+                break; \
+            } \
+            i = runEnd; \
+            continue; \
+        } \
+        if ((inputEncoding) == JSON_UTF8 && (stringEncoding) == JSON_UTF8 && \
+            parser->lexerState == LEXING_STRING && !Decoder_SequencePending(&parser->decoderData)) \
+        { \
+            size_t runLength = JSON_Parser_RecordUTF8StringRun(parser, pBytes + i, length - i, (allowControlChars)); \
+            if (runLength) \
+            { \
+                i += runLength; \
+                continue; \
+            } \
+        } \
+        if ((inputEncoding) != JSON_UTF8 && !Decoder_SequencePending(&parser->decoderData)) \
+        { \
+            size_t runLength = ScanWideCodepoints(pBytes + i, length - i, (inputEncoding)); \
+            if (runLength) \
+            { \
+                if (!JSON_Parser_ProcessWideRun(parser, pBytes + i, runLength)) \
+                { \
+                    return JSON_Failure; \
+                } \
+                if ((canSuspend) && GET_FLAGS(parser->state, PARSER_SUSPENDED)) \
+                { \
+                    break; \
+                } \
+                i += runLength; \
+                continue; \
+            } \
+        } \
+        output = Decoder_ProcessByte(&parser->decoderData, (inputEncoding), pBytes[i]); \
+        result = DECODER_RESULT_CODE(output); \
+        switch (result) \
+        { \
+        case SEQUENCE_PENDING: \
+            i++; \
+            break; \
+        case SEQUENCE_COMPLETE: \
+            /* Remember where the sequence is in the input, unless it \
+               started in a previous buffer. */ \
+            parser->pCodepointBytes = (i + 1 >= DECODER_SEQUENCE_LENGTH(output)) ? pBytes + i + 1 - DECODER_SEQUENCE_LENGTH(output) : NULL; \
+            if (!JSON_Parser_ProcessCodepoint(parser, DECODER_CODEPOINT(output), DECODER_SEQUENCE_LENGTH(output))) \
+            { \
+                return JSON_Failure; \
+            } \
+            i++; \
+            break; \
+        case SEQUENCE_INVALID_INCLUSIVE: \
+            i++; \
+            /* fallthrough */ \
+        case SEQUENCE_INVALID_EXCLUSIVE: \
+            parser->pCodepointBytes = NULL; \
+            if (!JSON_Parser_HandleInvalidEncodingSequence(parser, DECODER_SEQUENCE_LENGTH(output))) \
+            { \
+                return JSON_Failure; \
+            } \
+            break; \
+        } \
+        if ((canSuspend) && GET_FLAGS(parser->state, PARSER_SUSPENDED)) \
+        { \
+            break; \
+        } \
+    } \
+    parser->pCodepointBytes = NULL; \
+    return JSON_Success; \
+}
+
+DEFINE_INPUT_LOOP(Generic, parser->inputEncoding, parser->stringEncoding, parser->numberEncoding, GET_FLAGS(parser->flags, PARSER_ALLOW_CONTROL_CHARS), 1)
+DEFINE_INPUT_LOOP(UTF8, JSON_UTF8, JSON_UTF8, JSON_UTF8, 0, 0)
+
+JSON_Status JSON_Parser_ProcessInputBytes(JSON_Parser parser, const byte* pBytes, size_t length)
+{
+    /* Note that if length is 0, pBytes is allowed to be NULL. */
+    if (parser->inputEncoding == JSON_UTF8 && parser->stringEncoding == JSON_UTF8 && parser->numberEncoding == JSON_UTF8 &&
+        !GET_FLAGS(parser->flags, PARSER_ALLOW_CONTROL_CHARS) && !parser->reader)
+    {
+        return JSON_Parser_ProcessInputBytesUTF8(parser, pBytes, length);
+    }
+    return JSON_Parser_ProcessInputBytesGeneric(parser, pBytes, length);
+}
+
+static JSON_Status JSON_Parser_FlushDecoder(JSON_Parser parser)
+{
+    /* If the input was 1, 2, or 3 bytes long, and the input encoding was not
+       explicitly specified by the client, we can sometimes make a reasonable
+       guess. If the input was 1 or 3 bytes long, the only encoding that could
+       possibly be valid JSON is UF-8. If the input was 2 bytes long, we try
+       to match the following patterns in order, where .. is any byte value
+       and nz is any non-zero byte value:
+         FF FE => UTF-16LE with BOM
+         FE FF => UTF-16BE with BOM
+         nz nz => UTF-8
+         nz 00 => UTF-16LE
+         00 nz => UTF-16BE
+         .. .. => unknown encoding
+    */
+    if (parser->inputEncoding == JSON_UnknownEncoding &&
+        parser->decoderData.state != DECODER_RESET)
+    {
+        byte bytes[3];
+        size_t length = 0;
+        bytes[0] = (byte)(parser->decoderData.bits >> 24);
+        bytes[1] = (byte)(parser->decoderData.bits >> 16);
+        bytes[2] = (byte)(parser->decoderData.bits >> 8);
+        switch (parser->decoderData.state)
+        {
+        case DECODED_1_OF_4:
+            parser->inputEncoding = JSON_UTF8;
+            length = 1;
+            break;
+
+        case DECODED_2_OF_4:
+            if (bytes[0] == 0xFF && bytes[1] == 0xFE)
+            {
+                /* FF FE */
+                parser->inputEncoding = JSON_UTF16LE;
+            }
+            else if (bytes[0] == 0xFE && bytes[1] == 0xFF)
+            {
+                /* FE FF */
+                parser->inputEncoding = JSON_UTF16BE;
+            }
+            else if (bytes[0] != 0x00)
+            {
+                /* nz nz or
+                   nz 00 */
+                parser->inputEncoding = bytes[1] ? JSON_UTF8 : JSON_UTF16LE;
+            }
+            else if (bytes[1] != 0x00)
+            {
+                /* 00 nz */
+                parser->inputEncoding = JSON_UTF16BE;
+            }
+            else
+            {
+                /* 00 00 */
+                return JSON_Parser_HandleInvalidEncodingSequence(parser, 2);
+            }
+            length = 2;
+            break;
+
+        case DECODED_3_OF_4:
+            parser->inputEncoding = JSON_UTF8;
+            length = 3;
+            break;
+        }
+
+        if (!JSON_Parser_CallEncodingDetectedHandler(parser))
+        {
+            return JSON_Failure;
+        }
+
+        /* Reset the decoder before reprocessing the bytes. */
+        if (!JSON_Parser_ProcessDetectionBytes(parser, bytes, length))
+        {
+            return JSON_Failure;
+        }
+    }
+
+    /* The decoder should be idle when parsing finishes. */
+    if (Decoder_SequencePending(&parser->decoderData))
+    {
+        return JSON_Parser_HandleInvalidEncodingSequence(parser, DECODER_STATE_BYTES(parser->decoderData.state));
+    }
+    return JSON_Success;
+}
+
+/* Parser state snapshots.
+
+   A snapshot written by JSON_Parser_SaveState() starts with a magic number
+   and a format version, followed by the settings that the state depends
+   on, so that it is not loaded into a parser that would interpret it
+   differently, and then by the state itself. Numbers are written as
+   unsigned LEB128 varints, so that snapshots are compact and do not depend
+   on the width of size_t or on byte order. The snapshot ends with an FNV-1a
+   hash of everything before it.
+
+   Pointers are never written. The hash sets of the open objects' member
+   names and the index of the interned names are keyed with a secret that
+   is chosen per parser, so only the names are written, and the sets and
+   the index are rebuilt when the snapshot is loaded. */
+
+static const byte stateMagic[] = { 'J', 'S', 'A', 'X' };
+
+#define STATE_VERSION         1
+#define STATE_CHECKSUM_LENGTH 8
+
+/* The parser state bits that can be saved. Snapshots can only be taken
+   between calls to JSON_Parser_Parse(), when no handler is running and
+   the parser has not finished. */
+#define SAVED_PARSER_STATE (PARSER_STARTED | PARSER_AFTER_CARRIAGE_RETURN | PARSER_LAZY_AFTER_CR | \
+                            PARSER_SKIPPING_VALUE | PARSER_FILTERING_PATHS | PARSER_OUTSIDE_MATCHED_VALUE)
+
+typedef struct tag_StateWriter
+{
+    byte*  pBytes;
+    size_t length;
+    size_t used; /* may exceed length, in which case nothing past length is written */
+} StateWriter;
+
+typedef struct tag_StateReader
+{
+    const byte* pBytes;
+    size_t      length;
+    size_t      used;
+    int         isValid;
+} StateReader;
+
+static JSON_UInt64 HashState(const byte* pBytes, size_t length)
+{
+    JSON_UInt64 hash = UINT64_FROM_HALVES(0xCBF29CE4, 0x84222325);
+    size_t i;
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ pBytes[i]) * UINT64_FROM_HALVES(0x00000100, 0x000001B3);
+    }
+    return hash;
+}
+
+static void StateWriter_WriteByte(StateWriter* pWriter, byte b)
+{
+    if (pWriter->used < pWriter->length)
+    {
+        pWriter->pBytes[pWriter->used] = b;
+    }
+    pWriter->used++;
+}
+
+static void StateWriter_WriteSize(StateWriter* pWriter, size_t value)
+{
+    while (value >= 0x80)
+    {
+        StateWriter_WriteByte(pWriter, (byte)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    StateWriter_WriteByte(pWriter, (byte)value);
+}
+
+static void StateWriter_WriteBytes(StateWriter* pWriter, const byte* pBytes, size_t length)
+{
+    size_t i;
+    StateWriter_WriteSize(pWriter, length);
+    for (i = 0; i < length; i++)
+    {
+        StateWriter_WriteByte(pWriter, pBytes[i]);
+    }
+}
+
+static void StateWriter_WriteDecoder(StateWriter* pWriter, const DecoderData* pDecoderData)
+{
+    StateWriter_WriteSize(pWriter, pDecoderData->state);
+    StateWriter_WriteSize(pWriter, pDecoderData->bits);
+}
+
+static byte StateReader_ReadByte(StateReader* pReader)
+{
+    if (pReader->used == pReader->length)
+    {
+        pReader->isValid = 0;
+        return 0;
+    }
+    return pReader->pBytes[pReader->used++];
+}
+
+static size_t StateReader_ReadSize(StateReader* pReader)
+{
+    size_t value = 0;
+    size_t shift;
+    for (shift = 0; pReader->isValid; shift += 7)
+    {
+        byte b = StateReader_ReadByte(pReader);
+        size_t bits = (size_t)(b & 0x7F);
+        if (shift >= sizeof(size_t) * 8 || ((bits << shift) >> shift) != bits)
+        {
+            /* The value does not fit in a size_t on this platform. */
+            pReader->isValid = 0;
+            break;
+        }
+        value |= bits << shift;
+        if (!(b & 0x80))
+        {
+            return value;
+        }
+    }
+    return 0;
+}
+
+static size_t StateReader_ReadBoundedSize(StateReader* pReader, size_t maxValue)
+{
+    size_t value = StateReader_ReadSize(pReader);
+    if (value > maxValue)
+    {
+        pReader->isValid = 0;
+        return 0;
+    }
+    return value;
+}
+
+static size_t StateReader_ReadCount(StateReader* pReader)
+{
+    /* Every counted item takes at least one byte, so a count that is larger
+       than the rest of the snapshot is corrupt, and is rejected before it
+       is used to size an allocation. */
+    size_t count = StateReader_ReadSize(pReader);
+    if (count > pReader->length - pReader->used)
+    {
+        pReader->isValid = 0;
+        return 0;
+    }
+    return count;
+}
+
+static const byte* StateReader_ReadBytes(StateReader* pReader, size_t* pLength)
+{
+    const byte* pBytes;
+    *pLength = StateReader_ReadCount(pReader);
+    if (!pReader->isValid)
+    {
+        return NULL;
+    }
+    pBytes = pReader->pBytes + pReader->used;
+    pReader->used += *pLength;
+    return pBytes;
+}
+
+static void StateReader_ExpectSize(StateReader* pReader, size_t expectedValue)
+{
+    if (StateReader_ReadSize(pReader) != expectedValue)
+    {
+        pReader->isValid = 0;
+    }
+}
+
+static void StateReader_ReadDecoder(StateReader* pReader, DecoderData* pDecoderData)
+{
+    size_t state = StateReader_ReadSize(pReader);
+    size_t bits = StateReader_ReadSize(pReader);
+    if (state != DECODER_RESET && state != DECODED_1_OF_2 && state != DECODED_1_OF_3 && state != DECODED_2_OF_3 &&
+        state != DECODED_1_OF_4 && state != DECODED_2_OF_4 && state != DECODED_3_OF_4)
+    {
+        pReader->isValid = 0;
+    }
+    else if ((size_t)(uint32_t)bits != bits)
+    {
+        pReader->isValid = 0;
+    }
+    else
+    {
+        pDecoderData->state = (DecoderState)state;
+        pDecoderData->bits = (uint32_t)bits;
+    }
+}
+
+static int IsValidSymbolStack(const Symbol* pStack, size_t length)
+{
+    /* Checks that the stack is one that the grammarian could have built:
+       the closing token and progress of every open container, outermost
+       first, and then what the innermost container expects next. Only the
+       innermost container can be waiting for its first member or item, or
+       partway through one. */
+    size_t i = 0;
+    if (length == 1 && pStack[0] == NT_VALUE)
+    {
+        return 1;
+    }
+    while (i < length)
+    {
+        Symbol more = (pStack[i] == T_RIGHT_CURLY) ? NT_MORE_MEMBERS : NT_MORE_ITEMS;
+        Symbol first = (pStack[i] == T_RIGHT_CURLY) ? NT_MEMBERS : NT_ITEMS;
+        Symbol next = (pStack[i] == T_RIGHT_CURLY) ? NT_MEMBER : NT_ITEM;
+        size_t rest;
+        if ((pStack[i] != T_RIGHT_CURLY && pStack[i] != T_RIGHT_SQUARE) || i + 1 == length)
+        {
+            return 0;
+        }
+        if (pStack[i + 1] == first)
+        {
+            return i + 2 == length;
+        }
+        if (pStack[i + 1] != more)
+        {
+            return 0;
+        }
+        i += 2;
+        rest = length - i;
+        if (rest && pStack[i] != T_RIGHT_CURLY && pStack[i] != T_RIGHT_SQUARE)
+        {
+            return (rest == 1 && (pStack[i] == next || pStack[i] == NT_VALUE)) ||
+                   (rest == 2 && more == NT_MORE_MEMBERS && pStack[i] == NT_VALUE && pStack[i + 1] == T_COLON);
+        }
+    }
+    return 1;
+}
+
+static void JSON_Parser_WriteSettingsFingerprint(JSON_Parser parser, StateWriter* pWriter)
+{
+    /* The settings themselves are not saved, since the handlers can't be,
+       but those that change how the state is interpreted are recorded so
+       that JSON_Parser_LoadState() can check that they match. */
+    StateWriter_WriteSize(pWriter, parser->flags);
+    StateWriter_WriteSize(pWriter, parser->stringEncoding);
+    StateWriter_WriteSize(pWriter, parser->numberEncoding);
+    StateWriter_WriteSize(pWriter, parser->maxStringLength);
+    StateWriter_WriteSize(pWriter, parser->maxNumberLength);
+    StateWriter_WriteSize(pWriter, parser->internedKeyCapacity);
+    StateWriter_WriteSize(pWriter, (size_t)parser->keyEvictionPolicy);
+    StateWriter_WriteSize(pWriter, parser->pKnownKeys ? parser->pKnownKeys->keyCount : 0);
+    StateWriter_WriteSize(pWriter, parser->pPathFilter ? parser->pPathFilter->pathCount : 0);
+}
+
+static void JSON_Parser_WriteState(JSON_Parser parser, StateWriter* pWriter)
+{
+    size_t i;
+    size_t j;
+    for (i = 0; i < sizeof(stateMagic); i++)
+    {
+        StateWriter_WriteByte(pWriter, stateMagic[i]);
+    }
+    StateWriter_WriteByte(pWriter, STATE_VERSION);
+    JSON_Parser_WriteSettingsFingerprint(parser, pWriter);
+    StateWriter_WriteSize(pWriter, parser->inputEncoding);
+    StateWriter_WriteSize(pWriter, parser->state & SAVED_PARSER_STATE);
+
+    /* Lexer and location state. */
+    StateWriter_WriteSize(pWriter, parser->token);
+    StateWriter_WriteSize(pWriter, parser->tokenAttributes);
+    StateWriter_WriteSize(pWriter, parser->lexerState);
+    StateWriter_WriteSize(pWriter, parser->lexerBits);
+    StateWriter_WriteSize(pWriter, parser->codepointLocationByte);
+    StateWriter_WriteSize(pWriter, parser->codepointLocationLine);
+    StateWriter_WriteSize(pWriter, parser->codepointLocationColumn);
+    StateWriter_WriteSize(pWriter, parser->tokenLocationByte);
+    StateWriter_WriteSize(pWriter, parser->tokenLocationLine);
+    StateWriter_WriteSize(pWriter, parser->tokenLocationColumn);
+    StateWriter_WriteSize(pWriter, parser->lazyLocationByte);
+    StateWriter_WriteSize(pWriter, parser->lazyLocationLine);
+    StateWriter_WriteSize(pWriter, parser->lazyLocationColumn);
+    StateWriter_WriteDecoder(pWriter, &parser->lazyLocationDecoderData);
+    StateWriter_WriteDecoder(pWriter, &parser->decoderData);
+    StateWriter_WriteBytes(pWriter, parser->pTokenBytes, parser->tokenBytesUsed);
+
+    /* Grammar state. */
+    StateWriter_WriteSize(pWriter, parser->depth);
+    StateWriter_WriteSize(pWriter, GET_FLAGS(parser->state, PARSER_SKIPPING_VALUE) ? parser->skippedValueDepth : 0);
+    StateWriter_WriteSize(pWriter, (parser->matchedValueDepth == NO_MATCHED_VALUE) ? 0 : parser->matchedValueDepth + 1);
+    StateWriter_WriteBytes(pWriter, parser->grammarianData.pStack, parser->grammarianData.stackUsed);
+
+    /* The names of the open objects' members, outermost object first. */
+    if (GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS))
+    {
+        StateWriter_WriteSize(pWriter, parser->memberNamesUsed);
+        for (i = 0; i < parser->memberNamesUsed; i++)
+        {
+            const MemberNames* pNames = &parser->pMemberNames[i];
+            const MemberName* pSlots = parser->pMemberNameSlots + pNames->firstSlot;
+            StateWriter_WriteSize(pWriter, pNames->nameCount);
+            for (j = 0; j < pNames->slotCount; j++)
+            {
+                if (pSlots[j].nameOffset != EMPTY_MEMBER_NAME_SLOT)
+                {
+                    StateWriter_WriteBytes(pWriter, parser->pMemberNameBytes + pSlots[j].nameOffset, pSlots[j].length);
+                }
+            }
+        }
+    }
+
+    /* The path filter's progress. */
+    if (parser->pPathFilter)
+    {
+        const PathFilter* pFilter = parser->pPathFilter;
+        size_t livePathCount = JSON_Parser_GetPendingLivePathsStart(parser) + parser->pendingLivePathCount;
+        for (i = 0; i < pFilter->pathCount; i++)
+        {
+            StateWriter_WriteSize(pWriter, pFilter->pPaths[i].isMatched);
+        }
+        StateWriter_WriteSize(pWriter, parser->pathFramesUsed);
+        for (i = 0; i < parser->pathFramesUsed; i++)
+        {
+            StateWriter_WriteSize(pWriter, parser->pPathFrames[i].firstLivePath);
+            StateWriter_WriteSize(pWriter, parser->pPathFrames[i].livePathCount);
+            StateWriter_WriteSize(pWriter, parser->pPathFrames[i].itemCount);
+        }
+        StateWriter_WriteSize(pWriter, parser->pendingLivePathCount);
+        for (i = 0; i < livePathCount; i++)
+        {
+            StateWriter_WriteSize(pWriter, parser->pLivePaths[i]);
+        }
+    }
+
+    /* The interned names, in order of their IDs, so that the IDs that the
+       client has already seen stay valid. */
+    StateWriter_WriteSize(pWriter, parser->internedKeyCount);
+    StateWriter_WriteSize(pWriter, parser->internedKeyClockHand);
+    for (i = 0; i < parser->internedKeyCount; i++)
+    {
+        const InternedKey* pKey = &parser->pInternedKeys[i];
+        StateWriter_WriteSize(pWriter, pKey->isRecentlyUsed);
+        StateWriter_WriteBytes(pWriter, pKey->pName, pKey->length);
+    }
+}
+
+static JSON_Status JSON_Parser_ReadMemberNames(JSON_Parser parser, StateReader* pReader, size_t objectCount)
+{
+    size_t listCount = StateReader_ReadCount(pReader);
+    size_t i;
+    if (!pReader->isValid || listCount != objectCount)
+    {
+        return JSON_Failure;
+    }
+    for (i = 0; i < listCount; i++)
+    {
+        size_t nameCount = StateReader_ReadCount(pReader);
+        size_t j;
+        if (!pReader->isValid || !JSON_Parser_PushMemberNameList(parser))
+        {
+            return JSON_Failure;
+        }
+        for (j = 0; j < nameCount; j++)
+        {
+            size_t length;
+            const byte* pName = StateReader_ReadBytes(pReader, &length);
+            if (!pName || !JSON_Parser_AddMemberName(parser, pName, length))
+            {
+                return JSON_Failure;
+            }
+        }
+    }
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_ReadPathFilterState(JSON_Parser parser, StateReader* pReader, ParserState state)
+{
+    PathFilter* pFilter = parser->pPathFilter;
+    size_t frameCount;
+    size_t livePathCount;
+    size_t i;
+    pFilter->matchedPathCount = 0;
+    for (i = 0; i < pFilter->pathCount; i++)
+    {
+        FilterPath* pPath = &pFilter->pPaths[i];
+        pPath->isMatched = (byte)StateReader_ReadBoundedSize(pReader, pPath->hasWildcard ? 0 : 1);
+        pFilter->matchedPathCount += pPath->isMatched;
+    }
+    frameCount = StateReader_ReadSize(pReader);
+    if (frameCount != (GET_FLAGS(state, PARSER_SKIPPING_VALUE) ? parser->skippedValueDepth : parser->depth))
+    {
+        /* The filter sees every open container outside the value that is
+           being skipped, if any. */
+        return JSON_Failure;
+    }
+    for (i = 0; i < frameCount; i++)
+    {
+        size_t firstLivePath = StateReader_ReadSize(pReader);
+        size_t framePathCount = StateReader_ReadBoundedSize(pReader, pFilter->pathCount);
+        size_t itemCount = StateReader_ReadSize(pReader);
+        if (!pReader->isValid || firstLivePath > SIZE_MAX - framePathCount ||
+            !JSON_Parser_PushPathFrame(parser, firstLivePath, framePathCount))
+        {
+            return JSON_Failure;
+        }
+        parser->pPathFrames[i].itemCount = itemCount;
+    }
+    parser->pendingLivePathCount = StateReader_ReadBoundedSize(pReader, pFilter->pathCount);
+    livePathCount = JSON_Parser_GetPendingLivePathsStart(parser);
+    if (!pReader->isValid || livePathCount > pReader->length - pReader->used)
+    {
+        /* Every live path takes at least one byte. */
+        return JSON_Failure;
+    }
+    livePathCount += parser->pendingLivePathCount;
+    for (i = 0; i < frameCount; i++)
+    {
+        if (parser->pPathFrames[i].firstLivePath + parser->pPathFrames[i].livePathCount > livePathCount)
+        {
+            return JSON_Failure;
+        }
+    }
+    if (!JSON_Parser_ReserveLivePaths(parser, livePathCount))
+    {
+        return JSON_Failure;
+    }
+    for (i = 0; i < livePathCount; i++)
+    {
+        parser->pLivePaths[i] = StateReader_ReadBoundedSize(pReader, pFilter->pathCount - 1);
+    }
+    return pReader->isValid ? JSON_Success : JSON_Failure;
+}
+
+static JSON_Status JSON_Parser_ReadInternedKeys(JSON_Parser parser, StateReader* pReader)
+{
+    size_t keyCount = StateReader_ReadBoundedSize(pReader, parser->internedKeyCapacity);
+    size_t clockHand = StateReader_ReadBoundedSize(pReader, keyCount ? keyCount - 1 : 0);
+    size_t nullTerminatorLength = SHORTEST_ENCODING_SEQUENCE(parser->stringEncoding);
+    size_t keyId;
+    JSON_Parser_FreeInternedKeys(parser);
+    if (!pReader->isValid)
+    {
+        return JSON_Failure;
+    }
+    if (!keyCount)
+    {
+        return JSON_Success;
+    }
+    if (!JSON_Parser_AllocateInternedKeys(parser))
+    {
+        return JSON_Failure;
+    }
+    for (keyId = 0; keyId < keyCount; keyId++)
+    {
+        InternedKey* pKey = &parser->pInternedKeys[keyId];
+        size_t mask = parser->internedKeyIndexLength - 1;
+        size_t isRecentlyUsed = StateReader_ReadBoundedSize(pReader, 1);
+        size_t length;
+        const byte* pBytes = StateReader_ReadBytes(pReader, &length);
+        size_t slot;
+        if (!pBytes)
+        {
+            return JSON_Failure;
+        }
+        pKey->pName = (byte*)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, length + nullTerminatorLength);
+        if (!pKey->pName)
+        {
+            return JSON_Failure;
+        }
+        memcpy(pKey->pName, pBytes, length);
+        memset(pKey->pName + length, 0, nullTerminatorLength);
+        pKey->length = length;
+        pKey->hash = HashMemberName(parser->memberNameHashKey, pBytes, length);
+        pKey->isRecentlyUsed = (byte)isRecentlyUsed;
+        parser->internedKeyCount++;
+        for (slot = pKey->hash & mask; parser->pInternedKeyIndex[slot] != NO_INTERNED_KEY; slot = (slot + 1) & mask)
+        {
+            const InternedKey* pOtherKey = &parser->pInternedKeys[parser->pInternedKeyIndex[slot]];
+            if (pOtherKey->hash == pKey->hash && pOtherKey->length == length && !memcmp(pOtherKey->pName, pBytes, length))
+            {
+                /* The same name can't have two IDs. */
+                return JSON_Failure;
+            }
+        }
+        parser->pInternedKeyIndex[slot] = keyId;
+    }
+    parser->internedKeyClockHand = clockHand;
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_ReadState(JSON_Parser parser, StateReader* pReader)
+{
+    ParserState state;
+    size_t value;
+    size_t length;
+    const byte* pBytes;
+    size_t objectCount = 0;
+    size_t arrayCount = 0;
+    size_t i;
+    for (i = 0; i < sizeof(stateMagic); i++)
+    {
+        if (StateReader_ReadByte(pReader) != stateMagic[i])
+        {
+            return JSON_Failure;
+        }
+    }
+    if (StateReader_ReadByte(pReader) != STATE_VERSION)
+    {
+        return JSON_Failure;
+    }
+    StateReader_ExpectSize(pReader, parser->flags);
+    StateReader_ExpectSize(pReader, parser->stringEncoding);
+    StateReader_ExpectSize(pReader, parser->numberEncoding);
+    StateReader_ExpectSize(pReader, parser->maxStringLength);
+    StateReader_ExpectSize(pReader, parser->maxNumberLength);
+    StateReader_ExpectSize(pReader, parser->internedKeyCapacity);
+    StateReader_ExpectSize(pReader, (size_t)parser->keyEvictionPolicy);
+    StateReader_ExpectSize(pReader, parser->pKnownKeys ? parser->pKnownKeys->keyCount : 0);
+    StateReader_ExpectSize(pReader, parser->pPathFilter ? parser->pPathFilter->pathCount : 0);
+    value = StateReader_ReadBoundedSize(pReader, JSON_UTF32BE);
+    if (parser->inputEncoding != JSON_UnknownEncoding && value != parser->inputEncoding)
+    {
+        /* The client has set a different input encoding. */
+        return JSON_Failure;
+    }
+    parser->inputEncoding = (Encoding)value;
+    value = StateReader_ReadSize(pReader);
+    if ((value & ~(size_t)SAVED_PARSER_STATE) ||
+        (parser->pPathFilter ? !GET_FLAGS(value, PARSER_FILTERING_PATHS) : GET_FLAGS(value, PARSER_FILTERING_PATHS | PARSER_OUTSIDE_MATCHED_VALUE)))
+    {
+        return JSON_Failure;
+    }
+    state = (ParserState)value;
+
+    /* Lexer and location state. */
+    parser->token = (Symbol)StateReader_ReadBoundedSize(pReader, T_COMMA);
+    parser->tokenAttributes = (TokenAttributes)StateReader_ReadBoundedSize(pReader, 0xFF);
+    parser->lexerState = (LexerState)StateReader_ReadBoundedSize(pReader, LEXING_MULTI_LINE_COMMENT_AFTER_STAR);
+    value = StateReader_ReadSize(pReader);
+    if ((size_t)(uint32_t)value != value ||
+        (parser->lexerState == LEXING_LITERAL && value >= sizeof(expectedLiteralChars)))
+    {
+        return JSON_Failure;
+    }
+    parser->lexerBits = (uint32_t)value;
+    parser->codepointLocationByte = StateReader_ReadSize(pReader);
+    parser->codepointLocationLine = StateReader_ReadSize(pReader);
+    parser->codepointLocationColumn = StateReader_ReadSize(pReader);
+    parser->tokenLocationByte = StateReader_ReadSize(pReader);
+    parser->tokenLocationLine = StateReader_ReadSize(pReader);
+    parser->tokenLocationColumn = StateReader_ReadSize(pReader);
+    parser->lazyLocationByte = StateReader_ReadSize(pReader);
+    parser->lazyLocationLine = StateReader_ReadSize(pReader);
+    parser->lazyLocationColumn = StateReader_ReadSize(pReader);
+    StateReader_ReadDecoder(pReader, &parser->lazyLocationDecoderData);
+    StateReader_ReadDecoder(pReader, &parser->decoderData);
+    pBytes = StateReader_ReadBytes(pReader, &length);
+    if (!pBytes)
+    {
+        return JSON_Failure;
+    }
+    if (!JSON_Parser_GrowTokenBytes(parser, length))
+    {
+        return JSON_Failure;
+    }
+    memcpy(parser->pTokenBytes, pBytes, length);
+    parser->tokenBytesUsed = length;
+
+    /* Grammar state. The depth must agree with the symbol stack, which
+       holds the closing token of every open container, since closing a
+       container pops its bookkeeping. */
+    parser->depth = StateReader_ReadSize(pReader);
+    parser->skippedValueDepth = StateReader_ReadBoundedSize(pReader, parser->depth);
+    value = StateReader_ReadBoundedSize(pReader, parser->depth + 1);
+    parser->matchedValueDepth = value ? value - 1 : NO_MATCHED_VALUE;
+    if (parser->pPathFilter && (GET_FLAGS(state, PARSER_OUTSIDE_MATCHED_VALUE) != 0) == (value != 0))
+    {
+        return JSON_Failure;
+    }
+    pBytes = StateReader_ReadBytes(pReader, &length);
+    if (!pBytes)
+    {
+        return JSON_Failure;
+    }
+    if (!IsValidSymbolStack(pBytes, length))
+    {
+        return JSON_Failure;
+    }
+    for (i = 0; i < length; i++)
+    {
+        objectCount += (pBytes[i] == T_RIGHT_CURLY);
+        arrayCount += (pBytes[i] == T_RIGHT_SQUARE);
+    }
+    if (objectCount + arrayCount != parser->depth)
+    {
+        return JSON_Failure;
+    }
+    if (length > parser->grammarianData.stackSize &&
+        !Grammarian_ResizeStack(&parser->grammarianData, &parser->memorySuite, length))
+    {
+        return JSON_Failure;
+    }
+    memcpy(parser->grammarianData.pStack, pBytes, length);
+    parser->grammarianData.stackUsed = length;
+
+    if ((GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS) && !JSON_Parser_ReadMemberNames(parser, pReader, objectCount)) ||
+        (parser->pPathFilter && !JSON_Parser_ReadPathFilterState(parser, pReader, state)) ||
+        !JSON_Parser_ReadInternedKeys(parser, pReader) ||
+        !pReader->isValid || pReader->used != pReader->length)
+    {
+        return JSON_Failure;
+    }
+    parser->state = state;
+    return JSON_Success;
+}
+
+static void JSON_Parser_DiscardLoadedState(JSON_Parser parser, Encoding inputEncoding)
+{
+    /* Puts back the state of a parser that has not started, keeping its
+       settings and handlers, after a snapshot failed to load. */
+    parser->inputEncoding = inputEncoding;
+    parser->token = T_NONE;
+    parser->tokenAttributes = 0;
+    parser->error = JSON_Error_None;
+    parser->errorOffset = 0;
+    parser->lexerState = LEXING_WHITESPACE;
+    parser->lexerBits = 0;
+    parser->codepointLocationByte = 0;
+    parser->codepointLocationLine = 0;
+    parser->codepointLocationColumn = 0;
+    parser->tokenLocationByte = 0;
+    parser->tokenLocationLine = 0;
+    parser->tokenLocationColumn = 0;
+    parser->lazyLocationByte = 0;
+    parser->lazyLocationLine = 0;
+    parser->lazyLocationColumn = 0;
+    Decoder_Reset(&parser->lazyLocationDecoderData);
+    parser->depth = 0;
+    parser->tokenBytesUsed = 0;
+    parser->skippedValueDepth = 0;
+    parser->matchedValueDepth = NO_MATCHED_VALUE;
+    parser->memberNamesUsed = 0;
+    parser->memberNameSlotsUsed = 0;
+    parser->memberNameBytesUsed = 0;
+    parser->pathFramesUsed = 0;
+    parser->pendingLivePathCount = 0;
+    if (parser->pPathFilter)
+    {
+        ResetPathFilterMatches(parser->pPathFilter);
+    }
+    Decoder_Reset(&parser->decoderData);
+    Grammarian_Reset(&parser->grammarianData, 1/* isInitialized */);
+    parser->grammarianData.stackUsed = GET_FLAGS(parser->flags, PARSER_MULTIPLE_DOCUMENTS) ? 0 : 1;
+}
+
+static void JSON_Parser_CopySettings(JSON_Parser parser, JSON_Parser source)
+{
+    /* Copies the settings and handlers that JSON_Parser_Reset() restores
+       to their default values. */
+    parser->userData = source->userData;
+    parser->flags = source->flags;
+    parser->inputEncoding = source->inputEncoding;
+    parser->stringEncoding = source->stringEncoding;
+    parser->numberEncoding = source->numberEncoding;
+    parser->maxStringLength = source->maxStringLength;
+    parser->maxNumberLength = source->maxNumberLength;
+    parser->bufferGrowthPolicy = source->bufferGrowthPolicy;
+    parser->grammarianData.stackUsed = GET_FLAGS(source->flags, PARSER_MULTIPLE_DOCUMENTS) ? 0 : 1;
+    parser->encodingDetectedHandler = source->encodingDetectedHandler;
+    parser->nullHandler = source->nullHandler;
+    parser->booleanHandler = source->booleanHandler;
+    parser->stringHandler = source->stringHandler;
+    parser->numberHandler = source->numberHandler;
+    parser->specialNumberHandler = source->specialNumberHandler;
+    parser->startObjectHandler = source->startObjectHandler;
+    parser->endObjectHandler = source->endObjectHandler;
+    parser->objectMemberHandler = source->objectMemberHandler;
+    parser->startArrayHandler = source->startArrayHandler;
+    parser->endArrayHandler = source->endArrayHandler;
+    parser->arrayItemHandler = source->arrayItemHandler;
+    parser->startDocumentHandler = source->startDocumentHandler;
+    parser->endDocumentHandler = source->endDocumentHandler;
+    parser->stringRefHandler = source->stringRefHandler;
+    parser->numberRefHandler = source->numberRefHandler;
+    parser->objectMemberRefHandler = source->objectMemberRefHandler;
+    parser->internedMemberHandler = source->internedMemberHandler;
+    parser->knownMemberHandler = source->knownMemberHandler;
+    parser->pathMatchHandler = source->pathMatchHandler;
+    parser->int64Handler = source->int64Handler;
+    parser->uint64Handler = source->uint64Handler;
+    parser->doubleHandler = source->doubleHandler;
+}
+
+/* Parser API functions. */
+
+JSON_Parser JSON_CALL JSON_Parser_Create(const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_Parser parser;
+    JSON_MemorySuite memorySuite;
+    if (pMemorySuite)
+    {
+        memorySuite = *pMemorySuite;
+        if (!memorySuite.realloc || !memorySuite.free)
+        {
+            /* The full memory suite must be specified. */
+            return NULL;
+        }
+    }
+    else
+    {
+        memorySuite = defaultMemorySuite;
+    }
+    parser = (JSON_Parser)memorySuite.realloc(memorySuite.userData, NULL, sizeof(struct JSON_Parser_Data));
+    if (!parser)
+    {
+        return NULL;
+    }
+    parser->memorySuite = memorySuite;
+    JSON_Parser_ResetData(parser, 0/* isInitialized */);
+    return parser;
+}
+
+JSON_Parser JSON_CALL JSON_Parser_Clone(JSON_Parser parser, const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_Parser clone;
+    if (!parser)
+    {
+        return NULL;
+    }
+    clone = JSON_Parser_Create(pMemorySuite);
+    if (!clone)
+    {
+        return NULL;
+    }
+    if ((parser->pKnownKeys && !(clone->pKnownKeys = CloneKnownKeys(&clone->memorySuite, parser->pKnownKeys))) ||
+        (parser->pPathFilter && !(clone->pPathFilter = ClonePathFilter(&clone->memorySuite, parser->pPathFilter))))
+    {
+        JSON_Parser_Free(clone);
+        return NULL;
+    }
+    clone->internedKeyCapacity = parser->internedKeyCapacity;
+    clone->keyEvictionPolicy = parser->keyEvictionPolicy;
+    JSON_Parser_CopySettings(clone, parser);
+
+    /* The event batch buffer and the tape belong to the original parser, so
+       the clone gets neither; the client must give it its own. */
+    SET_FLAGS(ParserState, clone->state, PARSER_FILTERING_PATHS | PARSER_OUTSIDE_MATCHED_VALUE, clone->pPathFilter);
+    return clone;
+}
+
+JSON_ParserConfig JSON_CALL JSON_ParserConfig_Create(JSON_Parser parser, const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_Parser templateParser;
+    JSON_ParserConfig config;
+    if (!parser || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API))
+    {
+        return NULL;
+    }
+    templateParser = JSON_Parser_Clone(parser, pMemorySuite);
+    if (!templateParser)
+    {
+        return NULL;
+    }
+    config = (JSON_ParserConfig)templateParser->memorySuite.realloc(templateParser->memorySuite.userData, NULL, sizeof(struct JSON_ParserConfig_Data));
+    if (!config)
+    {
+        JSON_Parser_Free(templateParser);
+        return NULL;
+    }
+    config->templateParser = templateParser;
+    return config;
+}
+
+JSON_Status JSON_CALL JSON_ParserConfig_Free(JSON_ParserConfig config)
+{
+    JSON_MemorySuite memorySuite;
+    if (!config)
+    {
+        return JSON_Failure;
+    }
+    memorySuite = config->templateParser->memorySuite;
+    JSON_Parser_Free(config->templateParser);
+    memorySuite.free(memorySuite.userData, config);
+    return JSON_Success;
+}
+
+JSON_Parser JSON_CALL JSON_Parser_CreateWithConfig(JSON_ParserConfig config, const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_Parser parser;
+    if (!config)
+    {
+        return NULL;
+    }
+    parser = JSON_Parser_Clone(config->templateParser, pMemorySuite);
+    if (parser)
+    {
+        parser->config = config;
+    }
+    return parser;
+}
+
+JSON_ParserPool JSON_CALL JSON_ParserPool_Create(JSON_ParserConfig config, size_t capacity, const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_ParserPool pool;
+    if (!config)
+    {
+        return NULL;
+    }
+    pool = (JSON_ParserPool)InstancePool_Create(pMemorySuite, sizeof(struct JSON_ParserPool_Data), capacity);
+    if (pool)
+    {
+        pool->config = config;
+    }
+    return pool;
+}
+
+JSON_Status JSON_CALL JSON_ParserPool_Free(JSON_ParserPool pool)
+{
+    size_t i;
+    if (!pool || InstancePool_HasAcquiredSlots(&pool->base))
+    {
+        return JSON_Failure;
+    }
+    for (i = 0; i < pool->base.capacity; i++)
+    {
+        JSON_Parser parser = (JSON_Parser)pool->base.pSlots[i].pInstance;
+        if (parser)
+        {
+            parser->pPool = NULL;
+            JSON_Parser_Free(parser);
+        }
+    }
+    InstancePool_Free(&pool->base);
+    return JSON_Success;
+}
+
+JSON_Parser JSON_CALL JSON_ParserPool_Acquire(JSON_ParserPool pool)
+{
+    JSON_Parser parser;
+    size_t slot;
+    if (!pool)
+    {
+        return NULL;
+    }
+    slot = InstancePool_AcquireSlot(&pool->base);
+    if (slot < pool->base.capacity && pool->base.pSlots[slot].pInstance)
+    {
+        return (JSON_Parser)pool->base.pSlots[slot].pInstance;
+    }
+
+    /* When every slot is acquired, the parser is created without a slot,
+       and is freed rather than kept when it is released. */
+    parser = JSON_Parser_CreateWithConfig(pool->config, &pool->base.memorySuite);
+    if (!parser)
+    {
+        if (slot < pool->base.capacity)
+        {
+            InstancePool_ReleaseSlot(&pool->base, slot, NULL);
+        }
+        return NULL;
+    }
+    parser->pPool = &pool->base;
+    parser->poolSlot = slot;
+    if (slot < pool->base.capacity)
+    {
+        pool->base.pSlots[slot].pInstance = parser;
+    }
+    return parser;
+}
+
+JSON_Status JSON_CALL JSON_ParserPool_Release(JSON_ParserPool pool, JSON_Parser parser)
+{
+    if (!pool || !parser || parser->pPool != &pool->base || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API))
+    {
+        return JSON_Failure;
+    }
+    if (parser->poolSlot == pool->base.capacity)
+    {
+        parser->pPool = NULL;
+        return JSON_Parser_Free(parser);
+    }
+    JSON_Parser_Reset(parser);
+    InstancePool_ReleaseSlot(&pool->base, parser->poolSlot, parser);
+    return JSON_Success;
+}
+
+JSON_Status JSON_CALL JSON_Parser_Free(JSON_Parser parser)
+{
+    if (!parser || parser->pPool || parser->reader || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_PROTECTED_API);
+    if (parser->pTokenBytes != parser->defaultTokenBytes)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pTokenBytes);
+    }
+    if (parser->pEventArena)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pEventArena);
+    }
+    JSON_Parser_FreeMemberNameLists(parser);
+    JSON_Parser_FreeInternedKeys(parser);
+    if (parser->pKnownKeys)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pKnownKeys);
+    }
+    if (parser->pPathFilter)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pPathFilter);
+    }
+    if (parser->pPathFrames)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pPathFrames);
+    }
+    if (parser->pLivePaths)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pLivePaths);
+    }
+    Grammarian_FreeAllocations(&parser->grammarianData, &parser->memorySuite);
+    parser->memorySuite.free(parser->memorySuite.userData, parser);
+    return JSON_Success;
+}
+
+JSON_Status JSON_CALL JSON_Parser_Reset(JSON_Parser parser)
+{
+    if (!parser || parser->reader || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_PROTECTED_API);
+    JSON_Parser_ResetData(parser, 1/* isInitialized */);
+    /* Note that JSON_Parser_ResetData() unset PARSER_IN_PROTECTED_API for us. */
+    if (parser->config)
+    {
+        JSON_Parser_CopySettings(parser, parser->config->templateParser);
+    }
+    return JSON_Success;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SaveState(JSON_Parser parser, void* pState, size_t length, size_t* pStateLength)
+{
+    StateWriter writer;
+    JSON_UInt64 checksum;
+    size_t i;
+    if (!pStateLength)
+    {
+        return JSON_Failure;
+    }
+    *pStateLength = 0;
+    if (!parser || parser->tape || parser->reader || GET_FLAGS(parser->state, PARSER_FINISHED | PARSER_IN_PROTECTED_API))
+    {
+        return JSON_Failure;
+    }
+    writer.pBytes = (byte*)pState;
+    writer.length = pState ? length : 0;
+    writer.used = 0;
+    JSON_Parser_WriteState(parser, &writer);
+    *pStateLength = writer.used + STATE_CHECKSUM_LENGTH;
+    if (!pState)
+    {
+        /* The client only wants to know how long the snapshot is. */
+        return JSON_Success;
+    }
+    if (length < STATE_CHECKSUM_LENGTH || writer.used > length - STATE_CHECKSUM_LENGTH)
+    {
+        return JSON_Failure;
+    }
+    checksum = HashState(writer.pBytes, writer.used);
+    for (i = 0; i < STATE_CHECKSUM_LENGTH; i++)
+    {
+        writer.pBytes[writer.used + i] = (byte)(checksum >> (i * 8));
+    }
+    return JSON_Success;
+}
+
+JSON_Status JSON_CALL JSON_Parser_LoadState(JSON_Parser parser, const void* pState, size_t length)
+{
+    StateReader reader;
+    JSON_UInt64 checksum;
+    Encoding inputEncoding;
+    size_t i;
+    if (!parser || !pState || length < STATE_CHECKSUM_LENGTH || parser->tape || parser->reader ||
+        GET_FLAGS(parser->state, PARSER_STARTED | PARSER_IN_PROTECTED_API))
+    {
+        return JSON_Failure;
+    }
+    reader.pBytes = (const byte*)pState;
+    reader.length = length - STATE_CHECKSUM_LENGTH;
+    reader.used = 0;
+    reader.isValid = 1;
+    checksum = HashState(reader.pBytes, reader.length);
+    for (i = 0; i < STATE_CHECKSUM_LENGTH; i++)
+    {
+        if (reader.pBytes[reader.length + i] != (byte)(checksum >> (i * 8)))
+        {
+            return JSON_Failure;
+        }
+    }
+    inputEncoding = parser->inputEncoding;
+    if (!JSON_Parser_ReadState(parser, &reader))
+    {
+        JSON_Parser_DiscardLoadedState(parser, inputEncoding);
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+/* The symbol stack holds two symbols for every open container, and up to
+   two more for the value being parsed. */
+#define SYMBOLS_FOR_DEPTH(depth) ((depth) * 2 + 2)
+
+JSON_Status JSON_CALL JSON_Parser_Reserve(JSON_Parser parser, size_t tokenBytes, size_t depth)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API) ||
+        tokenBytes > SIZE_MAX - LONGEST_ENCODING_SEQUENCE || depth > (SIZE_MAX - 2) / 2)
+    {
+        return JSON_Failure;
+    }
+    if (tokenBytes + LONGEST_ENCODING_SEQUENCE > parser->tokenBytesLength &&
+        !JSON_Parser_ResizeTokenBytes(parser, tokenBytes + LONGEST_ENCODING_SEQUENCE))
+    {
+        return JSON_Failure;
+    }
+    if (SYMBOLS_FOR_DEPTH(depth) > parser->grammarianData.stackSize &&
+        !Grammarian_ResizeStack(&parser->grammarianData, &parser->memorySuite, SYMBOLS_FOR_DEPTH(depth)))
+    {
+        return JSON_Failure;
+    }
+    return JSON_Success;
+}
+
+JSON_Status JSON_CALL JSON_Parser_Trim(JSON_Parser parser, size_t keepBytes)
+{
+    size_t tokenBytesLength;
+    size_t stackSize;
+    if (!parser || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API))
+    {
+        return JSON_Failure;
+    }
+
+    /* Neither buffer is shrunk past what it holds. If the memory suite
+       can't shrink a buffer, the buffer is kept as it is. */
+    tokenBytesLength = parser->tokenBytesUsed + LONGEST_ENCODING_SEQUENCE;
+    if (tokenBytesLength < keepBytes)
+    {
+        tokenBytesLength = keepBytes;
+    }
+    if (tokenBytesLength < parser->tokenBytesLength)
+    {
+        JSON_Parser_ResizeTokenBytes(parser, tokenBytesLength);
+    }
+    stackSize = (parser->grammarianData.stackUsed < keepBytes) ? keepBytes : parser->grammarianData.stackUsed;
+    if (stackSize < parser->grammarianData.stackSize)
+    {
+        Grammarian_ResizeStack(&parser->grammarianData, &parser->memorySuite, stackSize);
+    }
+    parser->tokenBytesHighWaterMark = 0;
+    parser->depthHighWaterMark = parser->depth;
+    return JSON_Success;
+}
+
+size_t JSON_CALL JSON_Parser_GetTokenBytesHighWaterMark(JSON_Parser parser)
+{
+    return parser ? parser->tokenBytesHighWaterMark : 0;
+}
+
+size_t JSON_CALL JSON_Parser_GetDepthHighWaterMark(JSON_Parser parser)
+{
+    return parser ? parser->depthHighWaterMark : 0;
+}
+
+void* JSON_CALL JSON_Parser_GetUserData(JSON_Parser parser)
+{
+    return parser ? parser->userData : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetUserData(JSON_Parser parser, void* userData)
+{
+    if (!parser)
+    {
+        return JSON_Failure;
+    }
+    parser->userData = userData;
+    return JSON_Success;
+}
+
+JSON_Encoding JSON_CALL JSON_Parser_GetInputEncoding(JSON_Parser parser)
+{
+    return parser ? (JSON_Encoding)parser->inputEncoding : JSON_UnknownEncoding;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetInputEncoding(JSON_Parser parser, JSON_Encoding encoding)
+{
+    if (!parser || encoding < JSON_UnknownEncoding || encoding > JSON_UTF32BE || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    parser->inputEncoding = (Encoding)encoding;
+    return JSON_Success;
+}
+
+JSON_Encoding JSON_CALL JSON_Parser_GetStringEncoding(JSON_Parser parser)
+{
+    return parser ? (JSON_Encoding)parser->stringEncoding : JSON_UTF8;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetStringEncoding(JSON_Parser parser, JSON_Encoding encoding)
+{
+    if (!parser || encoding <= JSON_UnknownEncoding || encoding > JSON_UTF32BE || GET_FLAGS(parser->state, PARSER_STARTED) ||
+        (parser->pPathFilter && encoding != JSON_UTF8))
+    {
+        return JSON_Failure;
+    }
+    parser->stringEncoding = (Encoding)encoding;
+    return JSON_Success;
+}
+
+size_t JSON_CALL JSON_Parser_GetMaxStringLength(JSON_Parser parser)
+{
+    return parser ? parser->maxStringLength : SIZE_MAX;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetMaxStringLength(JSON_Parser parser, size_t maxLength)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    parser->maxStringLength = maxLength;
+    return JSON_Success;
+}
+
+JSON_Encoding JSON_CALL JSON_Parser_GetNumberEncoding(JSON_Parser parser)
+{
+    return parser ? (JSON_Encoding)parser->numberEncoding : JSON_UTF8;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetNumberEncoding(JSON_Parser parser, JSON_Encoding encoding)
+{
+    if (!parser || encoding <= JSON_UnknownEncoding || encoding > JSON_UTF32BE || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    parser->numberEncoding = (Encoding)encoding;
+    return JSON_Success;
+}
+
+size_t JSON_CALL JSON_Parser_GetMaxNumberLength(JSON_Parser parser)
+{
+    return parser ? parser->maxNumberLength : SIZE_MAX;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetMaxNumberLength(JSON_Parser parser, size_t maxLength)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    parser->maxNumberLength = maxLength;
+    return JSON_Success;
+}
+
+JSON_BufferGrowthPolicy JSON_CALL JSON_Parser_GetBufferGrowthPolicy(JSON_Parser parser)
+{
+    return parser ? parser->bufferGrowthPolicy : JSON_GrowByDoubling;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetBufferGrowthPolicy(JSON_Parser parser, JSON_BufferGrowthPolicy policy)
+{
+    if (!parser || (policy != JSON_GrowByDoubling && policy != JSON_GrowByHalf) || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    parser->bufferGrowthPolicy = policy;
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetAllowBOM(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_BOM)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetAllowBOM(JSON_Parser parser, JSON_Boolean allowBOM)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_BOM, allowBOM);
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetAllowComments(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_COMMENTS)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetAllowComments(JSON_Parser parser, JSON_Boolean allowComments)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_COMMENTS, allowComments);
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetAllowSpecialNumbers(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetAllowSpecialNumbers(JSON_Parser parser, JSON_Boolean allowSpecialNumbers)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS, allowSpecialNumbers);
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetAllowHexNumbers(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_HEX_NUMBERS)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetAllowHexNumbers(JSON_Parser parser, JSON_Boolean allowHexNumbers)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_HEX_NUMBERS, allowHexNumbers);
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetAllowUnescapedControlCharacters(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_CONTROL_CHARS)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetAllowUnescapedControlCharacters(JSON_Parser parser, JSON_Boolean allowUnescapedControlCharacters)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_CONTROL_CHARS, allowUnescapedControlCharacters);
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetReplaceInvalidEncodingSequences(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_REPLACE_INVALID)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetReplaceInvalidEncodingSequences(JSON_Parser parser, JSON_Boolean replaceInvalidEncodingSequences)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_REPLACE_INVALID, replaceInvalidEncodingSequences);
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetTrackObjectMembers(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetTrackObjectMembers(JSON_Parser parser, JSON_Boolean trackObjectMembers)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_TRACK_OBJECT_MEMBERS, trackObjectMembers);
+    return JSON_Success;
+}
 
-    case LEXING_NUMBER_AFTER_X:
-        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))
-        {
-            codepointToRecord = c;
-            parser->lexerState = LEXING_NUMBER_HEX_DIGITS;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 1, JSON_IsHex))
-        {
-            return JSON_Failure;
-        }
-        goto advance;
+size_t JSON_CALL JSON_Parser_GetInternedKeyCapacity(JSON_Parser parser)
+{
+    return parser ? parser->internedKeyCapacity : 0;
+}
 
-    case LEXING_NUMBER_HEX_DIGITS:
-        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))
-        {
-            codepointToRecord = c;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else
-        {
-            /* The number is finished. */
-            if (!JSON_Parser_ProcessToken(parser))
-            {
-                return JSON_Failure;
-            }
-            goto reprocess;
-        }
-        goto advance;
+JSON_Status JSON_CALL JSON_Parser_SetInternedKeyCapacity(JSON_Parser parser, size_t capacity)
+{
+    if (!parser || capacity == NO_INTERNED_KEY || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    if (capacity != parser->internedKeyCapacity)
+    {
+        JSON_Parser_FreeInternedKeys(parser);
+        parser->internedKeyCapacity = capacity;
+    }
+    return JSON_Success;
+}
 
-    case LEXING_NUMBER_DECIMAL_DIGITS:
-        if (c >= '0' && c <= '9')
-        {
-            codepointToRecord = c;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (c == '.')
-        {
-            codepointToRecord = '.';
-            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsDecimalPoint);
-            parser->lexerState = LEXING_NUMBER_AFTER_DOT;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (c == 'e' || c == 'E')
-        {
-            codepointToRecord = c;
-            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsExponent);
-            parser->lexerState = LEXING_NUMBER_AFTER_E;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else
+size_t JSON_CALL JSON_Parser_GetKnownKeyCount(JSON_Parser parser)
+{
+    return (parser && parser->pKnownKeys) ? parser->pKnownKeys->keyCount : 0;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetKnownKeys(JSON_Parser parser, const char* const* ppKeys, const size_t* pLengths, size_t keyCount)
+{
+    KnownKeys* pKnownKeys = NULL;
+    if (!parser || (keyCount && !ppKeys) || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    if (keyCount)
+    {
+        size_t i;
+        for (i = 0; i < keyCount; i++)
         {
-            /* The number is finished. */
-            if (!JSON_Parser_ProcessToken(parser))
+            if (!ppKeys[i])
             {
                 return JSON_Failure;
             }
-            goto reprocess;
-        }
-        goto advance;
-
-    case LEXING_NUMBER_AFTER_DOT:
-        if (c >= '0' && c <= '9')
-        {
-            codepointToRecord = c;
-            parser->lexerState = LEXING_NUMBER_FRACTIONAL_DIGITS;
-            goto recordNumberCodepointAndAdvance;
         }
-        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 1, JSON_ContainsDecimalPoint))
+        pKnownKeys = CompileKnownKeys(&parser->memorySuite, ppKeys, pLengths, keyCount);
+        if (!pKnownKeys)
         {
             return JSON_Failure;
         }
-        goto advance;
+    }
+    if (parser->pKnownKeys)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pKnownKeys);
+    }
+    parser->pKnownKeys = pKnownKeys;
+    return JSON_Success;
+}
 
-    case LEXING_NUMBER_FRACTIONAL_DIGITS:
-        if (c >= '0' && c <= '9')
-        {
-            codepointToRecord = c;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (c == 'e' || c == 'E')
-        {
-            codepointToRecord = c;
-            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsExponent);
-            parser->lexerState = LEXING_NUMBER_AFTER_E;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else
-        {
-            /* The number is finished. */
-            if (!JSON_Parser_ProcessToken(parser))
-            {
-                return JSON_Failure;
-            }
-            goto reprocess;
-        }
-        goto advance;
+size_t JSON_CALL JSON_Parser_GetPathFilterCount(JSON_Parser parser)
+{
+    return (parser && parser->pPathFilter) ? parser->pPathFilter->pathCount : 0;
+}
 
-    case LEXING_NUMBER_AFTER_E:
-        if (c == '+')
-        {
-            codepointToRecord = c;
-            parser->lexerState = LEXING_NUMBER_AFTER_EXPONENT_SIGN;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (c == '-')
-        {
-            codepointToRecord = c;
-            SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNegativeExponent);
-            parser->lexerState = LEXING_NUMBER_AFTER_EXPONENT_SIGN;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (c >= '0' && c <= '9')
-        {
-            codepointToRecord = c;
-            parser->lexerState = LEXING_NUMBER_EXPONENT_DIGITS;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 1, JSON_ContainsExponent))
+JSON_Status JSON_CALL JSON_Parser_SetPathFilter(JSON_Parser parser, const char* const* ppPaths, size_t pathCount)
+{
+    PathFilter* pPathFilter = NULL;
+    if (!parser || (pathCount && (!ppPaths || parser->stringEncoding != JSON_UTF8)) || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    if (pathCount)
+    {
+        pPathFilter = CompilePathFilter(&parser->memorySuite, ppPaths, pathCount);
+        if (!pPathFilter)
         {
             return JSON_Failure;
         }
-        goto advance;
+    }
+    if (parser->pPathFilter)
+    {
+        parser->memorySuite.free(parser->memorySuite.userData, parser->pPathFilter);
+    }
+    parser->pPathFilter = pPathFilter;
+    SET_FLAGS(ParserState, parser->state, PARSER_FILTERING_PATHS | PARSER_OUTSIDE_MATCHED_VALUE, pPathFilter);
+    return JSON_Success;
+}
 
-    case LEXING_NUMBER_AFTER_EXPONENT_SIGN:
-        if (c >= '0' && c <= '9')
-        {
-            codepointToRecord = c;
-            parser->lexerState = LEXING_NUMBER_EXPONENT_DIGITS;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else if (!JSON_Parser_HandleInvalidNumber(parser, c, 2, JSON_ContainsExponent | JSON_ContainsNegativeExponent))
-        {
-            return JSON_Failure;
-        }
-        goto advance;
+JSON_Boolean JSON_CALL JSON_Parser_GetMatchedAllPaths(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->state, PARSER_MATCHED_ALL_PATHS)) ? JSON_True : JSON_False;
+}
 
-    case LEXING_NUMBER_EXPONENT_DIGITS:
-        if (c >= '0' && c <= '9')
-        {
-            codepointToRecord = c;
-            goto recordNumberCodepointAndAdvance;
-        }
-        else
-        {
-            /* The number is finished. */
-            if (!JSON_Parser_ProcessToken(parser))
-            {
-                return JSON_Failure;
-            }
-            goto reprocess;
-        }
-        goto advance;
+JSON_Boolean JSON_CALL JSON_Parser_GetSkipUnknownMembers(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_SKIP_UNKNOWN_MEMBERS)) ? JSON_True : JSON_False;
+}
 
-    case LEXING_COMMENT_AFTER_SLASH:
-        if (c == '/')
-        {
-            parser->lexerState = LEXING_SINGLE_LINE_COMMENT;
-        }
-        else if (c == '*')
-        {
-            parser->lexerState = LEXING_MULTI_LINE_COMMENT;
-        }
-        else
-        {
-            JSON_Parser_SetErrorAtToken(parser, JSON_Error_UnknownToken);
-            return JSON_Failure;
-        }
-        goto advance;
+JSON_Status JSON_CALL JSON_Parser_SetSkipUnknownMembers(JSON_Parser parser, JSON_Boolean skipUnknownMembers)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_SKIP_UNKNOWN_MEMBERS, skipUnknownMembers);
+    return JSON_Success;
+}
 
-    case LEXING_SINGLE_LINE_COMMENT:
-        if (c == CARRIAGE_RETURN_CODEPOINT || c == LINE_FEED_CODEPOINT || c == EOF_CODEPOINT)
-        {
-            parser->lexerState = LEXING_WHITESPACE;
-        }
-        goto advance;
+JSON_KeyEvictionPolicy JSON_CALL JSON_Parser_GetKeyEvictionPolicy(JSON_Parser parser)
+{
+    return parser ? parser->keyEvictionPolicy : JSON_EvictLeastRecentlyUsed;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetKeyEvictionPolicy(JSON_Parser parser, JSON_KeyEvictionPolicy policy)
+{
+    if (!parser || (policy != JSON_EvictLeastRecentlyUsed && policy != JSON_EvictNone) || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    parser->keyEvictionPolicy = policy;
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetStopAfterEmbeddedDocument(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetStopAfterEmbeddedDocument(JSON_Parser parser, JSON_Boolean stopAfterEmbeddedDocument)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_EMBEDDED_DOCUMENT, stopAfterEmbeddedDocument);
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetAllowMultipleDocuments(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_MULTIPLE_DOCUMENTS)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetAllowMultipleDocuments(JSON_Parser parser, JSON_Boolean allowMultipleDocuments)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_MULTIPLE_DOCUMENTS, allowMultipleDocuments);
+
+    /* In multi-document mode, the grammarian starts out as if it had
+       finished a document, so that the first token starts one. */
+    parser->grammarianData.stackUsed = allowMultipleDocuments ? 0 : 1;
+    return JSON_Success;
+}
+
+JSON_Boolean JSON_CALL JSON_Parser_GetAllowArraySegment(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_ARRAY_SEGMENT)) ? JSON_True : JSON_False;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetAllowArraySegment(JSON_Parser parser, JSON_Boolean allowArraySegment)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
+    }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_ARRAY_SEGMENT, allowArraySegment);
+    return JSON_Success;
+}
 
-    case LEXING_MULTI_LINE_COMMENT:
-        if (c == '*')
-        {
-            parser->lexerState = LEXING_MULTI_LINE_COMMENT_AFTER_STAR;
-        }
-        goto advance;
+JSON_Boolean JSON_CALL JSON_Parser_GetTrackLocationsLazily(JSON_Parser parser)
+{
+    return (parser && GET_FLAGS(parser->flags, PARSER_LAZY_LOCATIONS)) ? JSON_True : JSON_False;
+}
 
-    case LEXING_MULTI_LINE_COMMENT_AFTER_STAR:
-        if (c == '/')
-        {
-            parser->lexerState = LEXING_WHITESPACE;
-        }
-        else if (c != '*')
-        {
-            parser->lexerState = LEXING_MULTI_LINE_COMMENT;
-        }
-        goto advance;
+JSON_Status JSON_CALL JSON_Parser_SetTrackLocationsLazily(JSON_Parser parser, JSON_Boolean trackLocationsLazily)
+{
+    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    {
+        return JSON_Failure;
     }
+    SET_FLAGS(ParserFlags, parser->flags, PARSER_LAZY_LOCATIONS, trackLocationsLazily);
+    return JSON_Success;
+}
 
-recordStringCodepointAndAdvance:
+JSON_Error JSON_CALL JSON_Parser_GetError(JSON_Parser parser)
+{
+    return parser ? (JSON_Error)parser->error : JSON_Error_None;
+}
 
-    tokenEncoding = parser->stringEncoding;
-    maxTokenLength = parser->maxStringLength;
-    if (!codepointToRecord)
+JSON_Status JSON_CALL JSON_Parser_GetErrorLocation(JSON_Parser parser, JSON_Location* pLocation)
+{
+    if (!pLocation || !parser || parser->error == JSON_Error_None)
     {
-        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNullCharacter | JSON_ContainsControlCharacter);
+        return JSON_Failure;
     }
-    else if (codepointToRecord < FIRST_NON_CONTROL_CODEPOINT)
+    if (parser->errorOffset == ERROR_LOCATION_IS_TOKEN_START)
     {
-        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsControlCharacter);
+        pLocation->byte = parser->tokenLocationByte;
+        pLocation->line = parser->tokenLocationLine;
+        pLocation->column = parser->tokenLocationColumn;
     }
-    else if (codepointToRecord >= FIRST_NON_BMP_CODEPOINT)
+    else
     {
-        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNonASCIICharacter | JSON_ContainsNonBMPCharacter);
+        pLocation->byte = parser->codepointLocationByte - (SHORTEST_ENCODING_SEQUENCE(parser->inputEncoding) * parser->errorOffset);
+        pLocation->line = parser->codepointLocationLine;
+        pLocation->column = parser->codepointLocationColumn - parser->errorOffset;
     }
-    else if (codepointToRecord >= FIRST_NON_ASCII_CODEPOINT)
+    pLocation->depth = parser->depth;
+    return JSON_Success;
+}
+
+JSON_Status JSON_CALL JSON_Parser_GetTokenLocation(JSON_Parser parser, JSON_Location* pLocation)
+{
+    if (!parser || !pLocation || !GET_FLAGS(parser->state, PARSER_IN_TOKEN_HANDLER))
     {
-        SET_FLAGS_ON(TokenAttributes, parser->tokenAttributes, JSON_ContainsNonASCIICharacter);
+        return JSON_Failure;
     }
-    goto recordCodepointAndAdvance;
+    if (GET_FLAGS(parser->flags, PARSER_LAZY_LOCATIONS))
+    {
+        JSON_Parser_UpdateLazyLocation(parser, parser->codepointLocationByte);
+    }
+    pLocation->byte = parser->tokenLocationByte;
+    pLocation->line = parser->tokenLocationLine;
+    pLocation->column = parser->tokenLocationColumn;
+    pLocation->depth = parser->depth;
+    return JSON_Success;
+}
 
-recordNumberCodepointAndAdvance:
+JSON_Status JSON_CALL JSON_Parser_GetAfterTokenLocation(JSON_Parser parser, JSON_Location* pLocation)
+{
+    if (!parser || !pLocation || !GET_FLAGS(parser->state, PARSER_IN_TOKEN_HANDLER))
+    {
+        return JSON_Failure;
+    }
+    if (GET_FLAGS(parser->flags, PARSER_LAZY_LOCATIONS))
+    {
+        JSON_Parser_UpdateLazyLocation(parser, parser->codepointLocationByte);
+    }
+    pLocation->byte = parser->codepointLocationByte;
+    pLocation->line = parser->codepointLocationLine;
+    pLocation->column = parser->codepointLocationColumn;
+    pLocation->depth = parser->depth;
+    return JSON_Success;
+}
 
-    tokenEncoding = parser->numberEncoding;
-    maxTokenLength = parser->maxNumberLength;
-    goto recordCodepointAndAdvance;
+JSON_Parser_NullHandler JSON_CALL JSON_Parser_GetEncodingDetectedHandler(JSON_Parser parser)
+{
+    return parser ? parser->encodingDetectedHandler : NULL;
+}
 
-recordCodepointAndAdvance:
+JSON_Status JSON_CALL JSON_Parser_SetEncodingDetectedHandler(JSON_Parser parser, JSON_Parser_EncodingDetectedHandler handler)
+{
+    if (!parser)
+    {
+        return JSON_Failure;
+    }
+    parser->encodingDetectedHandler = handler;
+    return JSON_Success;
+}
 
-    /* We always ensure that there are LONGEST_ENCODING_SEQUENCE bytes
-       available in the buffer for the next codepoint, so we don't have to
-       check whether there is room when we decode a new codepoint, and if
-       there isn't another codepoint, we have space already allocated for
-       the encoded null terminator.*/
-    parser->tokenBytesUsed += EncodeCodepoint(codepointToRecord, tokenEncoding, parser->pTokenBytes + parser->tokenBytesUsed);
-    if (parser->tokenBytesUsed > maxTokenLength)
+JSON_Parser_NullHandler JSON_CALL JSON_Parser_GetNullHandler(JSON_Parser parser)
+{
+    return parser ? parser->nullHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetNullHandler(JSON_Parser parser, JSON_Parser_NullHandler handler)
+{
+    if (!parser)
+    {
+        return JSON_Failure;
+    }
+    parser->nullHandler = handler;
+    return JSON_Success;
+}
+
+JSON_Parser_BooleanHandler JSON_CALL JSON_Parser_GetBooleanHandler(JSON_Parser parser)
+{
+    return parser ? parser->booleanHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetBooleanHandler(JSON_Parser parser, JSON_Parser_BooleanHandler handler)
+{
+    if (!parser)
     {
-        JSON_Parser_SetErrorAtToken(parser, parser->token == T_NUMBER ? JSON_Error_TooLongNumber : JSON_Error_TooLongString);
         return JSON_Failure;
     }
-    if (parser->tokenBytesUsed > parser->tokenBytesLength - LONGEST_ENCODING_SEQUENCE)
+    parser->booleanHandler = handler;
+    return JSON_Success;
+}
+
+JSON_Parser_StringHandler JSON_CALL JSON_Parser_GetStringHandler(JSON_Parser parser)
+{
+    return parser ? parser->stringHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetStringHandler(JSON_Parser parser, JSON_Parser_StringHandler handler)
+{
+    if (!parser)
     {
-        byte* pBiggerBuffer = DoubleBuffer(&parser->memorySuite, parser->defaultTokenBytes, parser->pTokenBytes, parser->tokenBytesLength);
-        if (!pBiggerBuffer)
-        {
-            JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_OutOfMemory);
-            return JSON_Failure;
-        }
-        parser->pTokenBytes = pBiggerBuffer;
-        parser->tokenBytesLength *= 2;
+        return JSON_Failure;
     }
-    goto advance;
+    parser->stringHandler = handler;
+    return JSON_Success;
+}
 
-advance:
+JSON_Parser_NumberHandler JSON_CALL JSON_Parser_GetNumberHandler(JSON_Parser parser)
+{
+    return parser ? parser->numberHandler : NULL;
+}
 
-    /* The current codepoint has been accepted, so advance the codepoint
-       location counters accordingly. Note that the one time we don't
-       do this is when the codepoint is EOF, which doesn't actually
-       appear in the input stream. */
-    if (c == CARRIAGE_RETURN_CODEPOINT)
+JSON_Status JSON_CALL JSON_Parser_SetNumberHandler(JSON_Parser parser, JSON_Parser_NumberHandler handler)
+{
+    if (!parser)
     {
-        SET_FLAGS_ON(ParserState, parser->state, PARSER_AFTER_CARRIAGE_RETURN);
+        return JSON_Failure;
     }
-    if (c != EOF_CODEPOINT)
+    parser->numberHandler = handler;
+    return JSON_Success;
+}
+
+JSON_Parser_SpecialNumberHandler JSON_CALL JSON_Parser_GetSpecialNumberHandler(JSON_Parser parser)
+{
+    return parser ? parser->specialNumberHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetSpecialNumberHandler(JSON_Parser parser, JSON_Parser_SpecialNumberHandler handler)
+{
+    if (!parser)
     {
-        parser->codepointLocationByte += encodedLength;
-        if (c == CARRIAGE_RETURN_CODEPOINT || c == LINE_FEED_CODEPOINT)
-        {
-            /* The next character will begin a new line. */
-            parser->codepointLocationLine++;
-            parser->codepointLocationColumn = 0;
-        }
-        else
-        {
-            /* The next character will be on the same line. */
-            parser->codepointLocationColumn++;
-        }
+        return JSON_Failure;
     }
+    parser->specialNumberHandler = handler;
+    return JSON_Success;
+}
 
-    if (tokenFinished && !JSON_Parser_ProcessToken(parser))
+JSON_Parser_StartObjectHandler JSON_CALL JSON_Parser_GetStartObjectHandler(JSON_Parser parser)
+{
+    return parser ? parser->startObjectHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetStartObjectHandler(JSON_Parser parser, JSON_Parser_StartObjectHandler handler)
+{
+    if (!parser)
     {
         return JSON_Failure;
     }
+    parser->startObjectHandler = handler;
+    return JSON_Success;
+}
 
+JSON_Parser_EndObjectHandler JSON_CALL JSON_Parser_GetEndObjectHandler(JSON_Parser parser)
+{
+    return parser ? parser->endObjectHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetEndObjectHandler(JSON_Parser parser, JSON_Parser_EndObjectHandler handler)
+{
+    if (!parser)
+    {
+        return JSON_Failure;
+    }
+    parser->endObjectHandler = handler;
     return JSON_Success;
 }
 
-static JSON_Status JSON_Parser_FlushLexer(JSON_Parser parser)
+JSON_Parser_ObjectMemberHandler JSON_CALL JSON_Parser_GetObjectMemberHandler(JSON_Parser parser)
 {
-    /* Push the EOF codepoint to the lexer so that it can finish the pending
-       token, if any. The EOF codepoint is never emitted by the decoder
-       itself, since it is outside the Unicode range and therefore cannot
-       be encoded in any of the possible input encodings. */
-    if (!JSON_Parser_ProcessCodepoint(parser, EOF_CODEPOINT, 0))
+    return parser ? parser->objectMemberHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetObjectMemberHandler(JSON_Parser parser, JSON_Parser_ObjectMemberHandler handler)
+{
+    if (!parser)
+    {
+        return JSON_Failure;
+    }
+    parser->objectMemberHandler = handler;
+    return JSON_Success;
+}
+
+JSON_Parser_StartArrayHandler JSON_CALL JSON_Parser_GetStartArrayHandler(JSON_Parser parser)
+{
+    return parser ? parser->startArrayHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetStartArrayHandler(JSON_Parser parser, JSON_Parser_StartArrayHandler handler)
+{
+    if (!parser)
     {
         return JSON_Failure;
     }
+    parser->startArrayHandler = handler;
+    return JSON_Success;
+}
+
+JSON_Parser_EndArrayHandler JSON_CALL JSON_Parser_GetEndArrayHandler(JSON_Parser parser)
+{
+    return parser ? parser->endArrayHandler : NULL;
+}
 
-    /* The lexer should be idle when parsing finishes. */
-    if (parser->lexerState != LEXING_WHITESPACE)
+JSON_Status JSON_CALL JSON_Parser_SetEndArrayHandler(JSON_Parser parser, JSON_Parser_EndArrayHandler handler)
+{
+    if (!parser)
     {
-        JSON_Parser_SetErrorAtToken(parser, JSON_Error_IncompleteToken);
         return JSON_Failure;
     }
+    parser->endArrayHandler = handler;
     return JSON_Success;
 }
 
-/* Parser's decoder functions. */
+JSON_Parser_ArrayItemHandler JSON_CALL JSON_Parser_GetArrayItemHandler(JSON_Parser parser)
+{
+    return parser ? parser->arrayItemHandler : NULL;
+}
 
-static JSON_Status JSON_Parser_CallEncodingDetectedHandler(JSON_Parser parser)
+JSON_Status JSON_CALL JSON_Parser_SetArrayItemHandler(JSON_Parser parser, JSON_Parser_ArrayItemHandler handler)
 {
-    if (parser->encodingDetectedHandler && parser->encodingDetectedHandler(parser) != JSON_Parser_Continue)
+    if (!parser)
     {
-        JSON_Parser_SetErrorAtCodepoint(parser, JSON_Error_AbortedByHandler);
         return JSON_Failure;
     }
+    parser->arrayItemHandler = handler;
     return JSON_Success;
 }
 
-/* Forward declaration. */
-static JSON_Status JSON_Parser_ProcessInputBytes(JSON_Parser parser, const byte* pBytes, size_t length);
-
-static JSON_Status JSON_Parser_ProcessUnknownByte(JSON_Parser parser, byte b)
+JSON_Parser_StartDocumentHandler JSON_CALL JSON_Parser_GetStartDocumentHandler(JSON_Parser parser)
 {
-    /* When the input encoding is unknown, the first 4 bytes of input are
-       recorded in decoder.bits. */
+    return parser ? parser->startDocumentHandler : NULL;
+}
 
-    byte bytes[LONGEST_ENCODING_SEQUENCE];
-    switch (parser->decoderData.state)
+JSON_Status JSON_CALL JSON_Parser_SetStartDocumentHandler(JSON_Parser parser, JSON_Parser_StartDocumentHandler handler)
+{
+    if (!parser)
     {
-    case DECODER_RESET:
-        parser->decoderData.state = DECODED_1_OF_4;
-        parser->decoderData.bits = (uint32_t)b << 24;
-        break;
-
-    case DECODED_1_OF_4:
-        parser->decoderData.state = DECODED_2_OF_4;
-        parser->decoderData.bits |= (uint32_t)b << 16;
-        break;
-
-    case DECODED_2_OF_4:
-        parser->decoderData.state = DECODED_3_OF_4;
-        parser->decoderData.bits |= (uint32_t)b << 8;
-        break;
-
-    case DECODED_3_OF_4:
-        bytes[0] = (byte)(parser->decoderData.bits >> 24);
-        bytes[1] = (byte)(parser->decoderData.bits >> 16);
-        bytes[2] = (byte)(parser->decoderData.bits >> 8);
-        bytes[3] = (byte)(b);
-
-        /* We try to match the following patterns in order, where .. is any
-           byte value and nz is any non-zero byte value:
-              EF BB BF .. => UTF-8 with BOM
-              FF FE 00 00 => UTF-32LE with BOM
-              FF FE nz 00 => UTF-16LE with BOM
-              00 00 FE FF -> UTF-32BE with BOM
-              FE FF .. .. => UTF-16BE with BOM
-              nz nz .. .. => UTF-8
-              nz 00 nz .. => UTF-16LE
-              nz 00 00 00 => UTF-32LE
-              00 nz .. .. => UTF-16BE
-              00 00 00 nz => UTF-32BE
-              .. .. .. .. => unknown encoding */
-        if (bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF)
-        {
-            /* EF BB BF .. */
-            parser->inputEncoding = JSON_UTF8;
-        }
-        else if (bytes[0] == 0xFF && bytes[1] == 0xFE && bytes[3] == 0x00)
-        {
-            /* FF FE 00 00 or
-               FF FE nz 00 */
-            parser->inputEncoding = (bytes[2] == 0x00) ? JSON_UTF32LE : JSON_UTF16LE;
-        }
-        else if (bytes[0] == 0x00 && bytes[1] == 0x00 && bytes[2] == 0xFE && bytes[3] == 0xFF)
-        {
-            /* 00 00 FE FF */
-            parser->inputEncoding = JSON_UTF32BE;
-        }
-        else if (bytes[0] == 0xFE && bytes[1] == 0xFF)
-        {
-            /* FE FF .. .. */
-            parser->inputEncoding = JSON_UTF16BE;
-        }
-        else if (bytes[0] != 0x00)
-        {
-            /* nz .. .. .. */
-            if (bytes[1] != 0x00)
-            {
-                /* nz nz .. .. */
-                parser->inputEncoding = JSON_UTF8;
-            }
-            else if (bytes[2] != 0x00)
-            {
-                /* nz 00 nz .. */
-                parser->inputEncoding = JSON_UTF16LE;
-            }
-            else if (bytes[3] == 0x00)
-            {
-                /* nz 00 00 00 */
-                parser->inputEncoding = JSON_UTF32LE;
-            }
-            else
-            {
-                /* nz 00 00 nz => error */
-            }
-        }
-        else if (bytes[1] != 0x00)
-        {
-            /* 00 nz .. .. */
-            parser->inputEncoding = JSON_UTF16BE;
-        }
-        else if (bytes[2] == 0x00 && bytes[3] != 0x00)
-        {
-            /* 00 00 00 nz */
-            parser->inputEncoding = JSON_UTF32BE;
-        }
-        else
-        {
-            /* 00 00 nz .. or
-               00 00 00 00 => error */
-        }
-
-        if (parser->inputEncoding == JSON_UnknownEncoding)
-        {
-            return JSON_Parser_HandleInvalidEncodingSequence(parser, 4);
-        }
-
-        if (!JSON_Parser_CallEncodingDetectedHandler(parser))
-        {
-            return JSON_Failure;
-        }
-
-        /* Reset the decoder before reprocessing the bytes. */
-        Decoder_Reset(&parser->decoderData);
-        return JSON_Parser_ProcessInputBytes(parser, bytes, 4);
+        return JSON_Failure;
     }
-
-    /* We don't have 4 bytes yet. */
+    parser->startDocumentHandler = handler;
     return JSON_Success;
 }
 
-JSON_Status JSON_Parser_ProcessInputBytes(JSON_Parser parser, const byte* pBytes, size_t length)
+JSON_Parser_EndDocumentHandler JSON_CALL JSON_Parser_GetEndDocumentHandler(JSON_Parser parser)
 {
-    /* Note that if length is 0, pBytes is allowed to be NULL. */
-    size_t i = 0;
-    while (parser->inputEncoding == JSON_UnknownEncoding && i < length)
-    {
-        if (!JSON_Parser_ProcessUnknownByte(parser, pBytes[i]))
-        {
-            return JSON_Failure;
-        }
-        i++;
-    }
-    while (i < length)
-    {
-        DecoderOutput output = Decoder_ProcessByte(&parser->decoderData, parser->inputEncoding, pBytes[i]);
-        DecoderResultCode result = DECODER_RESULT_CODE(output);
-        switch (result)
-        {
-        case SEQUENCE_PENDING:
-            i++;
-            break;
-
-        case SEQUENCE_COMPLETE:
-            if (!JSON_Parser_ProcessCodepoint(parser, DECODER_CODEPOINT(output), DECODER_SEQUENCE_LENGTH(output)))
-            {
-                return JSON_Failure;
-            }
-            i++;
-            break;
+    return parser ? parser->endDocumentHandler : NULL;
+}
 
-        case SEQUENCE_INVALID_INCLUSIVE:
-            i++;
-            /* fallthrough */
-        case SEQUENCE_INVALID_EXCLUSIVE:
-            if (!JSON_Parser_HandleInvalidEncodingSequence(parser, DECODER_SEQUENCE_LENGTH(output)))
-            {
-                return JSON_Failure;
-            }
-            break;
-        }
+JSON_Status JSON_CALL JSON_Parser_SetEndDocumentHandler(JSON_Parser parser, JSON_Parser_EndDocumentHandler handler)
+{
+    if (!parser)
+    {
+        return JSON_Failure;
     }
+    parser->endDocumentHandler = handler;
     return JSON_Success;
 }
 
-static JSON_Status JSON_Parser_FlushDecoder(JSON_Parser parser)
+JSON_Parser_StringRefHandler JSON_CALL JSON_Parser_GetStringRefHandler(JSON_Parser parser)
 {
-    /* If the input was 1, 2, or 3 bytes long, and the input encoding was not
-       explicitly specified by the client, we can sometimes make a reasonable
-       guess. If the input was 1 or 3 bytes long, the only encoding that could
-       possibly be valid JSON is UF-8. If the input was 2 bytes long, we try
-       to match the following patterns in order, where .. is any byte value
-       and nz is any non-zero byte value:
-         FF FE => UTF-16LE with BOM
-         FE FF => UTF-16BE with BOM
-         nz nz => UTF-8
-         nz 00 => UTF-16LE
-         00 nz => UTF-16BE
-         .. .. => unknown encoding
-    */
-    if (parser->inputEncoding == JSON_UnknownEncoding &&
-        parser->decoderData.state != DECODER_RESET)
-    {
-        byte bytes[3];
-        size_t length = 0;
-        bytes[0] = (byte)(parser->decoderData.bits >> 24);
-        bytes[1] = (byte)(parser->decoderData.bits >> 16);
-        bytes[2] = (byte)(parser->decoderData.bits >> 8);
-        switch (parser->decoderData.state)
-        {
-        case DECODED_1_OF_4:
-            parser->inputEncoding = JSON_UTF8;
-            length = 1;
-            break;
-
-        case DECODED_2_OF_4:
-            if (bytes[0] == 0xFF && bytes[1] == 0xFE)
-            {
-                /* FF FE */
-                parser->inputEncoding = JSON_UTF16LE;
-            }
-            else if (bytes[0] == 0xFE && bytes[1] == 0xFF)
-            {
-                /* FE FF */
-                parser->inputEncoding = JSON_UTF16BE;
-            }
-            else if (bytes[0] != 0x00)
-            {
-                /* nz nz or
-                   nz 00 */
-                parser->inputEncoding = bytes[1] ? JSON_UTF8 : JSON_UTF16LE;
-            }
-            else if (bytes[1] != 0x00)
-            {
-                /* 00 nz */
-                parser->inputEncoding = JSON_UTF16BE;
-            }
-            else
-            {
-                /* 00 00 */
-                return JSON_Parser_HandleInvalidEncodingSequence(parser, 2);
-            }
-            length = 2;
-            break;
-
-        case DECODED_3_OF_4:
-            parser->inputEncoding = JSON_UTF8;
-            length = 3;
-            break;
-        }
-
-        if (!JSON_Parser_CallEncodingDetectedHandler(parser))
-        {
-            return JSON_Failure;
-        }
-
-        /* Reset the decoder before reprocessing the bytes. */
-        parser->decoderData.state = DECODER_RESET;
-        parser->decoderData.bits = 0;
-        if (!JSON_Parser_ProcessInputBytes(parser, bytes, length))
-        {
-            return JSON_Failure;
-        }
-    }
+    return parser ? parser->stringRefHandler : NULL;
+}
 
-    /* The decoder should be idle when parsing finishes. */
-    if (Decoder_SequencePending(&parser->decoderData))
+JSON_Status JSON_CALL JSON_Parser_SetStringRefHandler(JSON_Parser parser, JSON_Parser_StringRefHandler handler)
+{
+    if (!parser)
     {
-        return JSON_Parser_HandleInvalidEncodingSequence(parser, DECODER_STATE_BYTES(parser->decoderData.state));
+        return JSON_Failure;
     }
+    parser->stringRefHandler = handler;
     return JSON_Success;
 }
 
-/* Parser API functions. */
+JSON_Parser_NumberRefHandler JSON_CALL JSON_Parser_GetNumberRefHandler(JSON_Parser parser)
+{
+    return parser ? parser->numberRefHandler : NULL;
+}
 
-JSON_Parser JSON_CALL JSON_Parser_Create(const JSON_MemorySuite* pMemorySuite)
+JSON_Status JSON_CALL JSON_Parser_SetNumberRefHandler(JSON_Parser parser, JSON_Parser_NumberRefHandler handler)
 {
-    JSON_Parser parser;
-    JSON_MemorySuite memorySuite;
-    if (pMemorySuite)
-    {
-        memorySuite = *pMemorySuite;
-        if (!memorySuite.realloc || !memorySuite.free)
-        {
-            /* The full memory suite must be specified. */
-            return NULL;
-        }
-    }
-    else
-    {
-        memorySuite = defaultMemorySuite;
-    }
-    parser = (JSON_Parser)memorySuite.realloc(memorySuite.userData, NULL, sizeof(struct JSON_Parser_Data));
     if (!parser)
     {
-        return NULL;
+        return JSON_Failure;
     }
-    parser->memorySuite = memorySuite;
-    JSON_Parser_ResetData(parser, 0/* isInitialized */);
-    return parser;
+    parser->numberRefHandler = handler;
+    return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_Free(JSON_Parser parser)
+JSON_Parser_ObjectMemberRefHandler JSON_CALL JSON_Parser_GetObjectMemberRefHandler(JSON_Parser parser)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API))
+    return parser ? parser->objectMemberRefHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetObjectMemberRefHandler(JSON_Parser parser, JSON_Parser_ObjectMemberRefHandler handler)
+{
+    if (!parser)
     {
         return JSON_Failure;
     }
-    SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_PROTECTED_API);
-    if (parser->pTokenBytes != parser->defaultTokenBytes)
-    {
-        parser->memorySuite.free(parser->memorySuite.userData, parser->pTokenBytes);
-    }
-    while (parser->pMemberNames)
+    parser->objectMemberRefHandler = handler;
+    return JSON_Success;
+}
+
+JSON_Parser_InternedMemberHandler JSON_CALL JSON_Parser_GetInternedMemberHandler(JSON_Parser parser)
+{
+    return parser ? parser->internedMemberHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetInternedMemberHandler(JSON_Parser parser, JSON_Parser_InternedMemberHandler handler)
+{
+    if (!parser)
     {
-        JSON_Parser_PopMemberNameList(parser);
+        return JSON_Failure;
     }
-    Grammarian_FreeAllocations(&parser->grammarianData, &parser->memorySuite);
-    parser->memorySuite.free(parser->memorySuite.userData, parser);
+    parser->internedMemberHandler = handler;
     return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_Reset(JSON_Parser parser)
+JSON_Parser_KnownMemberHandler JSON_CALL JSON_Parser_GetKnownMemberHandler(JSON_Parser parser)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_IN_PROTECTED_API))
+    return parser ? parser->knownMemberHandler : NULL;
+}
+
+JSON_Status JSON_CALL JSON_Parser_SetKnownMemberHandler(JSON_Parser parser, JSON_Parser_KnownMemberHandler handler)
+{
+    if (!parser)
     {
         return JSON_Failure;
     }
-    SET_FLAGS_ON(ParserState, parser->state, PARSER_IN_PROTECTED_API);
-    JSON_Parser_ResetData(parser, 1/* isInitialized */);
-    /* Note that JSON_Parser_ResetData() unset PARSER_IN_PROTECTED_API for us. */
+    parser->knownMemberHandler = handler;
     return JSON_Success;
 }
 
-void* JSON_CALL JSON_Parser_GetUserData(JSON_Parser parser)
+JSON_Parser_PathMatchHandler JSON_CALL JSON_Parser_GetPathMatchHandler(JSON_Parser parser)
 {
-    return parser ? parser->userData : NULL;
+    return parser ? parser->pathMatchHandler : NULL;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetUserData(JSON_Parser parser, void* userData)
+JSON_Status JSON_CALL JSON_Parser_SetPathMatchHandler(JSON_Parser parser, JSON_Parser_PathMatchHandler handler)
 {
     if (!parser)
     {
         return JSON_Failure;
     }
-    parser->userData = userData;
+    parser->pathMatchHandler = handler;
     return JSON_Success;
 }
 
-JSON_Encoding JSON_CALL JSON_Parser_GetInputEncoding(JSON_Parser parser)
+JSON_Parser_Int64Handler JSON_CALL JSON_Parser_GetInt64Handler(JSON_Parser parser)
 {
-    return parser ? (JSON_Encoding)parser->inputEncoding : JSON_UnknownEncoding;
+    return parser ? parser->int64Handler : NULL;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetInputEncoding(JSON_Parser parser, JSON_Encoding encoding)
+JSON_Status JSON_CALL JSON_Parser_SetInt64Handler(JSON_Parser parser, JSON_Parser_Int64Handler handler)
 {
-    if (!parser || encoding < JSON_UnknownEncoding || encoding > JSON_UTF32BE || GET_FLAGS(parser->state, PARSER_STARTED))
+    if (!parser)
     {
         return JSON_Failure;
     }
-    parser->inputEncoding = (Encoding)encoding;
+    parser->int64Handler = handler;
     return JSON_Success;
 }
 
-JSON_Encoding JSON_CALL JSON_Parser_GetStringEncoding(JSON_Parser parser)
+JSON_Parser_UInt64Handler JSON_CALL JSON_Parser_GetUInt64Handler(JSON_Parser parser)
 {
-    return parser ? (JSON_Encoding)parser->stringEncoding : JSON_UTF8;
+    return parser ? parser->uint64Handler : NULL;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetStringEncoding(JSON_Parser parser, JSON_Encoding encoding)
+JSON_Status JSON_CALL JSON_Parser_SetUInt64Handler(JSON_Parser parser, JSON_Parser_UInt64Handler handler)
 {
-    if (!parser || encoding <= JSON_UnknownEncoding || encoding > JSON_UTF32BE || GET_FLAGS(parser->state, PARSER_STARTED))
+    if (!parser)
     {
         return JSON_Failure;
     }
-    parser->stringEncoding = (Encoding)encoding;
+    parser->uint64Handler = handler;
     return JSON_Success;
 }
 
-size_t JSON_CALL JSON_Parser_GetMaxStringLength(JSON_Parser parser)
+JSON_Parser_EventBatchHandler JSON_CALL JSON_Parser_GetEventBatchHandler(JSON_Parser parser)
 {
-    return parser ? parser->maxStringLength : SIZE_MAX;
+    return parser ? parser->eventBatchHandler : NULL;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetMaxStringLength(JSON_Parser parser, size_t maxLength)
+JSON_Status JSON_CALL JSON_Parser_SetEventBatchHandler(JSON_Parser parser, JSON_Parser_EventBatchHandler handler, JSON_Event* pEvents, size_t maxEvents)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    if (!parser || (handler && (!pEvents || !maxEvents)) || GET_FLAGS(parser->state, PARSER_STARTED))
     {
         return JSON_Failure;
     }
-    parser->maxStringLength = maxLength;
+    parser->eventBatchHandler = handler;
+    parser->pEvents = handler ? pEvents : NULL;
+    parser->maxEvents = handler ? maxEvents : 0;
     return JSON_Success;
 }
 
-JSON_Encoding JSON_CALL JSON_Parser_GetNumberEncoding(JSON_Parser parser)
+JSON_Parser_DoubleHandler JSON_CALL JSON_Parser_GetDoubleHandler(JSON_Parser parser)
 {
-    return parser ? (JSON_Encoding)parser->numberEncoding : JSON_UTF8;
+    return parser ? parser->doubleHandler : NULL;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetNumberEncoding(JSON_Parser parser, JSON_Encoding encoding)
+JSON_Status JSON_CALL JSON_Parser_SetDoubleHandler(JSON_Parser parser, JSON_Parser_DoubleHandler handler)
 {
-    if (!parser || encoding <= JSON_UnknownEncoding || encoding > JSON_UTF32BE || GET_FLAGS(parser->state, PARSER_STARTED))
+    if (!parser)
     {
         return JSON_Failure;
     }
-    parser->numberEncoding = (Encoding)encoding;
+    parser->doubleHandler = handler;
     return JSON_Success;
 }
 
-size_t JSON_CALL JSON_Parser_GetMaxNumberLength(JSON_Parser parser)
+static JSON_Status JSON_Parser_ParseInput(JSON_Parser parser, const char* pBytes, size_t length, JSON_Boolean isFinal, size_t* pParsedLength)
 {
-    return parser ? parser->maxNumberLength : SIZE_MAX;
+    JSON_Status status = JSON_Failure;
+    if (parser && (pBytes || !length) && !GET_FLAGS(parser->state, PARSER_FINISHED | PARSER_IN_PROTECTED_API))
+    {
+        int finishedParsing = 0;
+        size_t windowByte = parser->codepointLocationByte + DECODER_STATE_BYTES(parser->decoderData.state);
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_STARTED | PARSER_IN_PROTECTED_API);
+        JSON_Parser_SetLazyLocationWindow(parser, (const byte*)pBytes, length, windowByte);
+        if (JSON_Parser_ProcessInputBytes(parser, (const byte*)pBytes, length))
+        {
+            /* New input was parsed successfully. */
+            if (GET_FLAGS(parser->state, PARSER_SUSPENDED))
+            {
+                /* A reader suspended parsing right after the codepoint that
+                   produced its events, which is always a complete sequence,
+                   so the rest of the input is parsed by the next call. */
+                length = parser->codepointLocationByte - windowByte;
+                parser->lazyLocationWindowLength = length;
+                status = JSON_Success;
+            }
+            else if (isFinal)
+            {
+                /* Make sure there is nothing pending in the decoder, lexer,
+                   or parser. */
+                if (JSON_Parser_FlushDecoder(parser) &&
+                    JSON_Parser_FlushLexer(parser) &&
+                    JSON_Parser_FlushParser(parser))
+                {
+                    status = JSON_Success;
+                }
+                finishedParsing = 1;
+            }
+            else
+            {
+                status = JSON_Success;
+            }
+        }
+        else
+        {
+            /* New input failed to parse. */
+            finishedParsing = 1;
+        }
+        if (GET_FLAGS(parser->state, PARSER_MATCHED_ALL_PATHS))
+        {
+            /* The parser stopped because every path in its filter has
+               matched, possibly while flushing the last token. */
+            status = JSON_Success;
+            finishedParsing = 1;
+        }
+        if (parser->eventCount && !JSON_Parser_FlushEvents(parser))
+        {
+            /* The events recorded from this chunk of input are delivered
+               whether or not it parsed successfully. */
+            status = JSON_Failure;
+            finishedParsing = 1;
+        }
+        if (status == JSON_Success && !finishedParsing && !JSON_Parser_MaterializeTokenRef(parser))
+        {
+            /* A partial token that refers to the input buffer must be
+               copied before the buffer goes out of scope. */
+            status = JSON_Failure;
+            finishedParsing = 1;
+        }
+        parser->pTokenRef = NULL;
+        if (status == JSON_Failure || !finishedParsing)
+        {
+            /* Once parsing has finished successfully, there are no more
+               locations to report. */
+            JSON_Parser_SyncLazyLocation(parser, status);
+        }
+        JSON_Parser_SetLazyLocationWindow(parser, NULL, 0, 0);
+        if (finishedParsing)
+        {
+            if (parser->tape)
+            {
+                JSON_Parser_FinishTape(parser, status);
+            }
+            SET_FLAGS_ON(ParserState, parser->state, PARSER_FINISHED);
+        }
+        if (pParsedLength)
+        {
+            *pParsedLength = length;
+        }
+        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_PROTECTED_API | PARSER_SUSPENDED);
+    }
+    return status;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetMaxNumberLength(JSON_Parser parser, size_t maxLength)
+JSON_Status JSON_CALL JSON_Parser_Parse(JSON_Parser parser, const char* pBytes, size_t length, JSON_Boolean isFinal)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    return (parser && parser->reader) ? JSON_Failure : JSON_Parser_ParseInput(parser, pBytes, length, isFinal, NULL);
+}
+
+#endif /* JSON_NO_PARSER */
+
+/******************** JSON Tape ********************/
+
+#ifndef JSON_NO_PARSER
+
+/* Tape entry types, in addition to the JSON_ValueType values. A member
+   name entry immediately precedes the entry for the member's value, and
+   an end entry follows the last descendant of each container. */
+#define TAPE_MEMBER_NAME 0x07
+#define TAPE_END         0x08
+
+#define DEFAULT_TAPE_ENTRIES      64
+#define DEFAULT_TAPE_ARENA_LENGTH 1024
+
+/* Marks the absence of an open container while a tape is being built. */
+#define NO_OPEN_CONTAINER SIZE_MAX
+
+typedef struct tag_TapeEntry
+{
+    byte   type;       /* a JSON_ValueType or TAPE_* value */
+    byte   attributes; /* the value of a boolean or special number, or the
+                          attributes of a string, number or member name */
+    size_t next;       /* the index of the entry after the value and all of
+                          its descendants; while a container is open, the
+                          index of the container that encloses it */
+    size_t offset;     /* the offset of a string, number or member name in
+                          the arena */
+    size_t length;     /* the length in bytes of a string, number or member
+                          name, or the number of children of a container */
+} TapeEntry;
+
+struct JSON_Tape_Data
+{
+    JSON_MemorySuite memorySuite;
+    TapeEntry*       pEntries;
+    size_t           entryCapacity;
+    size_t           entryCount;
+    byte*            pArena;
+    size_t           arenaLength;
+    size_t           arenaUsed;
+    size_t           openContainer;
+    Encoding         numberEncoding;
+    byte             isComplete;
+};
+
+static void JSON_Tape_ResetData(JSON_Tape tape)
+{
+    tape->entryCount = 0;
+    tape->arenaUsed = 0;
+    tape->openContainer = NO_OPEN_CONTAINER;
+    tape->numberEncoding = JSON_UTF8;
+    tape->isComplete = 0;
+}
+
+static JSON_Status JSON_Parser_AddTapeEntry(JSON_Parser parser, byte type, byte attributes, int hasValue)
+{
+    JSON_Tape tape = parser->tape;
+    TapeEntry* pEntry;
+    if (tape->entryCount == tape->entryCapacity)
+    {
+        size_t newCapacity = GetGrownLength(tape->entryCapacity, DEFAULT_TAPE_ENTRIES, tape->entryCount + 1);
+        TapeEntry* pNewEntries = NULL;
+        if (newCapacity <= SIZE_MAX / sizeof(TapeEntry))
+        {
+            pNewEntries = (TapeEntry*)tape->memorySuite.realloc(tape->memorySuite.userData, tape->pEntries, newCapacity * sizeof(TapeEntry));
+        }
+        if (!pNewEntries)
+        {
+            JSON_Parser_SetErrorAtToken(parser, JSON_Error_OutOfMemory);
+            return JSON_Failure;
+        }
+        tape->pEntries = pNewEntries;
+        tape->entryCapacity = newCapacity;
+    }
+    pEntry = &tape->pEntries[tape->entryCount];
+    pEntry->type = type;
+    pEntry->attributes = attributes;
+    pEntry->next = tape->entryCount + 1;
+    pEntry->offset = 0;
+    pEntry->length = 0;
+    if (hasValue)
+    {
+        Encoding encoding = (parser->token == T_NUMBER) ? parser->numberEncoding : parser->stringEncoding;
+        size_t nullTerminatorLength = SHORTEST_ENCODING_SEQUENCE(encoding);
+        size_t valueBytes = parser->tokenBytesUsed + nullTerminatorLength;
+        if (tape->arenaLength - tape->arenaUsed < valueBytes)
+        {
+            size_t newLength = GetGrownLength(tape->arenaLength, DEFAULT_TAPE_ARENA_LENGTH, tape->arenaUsed + valueBytes);
+            byte* pNewArena = (byte*)tape->memorySuite.realloc(tape->memorySuite.userData, tape->pArena, newLength);
+            if (!pNewArena)
+            {
+                JSON_Parser_SetErrorAtToken(parser, JSON_Error_OutOfMemory);
+                return JSON_Failure;
+            }
+            tape->pArena = pNewArena;
+            tape->arenaLength = newLength;
+        }
+        memcpy(tape->pArena + tape->arenaUsed, JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed);
+        memset(tape->pArena + tape->arenaUsed + parser->tokenBytesUsed, 0, nullTerminatorLength);
+        pEntry->offset = tape->arenaUsed;
+        pEntry->length = parser->tokenBytesUsed;
+        tape->arenaUsed += valueBytes;
+    }
+    if (type <= JSON_Value_Array && tape->openContainer != NO_OPEN_CONTAINER)
+    {
+        tape->pEntries[tape->openContainer].length++;
+    }
+    tape->entryCount++;
+    return JSON_Success;
+}
+
+static JSON_Status JSON_Parser_OpenTapeContainer(JSON_Parser parser, byte type)
+{
+    JSON_Tape tape = parser->tape;
+    size_t index = tape->entryCount;
+    if (!JSON_Parser_AddTapeEntry(parser, type, 0, 0) ||
+        !JSON_Parser_StartContainer(parser, type == JSON_Value_Object))
     {
         return JSON_Failure;
     }
-    parser->maxNumberLength = maxLength;
+    tape->pEntries[index].next = tape->openContainer;
+    tape->openContainer = index;
     return JSON_Success;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetAllowBOM(JSON_Parser parser)
+static JSON_Status JSON_Parser_CloseTapeContainer(JSON_Parser parser, byte type)
 {
-    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_BOM)) ? JSON_True : JSON_False;
+    JSON_Tape tape = parser->tape;
+    size_t index = tape->openContainer;
+    JSON_Parser_EndContainer(parser, type == JSON_Value_Object);
+    if (!JSON_Parser_AddTapeEntry(parser, TAPE_END, 0, 0))
+    {
+        return JSON_Failure;
+    }
+    tape->openContainer = tape->pEntries[index].next;
+    tape->pEntries[index].next = tape->entryCount;
+    return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetAllowBOM(JSON_Parser parser, JSON_Boolean allowBOM)
+static JSON_Status JSON_Parser_RecordTapeEvents(JSON_Parser parser, byte emit)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    /* Array items aren't recorded, since every item is followed by its
+       value anyway. */
+    if (!parser->tape->entryCount)
+    {
+        parser->tape->numberEncoding = parser->numberEncoding;
+    }
+    SET_FLAGS_OFF(byte, emit, EMIT_ARRAY_ITEM);
+    switch (emit)
+    {
+    case EMIT_NULL:
+        if (!JSON_Parser_AddTapeEntry(parser, JSON_Value_Null, 0, 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_BOOLEAN:
+        if (!JSON_Parser_AddTapeEntry(parser, JSON_Value_Boolean, (byte)(parser->token == T_TRUE ? JSON_True : JSON_False), 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_STRING:
+        if (!JSON_Parser_AddTapeEntry(parser, JSON_Value_String, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_NUMBER:
+        if (!JSON_Parser_AddTapeEntry(parser, JSON_Value_Number, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_SPECIAL_NUMBER:
+        if (!JSON_Parser_AddTapeEntry(parser, JSON_Value_SpecialNumber, (byte)(parser->token == T_NAN ? JSON_NaN :
+                                      (parser->token == T_INFINITY ? JSON_Infinity : JSON_NegativeInfinity)), 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_OBJECT:
+        if (!JSON_Parser_OpenTapeContainer(parser, JSON_Value_Object))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_OBJECT:
+        if (!JSON_Parser_CloseTapeContainer(parser, JSON_Value_Object))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_OBJECT_MEMBER:
+        if (!JSON_Parser_AddMemberNameToList(parser) || /* will fail if member is duplicate */
+            !JSON_Parser_AddTapeEntry(parser, TAPE_MEMBER_NAME, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_ARRAY:
+        if (!JSON_Parser_OpenTapeContainer(parser, JSON_Value_Array))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_ARRAY:
+        if (!JSON_Parser_CloseTapeContainer(parser, JSON_Value_Array))
+        {
+            return JSON_Failure;
+        }
+        break;
+    }
+    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT | PARSER_MULTIPLE_DOCUMENTS))
     {
-        return JSON_Failure;
+        return JSON_Parser_EndDocument(parser);
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_BOM, allowBOM);
     return JSON_Success;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetAllowComments(JSON_Parser parser)
+static void JSON_Parser_FinishTape(JSON_Parser parser, JSON_Status status)
 {
-    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_COMMENTS)) ? JSON_True : JSON_False;
+    /* The tape only contains a document once it has been parsed
+       successfully; a document that stopped after an embedded document is
+       complete too. */
+    JSON_Tape tape = parser->tape;
+    tape->isComplete = (byte)(tape->entryCount && tape->openContainer == NO_OPEN_CONTAINER &&
+                              (status == JSON_Success || parser->error == JSON_Error_StoppedAfterEmbeddedDocument));
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetAllowComments(JSON_Parser parser, JSON_Boolean allowComments)
+static const TapeEntry* JSON_Tape_GetEntry(JSON_Tape tape, size_t value)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    /* Only the values of a complete tape can be navigated, and member
+       names and end entries don't identify values. */
+    const TapeEntry* pEntry;
+    if (!tape || !tape->isComplete || value >= tape->entryCount)
     {
-        return JSON_Failure;
+        return NULL;
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_COMMENTS, allowComments);
-    return JSON_Success;
+    pEntry = &tape->pEntries[value];
+    return (pEntry->type <= JSON_Value_Array) ? pEntry : NULL;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetAllowSpecialNumbers(JSON_Parser parser)
+JSON_Tape JSON_CALL JSON_Tape_Create(const JSON_MemorySuite* pMemorySuite)
 {
-    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS)) ? JSON_True : JSON_False;
+    JSON_Tape tape;
+    JSON_MemorySuite memorySuite;
+    if (pMemorySuite)
+    {
+        memorySuite = *pMemorySuite;
+        if (!memorySuite.realloc || !memorySuite.free)
+        {
+            /* The full memory suite must be specified. */
+            return NULL;
+        }
+    }
+    else
+    {
+        memorySuite = defaultMemorySuite;
+    }
+    tape = (JSON_Tape)memorySuite.realloc(memorySuite.userData, NULL, sizeof(struct JSON_Tape_Data));
+    if (!tape)
+    {
+        return NULL;
+    }
+    tape->memorySuite = memorySuite;
+    tape->pEntries = NULL;
+    tape->entryCapacity = 0;
+    tape->pArena = NULL;
+    tape->arenaLength = 0;
+    JSON_Tape_ResetData(tape);
+    return tape;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetAllowSpecialNumbers(JSON_Parser parser, JSON_Boolean allowSpecialNumbers)
+JSON_Status JSON_CALL JSON_Tape_Free(JSON_Tape tape)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    if (!tape)
     {
         return JSON_Failure;
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_SPECIAL_NUMBERS, allowSpecialNumbers);
+    if (tape->pEntries)
+    {
+        tape->memorySuite.free(tape->memorySuite.userData, tape->pEntries);
+    }
+    if (tape->pArena)
+    {
+        tape->memorySuite.free(tape->memorySuite.userData, tape->pArena);
+    }
+    tape->memorySuite.free(tape->memorySuite.userData, tape);
     return JSON_Success;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetAllowHexNumbers(JSON_Parser parser)
-{
-    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_HEX_NUMBERS)) ? JSON_True : JSON_False;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetAllowHexNumbers(JSON_Parser parser, JSON_Boolean allowHexNumbers)
+JSON_Status JSON_CALL JSON_Tape_Reset(JSON_Tape tape)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    if (!tape)
     {
         return JSON_Failure;
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_HEX_NUMBERS, allowHexNumbers);
+    JSON_Tape_ResetData(tape);
     return JSON_Success;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetAllowUnescapedControlCharacters(JSON_Parser parser)
+JSON_Tape JSON_CALL JSON_Parser_GetTape(JSON_Parser parser)
 {
-    return (parser && GET_FLAGS(parser->flags, PARSER_ALLOW_CONTROL_CHARS)) ? JSON_True : JSON_False;
+    return parser ? parser->tape : NULL;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetAllowUnescapedControlCharacters(JSON_Parser parser, JSON_Boolean allowUnescapedControlCharacters)
+JSON_Status JSON_CALL JSON_Parser_SetTape(JSON_Parser parser, JSON_Tape tape)
 {
     if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
     {
         return JSON_Failure;
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_ALLOW_CONTROL_CHARS, allowUnescapedControlCharacters);
+    if (tape)
+    {
+        JSON_Tape_ResetData(tape);
+    }
+    parser->tape = tape;
     return JSON_Success;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetReplaceInvalidEncodingSequences(JSON_Parser parser)
-{
-    return (parser && GET_FLAGS(parser->flags, PARSER_REPLACE_INVALID)) ? JSON_True : JSON_False;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetReplaceInvalidEncodingSequences(JSON_Parser parser, JSON_Boolean replaceInvalidEncodingSequences)
+JSON_Status JSON_CALL JSON_Tape_GetRoot(JSON_Tape tape, size_t* pValue)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    if (!pValue || !JSON_Tape_GetEntry(tape, 0))
     {
         return JSON_Failure;
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_REPLACE_INVALID, replaceInvalidEncodingSequences);
+    *pValue = 0;
     return JSON_Success;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetTrackObjectMembers(JSON_Parser parser)
-{
-    return (parser && GET_FLAGS(parser->flags, PARSER_TRACK_OBJECT_MEMBERS)) ? JSON_True : JSON_False;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetTrackObjectMembers(JSON_Parser parser, JSON_Boolean trackObjectMembers)
+JSON_Status JSON_CALL JSON_Tape_GetValueType(JSON_Tape tape, size_t value, JSON_ValueType* pType)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !pType)
     {
         return JSON_Failure;
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_TRACK_OBJECT_MEMBERS, trackObjectMembers);
+    *pType = (JSON_ValueType)pEntry->type;
     return JSON_Success;
 }
 
-JSON_Boolean JSON_CALL JSON_Parser_GetStopAfterEmbeddedDocument(JSON_Parser parser)
-{
-    return (parser && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT)) ? JSON_True : JSON_False;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetStopAfterEmbeddedDocument(JSON_Parser parser, JSON_Boolean stopAfterEmbeddedDocument)
+JSON_Status JSON_CALL JSON_Tape_GetChildCount(JSON_Tape tape, size_t value, size_t* pCount)
 {
-    if (!parser || GET_FLAGS(parser->state, PARSER_STARTED))
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !pCount || (pEntry->type != JSON_Value_Object && pEntry->type != JSON_Value_Array))
     {
         return JSON_Failure;
     }
-    SET_FLAGS(ParserFlags, parser->flags, PARSER_EMBEDDED_DOCUMENT, stopAfterEmbeddedDocument);
+    *pCount = pEntry->length;
     return JSON_Success;
 }
 
-JSON_Error JSON_CALL JSON_Parser_GetError(JSON_Parser parser)
+JSON_Status JSON_CALL JSON_Tape_GetFirstChild(JSON_Tape tape, size_t value, size_t* pChild)
 {
-    return parser ? (JSON_Error)parser->error : JSON_Error_None;
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !pChild || (pEntry->type != JSON_Value_Object && pEntry->type != JSON_Value_Array) || !pEntry->length)
+    {
+        return JSON_Failure;
+    }
+    /* The value of an object's first member follows the member's name. */
+    *pChild = value + ((pEntry->type == JSON_Value_Object) ? 2 : 1);
+    return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_GetErrorLocation(JSON_Parser parser, JSON_Location* pLocation)
+JSON_Status JSON_CALL JSON_Tape_GetNextSibling(JSON_Tape tape, size_t value, size_t* pSibling)
 {
-    if (!pLocation || !parser || parser->error == JSON_Error_None)
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    const TapeEntry* pNextEntry;
+    if (!pEntry || !pSibling || !value)
     {
+        /* The root value has no siblings. */
         return JSON_Failure;
     }
-    if (parser->errorOffset == ERROR_LOCATION_IS_TOKEN_START)
-    {
-        pLocation->byte = parser->tokenLocationByte;
-        pLocation->line = parser->tokenLocationLine;
-        pLocation->column = parser->tokenLocationColumn;
-    }
-    else
+    pNextEntry = &tape->pEntries[pEntry->next];
+    if (pNextEntry->type == TAPE_END)
     {
-        pLocation->byte = parser->codepointLocationByte - (SHORTEST_ENCODING_SEQUENCE(parser->inputEncoding) * parser->errorOffset);
-        pLocation->line = parser->codepointLocationLine;
-        pLocation->column = parser->codepointLocationColumn - parser->errorOffset;
+        return JSON_Failure;
     }
-    pLocation->depth = parser->depth;
+    *pSibling = pEntry->next + ((pNextEntry->type == TAPE_MEMBER_NAME) ? 1 : 0);
     return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_GetTokenLocation(JSON_Parser parser, JSON_Location* pLocation)
+JSON_Status JSON_CALL JSON_Tape_GetMemberName(JSON_Tape tape, size_t value, const char** ppName, size_t* pLength, JSON_StringAttributes* pAttributes)
 {
-    if (!parser || !pLocation || !GET_FLAGS(parser->state, PARSER_IN_TOKEN_HANDLER))
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !ppName || !pLength || !pAttributes || !value || tape->pEntries[value - 1].type != TAPE_MEMBER_NAME)
     {
         return JSON_Failure;
     }
-    pLocation->byte = parser->tokenLocationByte;
-    pLocation->line = parser->tokenLocationLine;
-    pLocation->column = parser->tokenLocationColumn;
-    pLocation->depth = parser->depth;
+    pEntry = &tape->pEntries[value - 1];
+    *ppName = (const char*)tape->pArena + pEntry->offset;
+    *pLength = pEntry->length;
+    *pAttributes = pEntry->attributes;
     return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_GetAfterTokenLocation(JSON_Parser parser, JSON_Location* pLocation)
+JSON_Status JSON_CALL JSON_Tape_FindMember(JSON_Tape tape, size_t value, const char* pName, size_t length, size_t* pMember)
 {
-    if (!parser || !pLocation || !GET_FLAGS(parser->state, PARSER_IN_TOKEN_HANDLER))
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    size_t index;
+    if (!pEntry || !pMember || (!pName && length) || pEntry->type != JSON_Value_Object)
     {
         return JSON_Failure;
     }
-    pLocation->byte = parser->codepointLocationByte;
-    pLocation->line = parser->codepointLocationLine;
-    pLocation->column = parser->codepointLocationColumn;
-    pLocation->depth = parser->depth;
-    return JSON_Success;
-}
-
-JSON_Parser_NullHandler JSON_CALL JSON_Parser_GetEncodingDetectedHandler(JSON_Parser parser)
-{
-    return parser ? parser->encodingDetectedHandler : NULL;
+    /* Walk the member names, skipping over each member's value. */
+    index = value + 1;
+    while (tape->pEntries[index].type == TAPE_MEMBER_NAME)
+    {
+        const TapeEntry* pNameEntry = &tape->pEntries[index];
+        if (pNameEntry->length == length && !memcmp(tape->pArena + pNameEntry->offset, pName, length))
+        {
+            *pMember = index + 1;
+            return JSON_Success;
+        }
+        index = tape->pEntries[index + 1].next;
+    }
+    return JSON_Failure;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetEncodingDetectedHandler(JSON_Parser parser, JSON_Parser_EncodingDetectedHandler handler)
+JSON_Status JSON_CALL JSON_Tape_GetBoolean(JSON_Tape tape, size_t value, JSON_Boolean* pValue)
 {
-    if (!parser)
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !pValue || pEntry->type != JSON_Value_Boolean)
     {
         return JSON_Failure;
     }
-    parser->encodingDetectedHandler = handler;
+    *pValue = (JSON_Boolean)pEntry->attributes;
     return JSON_Success;
 }
 
-JSON_Parser_NullHandler JSON_CALL JSON_Parser_GetNullHandler(JSON_Parser parser)
-{
-    return parser ? parser->nullHandler : NULL;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetNullHandler(JSON_Parser parser, JSON_Parser_NullHandler handler)
+JSON_Status JSON_CALL JSON_Tape_GetString(JSON_Tape tape, size_t value, const char** ppValue, size_t* pLength, JSON_StringAttributes* pAttributes)
 {
-    if (!parser)
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !ppValue || !pLength || !pAttributes || pEntry->type != JSON_Value_String)
     {
         return JSON_Failure;
     }
-    parser->nullHandler = handler;
+    *ppValue = (const char*)tape->pArena + pEntry->offset;
+    *pLength = pEntry->length;
+    *pAttributes = pEntry->attributes;
     return JSON_Success;
 }
 
-JSON_Parser_BooleanHandler JSON_CALL JSON_Parser_GetBooleanHandler(JSON_Parser parser)
+JSON_Status JSON_CALL JSON_Tape_GetNumber(JSON_Tape tape, size_t value, const char** ppValue, size_t* pLength, JSON_NumberAttributes* pAttributes)
 {
-    return parser ? parser->booleanHandler : NULL;
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !ppValue || !pLength || !pAttributes || pEntry->type != JSON_Value_Number)
+    {
+        return JSON_Failure;
+    }
+    *ppValue = (const char*)tape->pArena + pEntry->offset;
+    *pLength = pEntry->length;
+    *pAttributes = pEntry->attributes;
+    return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetBooleanHandler(JSON_Parser parser, JSON_Parser_BooleanHandler handler)
+JSON_Status JSON_CALL JSON_Tape_GetSpecialNumber(JSON_Tape tape, size_t value, JSON_SpecialNumber* pValue)
 {
-    if (!parser)
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || !pValue || pEntry->type != JSON_Value_SpecialNumber)
     {
         return JSON_Failure;
     }
-    parser->booleanHandler = handler;
+    *pValue = (JSON_SpecialNumber)pEntry->attributes;
     return JSON_Success;
 }
 
-JSON_Parser_StringHandler JSON_CALL JSON_Parser_GetStringHandler(JSON_Parser parser)
+static const TapeEntry* JSON_Tape_ScanNumber(JSON_Tape tape, size_t value, ScannedNumber* pNumber)
 {
-    return parser ? parser->stringHandler : NULL;
+    const TapeEntry* pEntry = JSON_Tape_GetEntry(tape, value);
+    if (!pEntry || pEntry->type != JSON_Value_Number)
+    {
+        return NULL;
+    }
+    ScanNumber(tape->pArena + pEntry->offset, pEntry->length, tape->numberEncoding, pEntry->attributes, pNumber);
+    return pEntry;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetStringHandler(JSON_Parser parser, JSON_Parser_StringHandler handler)
+JSON_Status JSON_CALL JSON_Tape_GetInt64(JSON_Tape tape, size_t value, JSON_Int64* pValue)
 {
-    if (!parser)
-    {
-        return JSON_Failure;
-    }
-    parser->stringHandler = handler;
-    return JSON_Success;
+    ScannedNumber number;
+    const TapeEntry* pEntry = JSON_Tape_ScanNumber(tape, value, &number);
+    return (pEntry && pValue && ScannedNumberToInt64(&number, pEntry->attributes, pValue)) ? JSON_Success : JSON_Failure;
 }
 
-JSON_Parser_NumberHandler JSON_CALL JSON_Parser_GetNumberHandler(JSON_Parser parser)
+JSON_Status JSON_CALL JSON_Tape_GetUInt64(JSON_Tape tape, size_t value, JSON_UInt64* pValue)
 {
-    return parser ? parser->numberHandler : NULL;
+    ScannedNumber number;
+    const TapeEntry* pEntry = JSON_Tape_ScanNumber(tape, value, &number);
+    return (pEntry && pValue && ScannedNumberToUInt64(&number, pEntry->attributes, pValue)) ? JSON_Success : JSON_Failure;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetNumberHandler(JSON_Parser parser, JSON_Parser_NumberHandler handler)
+JSON_Status JSON_CALL JSON_Tape_GetDouble(JSON_Tape tape, size_t value, double* pValue)
 {
-    if (!parser)
+    ScannedNumber number;
+    const TapeEntry* pEntry = JSON_Tape_ScanNumber(tape, value, &number);
+    int inRange;
+    if (!pEntry || !pValue ||
+        !ScannedNumberToDouble(&number, &tape->memorySuite, tape->pArena + pEntry->offset, pEntry->length, tape->numberEncoding, pEntry->attributes, pValue, &inRange))
     {
         return JSON_Failure;
     }
-    parser->numberHandler = handler;
-    return JSON_Success;
+    return inRange ? JSON_Success : JSON_Failure;
 }
 
-JSON_Parser_SpecialNumberHandler JSON_CALL JSON_Parser_GetSpecialNumberHandler(JSON_Parser parser)
+#endif /* JSON_NO_PARSER */
+
+/******************** JSON Reader ********************/
+
+#ifndef JSON_NO_PARSER
+
+/* The most events that can be queued before the reader's parser is
+   suspended. A codepoint produces at most 6 events: it can end a number
+   or literal, and with it a document, and be a token itself, which can
+   start a document or an array segment (2 events) and end a document.
+   The codepoints that are replayed after the input encoding has been
+   detected (at most 4) can't be suspended, so their events, and those of
+   the codepoint after them or of the end of the input, are queued
+   together. */
+#define READER_QUEUE_LENGTH 32
+
+#define DEFAULT_READER_ARENA_LENGTH 256
+
+/* Reader input states. */
+#define READER_NEEDS_INPUT     0
+#define READER_HAS_INPUT       1
+#define READER_HAS_FINAL_INPUT 2
+
+/* An event waiting to be returned by JSON_Reader_Next(). A value that is
+   copied to the reader's arena is located by its offset, since the arena
+   can move as it grows. */
+typedef struct tag_QueuedEvent
+{
+    byte          type;
+    byte          attributes;
+    byte          isInArena;
+    JSON_Location location;
+    const byte*   pValue;      /* if the value is not in the arena */
+    size_t        valueOffset; /* if the value is in the arena */
+    size_t        valueLength;
+} QueuedEvent;
+
+struct JSON_Reader_Data
 {
-    return parser ? parser->specialNumberHandler : NULL;
+    JSON_Parser parser;
+    const byte* pInput;
+    size_t      inputLength;
+    size_t      inputUsed;
+    byte        inputState;
+    QueuedEvent events[READER_QUEUE_LENGTH];
+    size_t      firstEvent;
+    size_t      eventCount;
+    byte*       pArena;
+    size_t      arenaLength;
+    size_t      arenaUsed;
+};
+
+static void JSON_Reader_ResetData(JSON_Reader reader)
+{
+    reader->pInput = NULL;
+    reader->inputLength = 0;
+    reader->inputUsed = 0;
+    reader->inputState = READER_NEEDS_INPUT;
+    reader->firstEvent = 0;
+    reader->eventCount = 0;
+    reader->arenaUsed = 0;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetSpecialNumberHandler(JSON_Parser parser, JSON_Parser_SpecialNumberHandler handler)
+static JSON_Status JSON_Parser_QueueReaderEvent(JSON_Parser parser, JSON_EventType type, byte attributes, int hasValue)
 {
-    if (!parser)
+    /* Values are passed by reference, either to the input or to the token
+       buffer, since parsing is suspended before either can change, with
+       two exceptions. The bytes that are replayed after the input encoding
+       has been detected are in a local buffer, and a number that was
+       copied to the token buffer can be immediately followed by a token
+       that is copied there too (as in "1-2", which is two documents in
+       multi-document mode). Those values are copied to the arena. */
+    JSON_Reader reader = parser->reader;
+    QueuedEvent* pEvent;
+    if (reader->eventCount == READER_QUEUE_LENGTH)
     {
+        /* This can't happen; see READER_QUEUE_LENGTH. */
+        JSON_Parser_SetErrorAtToken(parser, JSON_Error_OutOfMemory);
         return JSON_Failure;
     }
-    parser->specialNumberHandler = handler;
+    pEvent = &reader->events[reader->eventCount];
+    pEvent->type = (byte)type;
+    pEvent->attributes = attributes;
+    pEvent->isInArena = 0;
+    if (GET_FLAGS(parser->flags, PARSER_LAZY_LOCATIONS))
+    {
+        JSON_Parser_UpdateLazyLocation(parser, parser->codepointLocationByte);
+    }
+    pEvent->location.byte = parser->tokenLocationByte;
+    pEvent->location.line = parser->tokenLocationLine;
+    pEvent->location.column = parser->tokenLocationColumn;
+    pEvent->location.depth = parser->depth;
+    pEvent->pValue = NULL;
+    pEvent->valueOffset = 0;
+    pEvent->valueLength = 0;
+    if (hasValue)
+    {
+        pEvent->valueLength = parser->tokenBytesUsed;
+        if (GET_FLAGS(parser->state, PARSER_REPLAYING_DETECTION) || (parser->token == T_NUMBER && !parser->pTokenRef))
+        {
+            if (!reader->pArena || reader->arenaLength - reader->arenaUsed < parser->tokenBytesUsed)
+            {
+                size_t newLength = GetGrownLength(reader->arenaLength, DEFAULT_READER_ARENA_LENGTH, reader->arenaUsed + parser->tokenBytesUsed);
+                byte* pNewArena = (byte*)parser->memorySuite.realloc(parser->memorySuite.userData, reader->pArena, newLength);
+                if (!pNewArena)
+                {
+                    JSON_Parser_SetErrorAtToken(parser, JSON_Error_OutOfMemory);
+                    return JSON_Failure;
+                }
+                reader->pArena = pNewArena;
+                reader->arenaLength = newLength;
+            }
+            memcpy(reader->pArena + reader->arenaUsed, JSON_Parser_GetTokenBytes(parser), parser->tokenBytesUsed);
+            pEvent->isInArena = 1;
+            pEvent->valueOffset = reader->arenaUsed;
+            reader->arenaUsed += parser->tokenBytesUsed;
+        }
+        else
+        {
+            pEvent->pValue = JSON_Parser_GetTokenBytes(parser);
+        }
+    }
+    reader->eventCount++;
+    if (!GET_FLAGS(parser->state, PARSER_REPLAYING_DETECTION))
+    {
+        SET_FLAGS_ON(ParserState, parser->state, PARSER_SUSPENDED);
+    }
     return JSON_Success;
 }
 
-JSON_Parser_StartObjectHandler JSON_CALL JSON_Parser_GetStartObjectHandler(JSON_Parser parser)
+static JSON_Status JSON_Parser_QueueReaderEvents(JSON_Parser parser, byte emit)
 {
-    return parser ? parser->startObjectHandler : NULL;
-}
+    /* Array items aren't queued, since every item is followed by its value
+       anyway. */
+    SET_FLAGS_OFF(byte, emit, EMIT_ARRAY_ITEM);
+    switch (emit)
+    {
+    case EMIT_NULL:
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_Null, 0, 0))
+        {
+            return JSON_Failure;
+        }
+        break;
 
-JSON_Status JSON_CALL JSON_Parser_SetStartObjectHandler(JSON_Parser parser, JSON_Parser_StartObjectHandler handler)
-{
-    if (!parser)
+    case EMIT_BOOLEAN:
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_Boolean, (byte)(parser->token == T_TRUE ? JSON_True : JSON_False), 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_STRING:
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_String, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_NUMBER:
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_Number, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_SPECIAL_NUMBER:
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_SpecialNumber, (byte)(parser->token == T_NAN ? JSON_NaN :
+                                          (parser->token == T_INFINITY ? JSON_Infinity : JSON_NegativeInfinity)), 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_OBJECT:
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_StartObject, 0, 0) ||
+            !JSON_Parser_StartContainer(parser, 1/*isObject*/))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_OBJECT:
+        JSON_Parser_EndContainer(parser, 1/*isObject*/);
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_EndObject, 0, 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_OBJECT_MEMBER:
+        if (!JSON_Parser_AddMemberNameToList(parser) || /* will fail if member is duplicate */
+            !JSON_Parser_QueueReaderEvent(parser, JSON_Event_ObjectMember, parser->tokenAttributes, 1))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_START_ARRAY:
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_StartArray, 0, 0) ||
+            !JSON_Parser_StartContainer(parser, 0/*isObject*/))
+        {
+            return JSON_Failure;
+        }
+        break;
+
+    case EMIT_END_ARRAY:
+        JSON_Parser_EndContainer(parser, 0/*isObject*/);
+        if (!JSON_Parser_QueueReaderEvent(parser, JSON_Event_EndArray, 0, 0))
+        {
+            return JSON_Failure;
+        }
+        break;
+    }
+    if (!parser->depth && GET_FLAGS(parser->flags, PARSER_EMBEDDED_DOCUMENT | PARSER_MULTIPLE_DOCUMENTS))
     {
-        return JSON_Failure;
+        return JSON_Parser_EndDocument(parser);
     }
-    parser->startObjectHandler = handler;
     return JSON_Success;
 }
 
-JSON_Parser_EndObjectHandler JSON_CALL JSON_Parser_GetEndObjectHandler(JSON_Parser parser)
-{
-    return parser ? parser->endObjectHandler : NULL;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetEndObjectHandler(JSON_Parser parser, JSON_Parser_EndObjectHandler handler)
+JSON_Reader JSON_CALL JSON_Reader_Create(const JSON_MemorySuite* pMemorySuite)
 {
+    JSON_Reader reader;
+    JSON_Parser parser = JSON_Parser_Create(pMemorySuite);
     if (!parser)
     {
-        return JSON_Failure;
+        return NULL;
     }
-    parser->endObjectHandler = handler;
-    return JSON_Success;
-}
-
-JSON_Parser_ObjectMemberHandler JSON_CALL JSON_Parser_GetObjectMemberHandler(JSON_Parser parser)
-{
-    return parser ? parser->objectMemberHandler : NULL;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetObjectMemberHandler(JSON_Parser parser, JSON_Parser_ObjectMemberHandler handler)
-{
-    if (!parser)
+    reader = (JSON_Reader)parser->memorySuite.realloc(parser->memorySuite.userData, NULL, sizeof(struct JSON_Reader_Data));
+    if (!reader)
     {
-        return JSON_Failure;
+        JSON_Parser_Free(parser);
+        return NULL;
     }
-    parser->objectMemberHandler = handler;
-    return JSON_Success;
-}
-
-JSON_Parser_StartArrayHandler JSON_CALL JSON_Parser_GetStartArrayHandler(JSON_Parser parser)
-{
-    return parser ? parser->startArrayHandler : NULL;
+    reader->parser = parser;
+    reader->pArena = NULL;
+    reader->arenaLength = 0;
+    JSON_Reader_ResetData(reader);
+    parser->reader = reader;
+    return reader;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetStartArrayHandler(JSON_Parser parser, JSON_Parser_StartArrayHandler handler)
+JSON_Status JSON_CALL JSON_Reader_Free(JSON_Reader reader)
 {
-    if (!parser)
+    JSON_Parser parser;
+    JSON_MemorySuite memorySuite;
+    if (!reader || GET_FLAGS(reader->parser->state, PARSER_IN_PROTECTED_API))
     {
         return JSON_Failure;
     }
-    parser->startArrayHandler = handler;
+    parser = reader->parser;
+    memorySuite = parser->memorySuite;
+    if (reader->pArena)
+    {
+        memorySuite.free(memorySuite.userData, reader->pArena);
+    }
+    parser->reader = NULL;
+    JSON_Parser_Free(parser);
+    memorySuite.free(memorySuite.userData, reader);
     return JSON_Success;
 }
 
-JSON_Parser_EndArrayHandler JSON_CALL JSON_Parser_GetEndArrayHandler(JSON_Parser parser)
-{
-    return parser ? parser->endArrayHandler : NULL;
-}
-
-JSON_Status JSON_CALL JSON_Parser_SetEndArrayHandler(JSON_Parser parser, JSON_Parser_EndArrayHandler handler)
+JSON_Status JSON_CALL JSON_Reader_Reset(JSON_Reader reader)
 {
-    if (!parser)
+    if (!reader || GET_FLAGS(reader->parser->state, PARSER_IN_PROTECTED_API))
     {
         return JSON_Failure;
     }
-    parser->endArrayHandler = handler;
+    /* The parser stays bound to the reader; see JSON_Parser_ResetData(). */
+    JSON_Parser_ResetData(reader->parser, 1/* isInitialized */);
+    JSON_Reader_ResetData(reader);
     return JSON_Success;
 }
 
-JSON_Parser_ArrayItemHandler JSON_CALL JSON_Parser_GetArrayItemHandler(JSON_Parser parser)
+JSON_Parser JSON_CALL JSON_Reader_GetParser(JSON_Reader reader)
 {
-    return parser ? parser->arrayItemHandler : NULL;
+    return reader ? reader->parser : NULL;
 }
 
-JSON_Status JSON_CALL JSON_Parser_SetArrayItemHandler(JSON_Parser parser, JSON_Parser_ArrayItemHandler handler)
+JSON_Status JSON_CALL JSON_Reader_SetInput(JSON_Reader reader, const char* pBytes, size_t length, JSON_Boolean isFinal)
 {
-    if (!parser)
+    if (!reader || (!pBytes && length) || reader->inputState != READER_NEEDS_INPUT ||
+        GET_FLAGS(reader->parser->state, PARSER_FINISHED | PARSER_IN_PROTECTED_API))
     {
         return JSON_Failure;
     }
-    parser->arrayItemHandler = handler;
+    reader->pInput = (const byte*)pBytes;
+    reader->inputLength = length;
+    reader->inputUsed = 0;
+    reader->inputState = isFinal ? READER_HAS_FINAL_INPUT : READER_HAS_INPUT;
     return JSON_Success;
 }
 
-JSON_Status JSON_CALL JSON_Parser_Parse(JSON_Parser parser, const char* pBytes, size_t length, JSON_Boolean isFinal)
+JSON_ReaderResult JSON_CALL JSON_Reader_Next(JSON_Reader reader, JSON_ReaderEvent* pEvent)
 {
-    JSON_Status status = JSON_Failure;
-    if (parser && (pBytes || !length) && !GET_FLAGS(parser->state, PARSER_FINISHED | PARSER_IN_PROTECTED_API))
+    JSON_Parser parser;
+    const QueuedEvent* pQueuedEvent;
+    if (!reader || !pEvent || GET_FLAGS(reader->parser->state, PARSER_IN_PROTECTED_API))
     {
-        int finishedParsing = 0;
-        SET_FLAGS_ON(ParserState, parser->state, PARSER_STARTED | PARSER_IN_PROTECTED_API);
-        if (JSON_Parser_ProcessInputBytes(parser, (const byte*)pBytes, length))
+        return JSON_Reader_Failed;
+    }
+    parser = reader->parser;
+    while (!reader->eventCount)
+    {
+        size_t parsedLength = 0;
+        if (GET_FLAGS(parser->state, PARSER_FINISHED))
         {
-            /* New input was parsed successfully. */
-            if (isFinal)
-            {
-                /* Make sure there is nothing pending in the decoder, lexer,
-                   or parser. */
-                if (JSON_Parser_FlushDecoder(parser) &&
-                    JSON_Parser_FlushLexer(parser) &&
-                    JSON_Parser_FlushParser(parser))
-                {
-                    status = JSON_Success;
-                }
-                finishedParsing = 1;
-            }
-            else
-            {
-                status = JSON_Success;
-            }
+            return (parser->error == JSON_Error_None) ? JSON_Reader_Finished : JSON_Reader_Failed;
         }
-        else
+        if (reader->inputState == READER_HAS_INPUT && reader->inputUsed == reader->inputLength)
         {
-            /* New input failed to parse. */
-            finishedParsing = 1;
+            reader->inputState = READER_NEEDS_INPUT;
         }
-        if (finishedParsing)
+        if (reader->inputState == READER_NEEDS_INPUT)
         {
-            SET_FLAGS_ON(ParserState, parser->state, PARSER_FINISHED);
+            return JSON_Reader_NeedsInput;
         }
-        SET_FLAGS_OFF(ParserState, parser->state, PARSER_IN_PROTECTED_API);
+
+        /* The events that were queued have all been returned, so the
+           values they referred to can be overwritten. */
+        reader->firstEvent = 0;
+        reader->arenaUsed = 0;
+        JSON_Parser_ParseInput(parser, reader->pInput ? (const char*)reader->pInput + reader->inputUsed : NULL, reader->inputLength - reader->inputUsed,
+                               (JSON_Boolean)(reader->inputState == READER_HAS_FINAL_INPUT), &parsedLength);
+        reader->inputUsed += parsedLength;
     }
-    return status;
+    pQueuedEvent = &reader->events[reader->firstEvent];
+    reader->firstEvent++;
+    reader->eventCount--;
+    pEvent->type = (JSON_EventType)pQueuedEvent->type;
+    pEvent->attributes = pQueuedEvent->attributes;
+    pEvent->location = pQueuedEvent->location;
+    pEvent->pValue = pQueuedEvent->isInArena ? (const char*)reader->pArena + pQueuedEvent->valueOffset : (const char*)pQueuedEvent->pValue;
+    pEvent->length = pQueuedEvent->valueLength;
+    return JSON_Reader_HasEvent;
 }
 
 #endif /* JSON_NO_PARSER */
@@ -3211,6 +10301,23 @@ struct JSON_Writer_Data
     Error                     error;
     GrammarianData            grammarianData;
     JSON_Writer_OutputHandler outputHandler;
+    JSON_WriterConfig         config;
+    InstancePool*             pPool;
+    size_t                    poolSlot;
+};
+
+/* A writer configuration instance. Its template writer holds the settings
+   and handlers, and is never used to write. */
+struct JSON_WriterConfig_Data
+{
+    JSON_Writer templateWriter;
+};
+
+/* A writer pool instance. */
+struct JSON_WriterPool_Data
+{
+    InstancePool      base;
+    JSON_WriterConfig config;
 };
 
 /* Writer internal functions. */
@@ -3223,9 +10330,25 @@ static void JSON_Writer_ResetData(JSON_Writer writer, int isInitialized)
     writer->error = JSON_Error_None;
     Grammarian_Reset(&writer->grammarianData, isInitialized);
     writer->outputHandler = NULL;
+    if (!isInitialized)
+    {
+        writer->config = NULL;
+        writer->pPool = NULL;
+        writer->poolSlot = 0;
+    }
     writer->state = WRITER_RESET; /* do this last! */
 }
 
+static void JSON_Writer_CopySettings(JSON_Writer writer, JSON_Writer source)
+{
+    /* Copies the settings and handlers that JSON_Writer_Reset() restores
+       to their default values. */
+    writer->userData = source->userData;
+    writer->flags = source->flags;
+    writer->outputEncoding = source->outputEncoding;
+    writer->outputHandler = source->outputHandler;
+}
+
 static void JSON_Writer_SetError(JSON_Writer writer, Error error)
 {
     writer->error = error;
@@ -3820,7 +10943,7 @@ JSON_Writer JSON_CALL JSON_Writer_Create(const JSON_MemorySuite* pMemorySuite)
 
 JSON_Status JSON_CALL JSON_Writer_Free(JSON_Writer writer)
 {
-    if (!writer || GET_FLAGS(writer->state, WRITER_IN_PROTECTED_API))
+    if (!writer || writer->pPool || GET_FLAGS(writer->state, WRITER_IN_PROTECTED_API))
     {
         return JSON_Failure;
     }
@@ -3839,6 +10962,148 @@ JSON_Status JSON_CALL JSON_Writer_Reset(JSON_Writer writer)
     SET_FLAGS_ON(WriterState, writer->state, WRITER_IN_PROTECTED_API);
     JSON_Writer_ResetData(writer, 1/* isInitialized */);
     /* Note that JSON_Writer_ResetData() unset WRITER_IN_PROTECTED_API for us. */
+    if (writer->config)
+    {
+        JSON_Writer_CopySettings(writer, writer->config->templateWriter);
+    }
+    return JSON_Success;
+}
+
+JSON_WriterConfig JSON_CALL JSON_WriterConfig_Create(JSON_Writer writer, const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_Writer templateWriter;
+    JSON_WriterConfig config;
+    if (!writer || GET_FLAGS(writer->state, WRITER_IN_PROTECTED_API))
+    {
+        return NULL;
+    }
+    templateWriter = JSON_Writer_Create(pMemorySuite);
+    if (!templateWriter)
+    {
+        return NULL;
+    }
+    config = (JSON_WriterConfig)templateWriter->memorySuite.realloc(templateWriter->memorySuite.userData, NULL, sizeof(struct JSON_WriterConfig_Data));
+    if (!config)
+    {
+        JSON_Writer_Free(templateWriter);
+        return NULL;
+    }
+    JSON_Writer_CopySettings(templateWriter, writer);
+    config->templateWriter = templateWriter;
+    return config;
+}
+
+JSON_Status JSON_CALL JSON_WriterConfig_Free(JSON_WriterConfig config)
+{
+    JSON_MemorySuite memorySuite;
+    if (!config)
+    {
+        return JSON_Failure;
+    }
+    memorySuite = config->templateWriter->memorySuite;
+    JSON_Writer_Free(config->templateWriter);
+    memorySuite.free(memorySuite.userData, config);
+    return JSON_Success;
+}
+
+JSON_Writer JSON_CALL JSON_Writer_CreateWithConfig(JSON_WriterConfig config, const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_Writer writer;
+    if (!config)
+    {
+        return NULL;
+    }
+    writer = JSON_Writer_Create(pMemorySuite);
+    if (writer)
+    {
+        JSON_Writer_CopySettings(writer, config->templateWriter);
+        writer->config = config;
+    }
+    return writer;
+}
+
+JSON_WriterPool JSON_CALL JSON_WriterPool_Create(JSON_WriterConfig config, size_t capacity, const JSON_MemorySuite* pMemorySuite)
+{
+    JSON_WriterPool pool;
+    if (!config)
+    {
+        return NULL;
+    }
+    pool = (JSON_WriterPool)InstancePool_Create(pMemorySuite, sizeof(struct JSON_WriterPool_Data), capacity);
+    if (pool)
+    {
+        pool->config = config;
+    }
+    return pool;
+}
+
+JSON_Status JSON_CALL JSON_WriterPool_Free(JSON_WriterPool pool)
+{
+    size_t i;
+    if (!pool || InstancePool_HasAcquiredSlots(&pool->base))
+    {
+        return JSON_Failure;
+    }
+    for (i = 0; i < pool->base.capacity; i++)
+    {
+        JSON_Writer writer = (JSON_Writer)pool->base.pSlots[i].pInstance;
+        if (writer)
+        {
+            writer->pPool = NULL;
+            JSON_Writer_Free(writer);
+        }
+    }
+    InstancePool_Free(&pool->base);
+    return JSON_Success;
+}
+
+JSON_Writer JSON_CALL JSON_WriterPool_Acquire(JSON_WriterPool pool)
+{
+    JSON_Writer writer;
+    size_t slot;
+    if (!pool)
+    {
+        return NULL;
+    }
+    slot = InstancePool_AcquireSlot(&pool->base);
+    if (slot < pool->base.capacity && pool->base.pSlots[slot].pInstance)
+    {
+        return (JSON_Writer)pool->base.pSlots[slot].pInstance;
+    }
+
+    /* When every slot is acquired, the writer is created without a slot,
+       and is freed rather than kept when it is released. */
+    writer = JSON_Writer_CreateWithConfig(pool->config, &pool->base.memorySuite);
+    if (!writer)
+    {
+        if (slot < pool->base.capacity)
+        {
+            InstancePool_ReleaseSlot(&pool->base, slot, NULL);
+        }
+        return NULL;
+    }
+    writer->pPool = &pool->base;
+    writer->poolSlot = slot;
+    if (slot < pool->base.capacity)
+    {
+        pool->base.pSlots[slot].pInstance = writer;
+    }
+    return writer;
+}
+
+JSON_Status JSON_CALL JSON_WriterPool_Release(JSON_WriterPool pool, JSON_Writer writer)
+{
+    if (!pool || !writer || writer->pPool != &pool->base || GET_FLAGS(writer->state, WRITER_IN_PROTECTED_API))
+    {
+        return JSON_Failure;
+    }
+    if (writer->poolSlot == pool->base.capacity)
+    {
+        writer->pPool = NULL;
+        return JSON_Writer_Free(writer);
+    }
+    JSON_Writer_Reset(writer);
+    InstancePool_ReleaseSlot(&pool->base, writer->poolSlot, writer);
     return JSON_Success;
 }
 
@@ -4192,3 +11457,180 @@ JSON_Encoding JSON_CALL JSON_NativeUTF32Encoding(void)
 {
     return (JSON_Encoding)(((byte*)&endianEncodings)[0]);
 }
+
+size_t JSON_CALL JSON_FindRecordBoundary(const char* pBytes, size_t length, size_t offset)
+{
+    /* Neither byte can occur inside a multi-byte UTF-8 sequence. */
+    const byte* pRecords = (const byte*)pBytes;
+    if (offset >= length)
+    {
+        return length;
+    }
+    if (!offset || pRecords[offset - 1] == LINE_FEED_CODEPOINT)
+    {
+        return offset;
+    }
+    for (; offset < length; offset++)
+    {
+        if (pRecords[offset] == LINE_FEED_CODEPOINT)
+        {
+            return offset + 1;
+        }
+        if (pRecords[offset] == RECORD_SEPARATOR_CODEPOINT)
+        {
+            return offset;
+        }
+    }
+    return length;
+}
+
+/* The number of bytes after the offset that JSON_FindArrayItemBoundary()
+   looks at. */
+#define ARRAY_ITEM_BOUNDARY_LOOKAHEAD (1024 * 1024)
+
+static int IsWhitespaceByte(byte b)
+{
+    return b == ' ' || b == TAB_CODEPOINT || b == LINE_FEED_CODEPOINT || b == CARRIAGE_RETURN_CODEPOINT;
+}
+
+static int IsEscapedByte(const byte* pBytes, size_t index)
+{
+    /* A character is escaped if an odd number of backslashes precede it. */
+    size_t backslashes = 0;
+    while (index > backslashes && pBytes[index - backslashes - 1] == '\\')
+    {
+        backslashes++;
+    }
+    return (int)(backslashes & 1);
+}
+
+static int CanStartString(const byte* pBytes, size_t index)
+{
+    /* An opening quotation mark follows the start of a container, a comma
+       or a colon. */
+    while (index && IsWhitespaceByte(pBytes[index - 1]))
+    {
+        index--;
+    }
+    return !index || pBytes[index - 1] == '[' || pBytes[index - 1] == '{' || pBytes[index - 1] == ',' || pBytes[index - 1] == ':';
+}
+
+static int CanEndString(const byte* pBytes, size_t index, size_t end)
+{
+    /* A closing quotation mark is followed by the end of a container, a
+       comma or a colon. */
+    index++;
+    while (index < end && IsWhitespaceByte(pBytes[index]))
+    {
+        index++;
+    }
+    return index == end || pBytes[index] == ']' || pBytes[index] == '}' || pBytes[index] == ',' || pBytes[index] == ':';
+}
+
+static int IsInsideString(const byte* pBytes, size_t start, size_t end)
+{
+    /* The unescaped quotation marks after the position alternately open
+       and close strings, so if the position is inside a string, the odd
+       ones open strings, and otherwise the even ones do. The quotation
+       marks are checked against both possibilities until only one of them
+       fits; in valid JSON, the right one always does. If both fit, which
+       is only likely if there are no quotation marks at all, we guess that
+       the position is not inside a string. */
+    int outsideFits = 1;
+    int insideFits = 1;
+    size_t quotes = 0;
+    size_t i;
+    for (i = start; i < end && outsideFits && insideFits; i++)
+    {
+        if (pBytes[i] == '"' && !IsEscapedByte(pBytes, i))
+        {
+            int canStart = CanStartString(pBytes, i);
+            int canEnd = CanEndString(pBytes, i, end);
+            if (quotes & 1)
+            {
+                outsideFits = canEnd;
+                insideFits = canStart;
+            }
+            else
+            {
+                outsideFits = canStart;
+                insideFits = canEnd;
+            }
+            quotes++;
+        }
+    }
+    return insideFits && !outsideFits;
+}
+
+size_t JSON_CALL JSON_FindArrayItemBoundary(const char* pBytes, size_t length, size_t offset)
+{
+    const byte* pArray = (const byte*)pBytes;
+    size_t boundary = length;
+    size_t end = length;
+    long depth = 0;
+    long minDepth = 0;
+    int insideString;
+    if (!offset || offset >= length)
+    {
+        return offset ? length : 0;
+    }
+
+    /* The array's right square bracket is left out of the search, since
+       the depth that it closes is shallower than that of any boundary. */
+    while (end > offset && IsWhitespaceByte(pArray[end - 1]))
+    {
+        end--;
+    }
+    if (end > offset)
+    {
+        end--;
+    }
+    if (end - offset > ARRAY_ITEM_BOUNDARY_LOOKAHEAD)
+    {
+        end = offset + ARRAY_ITEM_BOUNDARY_LOOKAHEAD;
+    }
+    insideString = IsInsideString(pArray, offset, end);
+    if (insideString && IsEscapedByte(pArray, offset))
+    {
+        offset++;
+    }
+    for (; offset < end; offset++)
+    {
+        byte b = pArray[offset];
+        if (insideString)
+        {
+            if (b == '\\')
+            {
+                offset++;
+            }
+            else if (b == '"')
+            {
+                insideString = 0;
+            }
+        }
+        else if (b == '"')
+        {
+            insideString = 1;
+        }
+        else if (b == '{' || b == '[')
+        {
+            depth++;
+        }
+        else if (b == '}' || b == ']')
+        {
+            depth--;
+            if (depth < minDepth)
+            {
+                /* The commas found so far are inside the container that
+                   just ended. */
+                minDepth = depth;
+                boundary = length;
+            }
+        }
+        else if (b == ',' && depth == minDepth && boundary == length)
+        {
+            boundary = offset;
+        }
+    }
+    return boundary;
+}
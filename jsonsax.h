@@ -35,6 +35,11 @@
 #error JSON_NO_PARSER and JSON_NO_WRITER cannot both be defined!
 #endif
 
+/* JSON_NO_SIMD, if defined when building the library, prevents the parser
+ * from using SIMD instructions (SSE2, SSSE3 or AVX2, when the compiler targets
+ * them) to scan input, so that only portable C is used.
+ */
+
 #include <stddef.h> /* for size_t and NULL */
 
 /* The library API is C and should not be subjected to C++ name mangling. */
@@ -82,6 +87,16 @@ extern "C" {
 
 #define JSON_API(t) JSON_EXPORT t JSON_CALL
 
+/* 64-bit integer types used by the library (compiler-dependent). */
+#if defined(_MSC_VER)
+typedef __int64          JSON_Int64;
+typedef unsigned __int64 JSON_UInt64;
+#else
+#include <stdint.h>
+typedef int64_t          JSON_Int64;
+typedef uint64_t         JSON_UInt64;
+#endif
+
 /* Boolean values used by the library. */
 typedef enum tag_JSON_Boolean
 {
@@ -207,6 +222,86 @@ typedef struct tag_JSON_MemorySuite
     JSON_FreeHandler    free;
 } JSON_MemorySuite;
 
+/******************** Arena Memory Suite ********************/
+
+/* Arena instance.
+ *
+ * An arena is a ready-made memory suite that allocates memory by bumping a
+ * pointer through large slabs, which it obtains from an underlying memory
+ * suite. Freeing memory is a no-op, except that the most recent
+ * allocations in the current slab are reclaimed when they are freed in
+ * the reverse order of their allocation; all of the arena's memory is
+ * reclaimed at once when the arena is reset.
+ *
+ * This makes allocation very cheap for clients that parse or write one
+ * document at a time: create a parser or writer from the arena's memory
+ * suite, use it for one document, free it, and reset the arena. The slabs
+ * are kept across resets, so once the arena has grown big enough for the
+ * documents being processed, it doesn't call the underlying memory suite
+ * at all.
+ *
+ * Blocks allocated from an arena are aligned suitably for any of the basic
+ * C types.
+ */
+struct JSON_Arena_Data; /* opaque data */
+typedef struct JSON_Arena_Data* JSON_Arena;
+
+/* Create an arena instance.
+ *
+ * If pMemorySuite is null, the library will use the C runtime realloc() and
+ * free() as the arena's underlying memory suite. Otherwise, all the
+ * handlers in the memory suite must be non-null or the call will fail and
+ * return null.
+ *
+ * The slabSize parameter specifies the size in bytes of the slabs that the
+ * arena allocates from the underlying memory suite; if it is 0, a default
+ * size of 64 KB is used. Allocations too big to fit in a slab are given a
+ * slab of their own.
+ */
+JSON_API(JSON_Arena) JSON_Arena_Create(const JSON_MemorySuite* pMemorySuite, size_t slabSize);
+
+/* Free an arena instance, and all of the memory allocated from it.
+ *
+ * Every successful call to JSON_Arena_Create() must eventually be paired
+ * with a call to JSON_Arena_Free() in order to avoid leaking memory.
+ *
+ * This function returns failure if the arena parameter is null.
+ */
+JSON_API(JSON_Status) JSON_Arena_Free(JSON_Arena arena);
+
+/* Reset an arena instance, reclaiming all of the memory allocated from it
+ * at once.
+ *
+ * No parser, writer or tape instance whose memory suite is the arena's
+ * may be in use when the arena is reset; such instances do not need to be
+ * freed first, since freeing memory to an arena is a no-op anyway, but
+ * they must not be used (or freed) afterwards.
+ *
+ * This function returns failure if the arena parameter is null.
+ */
+JSON_API(JSON_Status) JSON_Arena_Reset(JSON_Arena arena);
+
+/* Get the memory suite that allocates memory from an arena instance.
+ *
+ * The result can be passed directly to JSON_Parser_Create(),
+ * JSON_Writer_Create() or JSON_Tape_Create(). It remains valid until the
+ * arena is freed.
+ *
+ * This function returns null if the arena parameter is null.
+ */
+JSON_API(const JSON_MemorySuite*) JSON_Arena_GetMemorySuite(JSON_Arena arena);
+
+/* Get the greatest number of bytes that have been allocated from an arena
+ * instance at once since it was created, including the space taken up by
+ * the arena's own bookkeeping for each block.
+ *
+ * Clients can use this value to choose a slab size big enough for their
+ * documents to fit in a single slab.
+ *
+ * This function returns 0 if the arena parameter is null.
+ */
+JSON_API(size_t) JSON_Arena_GetHighWaterMark(JSON_Arena arena);
+
 /******************** JSON Parser ********************/
 
 #ifndef JSON_NO_PARSER
@@ -224,13 +319,139 @@ typedef struct JSON_Parser_Data* JSON_Parser;
  */
 JSON_API(JSON_Parser) JSON_Parser_Create(const JSON_MemorySuite* pMemorySuite);
 
+/* Create a parser instance with the same settings and handlers as an
+ * existing parser instance.
+ *
+ * The pMemorySuite parameter has the same meaning as it does for
+ * JSON_Parser_Create(); the existing parser's memory suite is not shared
+ * with the new parser. The new parser gets the existing parser's user data,
+ * settings, known keys, path filter and handlers, except for its event
+ * batch handler and its tape, which belong to the existing parser. It does
+ * not get the existing parser's parse state or interned keys, so interned
+ * key IDs are not comparable between the two parsers; known key indexes
+ * are.
+ *
+ * Parsers that do not share memory suites, tapes or event buffers are
+ * independent of each other, so a clone can be used to parse one part of a
+ * larger input on another thread while the existing parser, or other
+ * clones, parse the other parts. Cloning only reads the existing parser,
+ * so any number of threads can clone it at once as long as no thread is
+ * using it to parse or changing its settings at the same time.
+ *
+ * This function returns null if the parser parameter is null or if memory
+ * could not be allocated for the new parser.
+ */
+JSON_API(JSON_Parser) JSON_Parser_Clone(JSON_Parser parser, const JSON_MemorySuite* pMemorySuite);
+
+/* Parser configuration instance.
+ *
+ * A configuration is an immutable snapshot of the settings and handlers of
+ * a parser instance, from which any number of parsers can be created
+ * without calling each setter again. Parsers created from a configuration
+ * stay bound to it: JSON_Parser_Reset() restores their settings and
+ * handlers to the configuration's rather than to the default values.
+ *
+ * Creating parsers from a configuration only reads it, so any number of
+ * threads can share one configuration.
+ */
+struct JSON_ParserConfig_Data; /* opaque data */
+typedef struct JSON_ParserConfig_Data* JSON_ParserConfig;
+
+/* Create a parser configuration instance.
+ *
+ * The configuration gets the same settings and handlers from the parser
+ * that JSON_Parser_Clone() would give a clone, and the parser can be
+ * changed or freed afterwards without affecting the configuration. The
+ * pMemorySuite parameter has the same meaning as it does for
+ * JSON_Parser_Create(); it is used to allocate the configuration.
+ *
+ * This function returns null if the parser parameter is null, if the
+ * function was called from inside a handler, or if memory could not be
+ * allocated for the configuration.
+ */
+JSON_API(JSON_ParserConfig) JSON_ParserConfig_Create(JSON_Parser parser, const JSON_MemorySuite* pMemorySuite);
+
+/* Free a parser configuration instance.
+ *
+ * No parser created from the configuration, and no pool of such parsers,
+ * may be used after the configuration is freed.
+ *
+ * This function returns failure if the config parameter is null.
+ */
+JSON_API(JSON_Status) JSON_ParserConfig_Free(JSON_ParserConfig config);
+
+/* Create a parser instance bound to a configuration.
+ *
+ * The pMemorySuite parameter has the same meaning as it does for
+ * JSON_Parser_Create(). The parser must be freed with JSON_Parser_Free()
+ * before its configuration is freed.
+ *
+ * This function returns null if the config parameter is null or if memory
+ * could not be allocated for the new parser.
+ */
+JSON_API(JSON_Parser) JSON_Parser_CreateWithConfig(JSON_ParserConfig config, const JSON_MemorySuite* pMemorySuite);
+
+/* Parser pool instance.
+ *
+ * A pool keeps up to a fixed number of parsers bound to a configuration,
+ * so that a server that parses many small inputs doesn't have to create
+ * and configure a parser for each of them. JSON_ParserPool_Acquire() hands
+ * out an idle parser, creating one the first time each of the pool's slots
+ * is used, and JSON_ParserPool_Release() resets the parser (keeping its
+ * buffers, see JSON_Parser_Reset()) and makes it idle again. When every
+ * slot is in use, JSON_ParserPool_Acquire() creates an extra parser, which
+ * JSON_ParserPool_Release() frees.
+ *
+ * Any number of threads can acquire and release parsers at once without
+ * locking; the pool uses the compiler's atomic operations, so it is only
+ * available when the library is built by a compiler that provides them
+ * (GCC, Clang or Microsoft Visual C++). A parser acquired from a pool must
+ * only be used by one thread at a time, and must not be freed by the
+ * client; JSON_Parser_Free() returns failure for pooled parsers.
+ */
+struct JSON_ParserPool_Data; /* opaque data */
+typedef struct JSON_ParserPool_Data* JSON_ParserPool;
+
+/* Create a parser pool instance.
+ *
+ * The capacity parameter specifies the number of parsers that the pool
+ * keeps. The pMemorySuite parameter has the same meaning as it does for
+ * JSON_Parser_Create(); it is used to allocate the pool and its parsers,
+ * so it must be safe to call from any thread that uses the pool.
+ *
+ * This function returns null if the config parameter is null, if the
+ * capacity parameter is 0, if memory could not be allocated for the pool,
+ * or if the library was built without atomic operations.
+ */
+JSON_API(JSON_ParserPool) JSON_ParserPool_Create(JSON_ParserConfig config, size_t capacity, const JSON_MemorySuite* pMemorySuite);
+
+/* Free a parser pool instance and the parsers that it keeps.
+ *
+ * This function returns failure if the pool parameter is null or if any
+ * of the pool's parsers is still acquired.
+ */
+JSON_API(JSON_Status) JSON_ParserPool_Free(JSON_ParserPool pool);
+
+/* Acquire a parser from, or release a parser to, a parser pool instance.
+ *
+ * JSON_ParserPool_Acquire() returns null if the pool parameter is null or
+ * if memory could not be allocated for a new parser.
+ *
+ * JSON_ParserPool_Release() returns failure if either parameter is null,
+ * if the parser was not acquired from the pool, or if the function was
+ * called from inside one of the parser's handlers.
+ */
+JSON_API(JSON_Parser) JSON_ParserPool_Acquire(JSON_ParserPool pool);
+JSON_API(JSON_Status) JSON_ParserPool_Release(JSON_ParserPool pool, JSON_Parser parser);
+
 /* Free a parser instance.
  *
  * Every successful call to JSON_Parser_Create() must eventually be paired
  * with a call to JSON_Parser_Free() in order to avoid leaking memory.
  *
- * This function returns failure if the parser parameter is null or if the
- * function was called reentrantly from inside a handler.
+ * This function returns failure if the parser parameter is null, if the
+ * parser was acquired from a pool, or if the function was called
+ * reentrantly from inside a handler.
  */
 JSON_API(JSON_Status) JSON_Parser_Free(JSON_Parser parser);
 
@@ -242,10 +463,85 @@ JSON_API(JSON_Status) JSON_Parser_Free(JSON_Parser parser);
  * After a parser is reset, its state is indistinguishable from its state
  * when it was returned by JSON_Parser_Create(). The parser's custom memory
  * suite, if any, is preserved; all other settings, state, and handlers are
- * restored to their default values.
+ * restored to their default values, or to those of the parser's
+ * configuration if it was created by JSON_Parser_CreateWithConfig().
  */
 JSON_API(JSON_Status) JSON_Parser_Reset(JSON_Parser parser);
 
+/* Save and restore the state of a parser instance that is partway through
+ * an input stream.
+ *
+ * JSON_Parser_SaveState() writes a snapshot of the parser's state to the
+ * length bytes at pState, and sets *pStateLength to the length of the
+ * snapshot. If pState is null, the function just sets *pStateLength, so
+ * that the client can allocate a big enough buffer. The snapshot is a
+ * compact, versioned byte string that does not contain pointers, so it can
+ * be stored, or sent to another process or machine, and loaded later.
+ *
+ * JSON_Parser_LoadState() restores the state in a snapshot to a parser that
+ * has not started parsing. The client can then pass the parser the rest of
+ * the input stream, starting with the byte after the last one that the
+ * saving parser was passed, and the parser behaves exactly as the saving
+ * parser would have, down to the locations, member names and interned key
+ * IDs that it reports.
+ *
+ * A snapshot holds the state of the input stream, not the parser's
+ * settings, handlers, known keys or path filter; the client must set those
+ * up on the loading parser the same way that they were set up on the
+ * saving parser before calling JSON_Parser_LoadState(). The settings that
+ * affect how the state is interpreted are recorded in the snapshot, and
+ * loading fails if they don't match. The snapshot also ends with a
+ * checksum, and loading fails if the snapshot is damaged. If the loading
+ * parser's input encoding has been set, it must match the saving parser's.
+ *
+ * JSON_Parser_SaveState() returns failure if the parser or pStateLength
+ * parameters are null, if the parser has finished parsing, if the parser
+ * has a tape (refer to JSON_Parser_SetTape() for details), if the buffer is
+ * too short, or if the function was called from inside a handler.
+ *
+ * JSON_Parser_LoadState() returns failure if the parser or pState
+ * parameters are null, if the parser has started parsing or has a tape, if
+ * the snapshot is damaged, was written by a different version of the
+ * library, or does not match the parser's settings, or if memory could not
+ * be allocated. If loading fails, the parser is left as it was, except
+ * that its table of interned member names may have been emptied.
+ */
+JSON_API(JSON_Status) JSON_Parser_SaveState(JSON_Parser parser, void* pState, size_t length, size_t* pStateLength);
+JSON_API(JSON_Status) JSON_Parser_LoadState(JSON_Parser parser, const void* pState, size_t length);
+
+/* Manage the memory that a parser instance keeps for the current token and
+ * for its stack of open containers.
+ *
+ * Both buffers grow as needed, and JSON_Parser_Reset() keeps them at the
+ * size they have grown to, so that a parser that is reused does not have
+ * to grow them again. JSON_Parser_Reserve() grows them up front, so that
+ * tokens of up to tokenBytes bytes, when encoded in the string or number
+ * encoding, and containers nested up to depth levels deep, can be parsed
+ * without growing them. JSON_Parser_Trim() shrinks each of them to
+ * keepBytes bytes, but not past what it currently holds, so that a single
+ * huge token does not pin memory for the life of the parser.
+ *
+ * JSON_Parser_GetTokenBytesHighWaterMark() and
+ * JSON_Parser_GetDepthHighWaterMark() get the length in bytes of the
+ * longest token that was copied into the token buffer, and the deepest
+ * nesting of containers, since the parser was created or last trimmed.
+ * Trimming resets the depth high-water mark to the current depth. Tokens
+ * that were passed to the handlers by reference (refer to
+ * JSON_Parser_SetStringRefHandler() for details) don't count. Clients that
+ * pool parsers can use these values to decide what to reserve and what to
+ * keep.
+ *
+ * JSON_Parser_Reserve() and JSON_Parser_Trim() return failure if the parser
+ * parameter is null or if the function was called from inside a handler.
+ * JSON_Parser_Reserve() also returns failure if memory could not be
+ * allocated. The high-water mark functions return 0 if the parser
+ * parameter is null.
+ */
+JSON_API(JSON_Status) JSON_Parser_Reserve(JSON_Parser parser, size_t tokenBytes, size_t depth);
+JSON_API(JSON_Status) JSON_Parser_Trim(JSON_Parser parser, size_t keepBytes);
+JSON_API(size_t) JSON_Parser_GetTokenBytesHighWaterMark(JSON_Parser parser);
+JSON_API(size_t) JSON_Parser_GetDepthHighWaterMark(JSON_Parser parser);
+
 /* Get and set the user data value associated with a parser instance.
  *
  * This setting allows clients to associate additional data with a
@@ -330,6 +626,27 @@ JSON_API(JSON_Status) JSON_Parser_SetNumberEncoding(JSON_Parser parser, JSON_Enc
 JSON_API(size_t) JSON_Parser_GetMaxNumberLength(JSON_Parser parser);
 JSON_API(JSON_Status) JSON_Parser_SetMaxNumberLength(JSON_Parser parser, size_t maxLength);
 
+/* Get and set how a parser instance grows the buffer that holds the current
+ * token when a token doesn't fit in it.
+ *
+ *   - JSON_GrowByDoubling: the buffer doubles in size each time it grows.
+ *
+ *   - JSON_GrowByHalf: the buffer grows by half of its size each time it
+ *     grows, which takes more steps to reach a given size but overshoots
+ *     the longest token by less.
+ *
+ * The default value of this setting is JSON_GrowByDoubling.
+ *
+ * This setting cannot be changed once the parser has started parsing.
+ */
+typedef enum tag_JSON_BufferGrowthPolicy
+{
+    JSON_GrowByDoubling = 0,
+    JSON_GrowByHalf     = 1
+} JSON_BufferGrowthPolicy;
+JSON_API(JSON_BufferGrowthPolicy) JSON_Parser_GetBufferGrowthPolicy(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetBufferGrowthPolicy(JSON_Parser parser, JSON_BufferGrowthPolicy policy);
+
 /* Get and set whether a parser instance allows the input to begin with a
  * byte-order-mark (BOM).
  *
@@ -454,6 +771,46 @@ JSON_API(JSON_Status) JSON_Parser_SetReplaceInvalidEncodingSequences(JSON_Parser
 JSON_API(JSON_Boolean) JSON_Parser_GetTrackObjectMembers(JSON_Parser parser);
 JSON_API(JSON_Status) JSON_Parser_SetTrackObjectMembers(JSON_Parser parser, JSON_Boolean trackObjectMembers);
 
+/* Get and set the capacity of a parser instance's table of interned object
+ * member names, and what the parser does when the table is full.
+ *
+ * When an interned member handler is set (refer to
+ * JSON_Parser_SetInternedMemberHandler() for details), the parser looks up
+ * each object member name in this table, and gives each name it has not
+ * seen before an ID in the range [0, capacity). Clients that see the same
+ * few names over and over can then key their own lookups on the ID instead
+ * of hashing the name again.
+ *
+ * When the table is full and the parser encounters a name that is not in
+ * it, the eviction policy determines what happens:
+ *
+ *   - JSON_EvictLeastRecentlyUsed: the parser evicts a name that has not
+ *     been seen recently (approximating least-recently-used order) and
+ *     gives its ID to the new name.
+ *
+ *   - JSON_EvictNone: the names already in the table stay there, and the
+ *     new name is passed to the handler without an ID.
+ *
+ * The default capacity is 1024, and the default eviction policy is
+ * JSON_EvictLeastRecentlyUsed. A capacity of 0 disables interning.
+ *
+ * Unlike the parser's other settings, these settings and the contents of
+ * the table are preserved by JSON_Parser_Reset(), so that names keep their
+ * IDs across a stream of documents parsed one after another. Changing the
+ * capacity empties the table.
+ *
+ * These settings cannot be changed once the parser has started parsing.
+ */
+typedef enum tag_JSON_KeyEvictionPolicy
+{
+    JSON_EvictLeastRecentlyUsed = 0,
+    JSON_EvictNone              = 1
+} JSON_KeyEvictionPolicy;
+JSON_API(size_t) JSON_Parser_GetInternedKeyCapacity(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetInternedKeyCapacity(JSON_Parser parser, size_t capacity);
+JSON_API(JSON_KeyEvictionPolicy) JSON_Parser_GetKeyEvictionPolicy(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetKeyEvictionPolicy(JSON_Parser parser, JSON_KeyEvictionPolicy policy);
+
 /* Get and set whether a parser instance stops parsing as soon as the end of
  * the top-level JSON document is parsed.
  *
@@ -471,6 +828,105 @@ JSON_API(JSON_Status) JSON_Parser_SetTrackObjectMembers(JSON_Parser parser, JSON
 JSON_API(JSON_Boolean) JSON_Parser_GetStopAfterEmbeddedDocument(JSON_Parser parser);
 JSON_API(JSON_Status) JSON_Parser_SetStopAfterEmbeddedDocument(JSON_Parser parser, JSON_Boolean stopAfterEmbeddedDocument);
 
+/* Get and set whether a parser instance parses a sequence of top-level
+ * JSON documents instead of a single one.
+ *
+ * This setting allows the client to parse newline-delimited JSON, and
+ * concatenated JSON documents in general, with a single parser instance.
+ * Documents can be separated by any whitespace, by nothing at all when
+ * that is unambiguous (as in "{}[]"), and by the ASCII record separator
+ * character (U+001E) that precedes each document in RFC 7464 JSON text
+ * sequences. Zero documents is a valid sequence.
+ *
+ * The parser calls the start document handler before the first event of
+ * each document and the end document handler after its last event. The
+ * handlers, the settings, and the buffers that the parser has grown are
+ * kept from one document to the next; the things that belong to a single
+ * document, such as the object member names tracked by the
+ * TrackObjectMembers setting and the paths matched by the path filter,
+ * are not. When the parser has a tape, the tape holds the current
+ * document, and is complete when the end document handler is called.
+ *
+ * If the StopAfterEmbeddedDocument setting is also enabled, the parser
+ * stops after the first document as usual.
+ *
+ * The default value of this setting is JSON_False.
+ *
+ * This setting cannot be changed once the parser has started parsing.
+ */
+JSON_API(JSON_Boolean) JSON_Parser_GetAllowMultipleDocuments(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetAllowMultipleDocuments(JSON_Parser parser, JSON_Boolean allowMultipleDocuments);
+
+/* Get and set whether a parser instance accepts a segment of a top-level
+ * array instead of a whole document.
+ *
+ * This setting allows the client to split a very large top-level array
+ * into segments just before the commas between its items (see
+ * JSON_FindArrayItemBoundary()), and to parse the segments independently,
+ * for example on separate threads, with a parser for each.
+ *
+ * A segment that starts with a comma is parsed as if it were preceded by
+ * the array's left square bracket and by the items before it: the start
+ * array handler is called before the comma is parsed. A segment that ends
+ * right after an item of the array, rather than with the array's right
+ * square bracket, is parsed as if it ended with the bracket: the end
+ * array handler is called once all of the input has been parsed. Thus the
+ * handlers see each segment as an array of its own items; array indexes,
+ * including those in path filter paths, count from the segment's first
+ * item. The client can count the items of each segment to find the index
+ * of each item in the whole array.
+ *
+ * The segments are only correct if each of them except the first starts
+ * at a comma between two items of the array. The client can check this by
+ * checking that every segment parsed successfully and that the last one
+ * contained the array's right square bracket, which is the case if the
+ * token location of the end array event for the top-level array is before
+ * the end of the segment (when the bracket is missing, the event is
+ * located at the end of the segment). If each segment starts at some comma
+ * in the array, as those that start at the boundaries returned by
+ * JSON_FindArrayItemBoundary() do, the first segment that starts at a
+ * wrong comma always leaves the segment before it unterminated, inside a
+ * string or a nested value, so that the parse of the segment before it
+ * fails with JSON_Error_IncompleteToken or JSON_Error_ExpectedMoreTokens.
+ * The client can then join the two segments and parse the result again,
+ * until it parses successfully or is the last segment; if every segment
+ * then parses successfully, the segments are correct.
+ *
+ * This setting has no effect in multi-document mode.
+ *
+ * The default value of this setting is JSON_False.
+ *
+ * This setting cannot be changed once the parser has started parsing.
+ */
+JSON_API(JSON_Boolean) JSON_Parser_GetAllowArraySegment(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetAllowArraySegment(JSON_Parser parser, JSON_Boolean allowArraySegment);
+
+/* Get and set whether a parser instance tracks the line and column numbers
+ * of locations in the input stream lazily.
+ *
+ * By default, the parser updates the line and column numbers of its current
+ * location as it processes each character of input. If this setting is
+ * enabled, the parser only keeps track of byte offsets while parsing, and
+ * reconstructs the line and column numbers by rescanning the input when
+ * they are actually needed: when the client calls
+ * JSON_Parser_GetTokenLocation() or JSON_Parser_GetAfterTokenLocation()
+ * from a parse handler, when parsing fails, and before a call to
+ * JSON_Parser_Parse() that does not finish parsing returns, since the
+ * parser cannot refer to the client's buffer afterwards. The locations
+ * reported are identical in either case.
+ *
+ * Because each buffer that does not finish parsing is rescanned in its
+ * entirety, this setting only makes parsing faster for clients that
+ * rarely ask for locations and pass the whole input to the parser at
+ * once, in a single call to JSON_Parser_Parse().
+ *
+ * The default value of this setting is JSON_False.
+ *
+ * This setting cannot be changed once the parser has started parsing.
+ */
+JSON_API(JSON_Boolean) JSON_Parser_GetTrackLocationsLazily(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetTrackLocationsLazily(JSON_Parser parser, JSON_Boolean trackLocationsLazily);
+
 /* Get the type of error, if any, encountered by a parser instance.
  *
  * If the parser encountered an error while parsing input, this function
@@ -537,12 +993,26 @@ JSON_API(JSON_Status) JSON_Parser_GetAfterTokenLocation(JSON_Parser parser, JSON
  * Note that JSON_TreatAsDuplicateObjectMember should only be returned by
  * object member handlers. Refer to JSON_Parser_SetObjectMemberHandler()
  * for details.
+ *
+ * JSON_Parser_SkipValue should only be returned by object member handlers
+ * (including the object member ref, interned member, and known member
+ * handlers), by start object and start array handlers, and by the path
+ * match handler; any other handler that returns it aborts the parse.
+ * Returned from an object member handler, it skips the member's value;
+ * returned from a start object or start array handler, it skips the rest
+ * of the object or array, including its end; returned from the path match
+ * handler, it skips the matched value. The skipped value is still parsed and
+ * validated in full, so skipping never changes whether the input is
+ * accepted or where an error is reported, but no handlers are called for
+ * it and none of its tokens are copied where they can be referenced in
+ * the input instead.
  */
 typedef enum tag_JSON_Parser_HandlerResult
 {
     JSON_Parser_Continue                     = 0,
     JSON_Parser_Abort                        = 1,
-    JSON_Parser_TreatAsDuplicateObjectMember = 2
+    JSON_Parser_TreatAsDuplicateObjectMember = 2,
+    JSON_Parser_SkipValue                    = 3
 } JSON_Parser_HandlerResult;
 
 /* Get and set the handler that is called when a parser instance detects the
@@ -608,7 +1078,8 @@ JSON_API(JSON_Status) JSON_Parser_SetStringHandler(JSON_Parser parser, JSON_Pars
  * and different clients may wish to interpret them differently, for
  * example, as IEEE 754 doubles, 64-bit integers, or arbitrary-precision
  * bignums. For this reason, the parser does not attempt to interpret
- * number values, but leaves this to the client.
+ * number values, but leaves this to the client, unless the client sets
+ * one of the native number handlers (see below).
  *
  * The pValue parameter points to a buffer containing the number value,
  * encoded according to the parser instance's number encoding setting. The
@@ -641,6 +1112,9 @@ JSON_API(JSON_Status) JSON_Parser_SetSpecialNumberHandler(JSON_Parser parser, JS
 
 /* Get and set the handler that is called when a parser instance encounters
  * the left curly brace that starts an object.
+ *
+ * The handler can return JSON_Parser_SkipValue to skip the object's
+ * contents; the end object handler is then not called for it.
  */
 typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_StartObjectHandler)(JSON_Parser parser);
 JSON_API(JSON_Parser_StartObjectHandler) JSON_Parser_GetStartObjectHandler(JSON_Parser parser);
@@ -681,6 +1155,8 @@ JSON_API(JSON_Status) JSON_Parser_SetEndObjectHandler(JSON_Parser parser, JSON_P
  * specified name. This allows clients to implement duplicate member
  * checking without incurring the additional memory overhead associated
  * with enabling the TrackObjectMembers setting.
+ *
+ * The handler can return JSON_Parser_SkipValue to skip the member's value.
  */
 typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_ObjectMemberHandler)(JSON_Parser parser, char* pValue, size_t length, JSON_StringAttributes attributes);
 JSON_API(JSON_Parser_ObjectMemberHandler) JSON_Parser_GetObjectMemberHandler(JSON_Parser parser);
@@ -688,6 +1164,9 @@ JSON_API(JSON_Status) JSON_Parser_SetObjectMemberHandler(JSON_Parser parser, JSO
 
 /* Get and set the handler that is called when a parser instance encounters
  * the left square brace that starts an array.
+ *
+ * The handler can return JSON_Parser_SkipValue to skip the array's
+ * contents; the end array handler is then not called for it.
  */
 typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_StartArrayHandler)(JSON_Parser parser);
 JSON_API(JSON_Parser_StartArrayHandler) JSON_Parser_GetStartArrayHandler(JSON_Parser parser);
@@ -710,6 +1189,335 @@ typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_ArrayItemHandler)(JSO
 JSON_API(JSON_Parser_ArrayItemHandler) JSON_Parser_GetArrayItemHandler(JSON_Parser parser);
 JSON_API(JSON_Status) JSON_Parser_SetArrayItemHandler(JSON_Parser parser, JSON_Parser_ArrayItemHandler handler);
 
+/* Get and set the handlers that are called when a parser instance that
+ * allows multiple documents starts and finishes parsing a document.
+ *
+ * The start document handler is called before the events of the first
+ * token of the document, and the end document handler is called after the
+ * events of its last token, so JSON_Parser_GetTokenLocation() returns the
+ * location of that token. In batch mode, the events recorded before a
+ * document handler is called are delivered first. These handlers are not
+ * called unless the AllowMultipleDocuments setting is enabled.
+ */
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_StartDocumentHandler)(JSON_Parser parser);
+JSON_API(JSON_Parser_StartDocumentHandler) JSON_Parser_GetStartDocumentHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetStartDocumentHandler(JSON_Parser parser, JSON_Parser_StartDocumentHandler handler);
+
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_EndDocumentHandler)(JSON_Parser parser);
+JSON_API(JSON_Parser_EndDocumentHandler) JSON_Parser_GetEndDocumentHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetEndDocumentHandler(JSON_Parser parser, JSON_Parser_EndDocumentHandler handler);
+
+/* Get and set the handlers that are called instead of the string, number,
+ * and object member handlers, respectively, when they are set. These
+ * handlers allow the parser to avoid copying values.
+ *
+ * If the parser instance's string (or number) encoding is the same as its
+ * input encoding, and a value appears verbatim in a single buffer passed to
+ * JSON_Parser_Parse(), the pValue parameter points directly into that
+ * buffer. Otherwise -- for example, if the value contains escape sequences
+ * or replaced invalid encoding sequences, or spans more than one call to
+ * JSON_Parser_Parse() -- the value is copied to the parser instance's
+ * internal buffer as usual, and pValue points there instead. Either way,
+ * the buffer is NOT null-terminated and must not be modified, and it is
+ * only valid until the handler returns.
+ *
+ * The length and attributes parameters, and the handler return values, have
+ * the same meaning as for the corresponding handlers above.
+ */
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_StringRefHandler)(JSON_Parser parser, const char* pValue, size_t length, JSON_StringAttributes attributes);
+JSON_API(JSON_Parser_StringRefHandler) JSON_Parser_GetStringRefHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetStringRefHandler(JSON_Parser parser, JSON_Parser_StringRefHandler handler);
+
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_NumberRefHandler)(JSON_Parser parser, const char* pValue, size_t length, JSON_NumberAttributes attributes);
+JSON_API(JSON_Parser_NumberRefHandler) JSON_Parser_GetNumberRefHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetNumberRefHandler(JSON_Parser parser, JSON_Parser_NumberRefHandler handler);
+
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_ObjectMemberRefHandler)(JSON_Parser parser, const char* pValue, size_t length, JSON_StringAttributes attributes);
+JSON_API(JSON_Parser_ObjectMemberRefHandler) JSON_Parser_GetObjectMemberRefHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetObjectMemberRefHandler(JSON_Parser parser, JSON_Parser_ObjectMemberRefHandler handler);
+
+/* Get and set the handler that is called instead of the object member (and
+ * object member ref) handler when it is set, with the member name interned
+ * in the parser instance's table of names (refer to
+ * JSON_Parser_SetInternedKeyCapacity() for details).
+ *
+ * The keyId parameter is the name's ID in the table, or JSON_NO_KEY_ID if
+ * the name could not be interned because the table is full and the
+ * eviction policy is JSON_EvictNone, or because the capacity is 0. A name
+ * keeps its ID, from one document to the next, until it is evicted.
+ *
+ * The isNewKey parameter is JSON_True if the ID was given to the name
+ * during this call, either because the name had not been seen before or
+ * because the ID's previous name has just been evicted. Clients that cache
+ * information by ID should replace it when this happens.
+ *
+ * The pName parameter points to the interned name, encoded according to
+ * the parser instance's string encoding setting and null-terminated. It
+ * stays valid and unchanged until the name is evicted, the table is
+ * emptied, or the parser is freed, and must not be modified. If keyId is
+ * JSON_NO_KEY_ID, pName instead points to a copy of the name that is only
+ * valid until the handler returns.
+ *
+ * The length and attributes parameters, and the handler return values, have
+ * the same meaning as for the object member handler. Note that names are
+ * interned by their decoded bytes, so a name that is written with escape
+ * sequences in one place and without them in another gets the same ID in
+ * both places, but different attributes.
+ */
+#define JSON_NO_KEY_ID ((size_t)-1)
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_InternedMemberHandler)(JSON_Parser parser, size_t keyId, JSON_Boolean isNewKey, const char* pName, size_t length, JSON_StringAttributes attributes);
+JSON_API(JSON_Parser_InternedMemberHandler) JSON_Parser_GetInternedMemberHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetInternedMemberHandler(JSON_Parser parser, JSON_Parser_InternedMemberHandler handler);
+
+/* Set the object member names that a parser instance recognizes, and get
+ * the number of names that are set.
+ *
+ * Clients that bind objects to their own data structures usually know in
+ * advance every member name they care about. This function compiles the
+ * keyCount names in the ppKeys array into a perfect hash table, so that the
+ * parser can tell which of them a member name is, if any, with a single
+ * comparison (refer to JSON_Parser_SetKnownMemberHandler() and
+ * JSON_Parser_SetSkipUnknownMembers() for details). The names must be
+ * encoded according to the parser instance's string encoding setting. If
+ * pLengths is not NULL, it holds the length of each name, in bytes;
+ * otherwise, the names must be null-terminated.
+ *
+ * The parser makes its own copy of the names. Setting a keyCount of 0
+ * removes them. This function fails if any name appears more than once in
+ * the array, or if the parser cannot allocate the table.
+ *
+ * Unlike the parser's other settings, the known names are preserved by
+ * JSON_Parser_Reset().
+ *
+ * The known names cannot be changed once the parser has started parsing.
+ */
+JSON_API(size_t) JSON_Parser_GetKnownKeyCount(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetKnownKeys(JSON_Parser parser, const char* const* ppKeys, const size_t* pLengths, size_t keyCount);
+
+/* Get and set the handler that is called instead of the object member (and
+ * object member ref, and interned member) handler when it is set, with the
+ * index of the member name in the array that was passed to
+ * JSON_Parser_SetKnownKeys(), or JSON_UNKNOWN_KEY if the name is not one of
+ * the known names.
+ *
+ * If the name is known, pName points to the parser's own null-terminated
+ * copy of it, which stays valid until the known names are changed or the
+ * parser is freed. Otherwise, pName points to a null-terminated copy of the
+ * name that is only valid until the handler returns. Either way, the buffer
+ * must not be modified.
+ *
+ * The length and attributes parameters, and the handler return values, have
+ * the same meaning as for the object member handler.
+ */
+#define JSON_UNKNOWN_KEY ((size_t)-1)
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_KnownMemberHandler)(JSON_Parser parser, size_t keyIndex, const char* pName, size_t length, JSON_StringAttributes attributes);
+JSON_API(JSON_Parser_KnownMemberHandler) JSON_Parser_GetKnownMemberHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetKnownMemberHandler(JSON_Parser parser, JSON_Parser_KnownMemberHandler handler);
+
+/* Get and set whether a parser instance skips the object members whose
+ * names are not among its known names (refer to JSON_Parser_SetKnownKeys()
+ * for details).
+ *
+ * When this setting is enabled, no handlers are called for an unknown
+ * member, or for anything inside its value, and the parser does not copy
+ * or convert the value's strings and numbers. The value is still parsed
+ * and checked for errors, so that skipping a member never changes whether
+ * the input is accepted. If no names are known, all members are skipped.
+ *
+ * This setting only affects the handlers described above; it does not
+ * affect the events passed to the event batch handler or the values
+ * recorded on a tape.
+ *
+ * The default value of this setting is JSON_False.
+ *
+ * This setting cannot be changed once the parser has started parsing.
+ */
+JSON_API(JSON_Boolean) JSON_Parser_GetSkipUnknownMembers(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetSkipUnknownMembers(JSON_Parser parser, JSON_Boolean skipUnknownMembers);
+
+/* Set the paths of the values that a parser instance passes to its
+ * handlers, and get the number of paths that are set.
+ *
+ * Clients that only need a few values from large documents can describe
+ * them with the pathCount paths in the ppPaths array. Each path is a
+ * null-terminated, UTF-8 encoded JSON Pointer (RFC 6901), such as
+ * "/items/0/id", except that a reference token that is a single asterisk
+ * is a wildcard that matches any object member or array item. The empty
+ * path matches the whole document. As in JSON Pointer,
+ * a reference token that is an array index matches both the array item
+ * at that index and the object member with that name.
+ *
+ * Once paths are set, the handlers are only called for the events inside
+ * the values that match at least one of them, starting with the event
+ * that starts each such value (an array item event that precedes it
+ * belongs to the enclosing array, which does not match, so it is not
+ * reported). Values that neither match a path nor contain a value that
+ * does are skipped: they are still parsed and checked for errors, but the
+ * parser does not copy or convert their strings and numbers.
+ *
+ * A path without wildcards matches at most one value per document. If
+ * none of the paths have wildcards, the parser stops as soon as each of
+ * them has matched and the last matched value is complete, without
+ * looking at the rest of the input: JSON_Parser_Parse() returns
+ * JSON_Success, the parser is finished, and
+ * JSON_Parser_GetMatchedAllPaths() returns JSON_True.
+ *
+ * The paths are matched against member names as they are encoded by the
+ * parser, so paths can only be set when the parser instance's string
+ * encoding is UTF-8, and its string encoding cannot be changed while
+ * paths are set.
+ *
+ * The parser makes its own copy of the paths. Setting a pathCount of 0
+ * removes them. This function fails if any path is not a valid JSON
+ * Pointer, or if the parser cannot allocate memory for the paths.
+ *
+ * Like the known names, the paths are preserved by JSON_Parser_Reset().
+ *
+ * This setting only affects the handlers; it does not affect the events
+ * passed to the event batch handler or the values recorded on a tape.
+ *
+ * The paths cannot be changed once the parser has started parsing.
+ */
+JSON_API(size_t) JSON_Parser_GetPathFilterCount(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetPathFilter(JSON_Parser parser, const char* const* ppPaths, size_t pathCount);
+
+/* Get whether a parser instance stopped parsing early because every path
+ * set by JSON_Parser_SetPathFilter() has matched.
+ */
+JSON_API(JSON_Boolean) JSON_Parser_GetMatchedAllPaths(JSON_Parser parser);
+
+/* Get and set the handler that is called when a value matches a path set by
+ * JSON_Parser_SetPathFilter(), before any of the value's events.
+ *
+ * The pathIndex parameter is the index of the path in the array that was
+ * passed to JSON_Parser_SetPathFilter(). If a value matches more than one
+ * path, the handler is called once for each of them.
+ *
+ * The handler can return JSON_Parser_SkipValue to skip the value, in which
+ * case no events are reported for it.
+ */
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_PathMatchHandler)(JSON_Parser parser, size_t pathIndex);
+JSON_API(JSON_Parser_PathMatchHandler) JSON_Parser_GetPathMatchHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetPathMatchHandler(JSON_Parser parser, JSON_Parser_PathMatchHandler handler);
+
+/* Get and set the handlers that are called instead of the number (or
+ * number ref) handler when a number value can be represented by a native
+ * type, so that clients that want native values don't have to convert the
+ * text themselves.
+ *
+ * When the parser encounters a number, it calls the first of these
+ * handlers that is set and can represent the value:
+ *
+ *   1. The int64 handler, if the number has no fraction or exponent and
+ *      is in the range of JSON_Int64.
+ *
+ *   2. The uint64 handler, if the number has no fraction or exponent, is
+ *      not negative, and is in the range of JSON_UInt64.
+ *
+ *   3. The double handler, if the number is neither too big nor too small
+ *      (but not zero) to be represented by a finite double. The value is
+ *      correctly rounded to the nearest double, regardless of the locale.
+ *
+ * Hex numbers (see JSON_Parser_SetAllowHexNumbers()) are treated as
+ * integers, and those that need more than 64 bits are never passed to these
+ * handlers. A number that none of the handlers that are set can represent
+ * is passed to the number (or number ref) handler as usual, if set.
+ *
+ * The attributes parameter has the same meaning as for the number handler;
+ * among other things, it distinguishes -0 from 0 when the value is passed
+ * to the int64 handler.
+ */
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_Int64Handler)(JSON_Parser parser, JSON_Int64 value, JSON_NumberAttributes attributes);
+JSON_API(JSON_Parser_Int64Handler) JSON_Parser_GetInt64Handler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetInt64Handler(JSON_Parser parser, JSON_Parser_Int64Handler handler);
+
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_UInt64Handler)(JSON_Parser parser, JSON_UInt64 value, JSON_NumberAttributes attributes);
+JSON_API(JSON_Parser_UInt64Handler) JSON_Parser_GetUInt64Handler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetUInt64Handler(JSON_Parser parser, JSON_Parser_UInt64Handler handler);
+
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_DoubleHandler)(JSON_Parser parser, double value, JSON_NumberAttributes attributes);
+JSON_API(JSON_Parser_DoubleHandler) JSON_Parser_GetDoubleHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetDoubleHandler(JSON_Parser parser, JSON_Parser_DoubleHandler handler);
+
+/* Types of the events recorded by a parser instance in batch mode, or
+ * returned by a reader instance. Start and end document events are only
+ * returned by readers (see JSON_Reader_Next()); in batch mode, the start
+ * and end document handlers are called instead.
+ */
+typedef enum tag_JSON_EventType
+{
+    JSON_Event_Null          = 0,
+    JSON_Event_Boolean       = 1,
+    JSON_Event_String        = 2,
+    JSON_Event_Number        = 3,
+    JSON_Event_SpecialNumber = 4,
+    JSON_Event_StartObject   = 5,
+    JSON_Event_EndObject     = 6,
+    JSON_Event_ObjectMember  = 7,
+    JSON_Event_StartArray    = 8,
+    JSON_Event_EndArray      = 9,
+    JSON_Event_StartDocument = 10,
+    JSON_Event_EndDocument   = 11
+} JSON_EventType;
+
+/* An event recorded by a parser instance in batch mode.
+ *
+ * The type member is a JSON_EventType value.
+ *
+ * The attributes member depends on the type of the event: it is the
+ * JSON_Boolean value of a boolean event, the JSON_SpecialNumber value of
+ * a special number event, the JSON_StringAttributes of a string or object
+ * member event, the JSON_NumberAttributes of a number event, and 0 for
+ * all other events.
+ *
+ * The depth member has the same meaning as the depth member of the token
+ * location that would be reported for the event's token by
+ * JSON_Parser_GetTokenLocation().
+ *
+ * For string, number, and object member events, valueOffset is the offset
+ * of the value in the batch's arena, and valueLength is its length in
+ * bytes; both are 0 for all other events. The value is encoded and
+ * null-terminated exactly as it would be for the corresponding handler.
+ */
+typedef struct tag_JSON_Event
+{
+    unsigned char type;
+    unsigned char attributes;
+    unsigned int  depth;
+    size_t        valueOffset;
+    size_t        valueLength;
+} JSON_Event;
+
+/* Get and set the handler that is called with batches of events, and the
+ * array the events are recorded in, for a parser instance.
+ *
+ * Calling a handler for every token costs an indirect call per token,
+ * which can dominate the time spent parsing documents that consist of
+ * many small values. In batch mode, the parser instead records each event
+ * in the pEvents array, which can hold up to maxEvents events, and copies
+ * the values of strings, numbers, and object members into an arena that
+ * it manages. It calls the batch handler when the array is full, and
+ * before each call to JSON_Parser_Parse() returns if any events are
+ * pending, even if the call failed.
+ *
+ * The pEvents and pArena parameters are only valid until the handler
+ * returns. If the handler returns JSON_Parser_Abort, parsing fails with
+ * JSON_Error_AbortedByHandler.
+ *
+ * In batch mode, the null, boolean, string, number, special number,
+ * start and end object, object member, start and end array, and array
+ * item handlers (and the ref and native number handlers) are not called.
+ * Array items are not recorded as events, because each of them is
+ * followed by the event for its value anyway.
+ *
+ * Setting a NULL handler turns batch mode off. If the handler is not
+ * NULL, pEvents must not be NULL and maxEvents must not be 0. Batch mode
+ * cannot be turned on or off after the parser has started parsing.
+ */
+typedef JSON_Parser_HandlerResult (JSON_CALL * JSON_Parser_EventBatchHandler)(JSON_Parser parser, const JSON_Event* pEvents, size_t count, const char* pArena);
+JSON_API(JSON_Parser_EventBatchHandler) JSON_Parser_GetEventBatchHandler(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetEventBatchHandler(JSON_Parser parser, JSON_Parser_EventBatchHandler handler, JSON_Event* pEvents, size_t maxEvents);
+
 /* Push zero or more bytes of input to a parser instance.
  *
  * The pBytes parameter points to a buffer containing the bytes to be
@@ -736,6 +1544,316 @@ JSON_API(JSON_Status) JSON_Parser_Parse(JSON_Parser parser, const char* pBytes,
 
 #endif /* JSON_NO_PARSER */
 
+/******************** JSON Tape ********************/
+
+#ifndef JSON_NO_PARSER
+
+/* Tape instance.
+ *
+ * A tape is a compact, read-only representation of a parsed document that
+ * a parser instance can build directly, instead of calling handlers. All
+ * of the document's values are stored in a single flat array, in document
+ * order, and all of its strings, numbers, and object member names are
+ * stored one after another in a single arena, so building a tape takes
+ * only a handful of allocations no matter how large the document is.
+ *
+ * Each value on a tape is identified by its index, a size_t. Containers
+ * record the index just past their last descendant, so that navigating
+ * from a value to its next sibling takes constant time.
+ */
+struct JSON_Tape_Data; /* opaque data */
+typedef struct JSON_Tape_Data* JSON_Tape;
+
+/* Types of the values stored on a tape. */
+typedef enum tag_JSON_ValueType
+{
+    JSON_Value_Null          = 0,
+    JSON_Value_Boolean       = 1,
+    JSON_Value_String        = 2,
+    JSON_Value_Number        = 3,
+    JSON_Value_SpecialNumber = 4,
+    JSON_Value_Object        = 5,
+    JSON_Value_Array         = 6
+} JSON_ValueType;
+
+/* Create a tape instance.
+ *
+ * If pMemorySuite is null, the library will use the C runtime realloc() and
+ * free() as the tape's memory management suite. Otherwise, all the
+ * handlers in the memory suite must be non-null or the call will fail and
+ * return null.
+ */
+JSON_API(JSON_Tape) JSON_Tape_Create(const JSON_MemorySuite* pMemorySuite);
+
+/* Free a tape instance.
+ *
+ * Every successful call to JSON_Tape_Create() must eventually be paired
+ * with a call to JSON_Tape_Free() in order to avoid leaking memory. A tape
+ * must not be freed while a parser instance is building it.
+ *
+ * This function returns failure if the tape parameter is null.
+ */
+JSON_API(JSON_Status) JSON_Tape_Free(JSON_Tape tape);
+
+/* Reset a tape instance, discarding its contents.
+ *
+ * The memory that the tape has allocated is kept, so that building
+ * another tape of a similar size doesn't need to allocate it again.
+ *
+ * This function returns failure if the tape parameter is null.
+ */
+JSON_API(JSON_Status) JSON_Tape_Reset(JSON_Tape tape);
+
+/* Get and set the tape that a parser instance builds.
+ *
+ * Setting a tape resets it. When a parser has a tape, it records the
+ * document on the tape instead of calling the null, boolean, string,
+ * number, special number, start and end object, object member, start and
+ * end array, and array item handlers, or the ref, native number, and
+ * event batch handlers. The encoding detected handler is still called.
+ *
+ * Strings and object member names are stored in the parser's string
+ * encoding, and numbers in its number encoding. Like the values passed to
+ * handlers, they are null-terminated.
+ *
+ * The default value of this setting is NULL.
+ *
+ * This setting cannot be changed once the parser has started parsing.
+ */
+JSON_API(JSON_Tape) JSON_Parser_GetTape(JSON_Parser parser);
+JSON_API(JSON_Status) JSON_Parser_SetTape(JSON_Parser parser, JSON_Tape tape);
+
+/* Get the root value of a tape instance.
+ *
+ * This function returns failure if the tape parameter or the pValue
+ * parameter is null, or if the tape does not contain a complete document,
+ * which is the case until the parser building it has parsed the document
+ * successfully.
+ */
+JSON_API(JSON_Status) JSON_Tape_GetRoot(JSON_Tape tape, size_t* pValue);
+
+/* Get the type of a value on a tape.
+ *
+ * This function, and all of the functions below, return failure if the
+ * tape parameter or any output parameter is null, or if the value
+ * parameter does not identify a value on the tape.
+ */
+JSON_API(JSON_Status) JSON_Tape_GetValueType(JSON_Tape tape, size_t value, JSON_ValueType* pType);
+
+/* Get the number of members of an object, or items of an array, on a
+ * tape.
+ *
+ * This function returns failure if the value is not an object or array.
+ */
+JSON_API(JSON_Status) JSON_Tape_GetChildCount(JSON_Tape tape, size_t value, size_t* pCount);
+
+/* Iterate over the members of an object, or the items of an array, on a
+ * tape.
+ *
+ * JSON_Tape_GetFirstChild() gets the first item of an array, or the value
+ * of the first member of an object, and returns failure if the value is
+ * not an object or array, or is empty.
+ *
+ * JSON_Tape_GetNextSibling() gets the item or member value that follows
+ * the specified one in the same container, and returns failure if there
+ * isn't one.
+ */
+JSON_API(JSON_Status) JSON_Tape_GetFirstChild(JSON_Tape tape, size_t value, size_t* pChild);
+JSON_API(JSON_Status) JSON_Tape_GetNextSibling(JSON_Tape tape, size_t value, size_t* pSibling);
+
+/* Get the name of the object member whose value is the specified value.
+ *
+ * This function returns failure if the value is not the value of an
+ * object member.
+ */
+JSON_API(JSON_Status) JSON_Tape_GetMemberName(JSON_Tape tape, size_t value, const char** ppName, size_t* pLength, JSON_StringAttributes* pAttributes);
+
+/* Find the value of the first member of an object, on a tape, whose name
+ * matches the specified name.
+ *
+ * The name is compared byte-for-byte, so it must be encoded in the string
+ * encoding of the parser that built the tape. pName may be NULL if and
+ * only if the length parameter is 0.
+ *
+ * This function returns failure if the value is not an object, or if it
+ * has no member with the specified name.
+ */
+JSON_API(JSON_Status) JSON_Tape_FindMember(JSON_Tape tape, size_t value, const char* pName, size_t length, size_t* pMember);
+
+/* Get the value of a null, boolean, string, number or special number on a
+ * tape.
+ *
+ * Each function returns failure if the value is not of the corresponding
+ * type.
+ *
+ * JSON_Tape_GetInt64(), JSON_Tape_GetUInt64() and JSON_Tape_GetDouble()
+ * convert a number value to a native type, and also return failure if the
+ * number cannot be represented exactly as an integer of the corresponding
+ * type or, in the case of doubles, if its magnitude is too large or too
+ * small to be represented. JSON_Tape_GetDouble() rounds numbers correctly
+ * to the nearest double.
+ */
+JSON_API(JSON_Status) JSON_Tape_GetBoolean(JSON_Tape tape, size_t value, JSON_Boolean* pValue);
+JSON_API(JSON_Status) JSON_Tape_GetString(JSON_Tape tape, size_t value, const char** ppValue, size_t* pLength, JSON_StringAttributes* pAttributes);
+JSON_API(JSON_Status) JSON_Tape_GetNumber(JSON_Tape tape, size_t value, const char** ppValue, size_t* pLength, JSON_NumberAttributes* pAttributes);
+JSON_API(JSON_Status) JSON_Tape_GetSpecialNumber(JSON_Tape tape, size_t value, JSON_SpecialNumber* pValue);
+JSON_API(JSON_Status) JSON_Tape_GetInt64(JSON_Tape tape, size_t value, JSON_Int64* pValue);
+JSON_API(JSON_Status) JSON_Tape_GetUInt64(JSON_Tape tape, size_t value, JSON_UInt64* pValue);
+JSON_API(JSON_Status) JSON_Tape_GetDouble(JSON_Tape tape, size_t value, double* pValue);
+
+#endif /* JSON_NO_PARSER */
+
+/******************** JSON Reader ********************/
+
+#ifndef JSON_NO_PARSER
+
+/* Reader instance.
+ *
+ * A reader is a pull-style interface to a parser: instead of calling
+ * handlers as the input is parsed, it returns the document's events one
+ * at a time when the client asks for them, so a client can consume a
+ * document by recursive descent, keeping its context on its own stack
+ * rather than in the parser's user data. The reader uses the same
+ * decoder, lexer and grammar as JSON_Parser_Parse(), and parses only as
+ * much of the input as it needs to produce the next event.
+ */
+struct JSON_Reader_Data; /* opaque data */
+typedef struct JSON_Reader_Data* JSON_Reader;
+
+/* An event returned by a reader instance.
+ *
+ * The type and attributes members have the same meaning as the
+ * corresponding members of JSON_Event.
+ *
+ * The location member is the location that JSON_Parser_GetTokenLocation()
+ * would report for the event's token if it were called from the event's
+ * handler. For start and end document events, that is the location of the
+ * document's first and last token, at depth 0.
+ *
+ * For string, number, and object member events, pValue points to the
+ * value and length is its length in bytes; pValue is NULL and length is 0
+ * for all other events. As with JSON_Parser_SetStringRefHandler(), pValue
+ * points directly into the input buffer if the value appears verbatim in
+ * it, and into a buffer that the reader manages otherwise. Either way,
+ * the value is NOT null-terminated and must not be modified, and it is
+ * only valid until the next call to JSON_Reader_Next().
+ */
+typedef struct tag_JSON_ReaderEvent
+{
+    JSON_EventType type;
+    unsigned char  attributes;
+    JSON_Location  location;
+    const char*    pValue;
+    size_t         length;
+} JSON_ReaderEvent;
+
+/* Values returned by JSON_Reader_Next(). */
+typedef enum tag_JSON_ReaderResult
+{
+    JSON_Reader_HasEvent   = 0,
+    JSON_Reader_NeedsInput = 1,
+    JSON_Reader_Finished   = 2,
+    JSON_Reader_Failed     = 3
+} JSON_ReaderResult;
+
+/* Create a reader instance.
+ *
+ * If pMemorySuite is null, the library will use the C runtime realloc() and
+ * free() as the reader's memory management suite. Otherwise, all the
+ * handlers in the memory suite must be non-null or the call will fail and
+ * return null.
+ */
+JSON_API(JSON_Reader) JSON_Reader_Create(const JSON_MemorySuite* pMemorySuite);
+
+/* Free a reader instance and its parser.
+ *
+ * This function fails if the reader parameter is null or if it is called
+ * from inside a handler of the reader's parser.
+ */
+JSON_API(JSON_Status) JSON_Reader_Free(JSON_Reader reader);
+
+/* Reset a reader instance so that it can be used to read a new document.
+ *
+ * The reader's parser is reset as if by JSON_Parser_Reset(), so its
+ * settings must be set again.
+ *
+ * This function fails if the reader parameter is null or if it is called
+ * from inside a handler of the reader's parser.
+ */
+JSON_API(JSON_Status) JSON_Reader_Reset(JSON_Reader reader);
+
+/* Get the parser that a reader instance reads with.
+ *
+ * The parser's settings (its encodings, maximum lengths, and the settings
+ * that allow extensions to JSON, multiple documents, and so on) determine
+ * how the reader parses its input, and can be changed until the reader
+ * starts reading. After JSON_Reader_Next() has returned
+ * JSON_Reader_Failed, JSON_Parser_GetError() and
+ * JSON_Parser_GetErrorLocation() describe the error.
+ *
+ * The parser only calls its encoding detected handler; the events that
+ * its other handlers would receive are returned by the reader instead,
+ * and it never records events in batch
+ * mode, builds a tape, or filters paths. JSON_Parser_Parse(),
+ * JSON_Parser_Reset(), JSON_Parser_Free(), JSON_Parser_SaveState() and
+ * JSON_Parser_LoadState() fail for the parser; the reader's own
+ * functions must be used instead.
+ */
+JSON_API(JSON_Parser) JSON_Reader_GetParser(JSON_Reader reader);
+
+/* Give a reader instance the next chunk of its input.
+ *
+ * The pBytes, length and isFinal parameters have the same meaning as for
+ * JSON_Parser_Parse(). The reader does not copy the input, so the buffer
+ * must remain valid, and must not be modified, until JSON_Reader_Next()
+ * returns something other than JSON_Reader_HasEvent.
+ *
+ * This function fails if the reader parameter is null, if the reader
+ * still has input to read (that is, if JSON_Reader_Next() has not
+ * returned JSON_Reader_NeedsInput since the last call), if the reader
+ * has finished reading, or if it is called from inside a handler of the
+ * reader's parser.
+ */
+JSON_API(JSON_Status) JSON_Reader_SetInput(JSON_Reader reader, const char* pBytes, size_t length, JSON_Boolean isFinal);
+
+/* Read the next event from a reader instance.
+ *
+ * This function parses the reader's input up to the end of the next
+ * event, if necessary, and returns one of the following:
+ *
+ *   JSON_Reader_HasEvent, after storing the event in *pEvent.
+ *
+ *   JSON_Reader_NeedsInput, if the input that was given to the reader has
+ *   been parsed without completing another event; for example, if it
+ *   ended in the middle of a token. The client must call
+ *   JSON_Reader_SetInput() with the next chunk of input before reading on.
+ *
+ *   JSON_Reader_Finished, once the final input has been parsed
+ *   successfully and all of its events have been returned.
+ *
+ *   JSON_Reader_Failed, once all the events that preceded a parse error
+ *   have been returned; see JSON_Reader_GetParser(). This is also returned
+ *   if the reader or pEvent parameters are null, or if the function is
+ *   called from inside a handler of the reader's parser.
+ *
+ * Events are returned in the same order, and with the same errors and
+ * locations, as the corresponding handlers would be called by
+ * JSON_Parser_Parse(). In particular, in multi-document mode, each
+ * document's events are preceded by a JSON_Event_StartDocument event and
+ * followed by a JSON_Event_EndDocument event. As in batch mode, array
+ * items are not returned as events, because each of them is followed by
+ * the event for its value anyway.
+ *
+ * Each event carries its own location, since JSON_Parser_GetTokenLocation()
+ * and JSON_Parser_GetAfterTokenLocation() fail for the reader's parser,
+ * which is never inside a handler. If the parser tracks locations lazily,
+ * they are reconstructed as each event is read, so lazy tracking saves
+ * little for a reader.
+ */
+JSON_API(JSON_ReaderResult) JSON_Reader_Next(JSON_Reader reader, JSON_ReaderEvent* pEvent);
+
+#endif /* JSON_NO_PARSER */
+
 /******************** JSON Writer ********************/
 
 #ifndef JSON_NO_WRITER
@@ -758,8 +1876,9 @@ JSON_API(JSON_Writer) JSON_Writer_Create(const JSON_MemorySuite* pMemorySuite);
  * Every successful call to JSON_Writer_Create() must eventually be paired
  * with a call to JSON_Writer_Free() in order to avoid leaking memory.
  *
- * This function returns failure if the writer parameter is null or if the
- * function was called reentrantly from inside a handler.
+ * This function returns failure if the writer parameter is null, if the
+ * writer was acquired from a pool, or if the function was called
+ * reentrantly from inside a handler.
  */
 JSON_API(JSON_Status) JSON_Writer_Free(JSON_Writer writer);
 
@@ -772,10 +1891,30 @@ JSON_API(JSON_Status) JSON_Writer_Free(JSON_Writer writer);
  * After a writer is reset, its state is indistinguishable from its state
  * when it was returned by JSON_Writer_Create(). The writer's custom memory
  * suite, if any, is preserved; all other settings, state, and handlers are
- * restored to their default values.
+ * restored to their default values, or to those of the writer's
+ * configuration if it was created by JSON_Writer_CreateWithConfig().
  */
 JSON_API(JSON_Status) JSON_Writer_Reset(JSON_Writer writer);
 
+/* Writer configuration and pool instances.
+ *
+ * These work like their parser counterparts (refer to JSON_ParserConfig
+ * and JSON_ParserPool for details). A writer configuration gets the
+ * writer's user data, settings and output handler.
+ */
+struct JSON_WriterConfig_Data; /* opaque data */
+typedef struct JSON_WriterConfig_Data* JSON_WriterConfig;
+struct JSON_WriterPool_Data; /* opaque data */
+typedef struct JSON_WriterPool_Data* JSON_WriterPool;
+
+JSON_API(JSON_WriterConfig) JSON_WriterConfig_Create(JSON_Writer writer, const JSON_MemorySuite* pMemorySuite);
+JSON_API(JSON_Status) JSON_WriterConfig_Free(JSON_WriterConfig config);
+JSON_API(JSON_Writer) JSON_Writer_CreateWithConfig(JSON_WriterConfig config, const JSON_MemorySuite* pMemorySuite);
+JSON_API(JSON_WriterPool) JSON_WriterPool_Create(JSON_WriterConfig config, size_t capacity, const JSON_MemorySuite* pMemorySuite);
+JSON_API(JSON_Status) JSON_WriterPool_Free(JSON_WriterPool pool);
+JSON_API(JSON_Writer) JSON_WriterPool_Acquire(JSON_WriterPool pool);
+JSON_API(JSON_Status) JSON_WriterPool_Release(JSON_WriterPool pool, JSON_Writer writer);
+
 /* Get and set the user data value associated with a writer instance.
  *
  * This setting allows clients to associate additional data with a
@@ -1033,6 +2172,53 @@ JSON_API(JSON_Encoding) JSON_NativeUTF16Encoding(void);
  */
 JSON_API(JSON_Encoding) JSON_NativeUTF32Encoding(void);
 
+/* Find the first record boundary at or after an offset in a buffer of
+ * newline-delimited JSON or of an RFC 7464 JSON text sequence.
+ *
+ * The record boundaries are the start and end of the buffer, the position
+ * just after each line feed, and the position of each ASCII record
+ * separator character (U+001E). The function returns the first boundary
+ * that is not before the offset parameter, or the length parameter if the
+ * offset is past the end of the buffer.
+ *
+ * Clients can use this function to split a large buffer of UTF-8 records
+ * into chunks that each contain whole records, and parse the chunks
+ * independently, for example on separate threads, with parsers that allow
+ * multiple documents (see JSON_Parser_Clone()). Processing the results of
+ * the chunks in the order of the chunks preserves the order of the
+ * records. The boundaries are only reliable if the records do not contain
+ * unescaped control characters or comments that span lines.
+ */
+JSON_API(size_t) JSON_FindRecordBoundary(const char* pBytes, size_t length, size_t offset);
+
+/* Find the first item boundary at or after an offset in a buffer that
+ * holds a single top-level array.
+ *
+ * The item boundaries are the start and end of the buffer and the position
+ * of each comma between two items of the array. Finding them exactly would
+ * mean scanning the buffer from the start, so the function guesses instead,
+ * looking at no more than the next megabyte of input. It decides whether
+ * the offset is inside a string from the unescaped quotation marks that
+ * follow it, which alternately open and close strings: only one choice
+ * usually leaves each opening quotation mark after a left bracket or
+ * brace, a comma or a colon, and each closing one before a right bracket
+ * or brace, a comma or a colon. It then returns the first comma at the
+ * shallowest nesting depth that the input reaches before the array's
+ * right square bracket, which is the last non-whitespace character of the
+ * buffer. It returns the length parameter if it finds no boundary.
+ *
+ * The guess is almost always right for arrays whose items are much smaller
+ * than a megabyte, including arrays of strings that contain commas; it can
+ * only be fooled by strings that all start and end with such punctuation.
+ * The function only ever returns a comma, so a wrong boundary is always
+ * detected when the segments are parsed. The buffer must be UTF-8. Clients
+ * can split the buffer into segments at the boundaries found for evenly
+ * spaced offsets, parse the segments independently with parsers that allow
+ * array segments (see JSON_Parser_SetAllowArraySegment()), and reparse any
+ * segment that is left unterminated together with the segment after it.
+ */
+JSON_API(size_t) JSON_FindArrayItemBoundary(const char* pBytes, size_t length, size_t offset);
+
 #ifdef __cplusplus
 }
 #endif
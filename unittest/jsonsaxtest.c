@@ -443,6 +443,9 @@ typedef struct tag_ParserSettings
     JSON_Boolean  replaceInvalidEncodingSequences;
     JSON_Boolean  trackObjectMembers;
     JSON_Boolean  stopAfterEmbeddedDocument;
+    JSON_Boolean  trackLocationsLazily;
+    JSON_Boolean  allowMultipleDocuments;
+    JSON_Boolean  allowArraySegment;
 } ParserSettings;
 
 static void InitParserSettings(ParserSettings* pSettings)
@@ -461,6 +464,9 @@ static void InitParserSettings(ParserSettings* pSettings)
     pSettings->replaceInvalidEncodingSequences = JSON_False;
     pSettings->trackObjectMembers = JSON_False;
     pSettings->stopAfterEmbeddedDocument = JSON_False;
+    pSettings->trackLocationsLazily = JSON_False;
+    pSettings->allowMultipleDocuments = JSON_False;
+    pSettings->allowArraySegment = JSON_False;
 }
 
 static void GetParserSettings(JSON_Parser parser, ParserSettings* pSettings)
@@ -479,6 +485,9 @@ static void GetParserSettings(JSON_Parser parser, ParserSettings* pSettings)
     pSettings->replaceInvalidEncodingSequences = JSON_Parser_GetReplaceInvalidEncodingSequences(parser);
     pSettings->trackObjectMembers = JSON_Parser_GetTrackObjectMembers(parser);
     pSettings->stopAfterEmbeddedDocument = JSON_Parser_GetStopAfterEmbeddedDocument(parser);
+    pSettings->trackLocationsLazily = JSON_Parser_GetTrackLocationsLazily(parser);
+    pSettings->allowMultipleDocuments = JSON_Parser_GetAllowMultipleDocuments(parser);
+    pSettings->allowArraySegment = JSON_Parser_GetAllowArraySegment(parser);
 }
 
 static int ParserSettingsAreIdentical(const ParserSettings* pSettings1, const ParserSettings* pSettings2)
@@ -496,7 +505,10 @@ static int ParserSettingsAreIdentical(const ParserSettings* pSettings1, const Pa
             pSettings1->allowUnescapedControlCharacters == pSettings2->allowUnescapedControlCharacters &&
             pSettings1->replaceInvalidEncodingSequences == pSettings2->replaceInvalidEncodingSequences &&
             pSettings1->trackObjectMembers == pSettings2->trackObjectMembers &&
-            pSettings1->stopAfterEmbeddedDocument == pSettings2->stopAfterEmbeddedDocument);
+            pSettings1->stopAfterEmbeddedDocument == pSettings2->stopAfterEmbeddedDocument &&
+            pSettings1->trackLocationsLazily == pSettings2->trackLocationsLazily &&
+            pSettings1->allowMultipleDocuments == pSettings2->allowMultipleDocuments &&
+            pSettings1->allowArraySegment == pSettings2->allowArraySegment);
 }
 
 static int CheckParserSettings(JSON_Parser parser, const ParserSettings* pExpectedSettings)
@@ -531,6 +543,9 @@ static int CheckParserSettings(JSON_Parser parser, const ParserSettings* pExpect
                "  JSON_Parser_GetReplaceInvalidEncodingSequences() %8d   %8d\n"
                "  JSON_Parser_GetTrackObjectMembers()              %8d   %8d\n"
                "  JSON_Parser_GetStopAfterEmbeddedDocument()       %8d   %8d\n"
+               "  JSON_Parser_GetTrackLocationsLazily()            %8d   %8d\n"
+               "  JSON_Parser_GetAllowMultipleDocuments()          %8d   %8d\n"
+               "  JSON_Parser_GetAllowArraySegment()               %8d   %8d\n"
                ,
                (int)pExpectedSettings->allowBOM, (int)actualSettings.allowBOM,
                (int)pExpectedSettings->allowComments, (int)actualSettings.allowComments,
@@ -539,7 +554,10 @@ static int CheckParserSettings(JSON_Parser parser, const ParserSettings* pExpect
                (int)pExpectedSettings->allowUnescapedControlCharacters, (int)actualSettings.allowUnescapedControlCharacters,
                (int)pExpectedSettings->replaceInvalidEncodingSequences, (int)actualSettings.replaceInvalidEncodingSequences,
                (int)pExpectedSettings->trackObjectMembers, (int)actualSettings.trackObjectMembers,
-               (int)pExpectedSettings->stopAfterEmbeddedDocument, (int)actualSettings.stopAfterEmbeddedDocument
+               (int)pExpectedSettings->stopAfterEmbeddedDocument, (int)actualSettings.stopAfterEmbeddedDocument,
+               (int)pExpectedSettings->trackLocationsLazily, (int)actualSettings.trackLocationsLazily,
+               (int)pExpectedSettings->allowMultipleDocuments, (int)actualSettings.allowMultipleDocuments,
+               (int)pExpectedSettings->allowArraySegment, (int)actualSettings.allowArraySegment
             );
     }
     return identical;
@@ -559,6 +577,18 @@ typedef struct tag_ParserHandlers
     JSON_Parser_StartArrayHandler       startArrayHandler;
     JSON_Parser_EndArrayHandler         endArrayHandler;
     JSON_Parser_ArrayItemHandler        arrayItemHandler;
+    JSON_Parser_StartDocumentHandler    startDocumentHandler;
+    JSON_Parser_EndDocumentHandler      endDocumentHandler;
+    JSON_Parser_StringRefHandler        stringRefHandler;
+    JSON_Parser_NumberRefHandler        numberRefHandler;
+    JSON_Parser_ObjectMemberRefHandler  objectMemberRefHandler;
+    JSON_Parser_Int64Handler            int64Handler;
+    JSON_Parser_UInt64Handler           uint64Handler;
+    JSON_Parser_DoubleHandler           doubleHandler;
+    JSON_Parser_EventBatchHandler       eventBatchHandler;
+    JSON_Parser_InternedMemberHandler   internedMemberHandler;
+    JSON_Parser_KnownMemberHandler      knownMemberHandler;
+    JSON_Parser_PathMatchHandler        pathMatchHandler;
 } ParserHandlers;
 
 static void InitParserHandlers(ParserHandlers* pHandlers)
@@ -575,6 +605,18 @@ static void InitParserHandlers(ParserHandlers* pHandlers)
     pHandlers->startArrayHandler = NULL;
     pHandlers->endArrayHandler = NULL;
     pHandlers->arrayItemHandler = NULL;
+    pHandlers->startDocumentHandler = NULL;
+    pHandlers->endDocumentHandler = NULL;
+    pHandlers->stringRefHandler = NULL;
+    pHandlers->numberRefHandler = NULL;
+    pHandlers->objectMemberRefHandler = NULL;
+    pHandlers->int64Handler = NULL;
+    pHandlers->uint64Handler = NULL;
+    pHandlers->doubleHandler = NULL;
+    pHandlers->eventBatchHandler = NULL;
+    pHandlers->internedMemberHandler = NULL;
+    pHandlers->knownMemberHandler = NULL;
+    pHandlers->pathMatchHandler = NULL;
 }
 
 static void GetParserHandlers(JSON_Parser parser, ParserHandlers* pHandlers)
@@ -591,6 +633,18 @@ static void GetParserHandlers(JSON_Parser parser, ParserHandlers* pHandlers)
     pHandlers->startArrayHandler = JSON_Parser_GetStartArrayHandler(parser);
     pHandlers->endArrayHandler = JSON_Parser_GetEndArrayHandler(parser);
     pHandlers->arrayItemHandler = JSON_Parser_GetArrayItemHandler(parser);
+    pHandlers->startDocumentHandler = JSON_Parser_GetStartDocumentHandler(parser);
+    pHandlers->endDocumentHandler = JSON_Parser_GetEndDocumentHandler(parser);
+    pHandlers->stringRefHandler = JSON_Parser_GetStringRefHandler(parser);
+    pHandlers->numberRefHandler = JSON_Parser_GetNumberRefHandler(parser);
+    pHandlers->objectMemberRefHandler = JSON_Parser_GetObjectMemberRefHandler(parser);
+    pHandlers->int64Handler = JSON_Parser_GetInt64Handler(parser);
+    pHandlers->uint64Handler = JSON_Parser_GetUInt64Handler(parser);
+    pHandlers->doubleHandler = JSON_Parser_GetDoubleHandler(parser);
+    pHandlers->eventBatchHandler = JSON_Parser_GetEventBatchHandler(parser);
+    pHandlers->internedMemberHandler = JSON_Parser_GetInternedMemberHandler(parser);
+    pHandlers->knownMemberHandler = JSON_Parser_GetKnownMemberHandler(parser);
+    pHandlers->pathMatchHandler = JSON_Parser_GetPathMatchHandler(parser);
 }
 
 static int ParserHandlersAreIdentical(const ParserHandlers* pHandlers1, const ParserHandlers* pHandlers2)
@@ -606,7 +660,19 @@ static int ParserHandlersAreIdentical(const ParserHandlers* pHandlers1, const Pa
             pHandlers1->objectMemberHandler == pHandlers2->objectMemberHandler &&
             pHandlers1->startArrayHandler == pHandlers2->startArrayHandler &&
             pHandlers1->endArrayHandler == pHandlers2->endArrayHandler &&
-            pHandlers1->arrayItemHandler == pHandlers2->arrayItemHandler);
+            pHandlers1->arrayItemHandler == pHandlers2->arrayItemHandler &&
+            pHandlers1->startDocumentHandler == pHandlers2->startDocumentHandler &&
+            pHandlers1->endDocumentHandler == pHandlers2->endDocumentHandler &&
+            pHandlers1->stringRefHandler == pHandlers2->stringRefHandler &&
+            pHandlers1->numberRefHandler == pHandlers2->numberRefHandler &&
+            pHandlers1->objectMemberRefHandler == pHandlers2->objectMemberRefHandler &&
+            pHandlers1->int64Handler == pHandlers2->int64Handler &&
+            pHandlers1->uint64Handler == pHandlers2->uint64Handler &&
+            pHandlers1->doubleHandler == pHandlers2->doubleHandler &&
+            pHandlers1->eventBatchHandler == pHandlers2->eventBatchHandler &&
+            pHandlers1->internedMemberHandler == pHandlers2->internedMemberHandler &&
+            pHandlers1->knownMemberHandler == pHandlers2->knownMemberHandler &&
+            pHandlers1->pathMatchHandler == pHandlers2->pathMatchHandler);
 }
 
 static int CheckParserHandlers(JSON_Parser parser, const ParserHandlers* pExpectedHandlers)
@@ -639,13 +705,37 @@ static int CheckParserHandlers(JSON_Parser parser, const ParserHandlers* pExpect
                "  JSON_Parser_GetStartArrayHandler()       %8s   %8s\n"
                "  JSON_Parser_GetEndArrayHandler()         %8s   %8s\n"
                "  JSON_Parser_GetArrayItemHandler()        %8s   %8s\n"
+               "  JSON_Parser_GetStartDocumentHandler()    %8s   %8s\n"
+               "  JSON_Parser_GetEndDocumentHandler()      %8s   %8s\n"
+               "  JSON_Parser_GetStringRefHandler()        %8s   %8s\n"
+               "  JSON_Parser_GetNumberRefHandler()        %8s   %8s\n"
+               "  JSON_Parser_GetObjectMemberRefHandler()  %8s   %8s\n"
+               "  JSON_Parser_GetInt64Handler()            %8s   %8s\n"
+               "  JSON_Parser_GetUInt64Handler()           %8s   %8s\n"
+               "  JSON_Parser_GetDoubleHandler()           %8s   %8s\n"
+               "  JSON_Parser_GetEventBatchHandler()       %8s   %8s\n"
+               "  JSON_Parser_GetInternedMemberHandler()   %8s   %8s\n"
+               "  JSON_Parser_GetKnownMemberHandler()      %8s   %8s\n"
+               "  JSON_Parser_GetPathMatchHandler()        %8s   %8s\n"
                ,
                HANDLER_STRING(pExpectedHandlers->startObjectHandler), HANDLER_STRING(actualHandlers.startObjectHandler),
                HANDLER_STRING(pExpectedHandlers->endObjectHandler), HANDLER_STRING(actualHandlers.endObjectHandler),
                HANDLER_STRING(pExpectedHandlers->objectMemberHandler), HANDLER_STRING(actualHandlers.objectMemberHandler),
                HANDLER_STRING(pExpectedHandlers->startArrayHandler), HANDLER_STRING(actualHandlers.startArrayHandler),
                HANDLER_STRING(pExpectedHandlers->endArrayHandler), HANDLER_STRING(actualHandlers.endArrayHandler),
-               HANDLER_STRING(pExpectedHandlers->arrayItemHandler), HANDLER_STRING(actualHandlers.arrayItemHandler)
+               HANDLER_STRING(pExpectedHandlers->arrayItemHandler), HANDLER_STRING(actualHandlers.arrayItemHandler),
+               HANDLER_STRING(pExpectedHandlers->startDocumentHandler), HANDLER_STRING(actualHandlers.startDocumentHandler),
+               HANDLER_STRING(pExpectedHandlers->endDocumentHandler), HANDLER_STRING(actualHandlers.endDocumentHandler),
+               HANDLER_STRING(pExpectedHandlers->stringRefHandler), HANDLER_STRING(actualHandlers.stringRefHandler),
+               HANDLER_STRING(pExpectedHandlers->numberRefHandler), HANDLER_STRING(actualHandlers.numberRefHandler),
+               HANDLER_STRING(pExpectedHandlers->objectMemberRefHandler), HANDLER_STRING(actualHandlers.objectMemberRefHandler),
+               HANDLER_STRING(pExpectedHandlers->int64Handler), HANDLER_STRING(actualHandlers.int64Handler),
+               HANDLER_STRING(pExpectedHandlers->uint64Handler), HANDLER_STRING(actualHandlers.uint64Handler),
+               HANDLER_STRING(pExpectedHandlers->doubleHandler), HANDLER_STRING(actualHandlers.doubleHandler),
+               HANDLER_STRING(pExpectedHandlers->eventBatchHandler), HANDLER_STRING(actualHandlers.eventBatchHandler),
+               HANDLER_STRING(pExpectedHandlers->internedMemberHandler), HANDLER_STRING(actualHandlers.internedMemberHandler),
+               HANDLER_STRING(pExpectedHandlers->knownMemberHandler), HANDLER_STRING(actualHandlers.knownMemberHandler),
+               HANDLER_STRING(pExpectedHandlers->pathMatchHandler), HANDLER_STRING(actualHandlers.pathMatchHandler)
             );
     }
     return identical;
@@ -881,6 +971,36 @@ static int CheckParserSetStopAfterEmbeddedDocument(JSON_Parser parser, JSON_Bool
     return 1;
 }
 
+static int CheckParserSetAllowMultipleDocuments(JSON_Parser parser, JSON_Boolean allowMultipleDocuments, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetAllowMultipleDocuments(parser, allowMultipleDocuments) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetAllowMultipleDocuments() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetAllowArraySegment(JSON_Parser parser, JSON_Boolean allowArraySegment, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetAllowArraySegment(parser, allowArraySegment) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetAllowArraySegment() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetTrackLocationsLazily(JSON_Parser parser, JSON_Boolean trackLocationsLazily, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetTrackLocationsLazily(parser, trackLocationsLazily) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetTrackLocationsLazily() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
 static int CheckParserSetEncodingDetectedHandler(JSON_Parser parser, JSON_Parser_EncodingDetectedHandler handler, JSON_Status expectedStatus)
 {
     if (JSON_Parser_SetEncodingDetectedHandler(parser, handler) != expectedStatus)
@@ -1001,6 +1121,126 @@ static int CheckParserSetArrayItemHandler(JSON_Parser parser, JSON_Parser_ArrayI
     return 1;
 }
 
+static int CheckParserSetStringRefHandler(JSON_Parser parser, JSON_Parser_StringRefHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetStringRefHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetStringRefHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetNumberRefHandler(JSON_Parser parser, JSON_Parser_NumberRefHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetNumberRefHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetNumberRefHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetObjectMemberRefHandler(JSON_Parser parser, JSON_Parser_ObjectMemberRefHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetObjectMemberRefHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetObjectMemberRefHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetInternedMemberHandler(JSON_Parser parser, JSON_Parser_InternedMemberHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetInternedMemberHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetInternedMemberHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetKnownMemberHandler(JSON_Parser parser, JSON_Parser_KnownMemberHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetKnownMemberHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetKnownMemberHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetStartDocumentHandler(JSON_Parser parser, JSON_Parser_StartDocumentHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetStartDocumentHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetStartDocumentHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetEndDocumentHandler(JSON_Parser parser, JSON_Parser_EndDocumentHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetEndDocumentHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetEndDocumentHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetPathMatchHandler(JSON_Parser parser, JSON_Parser_PathMatchHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetPathMatchHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetPathMatchHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetInt64Handler(JSON_Parser parser, JSON_Parser_Int64Handler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetInt64Handler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetInt64Handler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetUInt64Handler(JSON_Parser parser, JSON_Parser_UInt64Handler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetUInt64Handler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetUInt64Handler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetDoubleHandler(JSON_Parser parser, JSON_Parser_DoubleHandler handler, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetDoubleHandler(parser, handler) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetDoubleHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
+static int CheckParserSetEventBatchHandler(JSON_Parser parser, JSON_Parser_EventBatchHandler handler, JSON_Event* pEvents, size_t maxEvents, JSON_Status expectedStatus)
+{
+    if (JSON_Parser_SetEventBatchHandler(parser, handler, pEvents, maxEvents) != expectedStatus)
+    {
+        printf("FAILURE: expected JSON_Parser_SetEventBatchHandler() to return %s\n", (expectedStatus == JSON_Success) ? "JSON_Success" : "JSON_Failure");
+        return 0;
+    }
+    return 1;
+}
+
 static int CheckParserParse(JSON_Parser parser, const char* pBytes, size_t length, JSON_Boolean isFinal, JSON_Status expectedStatus)
 {
     if (JSON_Parser_Parse(parser, pBytes, length, isFinal) != expectedStatus)
@@ -1030,6 +1270,9 @@ static int TryToMisbehaveInParseHandler(JSON_Parser parser)
         !CheckParserSetReplaceInvalidEncodingSequences(parser, JSON_True, JSON_Failure) ||
         !CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Failure) ||
         !CheckParserSetStopAfterEmbeddedDocument(parser, JSON_True, JSON_Failure) ||
+        !CheckParserSetTrackLocationsLazily(parser, JSON_True, JSON_Failure) ||
+        !CheckParserSetAllowMultipleDocuments(parser, JSON_True, JSON_Failure) ||
+        !CheckParserSetAllowArraySegment(parser, JSON_True, JSON_Failure) ||
         !CheckParserParse(parser, " ", 1, JSON_False, JSON_Failure))
     {
         return 1;
@@ -1303,7 +1546,23 @@ static JSON_Parser_HandlerResult JSON_CALL ObjectMemberHandler(JSON_Parser parse
     return JSON_Parser_Continue;
 }
 
-static JSON_Parser_HandlerResult JSON_CALL StartArrayHandler(JSON_Parser parser)
+/* The ref handlers produce exactly the same output as their counterparts,
+   but they must not modify the value, which may be in the input buffer.
+   s_pRefInput and s_refInputLength describe the input buffer, if known,
+   and s_refCount counts the values that were referenced in it. */
+static const char* s_pRefInput = NULL;
+static size_t s_refInputLength = 0;
+static int s_refCount = 0;
+
+static void CountRef(const char* pValue, size_t length)
+{
+    if (s_pRefInput && length && pValue >= s_pRefInput && pValue + length <= s_pRefInput + s_refInputLength)
+    {
+        s_refCount++;
+    }
+}
+
+static JSON_Parser_HandlerResult JSON_CALL StringRefHandler(JSON_Parser parser, const char* pValue, size_t length, JSON_StringAttributes attributes)
 {
     JSON_Location location, afterLocation;
     if (s_failHandler)
@@ -1319,15 +1578,18 @@ static JSON_Parser_HandlerResult JSON_CALL StartArrayHandler(JSON_Parser parser)
     {
         return JSON_Parser_Abort;
     }
+    CountRef(pValue, length);
     OutputSeparator();
-    OutputFormatted("[:");
+    OutputFormatted("s(");
+    OutputStringBytes((const unsigned char*)pValue, length, attributes, JSON_Parser_GetStringEncoding(parser));
+    OutputFormatted("):");
     OutputLocation(&location);
     OutputFormatted("-");
     OutputLocation(&afterLocation);
     return JSON_Parser_Continue;
 }
 
-static JSON_Parser_HandlerResult JSON_CALL EndArrayHandler(JSON_Parser parser)
+static JSON_Parser_HandlerResult JSON_CALL NumberRefHandler(JSON_Parser parser, const char* pValue, size_t length, JSON_NumberAttributes attributes)
 {
     JSON_Location location, afterLocation;
     if (s_failHandler)
@@ -1343,15 +1605,18 @@ static JSON_Parser_HandlerResult JSON_CALL EndArrayHandler(JSON_Parser parser)
     {
         return JSON_Parser_Abort;
     }
+    CountRef(pValue, length);
     OutputSeparator();
-    OutputFormatted("]:");
+    OutputFormatted("#(");
+    OutputNumber((const unsigned char*)pValue, length, attributes, JSON_Parser_GetNumberEncoding(parser));
+    OutputFormatted("):");
     OutputLocation(&location);
     OutputFormatted("-");
     OutputLocation(&afterLocation);
     return JSON_Parser_Continue;
 }
 
-static JSON_Parser_HandlerResult JSON_CALL ArrayItemHandler(JSON_Parser parser)
+static JSON_Parser_HandlerResult JSON_CALL ObjectMemberRefHandler(JSON_Parser parser, const char* pValue, size_t length, JSON_StringAttributes attributes)
 {
     JSON_Location location, afterLocation;
     if (s_failHandler)
@@ -1362,353 +1627,485 @@ static JSON_Parser_HandlerResult JSON_CALL ArrayItemHandler(JSON_Parser parser)
     {
         return JSON_Parser_Abort;
     }
+    if (attributes == JSON_SimpleString && length == 9 && !memcmp(pValue, "duplicate", 9))
+    {
+        return JSON_Parser_TreatAsDuplicateObjectMember;
+    }
     if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success ||
         JSON_Parser_GetAfterTokenLocation(parser, &afterLocation) != JSON_Success)
     {
         return JSON_Parser_Abort;
     }
+    CountRef(pValue, length);
     OutputSeparator();
-    OutputFormatted("i:");
+    OutputFormatted("m(");
+    OutputStringBytes((const unsigned char*)pValue, length, attributes, JSON_Parser_GetStringEncoding(parser));
+    OutputFormatted("):");
     OutputLocation(&location);
     OutputFormatted("-");
     OutputLocation(&afterLocation);
     return JSON_Parser_Continue;
 }
 
-typedef enum tag_ParserParam
+/* The interned member handler outputs "k<id>(...)", with a "*" after the
+   ID if the name was just given it, and "-" in place of JSON_NO_KEY_ID. */
+static JSON_Parser_HandlerResult JSON_CALL InternedMemberHandler(JSON_Parser parser, size_t keyId, JSON_Boolean isNewKey, const char* pName, size_t length, JSON_StringAttributes attributes)
 {
-    Standard = 0,
+    if (s_failHandler)
+    {
+        return JSON_Parser_Abort;
+    }
+    if (attributes == JSON_SimpleString && length == 9 && !memcmp(pName, "duplicate", 9))
+    {
+        return JSON_Parser_TreatAsDuplicateObjectMember;
+    }
+    OutputSeparator();
+    if (keyId == JSON_NO_KEY_ID)
+    {
+        OutputFormatted("k-(");
+    }
+    else
+    {
+        OutputFormatted("k%d%s(", (int)keyId, isNewKey ? "*" : "");
+    }
+    OutputStringBytes((const unsigned char*)pName, length, attributes, JSON_Parser_GetStringEncoding(parser));
+    OutputFormatted(")");
+    return JSON_Parser_Continue;
+}
 
-    /* Bottom 4 bits are input encoding. */
-    DefaultIn = 0 << 0,
-    UTF8In    = 1 << 0,
-    UTF16LEIn = 2 << 0,
-    UTF16BEIn = 3 << 0,
-    UTF32LEIn = 4 << 0,
-    UTF32BEIn = 5 << 0,
+/* The known member handler outputs "K<index>(...)", with "-" in place of
+   JSON_UNKNOWN_KEY. */
+static JSON_Parser_HandlerResult JSON_CALL KnownMemberHandler(JSON_Parser parser, size_t keyIndex, const char* pName, size_t length, JSON_StringAttributes attributes)
+{
+    if (s_failHandler)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    if (keyIndex == JSON_UNKNOWN_KEY)
+    {
+        OutputFormatted("K-(");
+    }
+    else
+    {
+        OutputFormatted("K%d(", (int)keyIndex);
+    }
+    OutputStringBytes((const unsigned char*)pName, length, attributes, JSON_Parser_GetStringEncoding(parser));
+    OutputFormatted(")");
+    return JSON_Parser_Continue;
+}
 
-    /* Next 4 bits are output encoding. */
-    DefaultOut = 0 << 4,
-    UTF8Out    = 1 << 4,
-    UTF16LEOut = 2 << 4,
-    UTF16BEOut = 3 << 4,
-    UTF32LEOut = 4 << 4,
-    UTF32BEOut = 5 << 4,
+static JSON_Parser_HandlerResult JSON_CALL PathMatchHandler(JSON_Parser parser, size_t pathIndex)
+{
+    (void)parser;
+    if (s_failHandler)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    OutputFormatted("P%d", (int)pathIndex);
+    return JSON_Parser_Continue;
+}
 
-    /* Next 2 bits are max string length. */
-    DefaultMaxStringLength = 0 << 8,
-    MaxStringLength0       = 1 << 8,
-    MaxStringLength1       = 2 << 8,
-    MaxStringLength2       = 3 << 8,
+/* The skipping handlers output "M(...)", "S(...)", "{", and "[", and skip
+   the values of members and strings whose names start with an underscore,
+   and the containers that start at s_skippedContainerDepth. */
+static size_t s_skippedContainerDepth = 0;
 
-    /* Next 2 bits are max number length. */
-    DefaultMaxNumberLength = 0 << 10,
-    MaxNumberLength0       = 1 << 10,
-    MaxNumberLength1       = 2 << 10,
-    MaxNumberLength2       = 3 << 10,
+static JSON_Parser_HandlerResult JSON_CALL SkippingObjectMemberHandler(JSON_Parser parser, char* pValue, size_t length, JSON_StringAttributes attributes)
+{
+    OutputSeparator();
+    OutputFormatted("M(");
+    OutputStringBytes((const unsigned char*)pValue, length, attributes, JSON_Parser_GetStringEncoding(parser));
+    OutputFormatted(")");
+    return (length && pValue[0] == '_') ? JSON_Parser_SkipValue : JSON_Parser_Continue;
+}
 
-    /* Rest of bits are settings. */
-    AllowBOM                        = 1 << 12,
-    AllowComments                   = 1 << 13,
-    AllowSpecialNumbers             = 1 << 14,
-    AllowHexNumbers                 = 1 << 15,
-    AllowUnescapedControlCharacters = 1 << 16,
-    ReplaceInvalidEncodingSequences = 1 << 17,
-    TrackObjectMembers              = 1 << 18,
-    StopAfterEmbeddedDocument       = 1 << 19
-} ParserParam;
-typedef unsigned int ParserParams;
+static JSON_Parser_HandlerResult JSON_CALL SkippingStringHandler(JSON_Parser parser, char* pValue, size_t length, JSON_StringAttributes attributes)
+{
+    OutputSeparator();
+    OutputFormatted("S(");
+    OutputStringBytes((const unsigned char*)pValue, length, attributes, JSON_Parser_GetStringEncoding(parser));
+    OutputFormatted(")");
+    return (length && pValue[0] == '_') ? JSON_Parser_SkipValue : JSON_Parser_Continue;
+}
 
-typedef struct tag_ParseTest
+static JSON_Parser_HandlerResult JSON_CALL SkippingStartContainerHandler(JSON_Parser parser, const char* pOutput)
 {
-    const char*   pName;
-    ParserParams  parserParams;
-    const char*   pInput;
-    size_t        length;
-    JSON_Boolean  isFinal;
-    JSON_Encoding inputEncoding;
-    const char*   pOutput;
-} ParseTest;
+    JSON_Location location;
+    if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    OutputFormatted("%s", pOutput);
+    return (location.depth == s_skippedContainerDepth) ? JSON_Parser_SkipValue : JSON_Parser_Continue;
+}
 
-static void RunParseTest(const ParseTest* pTest)
+static JSON_Parser_HandlerResult JSON_CALL SkippingStartObjectHandler(JSON_Parser parser)
 {
-    JSON_Parser parser = NULL;
-    ParserSettings settings;
-    ParserState state;
-    printf("Test parsing %s ... ", pTest->pName);
+    return SkippingStartContainerHandler(parser, "{");
+}
 
-    InitParserSettings(&settings);
-    if ((pTest->parserParams & 0xF) != DefaultIn)
+static JSON_Parser_HandlerResult JSON_CALL SkippingStartArrayHandler(JSON_Parser parser)
+{
+    return SkippingStartContainerHandler(parser, "[");
+}
+
+/* The native number handlers output "i(...)", "u(...)", and "d(...)". The
+   64-bit values are formatted by hand because C89's printf() has no length
+   modifier for them. */
+static void OutputUInt64(JSON_UInt64 value)
+{
+    char digits[24];
+    int digitCount = 0;
+    do
     {
-        settings.inputEncoding = (JSON_Encoding)(pTest->parserParams & 0xF);
+        digits[digitCount++] = (char)('0' + (int)(value % 10));
+        value /= 10;
+    } while (value);
+    while (digitCount)
+    {
+        OutputCharacter(digits[--digitCount]);
     }
-    if ((pTest->parserParams & 0xF0) != DefaultOut)
+}
+
+static JSON_Parser_HandlerResult OutputNativeNumber(JSON_Parser parser, char type, const JSON_UInt64* pMagnitude, int isNegative, double value)
+{
+    JSON_Location location, afterLocation;
+    if (s_failHandler)
     {
-        settings.stringEncoding = settings.numberEncoding = (JSON_Encoding)((pTest->parserParams >> 4) & 0xF);
+        return JSON_Parser_Abort;
     }
-    if ((pTest->parserParams & 0x300) != DefaultMaxStringLength)
+    if (s_misbehaveInHandler && TryToMisbehaveInParseHandler(parser))
     {
-        settings.maxStringLength = (size_t)((pTest->parserParams >> 8) & 0x3) - 1;
+        return JSON_Parser_Abort;
     }
-    if ((pTest->parserParams & 0xC00) != DefaultMaxNumberLength)
+    if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success ||
+        JSON_Parser_GetAfterTokenLocation(parser, &afterLocation) != JSON_Success)
     {
-        settings.maxNumberLength = (size_t)((pTest->parserParams >> 10) & 0x3) - 1;
+        return JSON_Parser_Abort;
     }
-    settings.allowBOM = (JSON_Boolean)((pTest->parserParams >> 12) & 0x1);
-    settings.allowComments = (JSON_Boolean)((pTest->parserParams >> 13) & 0x1);
-    settings.allowSpecialNumbers = (JSON_Boolean)((pTest->parserParams >> 14) & 0x1);
-    settings.allowHexNumbers = (JSON_Boolean)((pTest->parserParams >> 15) & 0x1);
-    settings.allowUnescapedControlCharacters = (JSON_Boolean)((pTest->parserParams >> 16) & 0x1);
-    settings.replaceInvalidEncodingSequences = (JSON_Boolean)((pTest->parserParams >> 17) & 0x1);
-    settings.trackObjectMembers = (JSON_Boolean)((pTest->parserParams >> 18) & 0x1);
-    settings.stopAfterEmbeddedDocument = (JSON_Boolean)((pTest->parserParams >> 19) & 0x1);
-
-    InitParserState(&state);
-    state.inputEncoding = pTest->inputEncoding;
-    ResetOutput();
-
-    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
-        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
-        CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
-        CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
-        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
-        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
-        CheckParserSetSpecialNumberHandler(parser, &SpecialNumberHandler, JSON_Success) &&
-        CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
-        CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
-        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
-        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
-        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
-        CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
-        CheckParserSetInputEncoding(parser, settings.inputEncoding, JSON_Success) &&
-        CheckParserSetStringEncoding(parser, settings.stringEncoding, JSON_Success) &&
-        CheckParserSetNumberEncoding(parser, settings.numberEncoding, JSON_Success) &&
-        CheckParserSetMaxStringLength(parser, settings.maxStringLength, JSON_Success) &&
-        CheckParserSetMaxNumberLength(parser, settings.maxNumberLength, JSON_Success) &&
-        CheckParserSetAllowBOM(parser, settings.allowBOM, JSON_Success) &&
-        CheckParserSetAllowComments(parser, settings.allowComments, JSON_Success) &&
-        CheckParserSetAllowSpecialNumbers(parser, settings.allowSpecialNumbers, JSON_Success) &&
-        CheckParserSetAllowHexNumbers(parser, settings.allowHexNumbers, JSON_Success) &&
-        CheckParserSetAllowUnescapedControlCharacters(parser, settings.allowUnescapedControlCharacters, JSON_Success) &&
-        CheckParserSetReplaceInvalidEncodingSequences(parser, settings.replaceInvalidEncodingSequences, JSON_Success) &&
-        CheckParserSetTrackObjectMembers(parser, settings.trackObjectMembers, JSON_Success) &&
-        CheckParserSetStopAfterEmbeddedDocument(parser, settings.stopAfterEmbeddedDocument, JSON_Success))
+    OutputSeparator();
+    OutputCharacter(type);
+    OutputCharacter('(');
+    if (pMagnitude)
     {
-        JSON_Parser_Parse(parser, pTest->pInput, pTest->length, pTest->isFinal);
-        state.error = JSON_Parser_GetError(parser);
-        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
-        if (state.error != JSON_Error_None)
+        if (isNegative)
         {
-            OutputSeparator();
-            OutputFormatted("!(%s):", errorNames[state.error]);
-            OutputLocation(&state.errorLocation);
+            OutputCharacter('-');
         }
-        if (CheckParserState(parser, &state) && CheckOutput(pTest->pOutput))
+        OutputUInt64(*pMagnitude);
+    }
+    else
+    {
+        OutputFormatted("%.17g", value);
+    }
+    OutputFormatted("):");
+    OutputLocation(&location);
+    OutputFormatted("-");
+    OutputLocation(&afterLocation);
+    return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult JSON_CALL Int64Handler(JSON_Parser parser, JSON_Int64 value, JSON_NumberAttributes attributes)
+{
+    /* The attributes distinguish -0 from 0. */
+    JSON_UInt64 magnitude = (value < 0) ? (JSON_UInt64)0 - (JSON_UInt64)value : (JSON_UInt64)value;
+    return OutputNativeNumber(parser, 'i', &magnitude, (attributes & JSON_IsNegative) != 0, 0.0);
+}
+
+static JSON_Parser_HandlerResult JSON_CALL UInt64Handler(JSON_Parser parser, JSON_UInt64 value, JSON_NumberAttributes attributes)
+{
+    (void)attributes;
+    return OutputNativeNumber(parser, 'u', &value, 0, 0.0);
+}
+
+static JSON_Parser_HandlerResult JSON_CALL DoubleHandler(JSON_Parser parser, double value, JSON_NumberAttributes attributes)
+{
+    (void)attributes;
+    return OutputNativeNumber(parser, 'd', NULL, 0, value);
+}
+
+static JSON_Event s_events[64];
+
+static JSON_Parser_HandlerResult JSON_CALL EventBatchHandler(JSON_Parser parser, const JSON_Event* pEvents, size_t count, const char* pArena)
+{
+    static const char eventCodes[] = { 'n', 'b', 's', '#', 'x', '{', '}', 'm', '[', ']' };
+    size_t i;
+    (void)parser;
+    if (s_failHandler)
+    {
+        return JSON_Parser_Abort;
+    }
+    for (i = 0; i < count; i++)
+    {
+        const JSON_Event* pEvent = &pEvents[i];
+        OutputSeparator();
+        OutputCharacter(eventCodes[pEvent->type]);
+        OutputFormatted("%u", pEvent->depth);
+        if (pEvent->type == JSON_Event_String || pEvent->type == JSON_Event_Number || pEvent->type == JSON_Event_ObjectMember)
         {
-            printf("OK\n");
+            /* Values in the arena are null-terminated. */
+            if (pArena[pEvent->valueOffset + pEvent->valueLength])
+            {
+                return JSON_Parser_Abort;
+            }
+            OutputFormatted("(%s)", pArena + pEvent->valueOffset);
         }
-        else
+        else if (pEvent->type == JSON_Event_Boolean || pEvent->type == JSON_Event_SpecialNumber)
         {
-            s_failureCount++;
+            OutputFormatted("(%d)", (int)pEvent->attributes);
         }
     }
-    else
-    {
-        s_failureCount++;
-    }
-    JSON_Parser_Free(parser);
-    ResetOutput();
+    OutputSeparator();
+    OutputCharacter('|');
+    return JSON_Parser_Continue;
 }
 
-static void TestParserCreate(void)
+static JSON_Parser_HandlerResult JSON_CALL StartArrayHandler(JSON_Parser parser)
 {
-    JSON_Parser parser = NULL;
-    printf("Test creating parser ... ");
-    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
-        CheckParserHasDefaultValues(parser))
+    JSON_Location location, afterLocation;
+    if (s_failHandler)
     {
-        printf("OK\n");
+        return JSON_Parser_Abort;
     }
-    else
+    if (s_misbehaveInHandler && TryToMisbehaveInParseHandler(parser))
     {
-        s_failureCount++;
+        return JSON_Parser_Abort;
     }
-    JSON_Parser_Free(parser);
+    if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success ||
+        JSON_Parser_GetAfterTokenLocation(parser, &afterLocation) != JSON_Success)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    OutputFormatted("[:");
+    OutputLocation(&location);
+    OutputFormatted("-");
+    OutputLocation(&afterLocation);
+    return JSON_Parser_Continue;
 }
 
-static void TestParserCreateWithCustomMemorySuite(void)
+static JSON_Parser_HandlerResult JSON_CALL EndArrayHandler(JSON_Parser parser)
 {
-    JSON_Parser parser = NULL;
-    printf("Test creating parser with custom memory suite ... ");
-    if (CheckParserCreateWithCustomMemorySuite(NULL, NULL, JSON_Failure, &parser) &&
-        CheckParserCreateWithCustomMemorySuite(&ReallocHandler, NULL, JSON_Failure, &parser) &
-        CheckParserCreateWithCustomMemorySuite(NULL, &FreeHandler, JSON_Failure, &parser) &&
-        CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
-        CheckParserHasDefaultValues(parser))
+    JSON_Location location, afterLocation;
+    if (s_failHandler)
     {
-        printf("OK\n");
+        return JSON_Parser_Abort;
     }
-    else
+    if (s_misbehaveInHandler && TryToMisbehaveInParseHandler(parser))
     {
-        s_failureCount++;
+        return JSON_Parser_Abort;
     }
-    JSON_Parser_Free(parser);
+    if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success ||
+        JSON_Parser_GetAfterTokenLocation(parser, &afterLocation) != JSON_Success)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    OutputFormatted("]:");
+    OutputLocation(&location);
+    OutputFormatted("-");
+    OutputLocation(&afterLocation);
+    return JSON_Parser_Continue;
 }
 
-static void TestParserCreateMallocFailure(void)
+static JSON_Parser_HandlerResult JSON_CALL ArrayItemHandler(JSON_Parser parser)
 {
-    JSON_Parser parser = NULL;
-    printf("Test creating parser malloc failure ... ");
-    s_failMalloc = 1;
-    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Failure, &parser))
+    JSON_Location location, afterLocation;
+    if (s_failHandler)
     {
-        printf("OK\n");
+        return JSON_Parser_Abort;
     }
-    else
+    if (s_misbehaveInHandler && TryToMisbehaveInParseHandler(parser))
     {
-        s_failureCount++;
+        return JSON_Parser_Abort;
     }
-    s_failMalloc = 0;
-    JSON_Parser_Free(parser);
+    if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success ||
+        JSON_Parser_GetAfterTokenLocation(parser, &afterLocation) != JSON_Success)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    OutputFormatted("i:");
+    OutputLocation(&location);
+    OutputFormatted("-");
+    OutputLocation(&afterLocation);
+    return JSON_Parser_Continue;
 }
 
-static void TestParserSetSettings(void)
+static JSON_Parser_HandlerResult JSON_CALL StartDocumentHandler(JSON_Parser parser)
 {
-    JSON_Parser parser = NULL;
-    ParserSettings settings;
-    printf("Test setting parser settings ... ");
-    InitParserSettings(&settings);
-    settings.userData = (void*)1;
-    settings.inputEncoding = JSON_UTF16LE;
-    settings.stringEncoding = JSON_UTF32LE;
-    settings.numberEncoding = JSON_UTF32BE;
-    settings.maxStringLength = 2;
-    settings.maxNumberLength = 3;
-    settings.allowBOM = JSON_True;
-    settings.allowComments = JSON_True;
-    settings.allowSpecialNumbers = JSON_True;
-    settings.allowHexNumbers = JSON_True;
-    settings.allowUnescapedControlCharacters = JSON_True;
-    settings.replaceInvalidEncodingSequences = JSON_True;
-    settings.trackObjectMembers = JSON_True;
-    settings.stopAfterEmbeddedDocument = JSON_True;
-    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
-        CheckParserSetUserData(parser, settings.userData, JSON_Success) &&
-        CheckParserSetInputEncoding(parser, settings.inputEncoding, JSON_Success) &&
-        CheckParserSetStringEncoding(parser, settings.stringEncoding, JSON_Success) &&
-        CheckParserSetNumberEncoding(parser, settings.numberEncoding, JSON_Success) &&
-        CheckParserSetMaxStringLength(parser, settings.maxStringLength, JSON_Success) &&
-        CheckParserSetMaxNumberLength(parser, settings.maxNumberLength, JSON_Success) &&
-        CheckParserSetAllowBOM(parser, settings.allowBOM, JSON_Success) &&
-        CheckParserSetAllowComments(parser, settings.allowComments, JSON_Success) &&
-        CheckParserSetAllowSpecialNumbers(parser, settings.allowSpecialNumbers, JSON_Success) &&
-        CheckParserSetAllowHexNumbers(parser, settings.allowHexNumbers, JSON_Success) &&
-        CheckParserSetAllowUnescapedControlCharacters(parser, settings.allowUnescapedControlCharacters, JSON_Success) &&
-        CheckParserSetReplaceInvalidEncodingSequences(parser, settings.replaceInvalidEncodingSequences, JSON_Success) &&
-        CheckParserSetTrackObjectMembers(parser, settings.trackObjectMembers, JSON_Success) &&
-        CheckParserSetStopAfterEmbeddedDocument(parser, settings.stopAfterEmbeddedDocument, JSON_Success) &&
-        CheckParserSettings(parser, &settings))
+    JSON_Location location, afterLocation;
+    if (s_failHandler)
     {
-        printf("OK\n");
+        return JSON_Parser_Abort;
     }
-    else
+    if (s_misbehaveInHandler && TryToMisbehaveInParseHandler(parser))
     {
-        s_failureCount++;
+        return JSON_Parser_Abort;
     }
-    JSON_Parser_Free(parser);
+    if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success ||
+        JSON_Parser_GetAfterTokenLocation(parser, &afterLocation) != JSON_Success)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    OutputFormatted("<:");
+    OutputLocation(&location);
+    OutputFormatted("-");
+    OutputLocation(&afterLocation);
+    return JSON_Parser_Continue;
 }
 
-static void TestParserSetInvalidSettings(void)
+static JSON_Parser_HandlerResult JSON_CALL EndDocumentHandler(JSON_Parser parser)
 {
-    JSON_Parser parser = NULL;
-    ParserSettings settings;
-    printf("Test setting invalid parser settings ... ");
-    InitParserSettings(&settings);
-    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
-        CheckParserSetInputEncoding(parser, (JSON_Encoding)(JSON_UTF32BE + 1), JSON_Failure) &&
-        CheckParserSetStringEncoding(parser, JSON_UnknownEncoding, JSON_Failure) &&
-        CheckParserSetStringEncoding(parser, (JSON_Encoding)(JSON_UTF32BE + 1), JSON_Failure) &&
-        CheckParserSetNumberEncoding(parser, JSON_UnknownEncoding, JSON_Failure) &&
-        CheckParserSetNumberEncoding(parser, (JSON_Encoding)(JSON_UTF32BE + 1), JSON_Failure) &&
-        CheckParserParse(parser, NULL, 1, JSON_False, JSON_Failure) &&
-        CheckParserSettings(parser, &settings))
+    JSON_Location location, afterLocation;
+    if (s_failHandler)
     {
-        printf("OK\n");
+        return JSON_Parser_Abort;
     }
-    else
+    if (s_misbehaveInHandler && TryToMisbehaveInParseHandler(parser))
     {
-        s_failureCount++;
+        return JSON_Parser_Abort;
     }
-    JSON_Parser_Free(parser);
+    if (JSON_Parser_GetTokenLocation(parser, &location) != JSON_Success ||
+        JSON_Parser_GetAfterTokenLocation(parser, &afterLocation) != JSON_Success)
+    {
+        return JSON_Parser_Abort;
+    }
+    OutputSeparator();
+    OutputFormatted(">:");
+    OutputLocation(&location);
+    OutputFormatted("-");
+    OutputLocation(&afterLocation);
+    return JSON_Parser_Continue;
 }
 
-static void TestParserSetHandlers(void)
+typedef enum tag_ParserParam
 {
-    JSON_Parser parser = NULL;
-    ParserHandlers handlers;
-    printf("Test setting parser handlers ... ");
-    InitParserHandlers(&handlers);
-    handlers.encodingDetectedHandler = &EncodingDetectedHandler;
-    handlers.nullHandler = &NullHandler;
-    handlers.booleanHandler = &BooleanHandler;
-    handlers.stringHandler = &StringHandler;
-    handlers.numberHandler = &NumberHandler;
-    handlers.specialNumberHandler = &SpecialNumberHandler;
-    handlers.startObjectHandler = &StartObjectHandler;
-    handlers.endObjectHandler = &EndObjectHandler;
-    handlers.objectMemberHandler = &ObjectMemberHandler;
-    handlers.startArrayHandler = &StartArrayHandler;
-    handlers.endArrayHandler = &EndArrayHandler;
-    handlers.arrayItemHandler = &ArrayItemHandler;
-    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
-        CheckParserSetEncodingDetectedHandler(parser, handlers.encodingDetectedHandler, JSON_Success) &&
-        CheckParserSetNullHandler(parser, handlers.nullHandler, JSON_Success) &&
-        CheckParserSetBooleanHandler(parser, handlers.booleanHandler, JSON_Success) &&
-        CheckParserSetStringHandler(parser, handlers.stringHandler, JSON_Success) &&
-        CheckParserSetNumberHandler(parser, handlers.numberHandler, JSON_Success) &&
-        CheckParserSetSpecialNumberHandler(parser, handlers.specialNumberHandler, JSON_Success) &&
-        CheckParserSetStartObjectHandler(parser, handlers.startObjectHandler, JSON_Success) &&
-        CheckParserSetEndObjectHandler(parser, handlers.endObjectHandler, JSON_Success) &&
-        CheckParserSetObjectMemberHandler(parser, handlers.objectMemberHandler, JSON_Success) &&
-        CheckParserSetStartArrayHandler(parser, handlers.startArrayHandler, JSON_Success) &&
-        CheckParserSetEndArrayHandler(parser, handlers.endArrayHandler, JSON_Success) &&
-        CheckParserSetArrayItemHandler(parser, handlers.arrayItemHandler, JSON_Success) &&
-        CheckParserHandlers(parser, &handlers))
+    Standard = 0,
+
+    /* Bottom 4 bits are input encoding. */
+    DefaultIn = 0 << 0,
+    UTF8In    = 1 << 0,
+    UTF16LEIn = 2 << 0,
+    UTF16BEIn = 3 << 0,
+    UTF32LEIn = 4 << 0,
+    UTF32BEIn = 5 << 0,
+
+    /* Next 4 bits are output encoding. */
+    DefaultOut = 0 << 4,
+    UTF8Out    = 1 << 4,
+    UTF16LEOut = 2 << 4,
+    UTF16BEOut = 3 << 4,
+    UTF32LEOut = 4 << 4,
+    UTF32BEOut = 5 << 4,
+
+    /* Next 2 bits are max string length. */
+    DefaultMaxStringLength = 0 << 8,
+    MaxStringLength0       = 1 << 8,
+    MaxStringLength1       = 2 << 8,
+    MaxStringLength2       = 3 << 8,
+
+    /* Next 2 bits are max number length. */
+    DefaultMaxNumberLength = 0 << 10,
+    MaxNumberLength0       = 1 << 10,
+    MaxNumberLength1       = 2 << 10,
+    MaxNumberLength2       = 3 << 10,
+
+    /* Rest of bits are settings. */
+    AllowBOM                        = 1 << 12,
+    AllowComments                   = 1 << 13,
+    AllowSpecialNumbers             = 1 << 14,
+    AllowHexNumbers                 = 1 << 15,
+    AllowUnescapedControlCharacters = 1 << 16,
+    ReplaceInvalidEncodingSequences = 1 << 17,
+    TrackObjectMembers              = 1 << 18,
+    StopAfterEmbeddedDocument       = 1 << 19,
+    AllowMultipleDocuments          = 1 << 20,
+    AllowArraySegment               = 1 << 21
+} ParserParam;
+typedef unsigned int ParserParams;
+
+typedef struct tag_ParseTest
+{
+    const char*   pName;
+    ParserParams  parserParams;
+    const char*   pInput;
+    size_t        length;
+    JSON_Boolean  isFinal;
+    JSON_Encoding inputEncoding;
+    const char*   pOutput;
+} ParseTest;
+
+typedef enum tag_ParseMode
+{
+    ParseNormally,
+    ParseWithRefHandlers,
+    ParseWithLazyLocations
+} ParseMode;
+
+static void RunParseTest(const ParseTest* pTest, size_t chunkSize, ParseMode mode)
+{
+    JSON_Parser parser = NULL;
+    ParserSettings settings;
+    ParserState state;
+    if (mode == ParseWithRefHandlers)
     {
-        printf("OK\n");
+        printf("Test parsing %s with ref handlers ... ", pTest->pName);
+    }
+    else if (mode == ParseWithLazyLocations && chunkSize)
+    {
+        printf("Test parsing %s with lazy locations in %d-byte chunks ... ", pTest->pName, (int)chunkSize);
+    }
+    else if (mode == ParseWithLazyLocations)
+    {
+        printf("Test parsing %s with lazy locations ... ", pTest->pName);
+    }
+    else if (chunkSize)
+    {
+        printf("Test parsing %s in %d-byte chunks ... ", pTest->pName, (int)chunkSize);
     }
     else
     {
-        s_failureCount++;
+        printf("Test parsing %s ... ", pTest->pName);
     }
-    JSON_Parser_Free(parser);
-}
 
-static void TestParserReset(void)
-{
-    static const char input[] = "{\"foo\":{\"bar\":[1,2]},\"bar\":{"; /* partial document */
-    JSON_Parser parser = NULL;
-    ParserState state;
-    ParserSettings settings;
-    ParserHandlers handlers;
-    printf("Test resetting parser ... ");
-    InitParserState(&state);
     InitParserSettings(&settings);
-    InitParserHandlers(&handlers);
-    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
-        CheckParserSetUserData(parser, (void*)1, JSON_Success) &&
-        CheckParserSetInputEncoding(parser, JSON_UTF8, JSON_Success) &&
-        CheckParserSetStringEncoding(parser, JSON_UTF16LE, JSON_Success) &&
-        CheckParserSetNumberEncoding(parser, JSON_UTF16LE, JSON_Success) &&
-        CheckParserSetMaxStringLength(parser, 32, JSON_Success) &&
-        CheckParserSetMaxNumberLength(parser, 32, JSON_Success) &&
-        CheckParserSetAllowBOM(parser, JSON_True, JSON_Success) &&
-        CheckParserSetAllowComments(parser, JSON_True, JSON_Success) &&
-        CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
-        CheckParserSetAllowHexNumbers(parser, JSON_True, JSON_Success) &&
-        CheckParserSetAllowUnescapedControlCharacters(parser, JSON_True, JSON_Success) &&
-        CheckParserSetReplaceInvalidEncodingSequences(parser, JSON_True, JSON_Success) &&
-        CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+    if ((pTest->parserParams & 0xF) != DefaultIn)
+    {
+        settings.inputEncoding = (JSON_Encoding)(pTest->parserParams & 0xF);
+    }
+    if ((pTest->parserParams & 0xF0) != DefaultOut)
+    {
+        settings.stringEncoding = settings.numberEncoding = (JSON_Encoding)((pTest->parserParams >> 4) & 0xF);
+    }
+    if ((pTest->parserParams & 0x300) != DefaultMaxStringLength)
+    {
+        settings.maxStringLength = (size_t)((pTest->parserParams >> 8) & 0x3) - 1;
+    }
+    if ((pTest->parserParams & 0xC00) != DefaultMaxNumberLength)
+    {
+        settings.maxNumberLength = (size_t)((pTest->parserParams >> 10) & 0x3) - 1;
+    }
+    settings.allowBOM = (JSON_Boolean)((pTest->parserParams >> 12) & 0x1);
+    settings.allowComments = (JSON_Boolean)((pTest->parserParams >> 13) & 0x1);
+    settings.allowSpecialNumbers = (JSON_Boolean)((pTest->parserParams >> 14) & 0x1);
+    settings.allowHexNumbers = (JSON_Boolean)((pTest->parserParams >> 15) & 0x1);
+    settings.allowUnescapedControlCharacters = (JSON_Boolean)((pTest->parserParams >> 16) & 0x1);
+    settings.replaceInvalidEncodingSequences = (JSON_Boolean)((pTest->parserParams >> 17) & 0x1);
+    settings.trackObjectMembers = (JSON_Boolean)((pTest->parserParams >> 18) & 0x1);
+    settings.stopAfterEmbeddedDocument = (JSON_Boolean)((pTest->parserParams >> 19) & 0x1);
+    settings.allowMultipleDocuments = (JSON_Boolean)((pTest->parserParams >> 20) & 0x1);
+    settings.allowArraySegment = (JSON_Boolean)((pTest->parserParams >> 21) & 0x1);
+
+    InitParserState(&state);
+    state.inputEncoding = pTest->inputEncoding;
+    ResetOutput();
+
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
         CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
         CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
         CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
@@ -1721,74 +2118,85 @@ static void TestParserReset(void)
         CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
         CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
         CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
-        CheckParserParse(parser, input, sizeof(input) - 1, JSON_False, JSON_Success) &&
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserState(parser, &state) &&
-        CheckParserSettings(parser, &settings) &&
-        CheckParserHandlers(parser, &handlers))
-    {
-        printf("OK\n");
+        CheckParserSetStartDocumentHandler(parser, &StartDocumentHandler, JSON_Success) &&
+        CheckParserSetEndDocumentHandler(parser, &EndDocumentHandler, JSON_Success) &&
+        CheckParserSetInputEncoding(parser, settings.inputEncoding, JSON_Success) &&
+        CheckParserSetStringEncoding(parser, settings.stringEncoding, JSON_Success) &&
+        CheckParserSetNumberEncoding(parser, settings.numberEncoding, JSON_Success) &&
+        CheckParserSetMaxStringLength(parser, settings.maxStringLength, JSON_Success) &&
+        CheckParserSetMaxNumberLength(parser, settings.maxNumberLength, JSON_Success) &&
+        CheckParserSetAllowBOM(parser, settings.allowBOM, JSON_Success) &&
+        CheckParserSetAllowComments(parser, settings.allowComments, JSON_Success) &&
+        CheckParserSetAllowSpecialNumbers(parser, settings.allowSpecialNumbers, JSON_Success) &&
+        CheckParserSetAllowHexNumbers(parser, settings.allowHexNumbers, JSON_Success) &&
+        CheckParserSetAllowUnescapedControlCharacters(parser, settings.allowUnescapedControlCharacters, JSON_Success) &&
+        CheckParserSetReplaceInvalidEncodingSequences(parser, settings.replaceInvalidEncodingSequences, JSON_Success) &&
+        CheckParserSetTrackObjectMembers(parser, settings.trackObjectMembers, JSON_Success) &&
+        CheckParserSetStopAfterEmbeddedDocument(parser, settings.stopAfterEmbeddedDocument, JSON_Success) &&
+        CheckParserSetAllowMultipleDocuments(parser, settings.allowMultipleDocuments, JSON_Success) &&
+        CheckParserSetAllowArraySegment(parser, settings.allowArraySegment, JSON_Success) &&
+        CheckParserSetTrackLocationsLazily(parser, (JSON_Boolean)(mode == ParseWithLazyLocations), JSON_Success) &&
+        (mode != ParseWithRefHandlers ||
+         (CheckParserSetStringRefHandler(parser, &StringRefHandler, JSON_Success) &&
+          CheckParserSetNumberRefHandler(parser, &NumberRefHandler, JSON_Success) &&
+          CheckParserSetObjectMemberRefHandler(parser, &ObjectMemberRefHandler, JSON_Success))))
+    {
+        if (chunkSize)
+        {
+            /* Feeding the same input in small chunks must produce exactly
+               the same events, locations, and errors. */
+            size_t offset = 0;
+            do
+            {
+                size_t length = pTest->length - offset;
+                JSON_Boolean isFinal = pTest->isFinal;
+                if (length > chunkSize)
+                {
+                    length = chunkSize;
+                    isFinal = JSON_False;
+                }
+                if (JSON_Parser_Parse(parser, pTest->pInput + offset, length, isFinal) == JSON_Failure)
+                {
+                    break;
+                }
+                offset += length;
+            } while (offset < pTest->length);
+        }
+        else
+        {
+            JSON_Parser_Parse(parser, pTest->pInput, pTest->length, pTest->isFinal);
+        }
+        state.error = JSON_Parser_GetError(parser);
+        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
+        if (state.error != JSON_Error_None)
+        {
+            OutputSeparator();
+            OutputFormatted("!(%s):", errorNames[state.error]);
+            OutputLocation(&state.errorLocation);
+        }
+        if (CheckParserState(parser, &state) && CheckOutput(pTest->pOutput))
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            s_failureCount++;
+        }
     }
     else
     {
         s_failureCount++;
     }
     JSON_Parser_Free(parser);
+    ResetOutput();
 }
 
-static void TestParserMisbehaveInCallbacks(void)
+static void TestParserCreate(void)
 {
     JSON_Parser parser = NULL;
-    printf("Test parser misbehaving in callbacks ... ");
-    s_misbehaveInHandler = 1;
+    printf("Test creating parser ... ");
     if (CheckParserCreate(NULL, JSON_Success, &parser) &&
-        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
-        CheckParserParse(parser, "null", 4, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
-        CheckParserParse(parser, "null", 4, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
-        CheckParserParse(parser, "true", 4, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
-        CheckParserParse(parser, "\"\"", 2, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
-        CheckParserParse(parser, "7", 1, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
-        CheckParserSetSpecialNumberHandler(parser, &SpecialNumberHandler, JSON_Success) &&
-        CheckParserParse(parser, "NaN", 3, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
-        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
-        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
-        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
-        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
-        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Success) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
-        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Success))
+        CheckParserHasDefaultValues(parser))
     {
         printf("OK\n");
     }
@@ -1796,93 +2204,18 @@ static void TestParserMisbehaveInCallbacks(void)
     {
         s_failureCount++;
     }
-    s_misbehaveInHandler = 0;
     JSON_Parser_Free(parser);
 }
 
-static void TestParserAbortInCallbacks(void)
+static void TestParserCreateWithCustomMemorySuite(void)
 {
     JSON_Parser parser = NULL;
-    ParserState state;
-    printf("Test parser aborting in callbacks ... ");
-    InitParserState(&state);
-    state.error = JSON_Error_AbortedByHandler;
-    state.errorLocation.byte = 0;
-    state.errorLocation.line = 0;
-    state.errorLocation.column = 0;
-    state.errorLocation.depth = 0;
-    state.inputEncoding = JSON_UTF8;
-    s_failHandler = 1;
-    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
-        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
-        CheckParserParse(parser, " ", 1, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
-        CheckParserParse(parser, "    ", 4, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        !!(state.errorLocation.byte = 1) && /* hacky */
-        !!(state.errorLocation.column = 1) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
-        CheckParserParse(parser, " null", 6, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
-        CheckParserParse(parser, " true", 6, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
-        CheckParserParse(parser, " \"\"", 3, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
-        CheckParserParse(parser, " 7", 2, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
-        CheckParserSetSpecialNumberHandler(parser, &SpecialNumberHandler, JSON_Success) &&
-        CheckParserParse(parser, " NaN", 4, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
-        CheckParserParse(parser, " {}", 3, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
-        CheckParserParse(parser, "{}", 2, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
-        CheckParserParse(parser, " []", 3, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
-        CheckParserParse(parser, "[]", 2, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        !!(state.errorLocation.depth = 1) && /* hacky! */
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
-        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state) &&
-
-        CheckParserReset(parser, JSON_Success) &&
-        CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
-        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Failure) &&
-        CheckParserState(parser, &state))
+    printf("Test creating parser with custom memory suite ... ");
+    if (CheckParserCreateWithCustomMemorySuite(NULL, NULL, JSON_Failure, &parser) &&
+        CheckParserCreateWithCustomMemorySuite(&ReallocHandler, NULL, JSON_Failure, &parser) &
+        CheckParserCreateWithCustomMemorySuite(NULL, &FreeHandler, JSON_Failure, &parser) &&
+        CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
+        CheckParserHasDefaultValues(parser))
     {
         printf("OK\n");
     }
@@ -1890,38 +2223,15 @@ static void TestParserAbortInCallbacks(void)
     {
         s_failureCount++;
     }
-    s_failHandler = 0;
     JSON_Parser_Free(parser);
 }
 
-static void TestParserStringMallocFailure(void)
+static void TestParserCreateMallocFailure(void)
 {
-    int succeeded = 0;
     JSON_Parser parser = NULL;
-    ParserState state;
-    printf("Test parser string malloc failure ... ");
-    InitParserState(&state);
-    state.error = JSON_Error_OutOfMemory;
-    state.inputEncoding = JSON_UTF8;
-    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
-        CheckParserParse(parser, "\"", 1, JSON_False, JSON_Success))
-    {
-        s_failMalloc = 1;
-        for (;;)
-        {
-            if (JSON_Parser_Parse(parser, "a", 1, JSON_False) == JSON_Failure)
-            {
-                break;
-            }
-        }
-        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
-        if (CheckParserState(parser, &state))
-        {
-            succeeded = 1;
-        }
-        s_failMalloc = 0;
-    }
-    if (succeeded)
+    printf("Test creating parser malloc failure ... ");
+    s_failMalloc = 1;
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Failure, &parser))
     {
         printf("OK\n");
     }
@@ -1929,37 +2239,52 @@ static void TestParserStringMallocFailure(void)
     {
         s_failureCount++;
     }
+    s_failMalloc = 0;
     JSON_Parser_Free(parser);
 }
 
-static void TestParserStringReallocFailure(void)
+static void TestParserSetSettings(void)
 {
-    int succeeded = 0;
     JSON_Parser parser = NULL;
-    ParserState state;
-    printf("Test parser string realloc failure ... ");
-    InitParserState(&state);
-    state.error = JSON_Error_OutOfMemory;
-    state.inputEncoding = JSON_UTF8;
-    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
-        CheckParserParse(parser, "\"", 1, JSON_False, JSON_Success))
-    {
-        s_failRealloc = 1;
-        for (;;)
-        {
-            if (JSON_Parser_Parse(parser, "a", 1, JSON_False) == JSON_Failure)
-            {
-                break;
-            }
-        }
-        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
-        if (CheckParserState(parser, &state))
-        {
-            succeeded = 1;
-        }
-        s_failRealloc = 0;
-    }
-    if (succeeded)
+    ParserSettings settings;
+    printf("Test setting parser settings ... ");
+    InitParserSettings(&settings);
+    settings.userData = (void*)1;
+    settings.inputEncoding = JSON_UTF16LE;
+    settings.stringEncoding = JSON_UTF32LE;
+    settings.numberEncoding = JSON_UTF32BE;
+    settings.maxStringLength = 2;
+    settings.maxNumberLength = 3;
+    settings.allowBOM = JSON_True;
+    settings.allowComments = JSON_True;
+    settings.allowSpecialNumbers = JSON_True;
+    settings.allowHexNumbers = JSON_True;
+    settings.allowUnescapedControlCharacters = JSON_True;
+    settings.replaceInvalidEncodingSequences = JSON_True;
+    settings.trackObjectMembers = JSON_True;
+    settings.stopAfterEmbeddedDocument = JSON_True;
+    settings.trackLocationsLazily = JSON_True;
+    settings.allowMultipleDocuments = JSON_True;
+    settings.allowArraySegment = JSON_True;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetUserData(parser, settings.userData, JSON_Success) &&
+        CheckParserSetInputEncoding(parser, settings.inputEncoding, JSON_Success) &&
+        CheckParserSetStringEncoding(parser, settings.stringEncoding, JSON_Success) &&
+        CheckParserSetNumberEncoding(parser, settings.numberEncoding, JSON_Success) &&
+        CheckParserSetMaxStringLength(parser, settings.maxStringLength, JSON_Success) &&
+        CheckParserSetMaxNumberLength(parser, settings.maxNumberLength, JSON_Success) &&
+        CheckParserSetAllowBOM(parser, settings.allowBOM, JSON_Success) &&
+        CheckParserSetAllowComments(parser, settings.allowComments, JSON_Success) &&
+        CheckParserSetAllowSpecialNumbers(parser, settings.allowSpecialNumbers, JSON_Success) &&
+        CheckParserSetAllowHexNumbers(parser, settings.allowHexNumbers, JSON_Success) &&
+        CheckParserSetAllowUnescapedControlCharacters(parser, settings.allowUnescapedControlCharacters, JSON_Success) &&
+        CheckParserSetReplaceInvalidEncodingSequences(parser, settings.replaceInvalidEncodingSequences, JSON_Success) &&
+        CheckParserSetTrackObjectMembers(parser, settings.trackObjectMembers, JSON_Success) &&
+        CheckParserSetStopAfterEmbeddedDocument(parser, settings.stopAfterEmbeddedDocument, JSON_Success) &&
+        CheckParserSetTrackLocationsLazily(parser, settings.trackLocationsLazily, JSON_Success) &&
+        CheckParserSetAllowMultipleDocuments(parser, settings.allowMultipleDocuments, JSON_Success) &&
+        CheckParserSetAllowArraySegment(parser, settings.allowArraySegment, JSON_Success) &&
+        CheckParserSettings(parser, &settings))
     {
         printf("OK\n");
     }
@@ -1970,33 +2295,88 @@ static void TestParserStringReallocFailure(void)
     JSON_Parser_Free(parser);
 }
 
-static void TestParserStackMallocFailure(void)
+static void TestParserSetInvalidSettings(void)
 {
-    int succeeded = 0;
     JSON_Parser parser = NULL;
-    ParserState state;
-    printf("Test parser stack malloc failure ... ");
-    InitParserState(&state);
-    state.error = JSON_Error_OutOfMemory;
-    state.inputEncoding = JSON_UTF8;
-    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser))
+    ParserSettings settings;
+    printf("Test setting invalid parser settings ... ");
+    InitParserSettings(&settings);
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetInputEncoding(parser, (JSON_Encoding)(JSON_UTF32BE + 1), JSON_Failure) &&
+        CheckParserSetStringEncoding(parser, JSON_UnknownEncoding, JSON_Failure) &&
+        CheckParserSetStringEncoding(parser, (JSON_Encoding)(JSON_UTF32BE + 1), JSON_Failure) &&
+        CheckParserSetNumberEncoding(parser, JSON_UnknownEncoding, JSON_Failure) &&
+        CheckParserSetNumberEncoding(parser, (JSON_Encoding)(JSON_UTF32BE + 1), JSON_Failure) &&
+        CheckParserSetEventBatchHandler(parser, &EventBatchHandler, NULL, 1, JSON_Failure) &&
+        CheckParserSetEventBatchHandler(parser, &EventBatchHandler, s_events, 0, JSON_Failure) &&
+        CheckParserParse(parser, NULL, 1, JSON_False, JSON_Failure) &&
+        CheckParserSettings(parser, &settings))
     {
-        s_failMalloc = 1;
-        for (;;)
-        {
-            if (JSON_Parser_Parse(parser, "{\"a\":", 5, JSON_False) == JSON_Failure)
-            {
-                break;
-            }
-        }
-        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
-        if (CheckParserState(parser, &state))
-        {
-            succeeded = 1;
-        }
-        s_failMalloc = 0;
+        printf("OK\n");
     }
-    if (succeeded)
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserSetHandlers(void)
+{
+    JSON_Parser parser = NULL;
+    ParserHandlers handlers;
+    printf("Test setting parser handlers ... ");
+    InitParserHandlers(&handlers);
+    handlers.encodingDetectedHandler = &EncodingDetectedHandler;
+    handlers.nullHandler = &NullHandler;
+    handlers.booleanHandler = &BooleanHandler;
+    handlers.stringHandler = &StringHandler;
+    handlers.numberHandler = &NumberHandler;
+    handlers.specialNumberHandler = &SpecialNumberHandler;
+    handlers.startObjectHandler = &StartObjectHandler;
+    handlers.endObjectHandler = &EndObjectHandler;
+    handlers.objectMemberHandler = &ObjectMemberHandler;
+    handlers.startArrayHandler = &StartArrayHandler;
+    handlers.endArrayHandler = &EndArrayHandler;
+    handlers.arrayItemHandler = &ArrayItemHandler;
+    handlers.startDocumentHandler = &StartDocumentHandler;
+    handlers.endDocumentHandler = &EndDocumentHandler;
+    handlers.stringRefHandler = &StringRefHandler;
+    handlers.numberRefHandler = &NumberRefHandler;
+    handlers.objectMemberRefHandler = &ObjectMemberRefHandler;
+    handlers.int64Handler = &Int64Handler;
+    handlers.uint64Handler = &UInt64Handler;
+    handlers.doubleHandler = &DoubleHandler;
+    handlers.eventBatchHandler = &EventBatchHandler;
+    handlers.internedMemberHandler = &InternedMemberHandler;
+    handlers.knownMemberHandler = &KnownMemberHandler;
+    handlers.pathMatchHandler = &PathMatchHandler;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetEncodingDetectedHandler(parser, handlers.encodingDetectedHandler, JSON_Success) &&
+        CheckParserSetNullHandler(parser, handlers.nullHandler, JSON_Success) &&
+        CheckParserSetBooleanHandler(parser, handlers.booleanHandler, JSON_Success) &&
+        CheckParserSetStringHandler(parser, handlers.stringHandler, JSON_Success) &&
+        CheckParserSetNumberHandler(parser, handlers.numberHandler, JSON_Success) &&
+        CheckParserSetSpecialNumberHandler(parser, handlers.specialNumberHandler, JSON_Success) &&
+        CheckParserSetStartObjectHandler(parser, handlers.startObjectHandler, JSON_Success) &&
+        CheckParserSetEndObjectHandler(parser, handlers.endObjectHandler, JSON_Success) &&
+        CheckParserSetObjectMemberHandler(parser, handlers.objectMemberHandler, JSON_Success) &&
+        CheckParserSetStartArrayHandler(parser, handlers.startArrayHandler, JSON_Success) &&
+        CheckParserSetEndArrayHandler(parser, handlers.endArrayHandler, JSON_Success) &&
+        CheckParserSetArrayItemHandler(parser, handlers.arrayItemHandler, JSON_Success) &&
+        CheckParserSetStartDocumentHandler(parser, handlers.startDocumentHandler, JSON_Success) &&
+        CheckParserSetEndDocumentHandler(parser, handlers.endDocumentHandler, JSON_Success) &&
+        CheckParserSetStringRefHandler(parser, handlers.stringRefHandler, JSON_Success) &&
+        CheckParserSetNumberRefHandler(parser, handlers.numberRefHandler, JSON_Success) &&
+        CheckParserSetObjectMemberRefHandler(parser, handlers.objectMemberRefHandler, JSON_Success) &&
+        CheckParserSetInt64Handler(parser, handlers.int64Handler, JSON_Success) &&
+        CheckParserSetUInt64Handler(parser, handlers.uint64Handler, JSON_Success) &&
+        CheckParserSetDoubleHandler(parser, handlers.doubleHandler, JSON_Success) &&
+        CheckParserSetEventBatchHandler(parser, handlers.eventBatchHandler, s_events, sizeof(s_events) / sizeof(s_events[0]), JSON_Success) &&
+        CheckParserSetInternedMemberHandler(parser, handlers.internedMemberHandler, JSON_Success) &&
+        CheckParserSetKnownMemberHandler(parser, handlers.knownMemberHandler, JSON_Success) &&
+        CheckParserSetPathMatchHandler(parser, handlers.pathMatchHandler, JSON_Success) &&
+        CheckParserHandlers(parser, &handlers))
     {
         printf("OK\n");
     }
@@ -2007,21 +2387,240 @@ static void TestParserStackMallocFailure(void)
     JSON_Parser_Free(parser);
 }
 
-static void TestParserStackReallocFailure(void)
+static void TestParserReset(void)
 {
-    int succeeded = 0;
+    static const char input[] = "{\"foo\":{\"bar\":[1,2]},\"bar\":{"; /* partial document */
     JSON_Parser parser = NULL;
     ParserState state;
-    printf("Test parser stack realloc failure ... ");
+    ParserSettings settings;
+    ParserHandlers handlers;
+    printf("Test resetting parser ... ");
     InitParserState(&state);
-    state.error = JSON_Error_OutOfMemory;
+    InitParserSettings(&settings);
+    InitParserHandlers(&handlers);
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetUserData(parser, (void*)1, JSON_Success) &&
+        CheckParserSetInputEncoding(parser, JSON_UTF8, JSON_Success) &&
+        CheckParserSetStringEncoding(parser, JSON_UTF16LE, JSON_Success) &&
+        CheckParserSetNumberEncoding(parser, JSON_UTF16LE, JSON_Success) &&
+        CheckParserSetMaxStringLength(parser, 32, JSON_Success) &&
+        CheckParserSetMaxNumberLength(parser, 32, JSON_Success) &&
+        CheckParserSetAllowBOM(parser, JSON_True, JSON_Success) &&
+        CheckParserSetAllowComments(parser, JSON_True, JSON_Success) &&
+        CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
+        CheckParserSetAllowHexNumbers(parser, JSON_True, JSON_Success) &&
+        CheckParserSetAllowUnescapedControlCharacters(parser, JSON_True, JSON_Success) &&
+        CheckParserSetReplaceInvalidEncodingSequences(parser, JSON_True, JSON_Success) &&
+        CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+        CheckParserSetTrackLocationsLazily(parser, JSON_True, JSON_Success) &&
+        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
+        CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+        CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
+        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+        CheckParserSetSpecialNumberHandler(parser, &SpecialNumberHandler, JSON_Success) &&
+        CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
+        CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
+        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
+        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
+        CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
+        CheckParserSetStringRefHandler(parser, &StringRefHandler, JSON_Success) &&
+        CheckParserSetNumberRefHandler(parser, &NumberRefHandler, JSON_Success) &&
+        CheckParserSetObjectMemberRefHandler(parser, &ObjectMemberRefHandler, JSON_Success) &&
+        CheckParserSetInt64Handler(parser, &Int64Handler, JSON_Success) &&
+        CheckParserSetUInt64Handler(parser, &UInt64Handler, JSON_Success) &&
+        CheckParserSetDoubleHandler(parser, &DoubleHandler, JSON_Success) &&
+        CheckParserSetEventBatchHandler(parser, &EventBatchHandler, s_events, sizeof(s_events) / sizeof(s_events[0]), JSON_Success) &&
+        CheckParserParse(parser, input, sizeof(input) - 1, JSON_False, JSON_Success) &&
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserState(parser, &state) &&
+        CheckParserSettings(parser, &settings) &&
+        CheckParserHandlers(parser, &handlers))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserMisbehaveInCallbacks(void)
+{
+    JSON_Parser parser = NULL;
+    printf("Test parser misbehaving in callbacks ... ");
+    s_misbehaveInHandler = 1;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
+        CheckParserParse(parser, "null", 4, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+        CheckParserParse(parser, "null", 4, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
+        CheckParserParse(parser, "true", 4, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+        CheckParserParse(parser, "\"\"", 2, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+        CheckParserParse(parser, "7", 1, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
+        CheckParserSetSpecialNumberHandler(parser, &SpecialNumberHandler, JSON_Success) &&
+        CheckParserParse(parser, "NaN", 3, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
+        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
+        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
+        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
+        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Success) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
+        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Success))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    s_misbehaveInHandler = 0;
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserAbortInCallbacks(void)
+{
+    JSON_Parser parser = NULL;
+    ParserState state;
+    printf("Test parser aborting in callbacks ... ");
+    InitParserState(&state);
+    state.error = JSON_Error_AbortedByHandler;
+    state.errorLocation.byte = 0;
+    state.errorLocation.line = 0;
+    state.errorLocation.column = 0;
+    state.errorLocation.depth = 0;
     state.inputEncoding = JSON_UTF8;
-    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser))
+    s_failHandler = 1;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
+        CheckParserParse(parser, " ", 1, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetEncodingDetectedHandler(parser, &EncodingDetectedHandler, JSON_Success) &&
+        CheckParserParse(parser, "    ", 4, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        !!(state.errorLocation.byte = 1) && /* hacky */
+        !!(state.errorLocation.column = 1) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+        CheckParserParse(parser, " null", 6, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
+        CheckParserParse(parser, " true", 6, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+        CheckParserParse(parser, " \"\"", 3, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+        CheckParserParse(parser, " 7", 2, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
+        CheckParserSetSpecialNumberHandler(parser, &SpecialNumberHandler, JSON_Success) &&
+        CheckParserParse(parser, " NaN", 4, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
+        CheckParserParse(parser, " {}", 3, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
+        CheckParserParse(parser, "{}", 2, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+        CheckParserParse(parser, " []", 3, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
+        CheckParserParse(parser, "[]", 2, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        !!(state.errorLocation.depth = 1) && /* hacky! */
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
+        CheckParserParse(parser, "{\"x\":0}", 7, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state) &&
+
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
+        CheckParserParse(parser, "[0]", 3, JSON_True, JSON_Failure) &&
+        CheckParserState(parser, &state))
     {
-        s_failRealloc = 1;
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    s_failHandler = 0;
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserStringMallocFailure(void)
+{
+    int succeeded = 0;
+    JSON_Parser parser = NULL;
+    ParserState state;
+    printf("Test parser string malloc failure ... ");
+    InitParserState(&state);
+    state.error = JSON_Error_OutOfMemory;
+    state.inputEncoding = JSON_UTF8;
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
+        CheckParserParse(parser, "\"", 1, JSON_False, JSON_Success))
+    {
+        s_failMalloc = 1;
         for (;;)
         {
-            if (JSON_Parser_Parse(parser, "{\"a\":", 5, JSON_False) == JSON_Failure)
+            if (JSON_Parser_Parse(parser, "a", 1, JSON_False) == JSON_Failure)
             {
                 break;
             }
@@ -2031,7 +2630,7 @@ static void TestParserStackReallocFailure(void)
         {
             succeeded = 1;
         }
-        s_failRealloc = 0;
+        s_failMalloc = 0;
     }
     if (succeeded)
     {
@@ -2044,27 +2643,32 @@ static void TestParserStackReallocFailure(void)
     JSON_Parser_Free(parser);
 }
 
-static void TestParserDuplicateMemberTrackingMallocFailure(void)
+static void TestParserStringReallocFailure(void)
 {
     int succeeded = 0;
     JSON_Parser parser = NULL;
     ParserState state;
-    printf("Test parser duplicate member tracking malloc failure ... ");
+    printf("Test parser string realloc failure ... ");
     InitParserState(&state);
     state.error = JSON_Error_OutOfMemory;
-    state.errorLocation.byte = 1;
-    state.errorLocation.column = 1;
     state.inputEncoding = JSON_UTF8;
     if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
-        CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success))
+        CheckParserParse(parser, "\"", 1, JSON_False, JSON_Success))
     {
-        s_failMalloc = 1;
-        if (CheckParserParse(parser, "{\"a\":0}", 7, JSON_True, JSON_Failure) &&
-            CheckParserState(parser, &state))
+        s_failRealloc = 1;
+        for (;;)
+        {
+            if (JSON_Parser_Parse(parser, "a", 1, JSON_False) == JSON_Failure)
+            {
+                break;
+            }
+        }
+        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
+        if (CheckParserState(parser, &state))
         {
             succeeded = 1;
         }
-        s_failMalloc = 0;
+        s_failRealloc = 0;
     }
     if (succeeded)
     {
@@ -2077,20 +2681,178 @@ static void TestParserDuplicateMemberTrackingMallocFailure(void)
     JSON_Parser_Free(parser);
 }
 
-static void TestParserMissing(void)
+static void TestParserStackMallocFailure(void)
 {
+    int succeeded = 0;
+    JSON_Parser parser = NULL;
     ParserState state;
-    ParserSettings settings;
-    ParserHandlers handlers;
-    JSON_Location errorLocation;
-    printf("Test NULL parser instance ... ");
+    printf("Test parser stack malloc failure ... ");
     InitParserState(&state);
-    InitParserSettings(&settings);
-    InitParserHandlers(&handlers);
-    if (CheckParserState(NULL, &state) &&
-        CheckParserSettings(NULL, &settings) &&
-        CheckParserHandlers(NULL, &handlers) &&
-        CheckParserFree(NULL, JSON_Failure) &&
+    state.error = JSON_Error_OutOfMemory;
+    state.inputEncoding = JSON_UTF8;
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser))
+    {
+        s_failMalloc = 1;
+        for (;;)
+        {
+            if (JSON_Parser_Parse(parser, "{\"a\":", 5, JSON_False) == JSON_Failure)
+            {
+                break;
+            }
+        }
+        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
+        if (CheckParserState(parser, &state))
+        {
+            succeeded = 1;
+        }
+        s_failMalloc = 0;
+    }
+    if (succeeded)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserStackReallocFailure(void)
+{
+    int succeeded = 0;
+    JSON_Parser parser = NULL;
+    ParserState state;
+    printf("Test parser stack realloc failure ... ");
+    InitParserState(&state);
+    state.error = JSON_Error_OutOfMemory;
+    state.inputEncoding = JSON_UTF8;
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser))
+    {
+        s_failRealloc = 1;
+        for (;;)
+        {
+            if (JSON_Parser_Parse(parser, "{\"a\":", 5, JSON_False) == JSON_Failure)
+            {
+                break;
+            }
+        }
+        JSON_Parser_GetErrorLocation(parser, &state.errorLocation);
+        if (CheckParserState(parser, &state))
+        {
+            succeeded = 1;
+        }
+        s_failRealloc = 0;
+    }
+    if (succeeded)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserDuplicateMemberTrackingMallocFailure(void)
+{
+    int succeeded = 0;
+    JSON_Parser parser = NULL;
+    ParserState state;
+    printf("Test parser duplicate member tracking malloc failure ... ");
+    InitParserState(&state);
+    state.error = JSON_Error_OutOfMemory;
+    state.errorLocation.byte = 1;
+    state.errorLocation.column = 1;
+    state.inputEncoding = JSON_UTF8;
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
+        CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success))
+    {
+        s_failMalloc = 1;
+        if (CheckParserParse(parser, "{\"a\":0}", 7, JSON_True, JSON_Failure) &&
+            CheckParserState(parser, &state))
+        {
+            succeeded = 1;
+        }
+        s_failMalloc = 0;
+    }
+    if (succeeded)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserDuplicateMemberTrackingLargeObject(void)
+{
+    /* Enough members to make the member name sets grow several times, each
+       with a nested object that reuses its parent's member name. */
+    static char input[32768];
+    size_t length = 0;
+    size_t duplicateByte;
+    int succeeded = 0;
+    JSON_Parser parser = NULL;
+    ParserState state;
+    int i;
+    printf("Test parser duplicate member tracking in large object ... ");
+    input[length++] = '{';
+    for (i = 0; i < 1000; i++)
+    {
+        length += (size_t)sprintf(input + length, "%s\"m%d\":{\"m%d\":%d}", i ? "," : "", i, i, i);
+    }
+    duplicateByte = length + 1;
+    InitParserState(&state);
+    state.error = JSON_Error_DuplicateObjectMember;
+    state.errorLocation.byte = duplicateByte;
+    state.errorLocation.column = duplicateByte;
+    state.errorLocation.depth = 1;
+    state.inputEncoding = JSON_UTF8;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success))
+    {
+        input[length] = '}';
+        if (CheckParserParse(parser, input, length + 1, JSON_True, JSON_Success) &&
+            CheckParserReset(parser, JSON_Success) &&
+            CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success))
+        {
+            length += (size_t)sprintf(input + length, ",\"m500\":0}");
+            if (CheckParserParse(parser, input, length, JSON_True, JSON_Failure) &&
+                CheckParserState(parser, &state))
+            {
+                succeeded = 1;
+            }
+        }
+    }
+    if (succeeded)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserMissing(void)
+{
+    ParserState state;
+    ParserSettings settings;
+    ParserHandlers handlers;
+    JSON_Location errorLocation;
+    printf("Test NULL parser instance ... ");
+    InitParserState(&state);
+    InitParserSettings(&settings);
+    InitParserHandlers(&handlers);
+    if (CheckParserState(NULL, &state) &&
+        CheckParserSettings(NULL, &settings) &&
+        CheckParserHandlers(NULL, &handlers) &&
+        CheckParserFree(NULL, JSON_Failure) &&
         CheckParserReset(NULL, JSON_Failure) &&
         CheckParserSetUserData(NULL, (void*)1, JSON_Failure) &&
         CheckParserGetError(NULL, &errorLocation, JSON_Failure) &&
@@ -2111,6 +2873,18 @@ static void TestParserMissing(void)
         CheckParserSetStartArrayHandler(NULL, &StartArrayHandler, JSON_Failure) &&
         CheckParserSetEndArrayHandler(NULL, &EndArrayHandler, JSON_Failure) &&
         CheckParserSetArrayItemHandler(NULL, &ArrayItemHandler, JSON_Failure) &&
+        CheckParserSetStartDocumentHandler(NULL, &StartDocumentHandler, JSON_Failure) &&
+        CheckParserSetEndDocumentHandler(NULL, &EndDocumentHandler, JSON_Failure) &&
+        CheckParserSetStringRefHandler(NULL, &StringRefHandler, JSON_Failure) &&
+        CheckParserSetNumberRefHandler(NULL, &NumberRefHandler, JSON_Failure) &&
+        CheckParserSetObjectMemberRefHandler(NULL, &ObjectMemberRefHandler, JSON_Failure) &&
+        CheckParserSetInt64Handler(NULL, &Int64Handler, JSON_Failure) &&
+        CheckParserSetUInt64Handler(NULL, &UInt64Handler, JSON_Failure) &&
+        CheckParserSetDoubleHandler(NULL, &DoubleHandler, JSON_Failure) &&
+        CheckParserSetEventBatchHandler(NULL, &EventBatchHandler, s_events, sizeof(s_events) / sizeof(s_events[0]), JSON_Failure) &&
+        CheckParserSetInternedMemberHandler(NULL, &InternedMemberHandler, JSON_Failure) &&
+        CheckParserSetKnownMemberHandler(NULL, &KnownMemberHandler, JSON_Failure) &&
+        CheckParserSetPathMatchHandler(NULL, &PathMatchHandler, JSON_Failure) &&
         CheckParserParse(NULL, "7", 1, JSON_True, JSON_Failure))
     {
         printf("OK\n");
@@ -2652,6 +3426,8 @@ PARSE_TEST("very long number", Standard, "12345678901234567890123456789012345678
 PARSE_TEST("too long number (1)", MaxNumberLength0, "1", FINAL, UTF8, "u(8) !(TooLongNumber):0,0,0,0")
 PARSE_TEST("too long number (2)", MaxNumberLength1, "-1", FINAL, UTF8, "u(8) !(TooLongNumber):0,0,0,0")
 PARSE_TEST("too long number (3)", MaxNumberLength2, "1.0", FINAL, UTF8, "u(8) !(TooLongNumber):0,0,0,0")
+PARSE_TEST("too long number (4)", MaxNumberLength2, "[12,345]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-3,0,3,1 #(12):1,0,1,1-3,0,3,1 !(TooLongNumber):4,0,4,1")
+PARSE_TEST("too long number (5)", MaxNumberLength2, "1e10", FINAL, UTF8, "u(8) !(TooLongNumber):0,0,0,0")
 
 /* hex numbers */
 
@@ -2732,6 +3508,60 @@ PARSE_TEST("unescaped control character (3)", AllowUnescapedControlCharacters, "
 PARSE_TEST("unescaped control character (4)", AllowUnescapedControlCharacters, "\"abc\x0D\"", FINAL, UTF8, "u(8) s(c abc<0D>):0,0,0,0-6,1,1,0")
 PARSE_TEST("unescaped control character (5)", AllowUnescapedControlCharacters, "\"abc\x1F\"", FINAL, UTF8, "u(8) s(c abc<1F>):0,0,0,0-6,0,6,0")
 PARSE_TEST("unescaped newlines in string", AllowUnescapedControlCharacters, "\"\x0D\x0A \x0D \x0A\"!", FINAL, UTF8, "u(8) s(c <0D><0A><20><0D><20><0A>):0,0,0,0-8,3,1,0 !(UnknownToken):8,3,1,0")
+PARSE_TEST("long string cannot contain unescaped control character", Standard, "\""
+                   "0123456789ABCDEF0123456789ABCDEF0123456789\x01"
+                   "\"", FINAL, UTF8, "u(8) !(UnescapedControlCharacter):43,0,43,0")
+PARSE_TEST("long string with unescaped control characters", AllowUnescapedControlCharacters, "\""
+                   "0123456789ABCDEF0123456789ABCDEF0123456789\x01" "BCDEF0123456789ABCDEF0123456789ABCDEF\x00"
+                   "\"", FINAL, UTF8, "u(8) s(zc 0123456789ABCDEF0123456789ABCDEF0123456789<01>BCDEF0123456789ABCDEF0123456789ABCDEF<00>):0,0,0,0-83,0,83,0")
+PARSE_TEST("long string with escape sequence (UTF-8)", UTF8In, "[\""
+                   "0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789"
+                   "\\/b\"]", FINAL, UTF8, "[:0,0,0,0-1,0,1,0 i:1,0,1,1-80,0,80,1 s(0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789/b):1,0,1,1-80,0,80,1 ]:80,0,80,0-81,0,81,0")
+PARSE_TEST("long string with escape sequence (UTF-16LE)", UTF16LEIn, "[\x00" "\"\x00"
+                   "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "A\x00" "B\x00" "C\x00" "D\x00" "E\x00" "F\x00"
+                   "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "A\x00" "B\x00" "C\x00" "D\x00" "E\x00" "F\x00"
+                   "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "A\x00" "B\x00" "C\x00" "D\x00" "E\x00" "F\x00"
+                   "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "A\x00" "B\x00" "C\x00" "D\x00" "E\x00" "F\x00"
+                   "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00"
+                   "\\\x00" "/\x00" "\"\x00" "]\x00", FINAL, UTF16LE, "[:0,0,0,0-2,0,1,0 i:2,0,1,1-158,0,79,1 s(0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789/):2,0,1,1-158,0,79,1 ]:158,0,79,0-160,0,80,0")
+PARSE_TEST("long string cut off by end of partial input", UTF8In, "[\""
+                   "0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789", PARTIAL, UTF8, "[:0,0,0,0-1,0,1,0")
+PARSE_TEST("long number cut off by end of partial input (UTF-16LE)", UTF16LEIn, "[\x00"
+                   "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00"
+                   "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00"
+                   "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00"
+                   "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00" "1\x00" "2\x00" "3\x00" "4\x00" "5\x00" "6\x00" "7\x00" "8\x00" "9\x00" "0\x00", PARTIAL, UTF16LE, "[:0,0,0,0-2,0,1,0")
+PARSE_TEST("long multi-byte string", Standard, "\""
+                   "\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87"
+                   "\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87"
+                   "\"", FINAL, UTF8, "u(8) s(a <E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87>):0,0,0,0-50,0,18,0")
+PARSE_TEST("long multi-byte string with non-BMP character spanning blocks", Standard, "\""
+                   "0123456789ABCD\xF0\x9F\x98\x80\xC3\xA9" "0123456789ABCDEF\xF0\x9F\x98\x80"
+                   "\"", FINAL, UTF8, "u(8) s(ab 0123456789ABCD<F0><9F><98><80><C3><A9>0123456789ABCDEF<F0><9F><98><80>):0,0,0,0-42,0,35,0")
+PARSE_TEST("long multi-byte string cannot contain invalid encoding sequence", Standard, "\""
+                   "\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xED\xA0\x80"
+                   "\"", FINAL, UTF8, "u(8) !(InvalidEncodingSequence):19,0,7,0")
+PARSE_TEST("long multi-byte string cannot contain truncated encoding sequence", Standard, "\""
+                   "\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\xE4\xB8\xAD"
+                   "\"", FINAL, UTF8, "u(8) !(InvalidEncodingSequence):16,0,6,0")
+PARSE_TEST("replace invalid encoding sequences in long multi-byte string", ReplaceInvalidEncodingSequences, "\""
+                   "\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\xE4\xB8\xAD\xFF"
+                   "\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD"
+                   "\"", FINAL, UTF8, "u(8) s(ar <E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><EF><BF><BD><E4><B8><AD><EF><BF><BD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD>):0,0,0,0-41,0,16,0")
+PARSE_TEST("long multi-byte string cannot contain unescaped control character", Standard, "\""
+                   "\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\x01"
+                   "\"", FINAL, UTF8, "u(8) !(UnescapedControlCharacter):19,0,7,0")
+PARSE_TEST("long multi-byte string with unescaped control characters", AllowUnescapedControlCharacters, "\""
+                   "\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\xE4\xB8\xAD\xE6\x96\x87\x0A"
+                   "\xE4\xB8\xAD\xE6\x96\x87\x00\xE4\xB8\xAD\xE6\x96\x87"
+                   "\"", FINAL, UTF8, "u(8) s(zca <E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><E4><B8><AD><E6><96><87><0A><E4><B8><AD><E6><96><87><00><E4><B8><AD><E6><96><87>):0,0,0,0-34,1,6,0")
+PARSE_TEST("long UTF-16LE string", UTF16LEIn, "\"\x00" "a\x00" "b\x00" "c\x00" "d\x00" "e\x00" "f\x00g\x00\x3D\xD8\x00\xDE\xE9\x00-Na\x00" "b\x00" "c\x00" "d\x00" "e\x00" "f\x00g\x00h\x00i\x00j\x00k\x00l\x00m\x00n\x00o\x00p\x00\"\x00", FINAL, UTF16LE, "s(ab abcdefg<F0><9F><98><80><C3><A9><E4><B8><AD>abcdefghijklmnop):0,0,0,0-58,0,28,0")
+PARSE_TEST("long UTF-16BE string", UTF16BEIn | UTF16BEOut, "\x00\"\x00" "a\x00" "b\x00" "c\x00" "d\x00" "e\x00" "f\x00g\xD8\x3D\xDE\x00\x00\xE9N-\x00" "a\x00" "b\x00" "c\x00" "d\x00" "e\x00" "f\x00g\x00h\x00i\x00j\x00k\x00l\x00m\x00n\x00o\x00p\x00\"", FINAL, UTF16BE, "s(ab _a_b_c_d_e_f_g<D8 3D><DE 00><00 E9><4E 2D>_a_b_c_d_e_f_g_h_i_j_k_l_m_n_o_p):0,0,0,0-58,0,28,0")
+PARSE_TEST("long UTF-32LE string", UTF32LEIn, "\"\x00\x00\x00" "a\x00\x00\x00" "b\x00\x00\x00" "c\x00\x00\x00" "d\x00\x00\x00" "e\x00\x00\x00" "f\x00\x00\x00g\x00\x00\x00\x00\xF6\x01\x00\xE9\x00\x00\x00-N\x00\x00" "a\x00\x00\x00" "b\x00\x00\x00" "c\x00\x00\x00" "d\x00\x00\x00" "e\x00\x00\x00" "f\x00\x00\x00g\x00\x00\x00h\x00\x00\x00i\x00\x00\x00j\x00\x00\x00k\x00\x00\x00l\x00\x00\x00m\x00\x00\x00n\x00\x00\x00o\x00\x00\x00p\x00\x00\x00\"\x00\x00\x00", FINAL, UTF32LE, "s(ab abcdefg<F0><9F><98><80><C3><A9><E4><B8><AD>abcdefghijklmnop):0,0,0,0-112,0,28,0")
+PARSE_TEST("long UTF-32BE string", UTF32BEIn | UTF16LEOut, "\x00\x00\x00\"\x00\x00\x00" "a\x00\x00\x00" "b\x00\x00\x00" "c\x00\x00\x00" "d\x00\x00\x00" "e\x00\x00\x00" "f\x00\x00\x00g\x00\x01\xF6\x00\x00\x00\x00\xE9\x00\x00N-\x00\x00\x00" "a\x00\x00\x00" "b\x00\x00\x00" "c\x00\x00\x00" "d\x00\x00\x00" "e\x00\x00\x00" "f\x00\x00\x00g\x00\x00\x00h\x00\x00\x00i\x00\x00\x00j\x00\x00\x00k\x00\x00\x00l\x00\x00\x00m\x00\x00\x00n\x00\x00\x00o\x00\x00\x00p\x00\x00\x00\"", FINAL, UTF32BE, "s(ab a_b_c_d_e_f_g_<3D D8><00 DE><E9 00><2D 4E>a_b_c_d_e_f_g_h_i_j_k_l_m_n_o_p_):0,0,0,0-112,0,28,0")
+PARSE_TEST("long UTF-16LE string with unpaired surrogate", UTF16LEIn | ReplaceInvalidEncodingSequences, "\"\x00" "a\x00" "b\x00" "c\x00" "d\x00" "e\x00" "f\x00g\x00h\x00i\x00j\x00\x00\xD8k\x00l\x00m\x00n\x00o\x00p\x00q\x00r\x00s\x00t\x00u\x00\"\x00", FINAL, UTF16LE, "s(ar abcdefghij<EF><BF><BD>klmnopqrstu):0,0,0,0-48,0,24,0")
+PARSE_TEST("long UTF-16LE string with unescaped control characters", UTF16LEIn | AllowUnescapedControlCharacters, "\"\x00" "a\x00" "b\x00" "c\x00" "d\x00" "e\x00" "f\x00g\x00h\x00i\x00j\x00k\x00l\x00m\x00n\x00o\x00p\x00\x00\x00q\x00r\x00s\x00\x0A\x00t\x00u\x00v\x00\"\x00", FINAL, UTF16LE, "s(zc abcdefghijklmnop<00>qrs<0A>tuv):0,0,0,0-52,1,4,0")
+PARSE_TEST("UTF-16LE input with long whitespace runs", UTF16LEIn, "[\x00\x0D\x00\x0A\x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00" "1\x00,\x00\x0D\x00\x0A\x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00 \x00\"\x00x\x00\"\x00\x0D\x00\x0A\x00]\x00", FINAL, UTF16LE, "[:0,0,0,0-2,0,1,0 i:46,1,20,1-48,1,21,1 #(1):46,1,20,1-48,1,21,1 i:94,2,20,1-100,2,23,1 s(x):94,2,20,1-100,2,23,1 ]:104,3,0,0-106,3,1,0")
 PARSE_TEST("string cannot contain invalid escape sequence (1)", Standard, "\"\\v\"", FINAL, UTF8, "u(8) !(InvalidEscapeSequence):1,0,1,0")
 PARSE_TEST("string cannot contain invalid escape sequence (2)", Standard, "\"\\x0020\"", FINAL, UTF8, "u(8) !(InvalidEscapeSequence):1,0,1,0")
 PARSE_TEST("string cannot contain invalid escape sequence (3)", Standard, "\"\\ \"", FINAL, UTF8, "u(8) !(InvalidEscapeSequence):1,0,1,0")
@@ -2897,6 +3727,7 @@ PARSE_TEST("random /", Standard, "/", FINAL, UTF8, "u(8) !(UnknownToken):0,0,0,0
 /* multi-line input */
 
 PARSE_TEST("multi-line input", Standard, "[\r 1,\n  2,\r\n\r\n   3]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:3,1,1,1-4,1,2,1 #(1):3,1,1,1-4,1,2,1 i:8,2,2,1-9,2,3,1 #(2):8,2,2,1-9,2,3,1 i:17,4,3,1-18,4,4,1 #(3):17,4,3,1-18,4,4,1 ]:18,4,4,0-19,4,5,0")
+PARSE_TEST("multi-line input with long whitespace runs", Standard, "[\t\t\t\t\t\t\t\t\t\t\t\t\t\t\r\n                              1,\r\r                                        \n\n  2                                 ]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:47,1,30,1-48,1,31,1 #(1):47,1,30,1-48,1,31,1 i:95,5,2,1-96,5,3,1 #(2):95,5,2,1-96,5,3,1 ]:129,5,36,0-130,5,37,0")
 PARSE_TEST("multi-line input error (1)", Standard, "[\r1", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:2,1,0,1-3,1,1,1 #(1):2,1,0,1-3,1,1,1 !(ExpectedMoreTokens):3,1,1,1")
 PARSE_TEST("multi-line input error (2)", Standard, "[\n1", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:2,1,0,1-3,1,1,1 #(1):2,1,0,1-3,1,1,1 !(ExpectedMoreTokens):3,1,1,1")
 PARSE_TEST("multi-line input error (3)", Standard, "[\r\n1", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:3,1,0,1-4,1,1,1 #(1):3,1,0,1-4,1,1,1 !(ExpectedMoreTokens):4,1,1,1")
@@ -3120,47 +3951,2009 @@ PARSE_TEST("embedded 12. in UTF-16BE", StopAfterEmbeddedDocument, "\x00" "1\x00"
 PARSE_TEST("embedded 1.2e in UTF-32LE", StopAfterEmbeddedDocument, "1\x00\x00\x00" ".\x00\x00\x00" "2\x00\x00\x00" "e\x00\x00\x00" "-\x00\x00\x00", FINAL, UTF32LE, "u(32LE) #(. 1.2):0,0,0,0-12,0,3,0 !(StoppedAfterEmbeddedDocument):12,0,3,0")
 PARSE_TEST("embedded 00 in UTF-32BE", StopAfterEmbeddedDocument, "\x00\x00\x00" "0\x00\x00\x00" "0\x00\x00\x00" "0", FINAL, UTF32BE, "u(32BE) #(0):0,0,0,0-4,0,1,0 !(StoppedAfterEmbeddedDocument):4,0,1,0")
 
-PARSE_TEST("embedded empty string (1)", StopAfterEmbeddedDocument, "\"\"", FINAL, UTF8, "u(8) s():0,0,0,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
-PARSE_TEST("embedded empty string (2)", StopAfterEmbeddedDocument, "\"\"junk", FINAL, UTF8, "u(8) s():0,0,0,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
-PARSE_TEST("embedded string (1)", StopAfterEmbeddedDocument, "\"foo\"", FINAL, UTF8, "u(8) s(foo):0,0,0,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
-PARSE_TEST("embedded string (2)", StopAfterEmbeddedDocument, "\"foo\"junk", FINAL, UTF8, "u(8) s(foo):0,0,0,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
-PARSE_TEST("embedded string with newline", StopAfterEmbeddedDocument, "\"foo\\nbar\"", FINAL, UTF8, "u(8) s(c foo<0A>bar):0,0,0,0-10,0,10,0 !(StoppedAfterEmbeddedDocument):10,0,10,0")
-PARSE_TEST("embedded string with unescaped newline (1)", StopAfterEmbeddedDocument, "\"foo\nbar\"", FINAL, UTF8, "u(8) !(UnescapedControlCharacter):4,0,4,0")
-PARSE_TEST("embedded string with unescaped newline (2)", AllowUnescapedControlCharacters | StopAfterEmbeddedDocument, "\"foo\nbar\"", FINAL, UTF8, "u(8) s(c foo<0A>bar):0,0,0,0-9,1,4,0 !(StoppedAfterEmbeddedDocument):9,1,4,0")
-PARSE_TEST("unfinished embedded string (1)", StopAfterEmbeddedDocument, "\"foo", FINAL, UTF8, "u(8) !(IncompleteToken):0,0,0,0")
-PARSE_TEST("unfinished embedded string (2)", StopAfterEmbeddedDocument, "\"foo\xFF", FINAL, UTF8, "u(8) !(IncompleteToken):0,0,0,0")
-PARSE_TEST("embedded string containing invalid sequence (1)", StopAfterEmbeddedDocument, "\"foo\xFF\"", FINAL, UTF8, "u(8) !(IncompleteToken):0,0,0,0")
-PARSE_TEST("embedded string containing invalid sequence (2)", ReplaceInvalidEncodingSequences | StopAfterEmbeddedDocument, "\"foo\xFF\"", FINAL, UTF8, "u(8) s(ar foo<EF><BF><BD>):0,0,0,0-6,0,6,0 !(StoppedAfterEmbeddedDocument):6,0,6,0")
+PARSE_TEST("embedded empty string (1)", StopAfterEmbeddedDocument, "\"\"", FINAL, UTF8, "u(8) s():0,0,0,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
+PARSE_TEST("embedded empty string (2)", StopAfterEmbeddedDocument, "\"\"junk", FINAL, UTF8, "u(8) s():0,0,0,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
+PARSE_TEST("embedded string (1)", StopAfterEmbeddedDocument, "\"foo\"", FINAL, UTF8, "u(8) s(foo):0,0,0,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
+PARSE_TEST("embedded string (2)", StopAfterEmbeddedDocument, "\"foo\"junk", FINAL, UTF8, "u(8) s(foo):0,0,0,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
+PARSE_TEST("embedded string with newline", StopAfterEmbeddedDocument, "\"foo\\nbar\"", FINAL, UTF8, "u(8) s(c foo<0A>bar):0,0,0,0-10,0,10,0 !(StoppedAfterEmbeddedDocument):10,0,10,0")
+PARSE_TEST("embedded string with unescaped newline (1)", StopAfterEmbeddedDocument, "\"foo\nbar\"", FINAL, UTF8, "u(8) !(UnescapedControlCharacter):4,0,4,0")
+PARSE_TEST("embedded string with unescaped newline (2)", AllowUnescapedControlCharacters | StopAfterEmbeddedDocument, "\"foo\nbar\"", FINAL, UTF8, "u(8) s(c foo<0A>bar):0,0,0,0-9,1,4,0 !(StoppedAfterEmbeddedDocument):9,1,4,0")
+PARSE_TEST("unfinished embedded string (1)", StopAfterEmbeddedDocument, "\"foo", FINAL, UTF8, "u(8) !(IncompleteToken):0,0,0,0")
+PARSE_TEST("unfinished embedded string (2)", StopAfterEmbeddedDocument, "\"foo\xFF", FINAL, UTF8, "u(8) !(IncompleteToken):0,0,0,0")
+PARSE_TEST("embedded string containing invalid sequence (1)", StopAfterEmbeddedDocument, "\"foo\xFF\"", FINAL, UTF8, "u(8) !(IncompleteToken):0,0,0,0")
+PARSE_TEST("embedded string containing invalid sequence (2)", ReplaceInvalidEncodingSequences | StopAfterEmbeddedDocument, "\"foo\xFF\"", FINAL, UTF8, "u(8) s(ar foo<EF><BF><BD>):0,0,0,0-6,0,6,0 !(StoppedAfterEmbeddedDocument):6,0,6,0")
+
+PARSE_TEST("embedded empty array (1)", StopAfterEmbeddedDocument, "[]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 ]:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
+PARSE_TEST("embedded empty array (2)", StopAfterEmbeddedDocument, "[]!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 ]:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
+PARSE_TEST("embedded array (1)", StopAfterEmbeddedDocument, "[1]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 ]:2,0,2,0-3,0,3,0 !(StoppedAfterEmbeddedDocument):3,0,3,0")
+PARSE_TEST("embedded array (2)", StopAfterEmbeddedDocument, "[1]!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 ]:2,0,2,0-3,0,3,0 !(StoppedAfterEmbeddedDocument):3,0,3,0")
+PARSE_TEST("embedded nested array (1)", StopAfterEmbeddedDocument, "[[1]]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 [:1,0,1,1-2,0,2,1 i:2,0,2,2-3,0,3,2 #(1):2,0,2,2-3,0,3,2 ]:3,0,3,1-4,0,4,1 ]:4,0,4,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
+PARSE_TEST("embedded nested array (2)", StopAfterEmbeddedDocument, "[[1]]!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 [:1,0,1,1-2,0,2,1 i:2,0,2,2-3,0,3,2 #(1):2,0,2,2-3,0,3,2 ]:3,0,3,1-4,0,4,1 ]:4,0,4,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
+PARSE_TEST("embedded unclosed array (1)", StopAfterEmbeddedDocument, "[", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(ExpectedMoreTokens):1,0,1,1")
+PARSE_TEST("embedded unclosed array (2)", StopAfterEmbeddedDocument, "[!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(UnknownToken):1,0,1,1")
+PARSE_TEST("embedded unclosed array (2)", StopAfterEmbeddedDocument, "[\xFF", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(InvalidEncodingSequence):1,0,1,1")
+
+PARSE_TEST("embedded empty object (1)", StopAfterEmbeddedDocument, "{}", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
+PARSE_TEST("embedded empty object (2)", StopAfterEmbeddedDocument, "{}!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
+PARSE_TEST("embedded object (1)", StopAfterEmbeddedDocument, "{\"a\":1}", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 #(1):5,0,5,1-6,0,6,1 }:6,0,6,0-7,0,7,0 !(StoppedAfterEmbeddedDocument):7,0,7,0")
+PARSE_TEST("embedded object (2)", StopAfterEmbeddedDocument, "{\"a\":1}!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 #(1):5,0,5,1-6,0,6,1 }:6,0,6,0-7,0,7,0 !(StoppedAfterEmbeddedDocument):7,0,7,0")
+PARSE_TEST("embedded nested object (1)", StopAfterEmbeddedDocument, "{\"a\":{\"b\":1}}", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 {:5,0,5,1-6,0,6,1 m(b):6,0,6,2-9,0,9,2 #(1):10,0,10,2-11,0,11,2 }:11,0,11,1-12,0,12,1 }:12,0,12,0-13,0,13,0 !(StoppedAfterEmbeddedDocument):13,0,13,0")
+PARSE_TEST("embedded nested object (2)", StopAfterEmbeddedDocument, "{\"a\":{\"b\":1}}!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 {:5,0,5,1-6,0,6,1 m(b):6,0,6,2-9,0,9,2 #(1):10,0,10,2-11,0,11,2 }:11,0,11,1-12,0,12,1 }:12,0,12,0-13,0,13,0 !(StoppedAfterEmbeddedDocument):13,0,13,0")
+PARSE_TEST("embedded unclosed object (1)", StopAfterEmbeddedDocument, "{", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 !(ExpectedMoreTokens):1,0,1,1")
+PARSE_TEST("embedded unclosed object (2)", StopAfterEmbeddedDocument, "{!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 !(UnknownToken):1,0,1,1")
+PARSE_TEST("embedded unclosed object (2)", StopAfterEmbeddedDocument, "{\xFF", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 !(InvalidEncodingSequence):1,0,1,1")
+
+PARSE_TEST("multiple documents (empty)", AllowMultipleDocuments, "", FINAL, UnknownEncoding, "")
+PARSE_TEST("multiple documents (whitespace only)", AllowMultipleDocuments, " \n ", FINAL, UTF8, "u(8)")
+PARSE_TEST("multiple documents (one)", AllowMultipleDocuments, "7", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 #(7):0,0,0,0-1,0,1,0 >:0,0,0,0-1,0,1,0")
+PARSE_TEST("multiple documents (newline-delimited)", AllowMultipleDocuments, "{\"a\":1}\n{\"a\":2}\n", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 #(1):5,0,5,1-6,0,6,1 }:6,0,6,0-7,0,7,0 >:6,0,6,0-7,0,7,0 <:8,1,0,0-9,1,1,0 {:8,1,0,0-9,1,1,0 m(a):9,1,1,1-12,1,4,1 #(2):13,1,5,1-14,1,6,1 }:14,1,6,0-15,1,7,0 >:14,1,6,0-15,1,7,0")
+PARSE_TEST("multiple documents (whitespace-separated scalars)", AllowMultipleDocuments, "1 true \"x\" null", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 #(1):0,0,0,0-1,0,1,0 >:0,0,0,0-1,0,1,0 <:2,0,2,0-6,0,6,0 t:2,0,2,0-6,0,6,0 >:2,0,2,0-6,0,6,0 <:7,0,7,0-10,0,10,0 s(x):7,0,7,0-10,0,10,0 >:7,0,7,0-10,0,10,0 <:11,0,11,0-15,0,15,0 n:11,0,11,0-15,0,15,0 >:11,0,11,0-15,0,15,0")
+PARSE_TEST("multiple documents (concatenated containers)", AllowMultipleDocuments, "{}[]{}", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 >:1,0,1,0-2,0,2,0 <:2,0,2,0-3,0,3,0 [:2,0,2,0-3,0,3,0 ]:3,0,3,0-4,0,4,0 >:3,0,3,0-4,0,4,0 <:4,0,4,0-5,0,5,0 {:4,0,4,0-5,0,5,0 }:5,0,5,0-6,0,6,0 >:5,0,5,0-6,0,6,0")
+PARSE_TEST("multiple documents (record separators)", AllowMultipleDocuments, "\x1E{}\n\x1E[1]\n", FINAL, UTF8, "u(8) <:1,0,1,0-2,0,2,0 {:1,0,1,0-2,0,2,0 }:2,0,2,0-3,0,3,0 >:2,0,2,0-3,0,3,0 <:5,1,1,0-6,1,2,0 [:5,1,1,0-6,1,2,0 i:6,1,2,1-7,1,3,1 #(1):6,1,2,1-7,1,3,1 ]:7,1,3,0-8,1,4,0 >:7,1,3,0-8,1,4,0")
+PARSE_TEST("multiple documents (record separator inside document)", AllowMultipleDocuments, "\x1E[1,\x1E" "2]\n", FINAL, UTF8, "u(8) <:1,0,1,0-2,0,2,0 [:1,0,1,0-2,0,2,0 i:2,0,2,1-3,0,3,1 #(1):2,0,2,1-3,0,3,1 !(UnknownToken):4,0,4,1")
+PARSE_TEST("multiple documents (record separator not allowed)", DefaultIn, "\x1E{}", FINAL, UTF8, "u(8) !(UnknownToken):0,0,0,0")
+PARSE_TEST("multiple documents (duplicate member in second document)", AllowMultipleDocuments | TrackObjectMembers, "{\"a\":1} {\"a\":1,\"a\":2}", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 #(1):5,0,5,1-6,0,6,1 }:6,0,6,0-7,0,7,0 >:6,0,6,0-7,0,7,0 <:8,0,8,0-9,0,9,0 {:8,0,8,0-9,0,9,0 m(a):9,0,9,1-12,0,12,1 #(1):13,0,13,1-14,0,14,1 !(DuplicateObjectMember):15,0,15,1")
+PARSE_TEST("multiple documents (unexpected token between documents)", AllowMultipleDocuments, "{} ] {}", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 >:1,0,1,0-2,0,2,0 !(UnexpectedToken):3,0,3,0")
+PARSE_TEST("multiple documents (unfinished last document)", AllowMultipleDocuments, "{} {", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 >:1,0,1,0-2,0,2,0 <:3,0,3,0-4,0,4,0 {:3,0,3,0-4,0,4,0 !(ExpectedMoreTokens):4,0,4,1")
+PARSE_TEST("multiple documents (not final)", AllowMultipleDocuments, "{} 1", PARTIAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 >:1,0,1,0-2,0,2,0")
+PARSE_TEST("multiple documents (stop after embedded document)", AllowMultipleDocuments | StopAfterEmbeddedDocument, "{} {}", FINAL, UTF8, "u(8) <:0,0,0,0-1,0,1,0 {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 >:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
+PARSE_TEST("multiple documents (UTF-16LE)", UTF16LEIn | AllowMultipleDocuments, "1\x00\n\x00" "2\x00", FINAL, UTF16LE, "<:0,0,0,0-2,0,1,0 #(1):0,0,0,0-2,0,1,0 >:0,0,0,0-2,0,1,0 <:4,1,0,0-6,1,1,0 #(2):4,1,0,0-6,1,1,0 >:4,1,0,0-6,1,1,0")
+PARSE_TEST("array segment (whole array)", AllowArraySegment, "[1,2]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 i:3,0,3,1-4,0,4,1 #(2):3,0,3,1-4,0,4,1 ]:4,0,4,0-5,0,5,0")
+PARSE_TEST("array segment (first)", AllowArraySegment, "[1,{\"a\":2}", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 i:3,0,3,1-4,0,4,1 {:3,0,3,1-4,0,4,1 m(a):4,0,4,2-7,0,7,2 #(2):8,0,8,2-9,0,9,2 }:9,0,9,1-10,0,10,1 ]:10,0,10,0-10,0,10,0")
+PARSE_TEST("array segment (middle)", AllowArraySegment, ",3 ,[4]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(3):1,0,1,1-2,0,2,1 i:4,0,4,1-5,0,5,1 [:4,0,4,1-5,0,5,1 i:5,0,5,2-6,0,6,2 #(4):5,0,5,2-6,0,6,2 ]:6,0,6,1-7,0,7,1 ]:7,0,7,0-7,0,7,0")
+PARSE_TEST("array segment (last)", AllowArraySegment, ",5]\n", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(5):1,0,1,1-2,0,2,1 ]:2,0,2,0-3,0,3,0")
+PARSE_TEST("array segment (single item)", AllowArraySegment, ",6", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(6):1,0,1,1-2,0,2,1 ]:2,0,2,0-2,0,2,0")
+PARSE_TEST("array segment (not final)", AllowArraySegment, ",7,8", PARTIAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(7):1,0,1,1-2,0,2,1")
+PARSE_TEST("array segment (ends after comma)", AllowArraySegment, ",9,", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(9):1,0,1,1-2,0,2,1 !(ExpectedMoreTokens):3,0,3,1")
+PARSE_TEST("array segment (ends inside item)", AllowArraySegment, ",{\"a\":", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 {:1,0,1,1-2,0,2,1 m(a):2,0,2,2-5,0,5,2 !(ExpectedMoreTokens):6,0,6,2")
+PARSE_TEST("array segment (ends inside string)", AllowArraySegment, ",\"a,", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(IncompleteToken):1,0,1,1")
+PARSE_TEST("array segment (empty array)", AllowArraySegment, "[]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 ]:1,0,1,0-2,0,2,0")
+PARSE_TEST("array segment (empty)", AllowArraySegment, "", FINAL, UnknownEncoding, "!(ExpectedMoreTokens):0,0,0,0")
+PARSE_TEST("array segment (scalar document)", AllowArraySegment, "1", FINAL, UTF8, "u(8) #(1):0,0,0,0-1,0,1,0")
+PARSE_TEST("array segment (comma inside array)", AllowArraySegment, "[,1]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(UnexpectedToken):1,0,1,1")
+PARSE_TEST("array segment (closed twice)", AllowArraySegment, ",1]]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 ]:2,0,2,0-3,0,3,0 !(UnexpectedToken):3,0,3,0")
+PARSE_TEST("array segment not allowed", 0, ",1", FINAL, UTF8, "u(8) !(UnexpectedToken):0,0,0,0")
+
+};
+
+static void TestParserParse(void)
+{
+    size_t i;
+    for  (i = 0; i < sizeof(s_parseTests)/sizeof(s_parseTests[0]); i++)
+    {
+        RunParseTest(&s_parseTests[i], 0, ParseNormally);
+    }
+}
+
+static void TestParserParseInChunks(void)
+{
+    size_t i;
+    for  (i = 0; i < sizeof(s_parseTests)/sizeof(s_parseTests[0]); i++)
+    {
+        RunParseTest(&s_parseTests[i], 1, ParseNormally);
+        RunParseTest(&s_parseTests[i], 3, ParseNormally);
+    }
+}
+
+static void TestParserParseWithRefHandlers(void)
+{
+    size_t i;
+    for  (i = 0; i < sizeof(s_parseTests)/sizeof(s_parseTests[0]); i++)
+    {
+        RunParseTest(&s_parseTests[i], 0, ParseWithRefHandlers);
+    }
+}
+
+static void TestParserParseWithLazyLocations(void)
+{
+    /* Locations reconstructed on demand must be identical to the ones
+       tracked eagerly, whether the input arrives all at once or in chunks
+       that the parser can no longer refer to later. */
+    size_t i;
+    for  (i = 0; i < sizeof(s_parseTests)/sizeof(s_parseTests[0]); i++)
+    {
+        RunParseTest(&s_parseTests[i], 0, ParseWithLazyLocations);
+        RunParseTest(&s_parseTests[i], 1, ParseWithLazyLocations);
+        RunParseTest(&s_parseTests[i], 3, ParseWithLazyLocations);
+    }
+}
+
+static int ParseLongInput(const char* pInput, size_t length, int inOneCall)
+{
+    JSON_Parser parser = NULL;
+    JSON_Location errorLocation;
+    int ok = 0;
+    ResetOutput();
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success))
+    {
+        if (inOneCall)
+        {
+            JSON_Parser_Parse(parser, pInput, length, JSON_True);
+        }
+        else
+        {
+            /* Parse in chunks of an odd size, so that the runs cross chunk
+               boundaries at different points. */
+            size_t offset = 0;
+            while (offset < length && JSON_Parser_Parse(parser, pInput + offset, (length - offset > 7) ? 7 : length - offset, JSON_False))
+            {
+                offset += 7;
+            }
+            JSON_Parser_Parse(parser, NULL, 0, JSON_True);
+        }
+        if (JSON_Parser_GetError(parser) != JSON_Error_None &&
+            JSON_Parser_GetErrorLocation(parser, &errorLocation) == JSON_Success)
+        {
+            OutputSeparator();
+            OutputFormatted("!(%s):", errorNames[JSON_Parser_GetError(parser)]);
+            OutputLocation(&errorLocation);
+        }
+        ok = 1;
+    }
+    JSON_Parser_Free(parser);
+    return ok;
+}
+
+static void TestParserParseLongInput(void)
+{
+    /* The input is long, and its runs of whitespace (containing every kind
+       of line break) and string content cross SIMD block and chunk
+       boundaries at many different offsets. Only the numbers are output,
+       to keep the output short. */
+    static const char fragment[] =
+        "  \r\n\t\"abc\xC3\xA9\\n01234567890123456789012345678901234567890123456789\"\r\r\n \n,"
+        "                                                                \n\r"
+        "  \"0123456789012345678901234567890123456789012345678901234567890123456789\"  ,-12.5e3";
+    char* pInput = (char*)malloc(12 * 1024);
+    char* pExpectedOutput = NULL;
+    size_t length = 0;
+    printf("Test parsing long input in one call ... ");
+    if (pInput)
+    {
+        pInput[length++] = '[';
+        while (length + sizeof(fragment) + 16 < 12 * 1024)
+        {
+            memcpy(pInput + length, fragment, sizeof(fragment) - 1);
+            length += sizeof(fragment) - 1;
+            pInput[length] = (char)((length % 3) ? ' ' : '\n');
+            length++;
+            pInput[length++] = ',';
+        }
+        memcpy(pInput + length, "\r\n 9 ] x", 9);
+        length += 9;
+    }
+    if (pInput && ParseLongInput(pInput, length, 0))
+    {
+        pExpectedOutput = (char*)malloc((size_t)s_outputLength + 1);
+        if (pExpectedOutput)
+        {
+            memcpy(pExpectedOutput, s_outputBuffer, (size_t)s_outputLength + 1);
+        }
+    }
+    if (pExpectedOutput && ParseLongInput(pInput, length, 1) && CheckOutput(pExpectedOutput))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    free(pExpectedOutput);
+    free(pInput);
+    ResetOutput();
+}
+
+static void TestParserRefHandlersReferenceInput(void)
+{
+    static const char input[] = "{\"abc\":[\"de\\\"f\",-1.5e3,\"ghi\"],\"jkl\":\"long enough to need a second token buffer, or even a third one\"}";
+    JSON_Parser parser = NULL;
+    printf("Test parser ref handlers reference input ... ");
+    s_pRefInput = input;
+    s_refInputLength = sizeof(input) - 1;
+    s_refCount = 0;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetStringRefHandler(parser, &StringRefHandler, JSON_Success) &&
+        CheckParserSetNumberRefHandler(parser, &NumberRefHandler, JSON_Success) &&
+        CheckParserSetObjectMemberRefHandler(parser, &ObjectMemberRefHandler, JSON_Success) &&
+        CheckParserSetInputEncoding(parser, JSON_UTF8, JSON_Success) &&
+        CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+        CheckParserParse(parser, input, sizeof(input) - 1, JSON_True, JSON_Success) &&
+        CheckOutput("m(abc):1,0,1,1-6,0,6,1 s(de\"f):8,0,8,2-15,0,15,2 #(-.e -1.5e3):16,0,16,2-22,0,22,2 s(ghi):23,0,23,2-28,0,28,2 m(jkl):30,0,30,1-35,0,35,1 s(long<20>enough<20>to<20>need<20>a<20>second<20>token<20>buffer,<20>or<20>even<20>a<20>third<20>one):36,0,36,1-100,0,100,1"))
+    {
+        /* Every value except the one with an escape sequence should have
+           been referenced in the input. */
+        if (s_refCount == 5)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            printf("FAILURE: expected 5 values to be referenced in the input, but %d were\n", s_refCount);
+            s_failureCount++;
+        }
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    s_pRefInput = NULL;
+    s_refInputLength = 0;
+    JSON_Parser_Free(parser);
+    ResetOutput();
+}
+
+#define NATIVE_INT64  1
+#define NATIVE_UINT64 2
+#define NATIVE_DOUBLE 4
+#define NATIVE_ALL    (NATIVE_INT64 | NATIVE_UINT64 | NATIVE_DOUBLE)
+
+typedef struct tag_NativeNumberTest
+{
+    const char* pInput;
+    int         handlers;
+    const char* pOutput;
+} NativeNumberTest;
+
+static const NativeNumberTest s_nativeNumberTests[] =
+{
+    { "0", NATIVE_ALL, "i(0):0,0,0,0-1,0,1,0" },
+    { "-0", NATIVE_ALL, "i(-0):0,0,0,0-2,0,2,0" },
+    { "123", NATIVE_ALL, "i(123):0,0,0,0-3,0,3,0" },
+    { "9223372036854775807", NATIVE_ALL, "i(9223372036854775807):0,0,0,0-19,0,19,0" },
+    { "-9223372036854775808", NATIVE_ALL, "i(-9223372036854775808):0,0,0,0-20,0,20,0" },
+    { "9223372036854775808", NATIVE_ALL, "u(9223372036854775808):0,0,0,0-19,0,19,0" },
+    { "18446744073709551615", NATIVE_ALL, "u(18446744073709551615):0,0,0,0-20,0,20,0" },
+    { "18446744073709551616", NATIVE_ALL, "d(1.8446744073709552e+19):0,0,0,0-20,0,20,0" },
+    { "-9223372036854775809", NATIVE_ALL, "d(-9.2233720368547758e+18):0,0,0,0-20,0,20,0" },
+    { "0x1F", NATIVE_ALL, "i(31):0,0,0,0-4,0,4,0" },
+    { "0xFFFFFFFFFFFFFFFF", NATIVE_ALL, "u(18446744073709551615):0,0,0,0-18,0,18,0" },
+    { "0x10000000000000000", NATIVE_ALL, "#(x 0x10000000000000000):0,0,0,0-19,0,19,0" },
+    { "1.5", NATIVE_ALL, "d(1.5):0,0,0,0-3,0,3,0" },
+    { "-1.5e3", NATIVE_ALL, "d(-1500):0,0,0,0-6,0,6,0" },
+    { "1E2", NATIVE_ALL, "d(100):0,0,0,0-3,0,3,0" },
+    { "0.1", NATIVE_ALL, "d(0.10000000000000001):0,0,0,0-3,0,3,0" },
+    { "123e30", NATIVE_ALL, "d(1.23e+32):0,0,0,0-6,0,6,0" },
+    { "1.7976931348623157e308", NATIVE_ALL, "d(1.7976931348623157e+308):0,0,0,0-22,0,22,0" },
+    { "2.2250738585072011e-308", NATIVE_ALL, "d(2.2250738585072009e-308):0,0,0,0-23,0,23,0" },
+    { "4.9406564584124654e-324", NATIVE_ALL, "d(4.9406564584124654e-324):0,0,0,0-23,0,23,0" },
+    { "1e309", NATIVE_ALL, "#(e 1e309):0,0,0,0-5,0,5,0" },
+    { "-1e-400", NATIVE_ALL, "#(-e- -1e-400):0,0,0,0-7,0,7,0" },
+    { "0e-400", NATIVE_ALL, "d(0):0,0,0,0-6,0,6,0" },
+    { "0.1000000000000000055511151231257827021181583404541015625", NATIVE_ALL, "d(0.10000000000000001):0,0,0,0-57,0,57,0" },
+    { "9007199254740993", NATIVE_DOUBLE, "d(9007199254740992):0,0,0,0-16,0,16,0" },
+    { "9007199254740993.00000000000000000001", NATIVE_ALL, "d(9007199254740994):0,0,0,0-37,0,37,0" },
+    { "5", NATIVE_DOUBLE, "d(5):0,0,0,0-1,0,1,0" },
+    { "-0", NATIVE_DOUBLE, "d(-0):0,0,0,0-2,0,2,0" },
+    { "5", NATIVE_UINT64, "u(5):0,0,0,0-1,0,1,0" },
+    { "-5", NATIVE_UINT64, "#(- -5):0,0,0,0-2,0,2,0" },
+    { "1.0", NATIVE_INT64 | NATIVE_UINT64, "#(. 1.0):0,0,0,0-3,0,3,0" }
+};
+
+static void TestParserNativeNumberHandlers(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(s_nativeNumberTests) / sizeof(s_nativeNumberTests[0]); i++)
+    {
+        const NativeNumberTest* pTest = &s_nativeNumberTests[i];
+        size_t length = strlen(pTest->pInput);
+        int inChunks;
+        for (inChunks = 0; inChunks <= 1; inChunks++)
+        {
+            /* Parsing a byte at a time converts the number from the parser's
+               own copy of the text rather than from the input buffer. */
+            JSON_Parser parser = NULL;
+            size_t offset = 0;
+            int succeeded;
+            printf("Test parser native number handlers with %s%s ... ", pTest->pInput, inChunks ? " in chunks" : "");
+            succeeded = CheckParserCreate(NULL, JSON_Success, &parser) &&
+                        CheckParserSetAllowHexNumbers(parser, JSON_True, JSON_Success) &&
+                        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+                        CheckParserSetInt64Handler(parser, (pTest->handlers & NATIVE_INT64) ? &Int64Handler : NULL, JSON_Success) &&
+                        CheckParserSetUInt64Handler(parser, (pTest->handlers & NATIVE_UINT64) ? &UInt64Handler : NULL, JSON_Success) &&
+                        CheckParserSetDoubleHandler(parser, (pTest->handlers & NATIVE_DOUBLE) ? &DoubleHandler : NULL, JSON_Success);
+            while (succeeded && inChunks && offset < length)
+            {
+                succeeded = CheckParserParse(parser, pTest->pInput + offset, 1, JSON_False, JSON_Success);
+                offset++;
+            }
+            if (succeeded &&
+                CheckParserParse(parser, pTest->pInput + offset, length - offset, JSON_True, JSON_Success) &&
+                CheckOutput(pTest->pOutput))
+            {
+                printf("OK\n");
+            }
+            else
+            {
+                s_failureCount++;
+            }
+            JSON_Parser_Free(parser);
+            ResetOutput();
+        }
+    }
+}
+
+typedef struct tag_InternedMemberTest
+{
+    const char*            pName;
+    size_t                 capacity;
+    JSON_KeyEvictionPolicy policy;
+    const char*            pDocuments[2]; /* parsed one after another, with a reset in between */
+    JSON_Error             expectedError;
+    const char*            pOutput;
+} InternedMemberTest;
+
+static const InternedMemberTest s_internedMemberTests[] =
+{
+    { "names keep IDs across documents", 4, JSON_EvictLeastRecentlyUsed, { "{\"a\":1,\"b\":{\"a\":2,\"c\":3}}", "{\"c\":0,\"b\":0,\"a\":0}" }, JSON_Error_None, "k0*(a) k1*(b) k0(a) k2*(c) k2(c) k1(b) k0(a)" },
+    { "least recently used names are evicted", 2, JSON_EvictLeastRecentlyUsed, { "{\"a\":0,\"b\":0,\"a\":0}", "{\"c\":0,\"a\":0,\"b\":0}" }, JSON_Error_None, "k0*(a) k1*(b) k0(a) k1*(c) k0(a) k1*(b)" },
+    { "full table without eviction", 2, JSON_EvictNone, { "{\"a\":0,\"b\":0,\"a\":0}", "{\"c\":0,\"a\":0,\"b\":0}" }, JSON_Error_None, "k0*(a) k1*(b) k0(a) k-(c) k0(a) k1(b)" },
+    { "interning disabled", 0, JSON_EvictLeastRecentlyUsed, { "{\"a\":0,\"a\":0}", "{\"a\":0}" }, JSON_Error_None, "k-(a) k-(a) k-(a)" },
+    { "names are interned by their decoded bytes", 4, JSON_EvictLeastRecentlyUsed, { "{\"\\u0061\":0,\"a\":1}", "{\"\":0,\"\":0}" }, JSON_Error_None, "k0*(a) k0(a) k1*() k1()" },
+    { "duplicate member", 4, JSON_EvictLeastRecentlyUsed, { "{\"a\":0}", "{\"a\":0,\"duplicate\":1}" }, JSON_Error_DuplicateObjectMember, "k0*(a) k0(a)" }
+};
+
+static void TestParserInternedMemberHandler(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(s_internedMemberTests) / sizeof(s_internedMemberTests[0]); i++)
+    {
+        const InternedMemberTest* pTest = &s_internedMemberTests[i];
+        JSON_Parser parser = NULL;
+        int succeeded;
+        int document;
+        printf("Test parser interned member handler with %s ... ", pTest->pName);
+        succeeded = CheckParserCreate(NULL, JSON_Success, &parser) &&
+                    JSON_Parser_SetInternedKeyCapacity(parser, pTest->capacity) == JSON_Success &&
+                    JSON_Parser_SetKeyEvictionPolicy(parser, pTest->policy) == JSON_Success;
+        for (document = 0; succeeded && document < 2; document++)
+        {
+            const char* pInput = pTest->pDocuments[document];
+            int isLast = (document == 1);
+            succeeded = CheckParserReset(parser, JSON_Success) &&
+                        JSON_Parser_GetInternedKeyCapacity(parser) == pTest->capacity &&
+                        JSON_Parser_GetKeyEvictionPolicy(parser) == pTest->policy &&
+                        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
+                        CheckParserSetInternedMemberHandler(parser, &InternedMemberHandler, JSON_Success) &&
+                        CheckParserParse(parser, pInput, strlen(pInput), JSON_True,
+                                         (isLast && pTest->expectedError != JSON_Error_None) ? JSON_Failure : JSON_Success);
+        }
+        if (succeeded && CheckOutput(pTest->pOutput))
+        {
+            if (JSON_Parser_GetError(parser) == pTest->expectedError)
+            {
+                printf("OK\n");
+            }
+            else
+            {
+                printf("FAILURE: expected error %s but got %s\n", errorNames[pTest->expectedError], errorNames[JSON_Parser_GetError(parser)]);
+                s_failureCount++;
+            }
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Parser_Free(parser);
+        ResetOutput();
+    }
+}
+
+static void TestParserInternedKeySettings(void)
+{
+    JSON_Parser parser = NULL;
+    printf("Test parser interned key settings ... ");
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_GetInternedKeyCapacity(parser) == 1024 &&
+        JSON_Parser_GetKeyEvictionPolicy(parser) == JSON_EvictLeastRecentlyUsed &&
+        JSON_Parser_SetInternedKeyCapacity(parser, 1) == JSON_Success &&
+        JSON_Parser_SetKeyEvictionPolicy(parser, JSON_EvictNone) == JSON_Success &&
+        CheckParserParse(parser, "{", 1, JSON_False, JSON_Success) &&
+        JSON_Parser_SetInternedKeyCapacity(parser, 2) == JSON_Failure &&
+        JSON_Parser_SetKeyEvictionPolicy(parser, JSON_EvictLeastRecentlyUsed) == JSON_Failure &&
+        JSON_Parser_GetInternedKeyCapacity(parser) == 1 &&
+        JSON_Parser_GetKeyEvictionPolicy(parser) == JSON_EvictNone &&
+        JSON_Parser_GetInternedKeyCapacity(NULL) == 0 &&
+        JSON_Parser_SetInternedKeyCapacity(NULL, 1) == JSON_Failure &&
+        JSON_Parser_SetKeyEvictionPolicy(NULL, JSON_EvictNone) == JSON_Failure)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static const char* const s_knownKeys[] = { "id", "name", "tags", "" };
+
+typedef struct tag_KnownKeyTest
+{
+    const char* pName;
+    size_t      keyCount; /* the first keyCount names in s_knownKeys */
+    int         skipUnknownMembers;
+    const char* pInput;
+    JSON_Error  expectedError;
+    const char* pOutput;
+} KnownKeyTest;
+
+static const KnownKeyTest s_knownKeyTests[] =
+{
+    { "known and unknown members", 4, 0, "{\"id\":1,\"x\":2,\"\":3,\"nam\":4,\"name\":5}", JSON_Error_None, "{:0,0,0,0-1,0,1,0 K0(id) #(1):6,0,6,1-7,0,7,1 K-(x) #(2):12,0,12,1-13,0,13,1 K3() #(3):17,0,17,1-18,0,18,1 K-(nam) #(4):25,0,25,1-26,0,26,1 K1(name) #(5):34,0,34,1-35,0,35,1" },
+    { "no known keys", 0, 0, "{\"id\":1}", JSON_Error_None, "{:0,0,0,0-1,0,1,0 K-(id) #(1):6,0,6,1-7,0,7,1" },
+    { "skip unknown members", 4, 1, "{\"x\":{\"id\":[1,{\"name\":\"y\"}],\"z\":null},\"tags\":[\"a\"],\"y\":\"skipped\",\"id\":7}", JSON_Error_None, "{:0,0,0,0-1,0,1,0 m(tags):38,0,38,1-44,0,44,1 [:45,0,45,1-46,0,46,1 s(a):46,0,46,2-49,0,49,2 m(id):65,0,65,1-69,0,69,1 #(7):70,0,70,1-71,0,71,1" },
+    { "skip all members", 0, 1, "[{\"id\":1,\"name\":{}},2]", JSON_Error_None, "[:0,0,0,0-1,0,1,0 {:1,0,1,1-2,0,2,1 #(2):20,0,20,1-21,0,21,1" },
+    { "errors in skipped members are reported", 4, 1, "{\"x\":[1,2,}", JSON_Error_UnexpectedToken, "{:0,0,0,0-1,0,1,0" },
+    { "duplicates in skipped members are reported", 4, 1, "{\"x\":{\"a\":1,\"a\":2}}", JSON_Error_DuplicateObjectMember, "{:0,0,0,0-1,0,1,0" }
+};
+
+static void TestParserKnownKeys(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(s_knownKeyTests) / sizeof(s_knownKeyTests[0]); i++)
+    {
+        const KnownKeyTest* pTest = &s_knownKeyTests[i];
+        JSON_Parser parser = NULL;
+        printf("Test parser known keys with %s ... ", pTest->pName);
+        if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+            JSON_Parser_SetKnownKeys(parser, s_knownKeys, NULL, pTest->keyCount) == JSON_Success &&
+            JSON_Parser_GetKnownKeyCount(parser) == pTest->keyCount &&
+            JSON_Parser_SetSkipUnknownMembers(parser, pTest->skipUnknownMembers ? JSON_True : JSON_False) == JSON_Success &&
+            CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+            CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+            CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+            CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+            CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+            CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
+            CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
+            CheckParserSetKnownMemberHandler(parser, pTest->skipUnknownMembers ? NULL : &KnownMemberHandler, JSON_Success) &&
+            CheckParserParse(parser, pTest->pInput, strlen(pTest->pInput), JSON_True, (pTest->expectedError == JSON_Error_None) ? JSON_Success : JSON_Failure) &&
+            CheckOutput(pTest->pOutput))
+        {
+            if (JSON_Parser_GetError(parser) == pTest->expectedError)
+            {
+                printf("OK\n");
+            }
+            else
+            {
+                printf("FAILURE: expected error %s but got %s\n", errorNames[pTest->expectedError], errorNames[JSON_Parser_GetError(parser)]);
+                s_failureCount++;
+            }
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Parser_Free(parser);
+        ResetOutput();
+    }
+}
+
+typedef struct tag_PathFilterTest
+{
+    const char* pName;
+    const char* pPaths[3]; /* NULL-terminated */
+    const char* pInput;
+    JSON_Error  expectedError;
+    int         expectMatchedAllPaths;
+    const char* pOutput;
+} PathFilterTest;
+
+static const PathFilterTest s_pathFilterTests[] =
+{
+    { "member path", { "/b", NULL }, "{\"a\":1,\"b\":{\"c\":[2]},\"d\":3}", JSON_Error_None, 1, "P0 {:11,0,11,1-12,0,12,1 m(c):12,0,12,2-15,0,15,2 [:16,0,16,2-17,0,17,2 i:17,0,17,3-18,0,18,3 #(2):17,0,17,3-18,0,18,3 ]:18,0,18,2-19,0,19,2 }:19,0,19,1-20,0,20,1" },
+    { "root path", { "", NULL }, "[1]", JSON_Error_None, 1, "P0 [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 ]:2,0,2,0-3,0,3,0" },
+    { "array index path", { "/1", NULL }, "[0,[1],2]", JSON_Error_None, 1, "P0 [:3,0,3,1-4,0,4,1 i:4,0,4,2-5,0,5,2 #(1):4,0,4,2-5,0,5,2 ]:5,0,5,1-6,0,6,1" },
+    { "array index path on an object", { "/1", NULL }, "{\"0\":0,\"1\":1}", JSON_Error_None, 1, "P0 #(1):11,0,11,1-12,0,12,1" },
+    { "wildcard path", { "/items/*/id", NULL }, "{\"items\":[{\"id\":1,\"x\":0},{\"x\":{\"id\":0}},{\"id\":\"two\"}],\"id\":0}", JSON_Error_None, 0, "P0 #(1):16,0,16,3-17,0,17,3 P0 s(two):46,0,46,3-51,0,51,3" },
+    { "escaped path", { "/a~1b/~0", NULL }, "{\"a/b\":{\"~\":true},\"a~1b\":{\"~\":false}}", JSON_Error_None, 1, "P0 t:12,0,12,2-16,0,16,2" },
+    { "nested paths", { "/a", "/a/b", NULL }, "{\"a\":{\"b\":1}}", JSON_Error_None, 1, "P0 {:5,0,5,1-6,0,6,1 m(b):6,0,6,2-9,0,9,2 P1 #(1):10,0,10,2-11,0,11,2 }:11,0,11,1-12,0,12,1" },
+    { "early stop", { "/a", "/c/0", NULL }, "{\"a\":null,\"c\":[true],\"d\":[1,2,3]} this is not JSON", JSON_Error_None, 1, "P0 n:5,0,5,1-9,0,9,1 P1 t:15,0,15,2-19,0,19,2" },
+    { "unmatched path", { "/z", NULL }, "{\"a\":{\"z\":1}}", JSON_Error_None, 0, "" },
+    { "errors outside matched values", { "/a", "/b", NULL }, "{\"a\":1,\"x\":[1,}", JSON_Error_UnexpectedToken, 0, "P0 #(1):5,0,5,1-6,0,6,1" },
+    { "duplicates outside matched values", { "/a", NULL }, "{\"x\":{\"y\":1,\"y\":2},\"a\":1}", JSON_Error_DuplicateObjectMember, 0, "" }
+};
+
+static void TestParserPathFilter(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(s_pathFilterTests) / sizeof(s_pathFilterTests[0]); i++)
+    {
+        const PathFilterTest* pTest = &s_pathFilterTests[i];
+        JSON_Parser parser = NULL;
+        size_t pathCount = 0;
+        while (pTest->pPaths[pathCount])
+        {
+            pathCount++;
+        }
+        printf("Test parser path filter with %s ... ", pTest->pName);
+        if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+            JSON_Parser_SetPathFilter(parser, pTest->pPaths, pathCount) == JSON_Success &&
+            JSON_Parser_GetPathFilterCount(parser) == pathCount &&
+            CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+            CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+            CheckParserSetBooleanHandler(parser, &BooleanHandler, JSON_Success) &&
+            CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+            CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+            CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
+            CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
+            CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
+            CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+            CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
+            CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
+            CheckParserSetPathMatchHandler(parser, &PathMatchHandler, JSON_Success) &&
+            CheckParserParse(parser, pTest->pInput, strlen(pTest->pInput), JSON_True, (pTest->expectedError == JSON_Error_None) ? JSON_Success : JSON_Failure) &&
+            CheckOutput(pTest->pOutput))
+        {
+            if (JSON_Parser_GetError(parser) != pTest->expectedError)
+            {
+                printf("FAILURE: expected error %s but got %s\n", errorNames[pTest->expectedError], errorNames[JSON_Parser_GetError(parser)]);
+                s_failureCount++;
+            }
+            else if (JSON_Parser_GetMatchedAllPaths(parser) != (pTest->expectMatchedAllPaths ? JSON_True : JSON_False))
+            {
+                printf("FAILURE: expected JSON_Parser_GetMatchedAllPaths() to return %s\n", pTest->expectMatchedAllPaths ? "JSON_True" : "JSON_False");
+                s_failureCount++;
+            }
+            else
+            {
+                printf("OK\n");
+            }
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Parser_Free(parser);
+        ResetOutput();
+    }
+}
+
+static void TestParserSetPathFilter(void)
+{
+    static const char* const paths[] = { "/a", "" };
+    static const char* const badPaths[] = { "/a", "a" };
+    static const char* const badEscapePaths[] = { "/a~2" };
+    JSON_Parser parser = NULL;
+    printf("Test parser set path filter ... ");
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_GetPathFilterCount(parser) == 0 &&
+        JSON_Parser_SetPathFilter(parser, badPaths, 2) == JSON_Failure &&
+        JSON_Parser_SetPathFilter(parser, badEscapePaths, 1) == JSON_Failure &&
+        JSON_Parser_GetPathFilterCount(parser) == 0 &&
+        JSON_Parser_SetStringEncoding(parser, JSON_UTF16LE) == JSON_Success &&
+        JSON_Parser_SetPathFilter(parser, paths, 2) == JSON_Failure &&
+        JSON_Parser_SetStringEncoding(parser, JSON_UTF8) == JSON_Success &&
+        JSON_Parser_SetPathFilter(parser, paths, 2) == JSON_Success &&
+        JSON_Parser_GetPathFilterCount(parser) == 2 &&
+        JSON_Parser_SetStringEncoding(parser, JSON_UTF16LE) == JSON_Failure &&
+        CheckParserParse(parser, "{\"a\":1} x", 10, JSON_True, JSON_Success) &&
+        JSON_Parser_GetMatchedAllPaths(parser) == JSON_True &&
+        CheckParserParse(parser, "{", 1, JSON_False, JSON_Failure) &&
+        CheckParserReset(parser, JSON_Success) &&
+        JSON_Parser_GetMatchedAllPaths(parser) == JSON_False &&
+        JSON_Parser_GetPathFilterCount(parser) == 2 &&
+        CheckParserParse(parser, "{\"a\":1", 6, JSON_False, JSON_Success) &&
+        JSON_Parser_SetPathFilter(parser, paths, 1) == JSON_Failure &&
+        CheckParserParse(parser, "}", 1, JSON_True, JSON_Success) &&
+        JSON_Parser_GetMatchedAllPaths(parser) == JSON_True &&
+        CheckParserReset(parser, JSON_Success) &&
+        JSON_Parser_SetPathFilter(parser, NULL, 0) == JSON_Success &&
+        JSON_Parser_GetPathFilterCount(parser) == 0 &&
+        JSON_Parser_GetPathFilterCount(NULL) == 0 &&
+        JSON_Parser_GetMatchedAllPaths(NULL) == JSON_False &&
+        JSON_Parser_SetPathFilter(NULL, paths, 2) == JSON_Failure)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+typedef struct tag_SkipValueTest
+{
+    const char* pName;
+    size_t      skippedContainerDepth;
+    const char* pInput;
+    JSON_Error  expectedError;
+    const char* pOutput;
+} SkipValueTest;
+
+static const SkipValueTest s_skipValueTests[] =
+{
+    { "skipped member values", 9, "{\"_a\":{\"x\":[1,{}]},\"b\":2,\"_c\":\"s\",\"_d\":[],\"e\":null}", JSON_Error_None, "{ M(<5F>a) M(b) #(2):23,0,23,1-24,0,24,1 M(<5F>c) M(<5F>d) M(e) n:46,0,46,1-50,0,50,1 }:50,0,50,0-51,0,51,0" },
+    { "skipped containers", 1, "[1,[2,[3]],{\"a\":4},{},5]", JSON_Error_None, "[ #(1):1,0,1,1-2,0,2,1 [ { { #(5):22,0,22,1-23,0,23,1 ]:23,0,23,0-24,0,24,0" },
+    { "skipped root container", 0, "{\"a\":[1]}", JSON_Error_None, "{" },
+    { "skipped nested containers", 2, "{\"a\":{\"b\":{\"c\":1},\"d\":[2]},\"e\":3}", JSON_Error_None, "{ M(a) { M(b) { M(d) [ }:25,0,25,1-26,0,26,1 M(e) #(3):31,0,31,1-32,0,32,1 }:32,0,32,0-33,0,33,0" },
+    { "errors in skipped values", 9, "{\"_a\":[1,}", JSON_Error_UnexpectedToken, "{ M(<5F>a)" },
+    { "duplicates in skipped values", 1, "[{\"a\":1,\"a\":2}]", JSON_Error_DuplicateObjectMember, "[ {" },
+    { "skip returned by a string handler", 9, "[\"_s\"]", JSON_Error_AbortedByHandler, "[ S(<5F>s)" }
+};
+
+static void TestParserSkipValue(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(s_skipValueTests) / sizeof(s_skipValueTests[0]); i++)
+    {
+        const SkipValueTest* pTest = &s_skipValueTests[i];
+        JSON_Parser parser = NULL;
+        printf("Test parser handlers skipping %s ... ", pTest->pName);
+        s_skippedContainerDepth = pTest->skippedContainerDepth;
+        if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+            CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+            CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+            CheckParserSetStringHandler(parser, &SkippingStringHandler, JSON_Success) &&
+            CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+            CheckParserSetStartObjectHandler(parser, &SkippingStartObjectHandler, JSON_Success) &&
+            CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
+            CheckParserSetObjectMemberHandler(parser, &SkippingObjectMemberHandler, JSON_Success) &&
+            CheckParserSetStartArrayHandler(parser, &SkippingStartArrayHandler, JSON_Success) &&
+            CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
+            CheckParserParse(parser, pTest->pInput, strlen(pTest->pInput), JSON_True, (pTest->expectedError == JSON_Error_None) ? JSON_Success : JSON_Failure) &&
+            CheckOutput(pTest->pOutput))
+        {
+            if (JSON_Parser_GetError(parser) == pTest->expectedError)
+            {
+                printf("OK\n");
+            }
+            else
+            {
+                printf("FAILURE: expected error %s but got %s\n", errorNames[pTest->expectedError], errorNames[JSON_Parser_GetError(parser)]);
+                s_failureCount++;
+            }
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Parser_Free(parser);
+        ResetOutput();
+    }
+}
+
+static void TestParserManyKnownKeys(void)
+{
+    /* Enough names that the perfect hash needs many buckets, each of which
+       must be matched exactly, and some near misses that must not be. */
+    static char names[1000][8];
+    const char* keys[1000];
+    JSON_Parser parser = NULL;
+    int succeeded = 0;
+    int i;
+    printf("Test parser many known keys ... ");
+    for (i = 0; i < 1000; i++)
+    {
+        sprintf(names[i], "key%d", i);
+        keys[i] = names[i];
+    }
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_SetKnownKeys(parser, keys, NULL, 1000) == JSON_Success &&
+        JSON_Parser_GetKnownKeyCount(parser) == 1000)
+    {
+        succeeded = 1;
+        for (i = 0; succeeded && i < 1000; i++)
+        {
+            /* Look the names up by parsing each of them as a member, and a
+               name that isn't known right after it. */
+            char input[32];
+            size_t length = (size_t)sprintf(input, "{\"%s\":0,\"%sx\":1}", names[i], names[i]);
+            succeeded = CheckParserReset(parser, JSON_Success) &&
+                        CheckParserSetKnownMemberHandler(parser, &KnownMemberHandler, JSON_Success) &&
+                        CheckParserParse(parser, input, length, JSON_True, JSON_Success);
+            if (succeeded)
+            {
+                char expectedOutput[64];
+                sprintf(expectedOutput, "K%d(%s) K-(%sx)", i, names[i], names[i]);
+                succeeded = CheckOutput(expectedOutput);
+            }
+            ResetOutput();
+        }
+    }
+    if (succeeded)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserSetKnownKeys(void)
+{
+    static const char* const duplicateKeys[] = { "a", "b", "a" };
+    static const char* const keysWithNull[] = { "a", NULL };
+    static const size_t prefixLengths[] = { 1, 1, 1 };
+    static const size_t lengths[] = { 2, 2, 2 };
+    static const char* const keysWithLengths[] = { "ab", "a\0", "ac" };
+    JSON_Parser parser = NULL;
+    printf("Test setting parser known keys ... ");
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_GetKnownKeyCount(parser) == 0 &&
+        JSON_Parser_GetSkipUnknownMembers(parser) == JSON_False &&
+        JSON_Parser_SetKnownKeys(parser, duplicateKeys, NULL, 3) == JSON_Failure &&
+        JSON_Parser_SetKnownKeys(parser, keysWithLengths, prefixLengths, 3) == JSON_Failure && /* "a" thrice */
+        JSON_Parser_SetKnownKeys(parser, keysWithNull, NULL, 2) == JSON_Failure &&
+        JSON_Parser_SetKnownKeys(parser, NULL, NULL, 1) == JSON_Failure &&
+        JSON_Parser_GetKnownKeyCount(parser) == 0 &&
+        JSON_Parser_SetKnownKeys(parser, keysWithLengths, lengths, 3) == JSON_Success &&
+        JSON_Parser_SetSkipUnknownMembers(parser, JSON_True) == JSON_Success &&
+        CheckParserReset(parser, JSON_Success) &&
+        JSON_Parser_GetKnownKeyCount(parser) == 3 &&
+        JSON_Parser_GetSkipUnknownMembers(parser) == JSON_False &&
+        CheckParserParse(parser, "{", 1, JSON_False, JSON_Success) &&
+        JSON_Parser_SetKnownKeys(parser, NULL, NULL, 0) == JSON_Failure &&
+        JSON_Parser_SetSkipUnknownMembers(parser, JSON_True) == JSON_Failure &&
+        CheckParserReset(parser, JSON_Success) &&
+        JSON_Parser_SetKnownKeys(parser, NULL, NULL, 0) == JSON_Success &&
+        JSON_Parser_GetKnownKeyCount(parser) == 0 &&
+        JSON_Parser_GetKnownKeyCount(NULL) == 0 &&
+        JSON_Parser_SetKnownKeys(NULL, NULL, NULL, 0) == JSON_Failure &&
+        JSON_Parser_GetSkipUnknownMembers(NULL) == JSON_False &&
+        JSON_Parser_SetSkipUnknownMembers(NULL, JSON_True) == JSON_Failure)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+}
+
+typedef struct tag_EventBatchTest
+{
+    const char*   pName;
+    const char*   pInput;
+    JSON_Encoding inputEncoding;
+    size_t        maxEvents;
+    int           inChunks;
+    JSON_Error    expectedError;
+    const char*   pOutput;
+} EventBatchTest;
+
+static const EventBatchTest s_eventBatchTests[] =
+{
+    { "whole document", "{\"a\":[1,true,null,\"x\"],\"b\":-1.5}", JSON_UnknownEncoding, 3, 0, JSON_Error_None, "{0 m1(a) [1 | #2(1) b2(1) n2 | s2(x) ]1 m1(b) | #1(-1.5) }0 |" },
+    { "document in chunks", "{\"a\":[1,true,null,\"x\"],\"b\":-1.5}", JSON_UnknownEncoding, 3, 1, JSON_Error_None, "{0 m1(a) | [1 | #2(1) | b2(1) | n2 | s2(x) | ]1 | m1(b) | #1(-1.5) }0 |" },
+    { "one event per batch", "[NaN,-Infinity,false]", JSON_UnknownEncoding, 1, 0, JSON_Error_None, "[0 | x1(0) | x1(2) | b1(0) | ]0 |" },
+    { "arena growth", "[\"012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789\",123456789012345678901234567890]", JSON_UnknownEncoding, 64, 0, JSON_Error_None, "[0 s1(012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789) #1(123456789012345678901234567890) ]0 |" },
+    { "invalid document", "[1,2,x]", JSON_UnknownEncoding, 3, 0, JSON_Error_UnknownToken, "[0 #1(1) #1(2) |" },
+    { "duplicate member", "{\"a\":1,\"a\":2}", JSON_UnknownEncoding, 2, 0, JSON_Error_DuplicateObjectMember, "{0 m1(a) | #1(1) |" },
+    { "long string with escape sequence", "[\"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789\\/b\"]", JSON_UTF8, 3, 0, JSON_Error_None, "[0 s1(0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789/b) ]0 |" }
+};
+
+static void TestParserEventBatches(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(s_eventBatchTests) / sizeof(s_eventBatchTests[0]); i++)
+    {
+        const EventBatchTest* pTest = &s_eventBatchTests[i];
+        size_t length = strlen(pTest->pInput);
+        size_t offset = 0;
+        JSON_Parser parser = NULL;
+        int succeeded;
+        printf("Test parser event batches with %s ... ", pTest->pName);
+        succeeded = CheckParserCreate(NULL, JSON_Success, &parser) &&
+                    CheckParserSetInputEncoding(parser, pTest->inputEncoding, JSON_Success) &&
+                    CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
+                    CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+                    CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+                    CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
+                    CheckParserSetEventBatchHandler(parser, &EventBatchHandler, s_events, pTest->maxEvents, JSON_Success);
+        while (succeeded && pTest->inChunks && offset < length)
+        {
+            succeeded = CheckParserParse(parser, pTest->pInput + offset, 1, JSON_False, JSON_Success);
+            offset++;
+        }
+        if (succeeded &&
+            CheckParserParse(parser, pTest->pInput + offset, length - offset, JSON_True, (pTest->expectedError == JSON_Error_None) ? JSON_Success : JSON_Failure) &&
+            CheckOutput(pTest->pOutput))
+        {
+            if (JSON_Parser_GetError(parser) == pTest->expectedError)
+            {
+                printf("OK\n");
+            }
+            else
+            {
+                printf("FAILURE: expected error %s but got %s\n", errorNames[pTest->expectedError], errorNames[JSON_Parser_GetError(parser)]);
+                s_failureCount++;
+            }
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Parser_Free(parser);
+        ResetOutput();
+    }
+}
+
+static void TestParserAbortInEventBatchHandler(void)
+{
+    static const char input[] = "[1,2,3,4,5]";
+    JSON_Parser parser = NULL;
+    printf("Test parser abort in event batch handler ... ");
+    s_failHandler = 1;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetEventBatchHandler(parser, &EventBatchHandler, s_events, 2, JSON_Success) &&
+        CheckParserParse(parser, input, sizeof(input) - 1, JSON_True, JSON_Failure) &&
+        JSON_Parser_GetError(parser) == JSON_Error_AbortedByHandler &&
+        CheckParserSetEventBatchHandler(parser, NULL, NULL, 0, JSON_Failure))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    s_failHandler = 0;
+    JSON_Parser_Free(parser);
+}
+
+
+static JSON_Tape CreateTape(void)
+{
+    JSON_MemorySuite memorySuite;
+    memorySuite.userData = NULL;
+    memorySuite.realloc = &ReallocHandler;
+    memorySuite.free = &FreeHandler;
+    return JSON_Tape_Create(&memorySuite);
+}
+
+static int OutputTapeValue(JSON_Tape tape, size_t value)
+{
+    static const char* specialNumbers[] = { "NaN", "Infinity", "-Infinity" };
+    JSON_ValueType type;
+    JSON_Boolean boolean;
+    JSON_SpecialNumber specialNumber;
+    const char* pValue;
+    size_t length;
+    unsigned int attributes;
+    size_t count;
+    size_t child;
+    size_t childCount = 0;
+    if (!JSON_Tape_GetValueType(tape, value, &type))
+    {
+        printf("FAILURE: expected JSON_Tape_GetValueType() to return JSON_Success\n");
+        return 0;
+    }
+    switch (type)
+    {
+    case JSON_Value_Null:
+        OutputFormatted("null");
+        return 1;
+
+    case JSON_Value_Boolean:
+        if (!JSON_Tape_GetBoolean(tape, value, &boolean))
+        {
+            return 0;
+        }
+        OutputFormatted(boolean ? "true" : "false");
+        return 1;
+
+    case JSON_Value_String:
+        if (!JSON_Tape_GetString(tape, value, &pValue, &length, &attributes))
+        {
+            return 0;
+        }
+        OutputFormatted("\"%s\"", pValue);
+        return 1;
+
+    case JSON_Value_Number:
+        if (!JSON_Tape_GetNumber(tape, value, &pValue, &length, &attributes))
+        {
+            return 0;
+        }
+        OutputFormatted("%s", pValue);
+        return 1;
+
+    case JSON_Value_SpecialNumber:
+        if (!JSON_Tape_GetSpecialNumber(tape, value, &specialNumber))
+        {
+            return 0;
+        }
+        OutputFormatted("%s", specialNumbers[specialNumber]);
+        return 1;
+
+    default:
+        break;
+    }
+    if (!JSON_Tape_GetChildCount(tape, value, &count))
+    {
+        return 0;
+    }
+    OutputCharacter((type == JSON_Value_Object) ? '{' : '[');
+    if (JSON_Tape_GetFirstChild(tape, value, &child))
+    {
+        do
+        {
+            if (childCount)
+            {
+                OutputCharacter(',');
+            }
+            if (type == JSON_Value_Object)
+            {
+                if (!JSON_Tape_GetMemberName(tape, child, &pValue, &length, &attributes))
+                {
+                    printf("FAILURE: expected JSON_Tape_GetMemberName() to return JSON_Success\n");
+                    return 0;
+                }
+                OutputFormatted("%s:", pValue);
+            }
+            if (!OutputTapeValue(tape, child))
+            {
+                return 0;
+            }
+            childCount++;
+        } while (JSON_Tape_GetNextSibling(tape, child, &child));
+    }
+    OutputCharacter((type == JSON_Value_Object) ? '}' : ']');
+    if (childCount != count)
+    {
+        printf("FAILURE: expected %d children but iterated over %d\n", (int)count, (int)childCount);
+        return 0;
+    }
+    return 1;
+}
+
+typedef struct tag_TapeTest
+{
+    const char*   pName;
+    const char*   pInput;
+    JSON_Encoding inputEncoding;
+    int           inChunks;
+    const char*   pOutput;
+} TapeTest;
+
+static const TapeTest s_tapeTests[] =
+{
+    { "scalar", "-12.5", JSON_UnknownEncoding, 0, "-12.5" },
+    { "empty object", "{}", JSON_UnknownEncoding, 0, "{}" },
+    { "empty array", "[]", JSON_UnknownEncoding, 1, "[]" },
+    { "document", "{\"a\":[1,true,null,\"x\",-2.5e3],\"b\":{},\"c\":[[]],\"d\":NaN,\"e\":{\"f\":\"g\"}}", JSON_UnknownEncoding, 0, "{a:[1,true,null,\"x\",-2.5e3],b:{},c:[[]],d:NaN,e:{f:\"g\"}}" },
+    { "document in chunks", "{\"a\":[1,true,null,\"x\",-2.5e3],\"b\":{},\"c\":[[]],\"d\":NaN,\"e\":{\"f\":\"g\"}}", JSON_UnknownEncoding, 1, "{a:[1,true,null,\"x\",-2.5e3],b:{},c:[[]],d:NaN,e:{f:\"g\"}}" },
+    { "escaped strings", "[\"a\\tb\",\"\\u0041\"]", JSON_UnknownEncoding, 1, "[\"a\tb\",\"A\"]" },
+    { "long string with escape sequence", "[\"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789\\/b\"]", JSON_UTF8, 0, "[\"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789/b\"]" }
+};
+
+static void TestParserBuildTape(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(s_tapeTests) / sizeof(s_tapeTests[0]); i++)
+    {
+        const TapeTest* pTest = &s_tapeTests[i];
+        size_t length = strlen(pTest->pInput);
+        size_t offset = 0;
+        size_t root;
+        JSON_Parser parser = NULL;
+        JSON_Tape tape = CreateTape();
+        int succeeded;
+        printf("Test parser building tape with %s ... ", pTest->pName);
+        succeeded = CheckParserCreate(NULL, JSON_Success, &parser) &&
+                    CheckParserSetInputEncoding(parser, pTest->inputEncoding, JSON_Success) &&
+                    CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
+                    CheckParserSetNullHandler(parser, &NullHandler, JSON_Success) &&
+                    JSON_Parser_SetTape(parser, tape) == JSON_Success &&
+                    JSON_Parser_GetTape(parser) == tape;
+        while (succeeded && pTest->inChunks && offset < length)
+        {
+            succeeded = CheckParserParse(parser, pTest->pInput + offset, 1, JSON_False, JSON_Success);
+            offset++;
+        }
+        if (succeeded &&
+            CheckParserParse(parser, pTest->pInput + offset, length - offset, JSON_True, JSON_Success) &&
+            JSON_Tape_GetRoot(tape, &root) == JSON_Success &&
+            OutputTapeValue(tape, root) &&
+            CheckOutput(pTest->pOutput))
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Parser_Free(parser);
+        JSON_Tape_Free(tape);
+        ResetOutput();
+    }
+}
+
+static void TestParserBuildLargeTape(void)
+{
+    /* Enough values and text to make the tape grow several times. */
+    char input[8192];
+    size_t length = 0;
+    JSON_Parser parser = NULL;
+    JSON_Tape tape = CreateTape();
+    JSON_Int64 sum = 0;
+    size_t root;
+    size_t item;
+    size_t count;
+    int i;
+    printf("Test parser building large tape ... ");
+    input[length++] = '[';
+    for (i = 0; i < 200; i++)
+    {
+        length += (size_t)sprintf(input + length, "%s{\"key\":\"item %d\",\"value\":%d}", i ? "," : "", i, i);
+    }
+    input[length++] = ']';
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_SetTape(parser, tape) == JSON_Success &&
+        CheckParserParse(parser, input, length, JSON_True, JSON_Success) &&
+        JSON_Tape_GetRoot(tape, &root) == JSON_Success &&
+        JSON_Tape_GetChildCount(tape, root, &count) == JSON_Success &&
+        count == 200 &&
+        JSON_Tape_GetFirstChild(tape, root, &item) == JSON_Success)
+    {
+        size_t value;
+        JSON_Int64 n;
+        do
+        {
+            if (JSON_Tape_FindMember(tape, item, "value", 5, &value) == JSON_Success &&
+                JSON_Tape_GetInt64(tape, value, &n) == JSON_Success)
+            {
+                sum += n;
+            }
+        } while (JSON_Tape_GetNextSibling(tape, item, &item));
+        if (sum == 19900)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            printf("FAILURE: expected the values to add up to 19900, not %d\n", (int)sum);
+            s_failureCount++;
+        }
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+    JSON_Tape_Free(tape);
+}
+
+static void TestTapeNavigation(void)
+{
+    static const char input[] = "{\"i\":-9223372036854775808,\"u\":18446744073709551615,\"d\":0.1,\"big\":1e400,\"s\":\"str\",\"t\":true,\"x\":-Infinity,\"a\":[1,2,3],\"a\":4}";
+    JSON_Parser parser = NULL;
+    JSON_Tape tape = CreateTape();
+    size_t root, i, u, d, big, str, t, x, a, child, sibling;
+    JSON_ValueType type;
+    JSON_Int64 intValue;
+    JSON_UInt64 uintValue;
+    double doubleValue;
+    JSON_Boolean boolean;
+    JSON_SpecialNumber specialNumber;
+    const char* pValue;
+    size_t length;
+    size_t count;
+    unsigned int attributes;
+    printf("Test tape navigation ... ");
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetAllowSpecialNumbers(parser, JSON_True, JSON_Success) &&
+        JSON_Parser_SetTape(parser, tape) == JSON_Success &&
+        CheckParserParse(parser, input, sizeof(input) - 1, JSON_True, JSON_Success) &&
+        JSON_Parser_SetTape(parser, NULL) == JSON_Failure &&
+        JSON_Tape_GetRoot(tape, &root) == JSON_Success &&
+        JSON_Tape_GetRoot(tape, NULL) == JSON_Failure &&
+        JSON_Tape_GetRoot(NULL, &root) == JSON_Failure &&
+        JSON_Tape_GetValueType(tape, root, &type) == JSON_Success && type == JSON_Value_Object &&
+        JSON_Tape_GetValueType(tape, root + 1, &type) == JSON_Failure && /* member name */
+        JSON_Tape_GetValueType(tape, 1000, &type) == JSON_Failure &&
+        JSON_Tape_GetChildCount(tape, root, &count) == JSON_Success && count == 9 &&
+        JSON_Tape_GetNextSibling(tape, root, &sibling) == JSON_Failure &&
+        JSON_Tape_GetMemberName(tape, root, &pValue, &length, &attributes) == JSON_Failure &&
+        JSON_Tape_FindMember(tape, root, "i", 1, &i) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "u", 1, &u) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "d", 1, &d) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "big", 3, &big) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "s", 1, &str) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "t", 1, &t) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "x", 1, &x) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "a", 1, &a) == JSON_Success &&
+        JSON_Tape_FindMember(tape, root, "missing", 7, &child) == JSON_Failure &&
+        JSON_Tape_FindMember(tape, root, "", 0, &child) == JSON_Failure &&
+        JSON_Tape_FindMember(tape, root, NULL, 1, &child) == JSON_Failure &&
+        JSON_Tape_FindMember(tape, a, "a", 1, &child) == JSON_Failure &&
+        JSON_Tape_GetInt64(tape, i, &intValue) == JSON_Success && intValue == -(JSON_Int64)((JSON_UInt64)1 << 62) * 2 &&
+        JSON_Tape_GetUInt64(tape, i, &uintValue) == JSON_Failure &&
+        JSON_Tape_GetInt64(tape, u, &intValue) == JSON_Failure &&
+        JSON_Tape_GetUInt64(tape, u, &uintValue) == JSON_Success && uintValue == ~(JSON_UInt64)0 &&
+        JSON_Tape_GetDouble(tape, d, &doubleValue) == JSON_Success && doubleValue == 0.1 &&
+        JSON_Tape_GetInt64(tape, d, &intValue) == JSON_Failure &&
+        JSON_Tape_GetDouble(tape, big, &doubleValue) == JSON_Failure &&
+        JSON_Tape_GetNumber(tape, big, &pValue, &length, &attributes) == JSON_Success && length == 5 && !strcmp(pValue, "1e400") &&
+        JSON_Tape_GetString(tape, str, &pValue, &length, &attributes) == JSON_Success && length == 3 && !strcmp(pValue, "str") &&
+        JSON_Tape_GetNumber(tape, str, &pValue, &length, &attributes) == JSON_Failure &&
+        JSON_Tape_GetDouble(tape, str, &doubleValue) == JSON_Failure &&
+        JSON_Tape_GetBoolean(tape, t, &boolean) == JSON_Success && boolean == JSON_True &&
+        JSON_Tape_GetBoolean(tape, str, &boolean) == JSON_Failure &&
+        JSON_Tape_GetSpecialNumber(tape, x, &specialNumber) == JSON_Success && specialNumber == JSON_NegativeInfinity &&
+        JSON_Tape_GetMemberName(tape, a, &pValue, &length, &attributes) == JSON_Success && length == 1 && !strcmp(pValue, "a") &&
+        JSON_Tape_GetChildCount(tape, a, &count) == JSON_Success && count == 3 &&
+        JSON_Tape_GetChildCount(tape, t, &count) == JSON_Failure &&
+        JSON_Tape_GetFirstChild(tape, t, &child) == JSON_Failure &&
+        JSON_Tape_GetFirstChild(tape, a, &child) == JSON_Success &&
+        JSON_Tape_GetMemberName(tape, child, &pValue, &length, &attributes) == JSON_Failure &&
+        JSON_Tape_GetNextSibling(tape, child, &child) == JSON_Success &&
+        JSON_Tape_GetNextSibling(tape, child, &child) == JSON_Success &&
+        JSON_Tape_GetInt64(tape, child, &intValue) == JSON_Success && intValue == 3 &&
+        JSON_Tape_GetNextSibling(tape, child, &child) == JSON_Failure &&
+        JSON_Tape_GetNextSibling(tape, a, &sibling) == JSON_Success &&
+        JSON_Tape_GetMemberName(tape, sibling, &pValue, &length, &attributes) == JSON_Success && !strcmp(pValue, "a") &&
+        JSON_Tape_GetNextSibling(tape, sibling, &sibling) == JSON_Failure &&
+        JSON_Parser_Reset(parser) == JSON_Success &&
+        JSON_Parser_GetTape(parser) == NULL &&
+        JSON_Tape_GetRoot(tape, &root) == JSON_Success &&
+        JSON_Tape_Reset(tape) == JSON_Success &&
+        JSON_Tape_GetRoot(tape, &root) == JSON_Failure &&
+        JSON_Tape_GetValueType(tape, 0, &type) == JSON_Failure)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        printf("FAILURE: unexpected result from tape API\n");
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+    JSON_Tape_Free(tape);
+}
+
+static void TestTapeIncomplete(void)
+{
+    JSON_Parser parser = NULL;
+    JSON_Tape tape = CreateTape();
+    JSON_MemorySuite memorySuite;
+    size_t root;
+    printf("Test incomplete tape ... ");
+    memorySuite.userData = NULL;
+    memorySuite.realloc = &ReallocHandler;
+    memorySuite.free = NULL;
+    if (JSON_Tape_Create(&memorySuite) == NULL &&
+        CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_SetTape(parser, tape) == JSON_Success &&
+        CheckParserParse(parser, "[1,", 3, JSON_False, JSON_Success) &&
+        JSON_Tape_GetRoot(tape, &root) == JSON_Failure &&
+        CheckParserParse(parser, "2]x", 3, JSON_True, JSON_Failure) &&
+        JSON_Tape_GetRoot(tape, &root) == JSON_Failure &&
+        CheckParserReset(parser, JSON_Success) &&
+        CheckParserSetStopAfterEmbeddedDocument(parser, JSON_True, JSON_Success) &&
+        JSON_Parser_SetTape(parser, tape) == JSON_Success &&
+        CheckParserParse(parser, "[1,2]x", 6, JSON_True, JSON_Failure) &&
+        JSON_Parser_GetError(parser) == JSON_Error_StoppedAfterEmbeddedDocument &&
+        JSON_Tape_GetRoot(tape, &root) == JSON_Success &&
+        JSON_Tape_Free(NULL) == JSON_Failure &&
+        JSON_Tape_Reset(NULL) == JSON_Failure &&
+        JSON_Parser_GetTape(NULL) == NULL &&
+        JSON_Parser_SetTape(NULL, tape) == JSON_Failure)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        printf("FAILURE: unexpected result from tape API\n");
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+    JSON_Tape_Free(tape);
+}
+
+static void TestTapeMallocFailure(void)
+{
+    JSON_Parser parser = NULL;
+    JSON_Tape tape = CreateTape();
+    printf("Test tape malloc failure ... ");
+    s_failMalloc = 1;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_SetTape(parser, tape) == JSON_Success &&
+        CheckParserParse(parser, "[\"abc\"]", 7, JSON_True, JSON_Failure) &&
+        JSON_Parser_GetError(parser) == JSON_Error_OutOfMemory)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    s_failMalloc = 0;
+    JSON_Parser_Free(parser);
+    JSON_Tape_Free(tape);
+}
+
+/* The tape document handler outputs the document on the tape that it is
+   given when the parser has finished it. */
+static JSON_Tape s_documentTape = NULL;
+
+static JSON_Parser_HandlerResult JSON_CALL TapeDocumentHandler(JSON_Parser parser)
+{
+    size_t root;
+    (void)parser;
+    OutputSeparator();
+    if (JSON_Tape_GetRoot(s_documentTape, &root) != JSON_Success || !OutputTapeValue(s_documentTape, root))
+    {
+        return JSON_Parser_Abort;
+    }
+    return JSON_Parser_Continue;
+}
+
+static void TestParserMultipleDocuments(void)
+{
+    static const char* const paths[] = { "/id" };
+    static const char filterInput[] = "{\"id\":1,\"x\":[2]}\n{\"x\":3,\"id\":4}\n";
+    static const char tapeInput[] = "\x1E[1,2]\n\x1E{\"a\":null}\n";
+    JSON_Parser parser = NULL;
+    size_t root;
+    JSON_ValueType type;
+
+    printf("Test parser path filter across multiple documents ... ");
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_SetPathFilter(parser, paths, 1) == JSON_Success &&
+        CheckParserSetAllowMultipleDocuments(parser, JSON_True, JSON_Success) &&
+        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+        CheckParserSetStartDocumentHandler(parser, &StartDocumentHandler, JSON_Success) &&
+        CheckParserSetEndDocumentHandler(parser, &EndDocumentHandler, JSON_Success) &&
+        CheckParserSetPathMatchHandler(parser, &PathMatchHandler, JSON_Success) &&
+        CheckParserParse(parser, filterInput, sizeof(filterInput) - 1, JSON_True, JSON_Success) &&
+        CheckOutput("<:0,0,0,0-1,0,1,0 P0 #(1):6,0,6,1-7,0,7,1 >:15,0,15,0-16,0,16,0 <:17,1,0,0-18,1,1,0 P0 #(4):29,1,12,1-30,1,13,1 >:30,1,13,0-31,1,14,0"))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+    ResetOutput();
+
+    printf("Test parser building tape for each of multiple documents ... ");
+    s_documentTape = CreateTape();
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_SetTape(parser, s_documentTape) == JSON_Success &&
+        CheckParserSetAllowMultipleDocuments(parser, JSON_True, JSON_Success) &&
+        CheckParserSetEndDocumentHandler(parser, &TapeDocumentHandler, JSON_Success) &&
+        CheckParserParse(parser, tapeInput, sizeof(tapeInput) - 1, JSON_True, JSON_Success) &&
+        CheckOutput("[1,2] {a:null}") &&
+        JSON_Tape_GetRoot(s_documentTape, &root) == JSON_Success &&
+        JSON_Tape_GetValueType(s_documentTape, root, &type) == JSON_Success &&
+        type == JSON_Value_Object)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+    JSON_Tape_Free(s_documentTape);
+    s_documentTape = NULL;
+    ResetOutput();
+}
+
+static void TestParserClone(void)
+{
+    static const char* const keys[] = { "id", "x" };
+    static const char* const paths[] = { "/x" };
+    static const char input[] = "{\"id\":1,\"x\":[2]}\n{\"x\":{\"id\":3}}\n{\"id\":4,\"x\":5}\n";
+    JSON_Parser parser = NULL;
+    JSON_Parser clone = NULL;
+    ParserSettings settings;
+    ParserHandlers handlers;
+    size_t boundary;
+
+    printf("Test cloning parser settings and handlers ... ");
+    InitParserSettings(&settings);
+    settings.userData = (void*)1;
+    settings.stringEncoding = JSON_UTF16LE;
+    settings.maxStringLength = 2;
+    settings.allowComments = JSON_True;
+    settings.trackObjectMembers = JSON_True;
+    settings.allowMultipleDocuments = JSON_True;
+    InitParserHandlers(&handlers);
+    handlers.nullHandler = &NullHandler;
+    handlers.startDocumentHandler = &StartDocumentHandler;
+    handlers.knownMemberHandler = &KnownMemberHandler;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetUserData(parser, settings.userData, JSON_Success) &&
+        CheckParserSetStringEncoding(parser, settings.stringEncoding, JSON_Success) &&
+        CheckParserSetMaxStringLength(parser, settings.maxStringLength, JSON_Success) &&
+        CheckParserSetAllowComments(parser, settings.allowComments, JSON_Success) &&
+        CheckParserSetTrackObjectMembers(parser, settings.trackObjectMembers, JSON_Success) &&
+        CheckParserSetAllowMultipleDocuments(parser, settings.allowMultipleDocuments, JSON_Success) &&
+        CheckParserSetNullHandler(parser, handlers.nullHandler, JSON_Success) &&
+        CheckParserSetStartDocumentHandler(parser, handlers.startDocumentHandler, JSON_Success) &&
+        CheckParserSetKnownMemberHandler(parser, handlers.knownMemberHandler, JSON_Success) &&
+        CheckParserSetEventBatchHandler(parser, &EventBatchHandler, s_events, sizeof(s_events) / sizeof(s_events[0]), JSON_Success) &&
+        JSON_Parser_SetKnownKeys(parser, keys, NULL, 2) == JSON_Success &&
+        !JSON_Parser_Clone(NULL, NULL) &&
+        (clone = JSON_Parser_Clone(parser, NULL)) != NULL &&
+        CheckParserSettings(clone, &settings) &&
+        CheckParserHandlers(clone, &handlers) &&
+        JSON_Parser_GetKnownKeyCount(clone) == 2)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(clone);
+    JSON_Parser_Free(parser);
+    clone = NULL;
+
+    printf("Test parsing records in chunks with cloned parsers ... ");
+    boundary = JSON_FindRecordBoundary(input, sizeof(input) - 1, (sizeof(input) - 1) / 2);
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        JSON_Parser_SetKnownKeys(parser, keys, NULL, 2) == JSON_Success &&
+        JSON_Parser_SetPathFilter(parser, paths, 1) == JSON_Success &&
+        CheckParserSetAllowMultipleDocuments(parser, JSON_True, JSON_Success) &&
+        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+        CheckParserSetKnownMemberHandler(parser, &KnownMemberHandler, JSON_Success) &&
+        CheckParserSetEndDocumentHandler(parser, &EndDocumentHandler, JSON_Success) &&
+        (clone = JSON_Parser_Clone(parser, NULL)) != NULL &&
+        boundary == 32 &&
+        CheckParserParse(parser, input, boundary, JSON_True, JSON_Success) &&
+        CheckParserParse(clone, input + boundary, sizeof(input) - 1 - boundary, JSON_True, JSON_Success) &&
+        CheckOutput("#(2):13,0,13,2-14,0,14,2 >:15,0,15,0-16,0,16,0 K0(id) #(3):28,1,11,2-29,1,12,2 >:30,1,13,0-31,1,14,0 #(5):12,0,12,1-13,0,13,1 >:13,0,13,0-14,0,14,0"))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(clone);
+    JSON_Parser_Free(parser);
+    ResetOutput();
+
+    printf("Test cloning parser malloc failure ... ");
+    if (CheckParserCreate(NULL, JSON_Success, &parser))
+    {
+        JSON_MemorySuite memorySuite;
+        memorySuite.userData = NULL;
+        memorySuite.realloc = &ReallocHandler;
+        memorySuite.free = &FreeHandler;
+        s_failMalloc = 1;
+        clone = JSON_Parser_Clone(parser, &memorySuite);
+        s_failMalloc = 0;
+        if (!clone)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            printf("FAILURE: expected JSON_Parser_Clone() to return NULL\n");
+            s_failureCount++;
+        }
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(clone);
+    JSON_Parser_Free(parser);
+}
+
+static void TestParserArraySegments(void)
+{
+    static const char input[] = "[{\"a\":\"x,}\"},{\"b\":[1,2]},{\"c\":\"\\\"{\"}]";
+    JSON_Parser parser = NULL;
+    JSON_Parser segmentParsers[3] = { NULL, NULL, NULL };
+    size_t boundaries[4];
+    int ok;
+    int i;
+
+    printf("Test parsing array segments with cloned parsers ... ");
+    boundaries[0] = 0;
+    boundaries[1] = JSON_FindArrayItemBoundary(input, sizeof(input) - 1, (sizeof(input) - 1) / 3);
+    boundaries[2] = JSON_FindArrayItemBoundary(input, sizeof(input) - 1, (sizeof(input) - 1) * 2 / 3);
+    boundaries[3] = sizeof(input) - 1;
+    ok = CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetAllowArraySegment(parser, JSON_True, JSON_Success) &&
+        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+        CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+        CheckParserSetObjectMemberHandler(parser, &ObjectMemberHandler, JSON_Success) &&
+        CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+        CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
+        CheckParserSetArrayItemHandler(parser, &ArrayItemHandler, JSON_Success) &&
+        boundaries[1] == 12 && boundaries[2] == 24;
+    for (i = 0; ok && i < 3; i++)
+    {
+        segmentParsers[i] = JSON_Parser_Clone(parser, NULL);
+        ok = segmentParsers[i] &&
+            CheckParserParse(segmentParsers[i], input + boundaries[i], boundaries[i + 1] - boundaries[i], JSON_True, JSON_Success);
+    }
+    if (ok && CheckOutput("[:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 m(a):2,0,2,2-5,0,5,2 s(x,}):6,0,6,2-11,0,11,2 ]:12,0,12,0-12,0,12,0 [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 m(b):2,0,2,2-5,0,5,2 [:6,0,6,2-7,0,7,2 i:7,0,7,3-8,0,8,3 #(1):7,0,7,3-8,0,8,3 i:9,0,9,3-10,0,10,3 #(2):9,0,9,3-10,0,10,3 ]:10,0,10,2-11,0,11,2 ]:12,0,12,0-12,0,12,0 [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 m(c):2,0,2,2-5,0,5,2 s(\"{):6,0,6,2-11,0,11,2 ]:12,0,12,0-13,0,13,0"))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    for (i = 0; i < 3; i++)
+    {
+        JSON_Parser_Free(segmentParsers[i]);
+    }
+    JSON_Parser_Free(parser);
+    ResetOutput();
+}
+
+static int SetUpSnapshotParser(JSON_Parser parser)
+{
+    return CheckParserSetAllowComments(parser, JSON_True, JSON_Success) &&
+           CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+           CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+           CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+           CheckParserSetStartObjectHandler(parser, &StartObjectHandler, JSON_Success) &&
+           CheckParserSetEndObjectHandler(parser, &EndObjectHandler, JSON_Success) &&
+           CheckParserSetStartArrayHandler(parser, &StartArrayHandler, JSON_Success) &&
+           CheckParserSetEndArrayHandler(parser, &EndArrayHandler, JSON_Success) &&
+           CheckParserSetInternedMemberHandler(parser, &InternedMemberHandler, JSON_Success);
+}
+
+static int SetUpFilteredSnapshotParser(JSON_Parser parser)
+{
+    static const char* const paths[] = { "/a/1", "/b/*/c" };
+    return CheckParserSetAllowMultipleDocuments(parser, JSON_True, JSON_Success) &&
+           JSON_Parser_SetPathFilter(parser, paths, 2) == JSON_Success &&
+           CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+           CheckParserSetNumberHandler(parser, &NumberHandler, JSON_Success) &&
+           CheckParserSetPathMatchHandler(parser, &PathMatchHandler, JSON_Success) &&
+           CheckParserSetEndDocumentHandler(parser, &EndDocumentHandler, JSON_Success);
+}
+
+static int CheckSaveStateAtEveryOffset(const char* pInput, size_t length, size_t splitCount, int (*SetUp)(JSON_Parser), JSON_Status expectedStatus)
+{
+    /* Parses the input in one go, and then again, for each of the first
+       splitCount offsets, with a parser that takes over from a snapshot
+       taken at that offset. A parser that is reset keeps its interned
+       names, so each parse gets new parsers. */
+    JSON_Parser parser = NULL;
+    JSON_Parser restored = NULL;
+    JSON_Error expectedError = JSON_Error_None;
+    char* pExpectedOutput = NULL;
+    unsigned char state[1024];
+    size_t stateLength = 0;
+    size_t split;
+    int ok;
+    ok = CheckParserCreate(NULL, JSON_Success, &parser) &&
+         SetUp(parser) &&
+         CheckParserParse(parser, pInput, length, JSON_True, expectedStatus);
+    if (ok)
+    {
+        expectedError = JSON_Parser_GetError(parser);
+        pExpectedOutput = (char*)malloc((size_t)s_outputLength + 1);
+        ok = pExpectedOutput != NULL;
+    }
+    if (ok)
+    {
+        memcpy(pExpectedOutput, s_outputBuffer, (size_t)s_outputLength + 1);
+    }
+    JSON_Parser_Free(parser);
+    parser = NULL;
+    for (split = 0; ok && split < splitCount; split++)
+    {
+        ResetOutput();
+        ok = CheckParserCreate(NULL, JSON_Success, &parser) &&
+             SetUp(parser) &&
+             CheckParserParse(parser, pInput, split, JSON_False, JSON_Success) &&
+             JSON_Parser_SaveState(parser, NULL, 0, &stateLength) == JSON_Success &&
+             stateLength <= sizeof(state) &&
+             JSON_Parser_SaveState(parser, state, stateLength, &stateLength) == JSON_Success &&
+             CheckParserCreate(NULL, JSON_Success, &restored) &&
+             SetUp(restored) &&
+             JSON_Parser_LoadState(restored, state, stateLength) == JSON_Success &&
+             CheckParserParse(restored, pInput + split, length - split, JSON_True, expectedStatus) &&
+             JSON_Parser_GetError(restored) == expectedError &&
+             CheckOutput(pExpectedOutput);
+        if (!ok)
+        {
+            printf("FAILURE: restored parser diverged after %d bytes\n", (int)split);
+        }
+        JSON_Parser_Free(restored);
+        JSON_Parser_Free(parser);
+        restored = NULL;
+        parser = NULL;
+    }
+    free(pExpectedOutput);
+    ResetOutput();
+    return ok;
+}
+
+static void TestParserSaveState(void)
+{
+    /* The last member is a duplicate, which the restored parser can only
+       detect if the member names were saved, so the input is split at
+       every offset before the end of its name. */
+    static const char input[] = "{\"a\":[1,\"x\\u00E9y\",-2.5e1],\"b\":{\"c\":\"\xC3\xA9\",\"d\":[]},\n/* c */ \"a2\":-0.5,\"a\":0}";
+    static const char filteredInput[] = "{\"a\":[0,[1],2],\"b\":[{\"c\":\"x\"},{\"d\":{\"c\":3}},{\"c\":4}]} {\"a\":[5,6]}";
+    JSON_Parser parser = NULL;
+    JSON_Parser restored = NULL;
+    unsigned char state[1024];
+    size_t stateLength = 0;
+    int ok;
+
+    printf("Test saving and loading parser state at every offset ... ");
+    if (CheckSaveStateAtEveryOffset(input, sizeof(input) - 1, sizeof(input) - 5, &SetUpSnapshotParser, JSON_Failure) &&
+        CheckSaveStateAtEveryOffset(filteredInput, sizeof(filteredInput) - 1, sizeof(filteredInput) - 1, &SetUpFilteredSnapshotParser, JSON_Success))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+
+    printf("Test saving and loading parser state failures ... ");
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        SetUpSnapshotParser(parser) &&
+        CheckParserParse(parser, input, 20, JSON_False, JSON_Success) &&
+        JSON_Parser_SaveState(NULL, NULL, 0, &stateLength) == JSON_Failure &&
+        JSON_Parser_SaveState(parser, NULL, 0, NULL) == JSON_Failure &&
+        JSON_Parser_SaveState(parser, NULL, 0, &stateLength) == JSON_Success &&
+        JSON_Parser_SaveState(parser, state, stateLength - 1, &stateLength) == JSON_Failure &&
+        JSON_Parser_SaveState(parser, state, sizeof(state), &stateLength) == JSON_Success &&
+        JSON_Parser_LoadState(parser, state, stateLength) == JSON_Failure &&
+        CheckParserCreate(NULL, JSON_Success, &restored) &&
+        JSON_Parser_LoadState(NULL, state, stateLength) == JSON_Failure &&
+        JSON_Parser_LoadState(restored, state, stateLength) == JSON_Failure && /* settings differ */
+        SetUpSnapshotParser(restored) &&
+        CheckParserSetInputEncoding(restored, JSON_UTF16LE, JSON_Success) &&
+        JSON_Parser_LoadState(restored, state, stateLength) == JSON_Failure &&
+        CheckParserSetInputEncoding(restored, JSON_UTF8, JSON_Success) &&
+        JSON_Parser_LoadState(restored, state, stateLength - 1) == JSON_Failure)
+    {
+        state[stateLength / 2] ^= 1;
+        ok = JSON_Parser_LoadState(restored, state, stateLength) == JSON_Failure;
+        state[stateLength / 2] ^= 1;
+        if (ok &&
+            JSON_Parser_LoadState(restored, state, stateLength) == JSON_Success &&
+            CheckParserParse(restored, input + 20, sizeof(input) - 1 - 20, JSON_True, JSON_Failure) &&
+            JSON_Parser_GetError(restored) == JSON_Error_DuplicateObjectMember &&
+            JSON_Parser_SaveState(restored, NULL, 0, &stateLength) == JSON_Failure)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            s_failureCount++;
+        }
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(restored);
+    JSON_Parser_Free(parser);
+    ResetOutput();
+}
+
+static int CheckParserParseBytewise(JSON_Parser parser, const char* pBytes, size_t length)
+{
+    /* Feeding one byte at a time forces every token into the token buffer. */
+    size_t i;
+    for (i = 0; i < length; i++)
+    {
+        if (!CheckParserParse(parser, pBytes + i, 1, JSON_False, JSON_Success))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void TestParserBufferManagement(void)
+{
+    char input[40 + 302 + 40];
+    JSON_Parser parser = NULL;
+    size_t baseline;
+    size_t halfGrowth;
+    int ok;
+
+    memset(input, '[', 40);
+    input[40] = '"';
+    memset(input + 41, 'a', 300);
+    input[341] = '"';
+    memset(input + 342, ']', 40);
+
+    printf("Test parser buffer growth policy ... ");
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
+        JSON_Parser_GetBufferGrowthPolicy(parser) == JSON_GrowByDoubling &&
+        JSON_Parser_GetBufferGrowthPolicy(NULL) == JSON_GrowByDoubling &&
+        JSON_Parser_SetBufferGrowthPolicy(NULL, JSON_GrowByHalf) == JSON_Failure &&
+        JSON_Parser_SetBufferGrowthPolicy(parser, JSON_GrowByHalf) == JSON_Success &&
+        JSON_Parser_GetBufferGrowthPolicy(parser) == JSON_GrowByHalf &&
+        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success))
+    {
+        /* 64 -> 96 -> 144 -> 216 bytes when growing by half, versus
+           64 -> 128 -> 256 bytes when doubling. */
+        baseline = s_bytesAllocated;
+        ok = CheckParserParseBytewise(parser, input + 40, 201);
+        halfGrowth = s_bytesAllocated - baseline;
+        if (ok &&
+            halfGrowth == sizeof(size_t) + 216 &&
+            JSON_Parser_SetBufferGrowthPolicy(parser, JSON_GrowByDoubling) == JSON_Failure &&
+            CheckParserReset(parser, JSON_Success) &&
+            JSON_Parser_GetBufferGrowthPolicy(parser) == JSON_GrowByDoubling &&
+            CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+            JSON_Parser_Trim(parser, 0) == JSON_Success &&
+            s_bytesAllocated == baseline &&
+            CheckParserParseBytewise(parser, input + 40, 201) &&
+            s_bytesAllocated - baseline == sizeof(size_t) + 256)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            s_failureCount++;
+        }
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+    parser = NULL;
+    ResetOutput();
+
+    printf("Test parser reserve, trim and high-water marks ... ");
+    if (CheckParserCreateWithCustomMemorySuite(&ReallocHandler, &FreeHandler, JSON_Success, &parser) &&
+        CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+        JSON_Parser_Reserve(NULL, 300, 40) == JSON_Failure &&
+        JSON_Parser_Reserve(parser, (size_t)-1, 40) == JSON_Failure &&
+        JSON_Parser_Reserve(parser, 300, (size_t)-1) == JSON_Failure &&
+        JSON_Parser_Trim(NULL, 0) == JSON_Failure &&
+        JSON_Parser_GetTokenBytesHighWaterMark(NULL) == 0 &&
+        JSON_Parser_GetDepthHighWaterMark(NULL) == 0)
+    {
+        baseline = s_bytesAllocated;
+        s_failMalloc = 1;
+        ok = JSON_Parser_Reserve(parser, 300, 40) == JSON_Failure;
+        s_failMalloc = 0;
+        ok = ok && JSON_Parser_Reserve(parser, 300, 40) == JSON_Success;
+
+        /* Nothing may be allocated while parsing a document that fits. */
+        s_failMalloc = 1;
+        s_failRealloc = 1;
+        ok = ok &&
+            CheckParserParseBytewise(parser, input, sizeof(input)) &&
+            CheckParserParse(parser, NULL, 0, JSON_True, JSON_Success);
+        s_failMalloc = 0;
+        s_failRealloc = 0;
+        if (ok &&
+            JSON_Parser_GetTokenBytesHighWaterMark(parser) == 300 &&
+            JSON_Parser_GetDepthHighWaterMark(parser) == 40 &&
+            CheckParserReset(parser, JSON_Success) &&
+            JSON_Parser_GetTokenBytesHighWaterMark(parser) == 300 &&
+            CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+            CheckParserParse(parser, input, sizeof(input), JSON_True, JSON_Success) &&
+            JSON_Parser_Trim(parser, 0) == JSON_Success &&
+            JSON_Parser_GetTokenBytesHighWaterMark(parser) == 0 &&
+            JSON_Parser_GetDepthHighWaterMark(parser) == 0 &&
+            CheckParserReset(parser, JSON_Success) &&
+            JSON_Parser_Trim(parser, 0) == JSON_Success &&
+            s_bytesAllocated == baseline &&
+            CheckParserSetStringHandler(parser, &StringHandler, JSON_Success) &&
+            CheckParserParseBytewise(parser, input, 141) &&
+            JSON_Parser_Trim(parser, 0) == JSON_Success &&
+            CheckParserParse(parser, input + 141, sizeof(input) - 141, JSON_True, JSON_Success) &&
+            JSON_Parser_GetTokenBytesHighWaterMark(parser) == 300 &&
+            JSON_Parser_GetDepthHighWaterMark(parser) == 40)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            s_failureCount++;
+        }
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Parser_Free(parser);
+    ResetOutput();
+}
+
+static void TestParserPool(void)
+{
+    JSON_Parser parser = NULL;
+    JSON_Parser other = NULL;
+    JSON_Parser pooled[3] = { NULL, NULL, NULL };
+    JSON_ParserConfig config = NULL;
+    JSON_ParserPool pool = NULL;
+    ParserSettings settings;
+    ParserHandlers handlers;
+    size_t blocks;
 
-PARSE_TEST("embedded empty array (1)", StopAfterEmbeddedDocument, "[]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 ]:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
-PARSE_TEST("embedded empty array (2)", StopAfterEmbeddedDocument, "[]!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 ]:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
-PARSE_TEST("embedded array (1)", StopAfterEmbeddedDocument, "[1]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 ]:2,0,2,0-3,0,3,0 !(StoppedAfterEmbeddedDocument):3,0,3,0")
-PARSE_TEST("embedded array (2)", StopAfterEmbeddedDocument, "[1]!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 #(1):1,0,1,1-2,0,2,1 ]:2,0,2,0-3,0,3,0 !(StoppedAfterEmbeddedDocument):3,0,3,0")
-PARSE_TEST("embedded nested array (1)", StopAfterEmbeddedDocument, "[[1]]", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 [:1,0,1,1-2,0,2,1 i:2,0,2,2-3,0,3,2 #(1):2,0,2,2-3,0,3,2 ]:3,0,3,1-4,0,4,1 ]:4,0,4,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
-PARSE_TEST("embedded nested array (2)", StopAfterEmbeddedDocument, "[[1]]!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 i:1,0,1,1-2,0,2,1 [:1,0,1,1-2,0,2,1 i:2,0,2,2-3,0,3,2 #(1):2,0,2,2-3,0,3,2 ]:3,0,3,1-4,0,4,1 ]:4,0,4,0-5,0,5,0 !(StoppedAfterEmbeddedDocument):5,0,5,0")
-PARSE_TEST("embedded unclosed array (1)", StopAfterEmbeddedDocument, "[", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(ExpectedMoreTokens):1,0,1,1")
-PARSE_TEST("embedded unclosed array (2)", StopAfterEmbeddedDocument, "[!", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(UnknownToken):1,0,1,1")
-PARSE_TEST("embedded unclosed array (2)", StopAfterEmbeddedDocument, "[\xFF", FINAL, UTF8, "u(8) [:0,0,0,0-1,0,1,0 !(InvalidEncodingSequence):1,0,1,1")
+    printf("Test parser pool with shared configuration ... ");
+    InitParserSettings(&settings);
+    settings.userData = (void*)1;
+    settings.allowComments = JSON_True;
+    settings.allowMultipleDocuments = JSON_True;
+    InitParserHandlers(&handlers);
+    handlers.nullHandler = &NullHandler;
+    handlers.startDocumentHandler = &StartDocumentHandler;
+    if (CheckParserCreate(NULL, JSON_Success, &parser) &&
+        CheckParserSetUserData(parser, settings.userData, JSON_Success) &&
+        CheckParserSetAllowComments(parser, settings.allowComments, JSON_Success) &&
+        CheckParserSetAllowMultipleDocuments(parser, settings.allowMultipleDocuments, JSON_Success) &&
+        CheckParserSetNullHandler(parser, handlers.nullHandler, JSON_Success) &&
+        CheckParserSetStartDocumentHandler(parser, handlers.startDocumentHandler, JSON_Success) &&
+        !JSON_ParserConfig_Create(NULL, NULL) &&
+        (config = JSON_ParserConfig_Create(parser, NULL)) != NULL &&
+        CheckParserFree(parser, JSON_Success) &&
+        !JSON_ParserPool_Create(NULL, 2, NULL) &&
+        !JSON_ParserPool_Create(config, 0, NULL) &&
+        (pool = JSON_ParserPool_Create(config, 2, NULL)) != NULL &&
+        !JSON_ParserPool_Acquire(NULL) &&
+        (pooled[0] = JSON_ParserPool_Acquire(pool)) != NULL &&
+        (pooled[1] = JSON_ParserPool_Acquire(pool)) != NULL &&
+        (pooled[2] = JSON_ParserPool_Acquire(pool)) != NULL &&
+        pooled[0] != pooled[1] && pooled[1] != pooled[2] &&
+        CheckParserSettings(pooled[2], &settings) &&
+        CheckParserHandlers(pooled[2], &handlers) &&
+        CheckParserFree(pooled[0], JSON_Failure) &&
+        CheckParserSetAllowComments(pooled[0], JSON_False, JSON_Success) &&
+        CheckParserSetNullHandler(pooled[0], NULL, JSON_Success) &&
+        CheckParserParse(pooled[0], "null /**/ null", 14, JSON_False, JSON_Failure) &&
+        JSON_ParserPool_Release(pool, NULL) == JSON_Failure &&
+        JSON_ParserPool_Release(NULL, pooled[0]) == JSON_Failure &&
+        JSON_ParserPool_Release(pool, pooled[0]) == JSON_Success &&
+        JSON_ParserPool_Free(pool) == JSON_Failure)
+    {
+        /* The released parser is handed out again, with the settings and
+           handlers of the configuration rather than the defaults. */
+        ResetOutput();
+        blocks = s_blocksAllocated;
+        if (JSON_ParserPool_Acquire(pool) == pooled[0] &&
+            s_blocksAllocated == blocks &&
+            CheckParserSettings(pooled[0], &settings) &&
+            CheckParserHandlers(pooled[0], &handlers) &&
+            CheckParserParse(pooled[0], "null /**/ null", 14, JSON_True, JSON_Success) &&
+            CheckOutput("<:0,0,0,0-4,0,4,0 n:0,0,0,0-4,0,4,0 <:10,0,10,0-14,0,14,0 n:10,0,10,0-14,0,14,0") &&
+            JSON_ParserPool_Release(pool, pooled[2]) == JSON_Success &&
+            CheckParserCreate(NULL, JSON_Success, &other) &&
+            JSON_ParserPool_Release(pool, other) == JSON_Failure &&
+            (parser = JSON_Parser_CreateWithConfig(config, NULL)) != NULL &&
+            JSON_ParserPool_Release(pool, parser) == JSON_Failure &&
+            CheckParserSetAllowComments(parser, JSON_False, JSON_Success) &&
+            CheckParserReset(parser, JSON_Success) &&
+            CheckParserSettings(parser, &settings) &&
+            JSON_ParserPool_Release(pool, pooled[0]) == JSON_Success &&
+            JSON_ParserPool_Release(pool, pooled[1]) == JSON_Success &&
+            JSON_ParserPool_Free(pool) == JSON_Success)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        pool = NULL;
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_ParserPool_Free(pool);
+    JSON_Parser_Free(parser);
+    JSON_Parser_Free(other);
+    JSON_ParserConfig_Free(config);
+    ResetOutput();
+}
 
-PARSE_TEST("embedded empty object (1)", StopAfterEmbeddedDocument, "{}", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
-PARSE_TEST("embedded empty object (2)", StopAfterEmbeddedDocument, "{}!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 }:1,0,1,0-2,0,2,0 !(StoppedAfterEmbeddedDocument):2,0,2,0")
-PARSE_TEST("embedded object (1)", StopAfterEmbeddedDocument, "{\"a\":1}", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 #(1):5,0,5,1-6,0,6,1 }:6,0,6,0-7,0,7,0 !(StoppedAfterEmbeddedDocument):7,0,7,0")
-PARSE_TEST("embedded object (2)", StopAfterEmbeddedDocument, "{\"a\":1}!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 #(1):5,0,5,1-6,0,6,1 }:6,0,6,0-7,0,7,0 !(StoppedAfterEmbeddedDocument):7,0,7,0")
-PARSE_TEST("embedded nested object (1)", StopAfterEmbeddedDocument, "{\"a\":{\"b\":1}}", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 {:5,0,5,1-6,0,6,1 m(b):6,0,6,2-9,0,9,2 #(1):10,0,10,2-11,0,11,2 }:11,0,11,1-12,0,12,1 }:12,0,12,0-13,0,13,0 !(StoppedAfterEmbeddedDocument):13,0,13,0")
-PARSE_TEST("embedded nested object (2)", StopAfterEmbeddedDocument, "{\"a\":{\"b\":1}}!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 m(a):1,0,1,1-4,0,4,1 {:5,0,5,1-6,0,6,1 m(b):6,0,6,2-9,0,9,2 #(1):10,0,10,2-11,0,11,2 }:11,0,11,1-12,0,12,1 }:12,0,12,0-13,0,13,0 !(StoppedAfterEmbeddedDocument):13,0,13,0")
-PARSE_TEST("embedded unclosed object (1)", StopAfterEmbeddedDocument, "{", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 !(ExpectedMoreTokens):1,0,1,1")
-PARSE_TEST("embedded unclosed object (2)", StopAfterEmbeddedDocument, "{!", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 !(UnknownToken):1,0,1,1")
-PARSE_TEST("embedded unclosed object (2)", StopAfterEmbeddedDocument, "{\xFF", FINAL, UTF8, "u(8) {:0,0,0,0-1,0,1,0 !(InvalidEncodingSequence):1,0,1,1")
+static JSON_ReaderResult ReadDocument(JSON_Reader reader, const char* pInput, size_t length, size_t chunkLength, int outputLocations)
+{
+    /* Events are output like those of EventBatchHandler(), optionally
+       followed by their locations, and each time the reader needs input, a
+       ? is output and the next chunk is given to it. */
+    static const char eventCodes[] = { 'n', 'b', 's', '#', 'x', '{', '}', 'm', '[', ']', '<', '>' };
+    JSON_ReaderEvent event;
+    JSON_ReaderResult result;
+    size_t offset = 0;
+    while ((result = JSON_Reader_Next(reader, &event)) == JSON_Reader_HasEvent || result == JSON_Reader_NeedsInput)
+    {
+        OutputSeparator();
+        if (result == JSON_Reader_NeedsInput)
+        {
+            size_t chunk = (chunkLength && chunkLength < length - offset) ? chunkLength : length - offset;
+            OutputCharacter('?');
+            if (JSON_Reader_SetInput(reader, pInput + offset, chunk, (JSON_Boolean)(offset + chunk == length)) != JSON_Success)
+            {
+                return JSON_Reader_Failed;
+            }
+            offset += chunk;
+            continue;
+        }
+        OutputCharacter(eventCodes[event.type]);
+        OutputFormatted("%u", (unsigned int)event.location.depth);
+        if (event.type == JSON_Event_String || event.type == JSON_Event_Number || event.type == JSON_Event_ObjectMember)
+        {
+            OutputFormatted("(%.*s)", (int)event.length, event.pValue);
+        }
+        else if (event.type == JSON_Event_Boolean || event.type == JSON_Event_SpecialNumber)
+        {
+            OutputFormatted("(%d)", (int)event.attributes);
+        }
+        if (outputLocations)
+        {
+            OutputCharacter(':');
+            OutputLocation(&event.location);
+        }
+    }
+    return result;
+}
 
+typedef struct tag_ReaderTest
+{
+    const char*   pName;
+    const char*   pInput;
+    JSON_Encoding inputEncoding;
+    size_t        chunkLength; /* 0 to give the reader the whole input at once */
+    JSON_Error    expectedError;
+    const char*   pOutput;
+} ReaderTest;
+
+static const ReaderTest s_readerTests[] =
+{
+    { "whole document", "{\"a\":[1,true,null,\"x\"],\"b\":-1.5}", JSON_UnknownEncoding, 0, JSON_Error_None, "? {0 m1(a) [1 #2(1) b2(1) n2 s2(x) ]1 m1(b) #1(-1.5) }0" },
+    { "document in chunks", "{\"a\":[1,true,null,\"x\"],\"b\":-1.5}", JSON_UnknownEncoding, 3, JSON_Error_None, "? ? {0 m1(a) [1 ? #2(1) ? ? b2(1) ? n2 ? s2(x) ? ]1 ? m1(b) ? ? #1(-1.5) }0" },
+    { "bytewise document", "[NaN,-Infinity,\"\\u0041b\"]", JSON_UnknownEncoding, 1, JSON_Error_None, "? ? ? ? [0 ? x1(0) ? ? ? ? ? ? ? ? ? ? x1(2) ? ? ? ? ? ? ? ? ? s1(Ab) ? ]0" },
+    { "scalar document", "1234", JSON_UnknownEncoding, 2, JSON_Error_None, "? ? #0(1234)" },
+    { "empty document", "", JSON_UnknownEncoding, 0, JSON_Error_ExpectedMoreTokens, "?" },
+    { "invalid document", "[1,2,x]", JSON_UnknownEncoding, 0, JSON_Error_UnknownToken, "? [0 #1(1) #1(2)" },
+    { "duplicate member", "{\"a\":1,\"a\":2}", JSON_UnknownEncoding, 4, JSON_Error_DuplicateObjectMember, "? {0 m1(a) ? #1(1) ?" },
+    { "long string with escape sequence", "[\"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789\\/b\"]", JSON_UTF8, 0, JSON_Error_None, "? [0 s1(0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789/b) ]0" }
 };
 
-static void TestParserParse(void)
+static void TestReader(void)
 {
     size_t i;
-    for  (i = 0; i < sizeof(s_parseTests)/sizeof(s_parseTests[0]); i++)
+    for (i = 0; i < sizeof(s_readerTests) / sizeof(s_readerTests[0]); i++)
+    {
+        const ReaderTest* pTest = &s_readerTests[i];
+        JSON_Reader reader;
+        JSON_ReaderResult result;
+        printf("Test reader with %s ... ", pTest->pName);
+        reader = JSON_Reader_Create(NULL);
+        if (reader &&
+            CheckParserSetInputEncoding(JSON_Reader_GetParser(reader), pTest->inputEncoding, JSON_Success) &&
+            CheckParserSetAllowSpecialNumbers(JSON_Reader_GetParser(reader), JSON_True, JSON_Success) &&
+            CheckParserSetTrackObjectMembers(JSON_Reader_GetParser(reader), JSON_True, JSON_Success))
+        {
+            result = ReadDocument(reader, pTest->pInput, strlen(pTest->pInput), pTest->chunkLength, 0);
+            if (CheckOutput(pTest->pOutput))
+            {
+                if (result == ((pTest->expectedError == JSON_Error_None) ? JSON_Reader_Finished : JSON_Reader_Failed) &&
+                    JSON_Parser_GetError(JSON_Reader_GetParser(reader)) == pTest->expectedError)
+                {
+                    printf("OK\n");
+                }
+                else
+                {
+                    printf("FAILURE: expected error %s but got %s\n", errorNames[pTest->expectedError], errorNames[JSON_Parser_GetError(JSON_Reader_GetParser(reader))]);
+                    s_failureCount++;
+                }
+            }
+            else
+            {
+                s_failureCount++;
+            }
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Reader_Free(reader);
+        ResetOutput();
+    }
+}
+
+static void TestReaderMultipleDocuments(void)
+{
+    /* Each document's events are bracketed by its start and end document
+       events, wherever the chunks end. */
+    static const char input[] = "[1,2]\n[3] 4";
+    static const char* const expectedOutputs[] =
+    {
+        "? <0:0,0,0,0 [0:0,0,0,0 #1(1):1,0,1,1 #1(2):3,0,3,1 ]0:4,0,4,0 >0:4,0,4,0 <0:6,1,0,0 [0:6,1,0,0 #1(3):7,1,1,1 ]0:8,1,2,0 >0:8,1,2,0 <0:10,1,4,0 #0(4):10,1,4,0 >0:10,1,4,0",
+        "? ? ? ? <0:0,0,0,0 [0:0,0,0,0 #1(1):1,0,1,1 ? #1(2):3,0,3,1 ]0:4,0,4,0 >0:4,0,4,0 ? ? <0:6,1,0,0 [0:6,1,0,0 ? ? #1(3):7,1,1,1 ]0:8,1,2,0 >0:8,1,2,0 ? ? <0:10,1,4,0 #0(4):10,1,4,0 >0:10,1,4,0"
+    };
+    size_t i;
+    for (i = 0; i < sizeof(expectedOutputs) / sizeof(expectedOutputs[0]); i++)
+    {
+        JSON_Reader reader = JSON_Reader_Create(NULL);
+        printf("Test reader with multiple documents%s ... ", i ? " bytewise" : "");
+        if (reader &&
+            CheckParserSetAllowMultipleDocuments(JSON_Reader_GetParser(reader), JSON_True, JSON_Success) &&
+            ReadDocument(reader, input, sizeof(input) - 1, i, 1) == JSON_Reader_Finished &&
+            CheckOutput(expectedOutputs[i]))
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            s_failureCount++;
+        }
+        JSON_Reader_Free(reader);
+        ResetOutput();
+    }
+}
+
+static void TestReaderReferencesInput(void)
+{
+    static const char input[] = "{\"abc\":[\"x\\ty\",12]}";
+    JSON_Reader reader = NULL;
+    JSON_Parser parser;
+    JSON_ReaderEvent event;
+    JSON_Location location;
+    printf("Test reader references input ... ");
+    if ((reader = JSON_Reader_Create(NULL)) != NULL &&
+        (parser = JSON_Reader_GetParser(reader)) != NULL &&
+        JSON_Reader_GetParser(NULL) == NULL &&
+        JSON_Reader_Next(NULL, &event) == JSON_Reader_Failed &&
+        JSON_Reader_Next(reader, NULL) == JSON_Reader_Failed &&
+        JSON_Reader_SetInput(NULL, input, sizeof(input) - 1, JSON_True) == JSON_Failure &&
+        JSON_Reader_SetInput(reader, NULL, 1, JSON_True) == JSON_Failure &&
+        CheckParserSetInputEncoding(parser, JSON_UTF8, JSON_Success) &&
+        JSON_Reader_SetInput(reader, input, sizeof(input) - 1, JSON_True) == JSON_Success &&
+        JSON_Reader_SetInput(reader, input, sizeof(input) - 1, JSON_True) == JSON_Failure &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_StartObject &&
+        !event.pValue && !event.length &&
+        CheckParserSetAllowComments(parser, JSON_True, JSON_Failure) &&
+        CheckParserParse(parser, "{}", 2, JSON_True, JSON_Failure) &&
+        CheckParserReset(parser, JSON_Failure) &&
+        CheckParserFree(parser, JSON_Failure) &&
+
+        /* Verbatim values point into the input, and the others don't. */
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_ObjectMember &&
+        event.pValue == input + 2 && event.length == 3 &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_StartArray && event.location.depth == 1 &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_String &&
+        (event.pValue < input || event.pValue >= input + sizeof(input)) && event.length == 3 && !memcmp(event.pValue, "x\ty", 3) &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_Number &&
+        event.pValue == input + 15 && event.length == 2 &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_EndArray &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_EndObject && event.location.depth == 0 &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_Finished &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_Finished &&
+        JSON_Reader_SetInput(reader, input, sizeof(input) - 1, JSON_True) == JSON_Failure &&
+
+        /* Resetting the reader resets its parser, which stays bound to it. */
+        JSON_Reader_Reset(NULL) == JSON_Failure &&
+        JSON_Reader_Reset(reader) == JSON_Success &&
+        JSON_Reader_GetParser(reader) == parser &&
+        CheckParserSetAllowComments(parser, JSON_True, JSON_Success) &&
+        JSON_Reader_SetInput(reader, "[/**/1", 6, JSON_False) == JSON_Success &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_StartArray &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_NeedsInput &&
+        JSON_Reader_SetInput(reader, "x", 1, JSON_True) == JSON_Success &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_HasEvent && event.type == JSON_Event_Number &&
+        event.length == 1 && event.pValue[0] == '1' &&
+        JSON_Reader_Next(reader, &event) == JSON_Reader_Failed &&
+        JSON_Parser_GetError(parser) == JSON_Error_UnknownToken &&
+        JSON_Parser_GetErrorLocation(parser, &location) == JSON_Success &&
+        location.byte == 6 && location.depth == 1 &&
+        JSON_Reader_Free(NULL) == JSON_Failure)
+    {
+        printf("OK\n");
+    }
+    else
     {
-        RunParseTest(&s_parseTests[i]);
+        s_failureCount++;
     }
+    JSON_Reader_Free(reader);
 }
 
 #endif /* JSON_NO_PARSER */
@@ -3791,6 +6584,61 @@ static void TestWriterReset(void)
     JSON_Writer_Free(writer);
 }
 
+static void TestWriterPool(void)
+{
+    JSON_Writer writer = NULL;
+    JSON_Writer pooled[2] = { NULL, NULL };
+    JSON_WriterConfig config = NULL;
+    JSON_WriterPool pool = NULL;
+    WriterSettings settings;
+    WriterHandlers handlers;
+    printf("Test writer pool with shared configuration ... ");
+    ResetOutput();
+    InitWriterSettings(&settings);
+    settings.userData = (void*)1;
+    settings.useCRLF = JSON_True;
+    InitWriterHandlers(&handlers);
+    handlers.outputHandler = &OutputHandler;
+    if (CheckWriterCreate(NULL, JSON_Success, &writer) &&
+        CheckWriterSetUserData(writer, settings.userData, JSON_Success) &&
+        CheckWriterSetUseCRLF(writer, settings.useCRLF, JSON_Success) &&
+        CheckWriterSetOutputHandler(writer, handlers.outputHandler, JSON_Success) &&
+        !JSON_WriterConfig_Create(NULL, NULL) &&
+        (config = JSON_WriterConfig_Create(writer, NULL)) != NULL &&
+        CheckWriterFree(writer, JSON_Success) &&
+        (writer = JSON_Writer_CreateWithConfig(config, NULL)) != NULL &&
+        CheckWriterSettings(writer, &settings) &&
+        CheckWriterHandlers(writer, &handlers) &&
+        !JSON_WriterPool_Create(config, 0, NULL) &&
+        (pool = JSON_WriterPool_Create(config, 1, NULL)) != NULL &&
+        (pooled[0] = JSON_WriterPool_Acquire(pool)) != NULL &&
+        (pooled[1] = JSON_WriterPool_Acquire(pool)) != NULL &&
+        CheckWriterFree(pooled[0], JSON_Failure) &&
+        CheckWriterSetOutputHandler(pooled[0], NULL, JSON_Success) &&
+        CheckWriterWriteNull(pooled[0], JSON_Success) &&
+        JSON_WriterPool_Release(pool, writer) == JSON_Failure &&
+        JSON_WriterPool_Release(pool, pooled[1]) == JSON_Success &&
+        JSON_WriterPool_Release(pool, pooled[0]) == JSON_Success &&
+        JSON_WriterPool_Acquire(pool) == pooled[0] &&
+        CheckWriterSettings(pooled[0], &settings) &&
+        CheckWriterHandlers(pooled[0], &handlers) &&
+        CheckWriterWriteNull(pooled[0], JSON_Success) &&
+        CheckOutput("null") &&
+        JSON_WriterPool_Free(pool) == JSON_Failure &&
+        JSON_WriterPool_Release(pool, pooled[0]) == JSON_Success &&
+        JSON_WriterPool_Free(pool) == JSON_Success)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Writer_Free(writer);
+    JSON_WriterConfig_Free(config);
+    ResetOutput();
+}
+
 static void TestWriterMisbehaveInCallbacks(void)
 {
     JSON_Writer writer = NULL;
@@ -4905,6 +7753,213 @@ static void TestWriterWriteNewLine(void)
 
 #endif /* JSON_NO_WRITER */
 
+static JSON_Arena CreateArena(size_t slabSize)
+{
+    JSON_MemorySuite memorySuite;
+    memorySuite.userData = NULL;
+    memorySuite.realloc = &ReallocHandler;
+    memorySuite.free = &FreeHandler;
+    return JSON_Arena_Create(&memorySuite, slabSize);
+}
+
+static void TestArenaCreate(void)
+{
+    JSON_MemorySuite memorySuite;
+    JSON_Arena arena = NULL;
+    printf("Test creating arena ... ");
+    memorySuite.userData = NULL;
+    memorySuite.realloc = &ReallocHandler;
+    memorySuite.free = NULL;
+    if (JSON_Arena_Create(&memorySuite, 0) == NULL &&
+        JSON_Arena_Free(NULL) == JSON_Failure &&
+        JSON_Arena_Reset(NULL) == JSON_Failure &&
+        JSON_Arena_GetMemorySuite(NULL) == NULL &&
+        JSON_Arena_GetHighWaterMark(NULL) == 0 &&
+        (s_failMalloc = 1, CreateArena(0) == NULL) &&
+        (s_failMalloc = 0, (arena = CreateArena(0)) != NULL) &&
+        JSON_Arena_GetMemorySuite(arena) != NULL &&
+        JSON_Arena_GetHighWaterMark(arena) == 0)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        printf("FAILURE: unexpected result from arena API\n");
+        s_failureCount++;
+    }
+    s_failMalloc = 0;
+    JSON_Arena_Free(arena);
+}
+
+static void TestArenaAllocation(void)
+{
+    JSON_Arena arena = CreateArena(256);
+    const JSON_MemorySuite* pSuite = JSON_Arena_GetMemorySuite(arena);
+    char* p1;
+    char* p2;
+    char* p3;
+    char* pLarge;
+    char* pFirst;
+    size_t blocksAllocated;
+    int succeeded = 0;
+    printf("Test arena allocation ... ");
+    p1 = (char*)pSuite->realloc(pSuite->userData, NULL, 10);
+    p2 = (char*)pSuite->realloc(pSuite->userData, NULL, 3);
+    pFirst = p1;
+    if (p1 && p2 && !((size_t)p1 % sizeof(double)) && !((size_t)p2 % sizeof(double)))
+    {
+        memcpy(p1, "abcdefghij", 10);
+        memcpy(p2, "xyz", 3);
+        /* The most recent block grows in place; others are copied. */
+        p3 = (char*)pSuite->realloc(pSuite->userData, p2, 40);
+        if (p3 == p2 && !memcmp(p3, "xyz", 3))
+        {
+            p3 = (char*)pSuite->realloc(pSuite->userData, p1, 20);
+            if (p3 && p3 != p1 && !memcmp(p3, "abcdefghij", 10))
+            {
+                /* Freeing the most recent block reclaims it. */
+                pSuite->free(pSuite->userData, p3);
+                p1 = (char*)pSuite->realloc(pSuite->userData, NULL, 20);
+                pLarge = (char*)pSuite->realloc(pSuite->userData, NULL, 1000);
+                if (p1 == p3 && pLarge)
+                {
+                    memset(pLarge, 'L', 1000);
+                    blocksAllocated = s_blocksAllocated;
+                    if (JSON_Arena_GetHighWaterMark(arena) >= 1000 + 40 + 20 + 10 &&
+                        JSON_Arena_Reset(arena) == JSON_Success &&
+                        pSuite->realloc(pSuite->userData, NULL, 10) == pFirst &&
+                        pSuite->realloc(pSuite->userData, NULL, 1000) == pLarge &&
+                        s_blocksAllocated == blocksAllocated)
+                    {
+                        succeeded = 1;
+                    }
+                }
+            }
+        }
+    }
+    if (succeeded)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        printf("FAILURE: unexpected result from arena memory suite\n");
+        s_failureCount++;
+    }
+    JSON_Arena_Free(arena);
+}
+
+typedef struct tag_LongDoubleAlignment
+{
+    char        c;
+    long double ld;
+} LongDoubleAlignment;
+
+static void TestArenaAlignment(void)
+{
+    /* The slabs come from malloc() rather than from the test memory suite,
+       which only aligns blocks to a size_t. Odd sizes make sure that each
+       block is padded out to the alignment before the next one starts. */
+    JSON_Arena arena = JSON_Arena_Create(NULL, 256);
+    const JSON_MemorySuite* pSuite = JSON_Arena_GetMemorySuite(arena);
+    size_t size;
+    int aligned = 1;
+    printf("Test arena alignment ... ");
+    for (size = 1; aligned && size < 100; size += 2)
+    {
+        char* p = (char*)pSuite->realloc(pSuite->userData, NULL, size);
+        aligned = p && !((size_t)p % offsetof(LongDoubleAlignment, ld));
+    }
+    if (aligned)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        printf("FAILURE: expected arena blocks to be aligned for long double\n");
+        s_failureCount++;
+    }
+    JSON_Arena_Free(arena);
+}
+
+#ifndef JSON_NO_PARSER
+
+static void TestArenaParser(void)
+{
+    static const char input[] = "{\"a\":{\"b\":[1,2,{\"c\":\"a string long enough to need its own buffer, more than sixty-four bytes\"}],\"d\":{}},\"e\":{\"f\":null}}";
+    JSON_Arena arena = CreateArena(1024);
+    JSON_Parser parser;
+    size_t blocksAllocated = 0;
+    int i;
+    int succeeded = 1;
+    printf("Test parsing with arena ... ");
+    for (i = 0; succeeded && i < 3; i++)
+    {
+        /* Once the arena has grown, parsing another document doesn't need
+           any more memory from the underlying suite. */
+        parser = JSON_Parser_Create(JSON_Arena_GetMemorySuite(arena));
+        succeeded = parser &&
+                    CheckParserSetTrackObjectMembers(parser, JSON_True, JSON_Success) &&
+                    CheckParserParse(parser, input, sizeof(input) - 1, JSON_True, JSON_Success) &&
+                    (i < 2 || s_blocksAllocated == blocksAllocated);
+        blocksAllocated = s_blocksAllocated;
+        JSON_Parser_Free(parser);
+        JSON_Arena_Reset(arena);
+    }
+    if (succeeded && JSON_Arena_GetHighWaterMark(arena))
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        printf("FAILURE: unexpected result parsing with arena\n");
+        s_failureCount++;
+    }
+    JSON_Arena_Free(arena);
+}
+
+#endif /* JSON_NO_PARSER */
+
+#ifndef JSON_NO_WRITER
+
+static void TestArenaWriter(void)
+{
+    JSON_Arena arena = CreateArena(0);
+    JSON_Writer writer = JSON_Writer_Create(JSON_Arena_GetMemorySuite(arena));
+    int depth;
+    printf("Test writing with arena ... ");
+    if (writer &&
+        CheckWriterSetOutputHandler(writer, &OutputHandler, JSON_Success))
+    {
+        for (depth = 0; depth < 40; depth++)
+        {
+            JSON_Writer_WriteStartArray(writer);
+        }
+        for (depth = 0; depth < 40; depth++)
+        {
+            JSON_Writer_WriteEndArray(writer);
+        }
+        if (JSON_Writer_GetError(writer) == JSON_Error_None && s_outputLength == 80)
+        {
+            printf("OK\n");
+        }
+        else
+        {
+            printf("FAILURE: unexpected result writing with arena\n");
+            s_failureCount++;
+        }
+    }
+    else
+    {
+        s_failureCount++;
+    }
+    JSON_Writer_Free(writer);
+    JSON_Arena_Free(arena);
+    ResetOutput();
+}
+
+#endif /* JSON_NO_WRITER */
+
 static void TestLibraryVersion(void)
 {
     const JSON_Version* pVersion = JSON_LibraryVersion();
@@ -5009,6 +8064,60 @@ static void TestNativeUTF32Encoding(void)
     }
 }
 
+static void TestFindRecordBoundary(void)
+{
+    static const char input[] = "[1]\n\x1E{}\n\n2";
+    printf("Test finding record boundaries ... ");
+    if (JSON_FindRecordBoundary(input, sizeof(input) - 1, 0) == 0 &&
+        JSON_FindRecordBoundary(input, sizeof(input) - 1, 1) == 4 &&
+        JSON_FindRecordBoundary(input, sizeof(input) - 1, 4) == 4 &&
+        JSON_FindRecordBoundary(input, sizeof(input) - 1, 5) == 8 &&
+        JSON_FindRecordBoundary(input, sizeof(input) - 1, 8) == 8 &&
+        JSON_FindRecordBoundary(input, sizeof(input) - 1, 9) == 9 &&
+        JSON_FindRecordBoundary(input, sizeof(input) - 1, 10) == 10 &&
+        JSON_FindRecordBoundary(input, sizeof(input) - 1, 11) == 10 &&
+        JSON_FindRecordBoundary(input, 3, 1) == 3 &&
+        JSON_FindRecordBoundary(NULL, 0, 0) == 0)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+}
+
+static void TestFindArrayItemBoundary(void)
+{
+    static const char input[] = "[{\"a\":\"x,}\"},{\"b\":[1,2]},{\"c\":\"\\\"{\"}] ";
+    static const char strings[] = "[\"a,b\",\"c,d\",\",:\",\"x\\\\\\\",z\"]";
+    printf("Test finding array item boundaries ... ");
+    if (JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 0) == 0 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 1) == 12 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 8) == 12 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 12) == 12 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 13) == 24 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 19) == 24 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 25) == 38 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 36) == 38 &&
+        JSON_FindArrayItemBoundary(input, sizeof(input) - 1, 38) == 38 &&
+        JSON_FindArrayItemBoundary(strings, sizeof(strings) - 1, 2) == 6 &&
+        JSON_FindArrayItemBoundary(strings, sizeof(strings) - 1, 4) == 6 &&
+        JSON_FindArrayItemBoundary(strings, sizeof(strings) - 1, 8) == 12 &&
+        JSON_FindArrayItemBoundary(strings, sizeof(strings) - 1, 14) == 17 &&
+        JSON_FindArrayItemBoundary(strings, sizeof(strings) - 1, 15) == 17 &&
+        JSON_FindArrayItemBoundary(strings, sizeof(strings) - 1, 21) == 28 &&
+        JSON_FindArrayItemBoundary(strings, sizeof(strings) - 1, 24) == 28 &&
+        JSON_FindArrayItemBoundary(NULL, 0, 0) == 0)
+    {
+        printf("OK\n");
+    }
+    else
+    {
+        s_failureCount++;
+    }
+}
+
 static void TestNoLeaks(void)
 {
     printf("Checking for memory leaks ... ");
@@ -5048,7 +8157,38 @@ int main(int argc, char* argv[])
     TestParserStackMallocFailure();
     TestParserStackReallocFailure();
     TestParserDuplicateMemberTrackingMallocFailure();
+    TestParserDuplicateMemberTrackingLargeObject();
     TestParserParse();
+    TestParserParseInChunks();
+    TestParserParseWithRefHandlers();
+    TestParserParseWithLazyLocations();
+    TestParserParseLongInput();
+    TestParserRefHandlersReferenceInput();
+    TestParserNativeNumberHandlers();
+    TestParserInternedMemberHandler();
+    TestParserInternedKeySettings();
+    TestParserKnownKeys();
+    TestParserSkipValue();
+    TestParserPathFilter();
+    TestParserSetPathFilter();
+    TestParserManyKnownKeys();
+    TestParserSetKnownKeys();
+    TestParserEventBatches();
+    TestParserAbortInEventBatchHandler();
+    TestParserBuildTape();
+    TestParserBuildLargeTape();
+    TestTapeNavigation();
+    TestTapeIncomplete();
+    TestTapeMallocFailure();
+    TestParserMultipleDocuments();
+    TestParserClone();
+    TestParserArraySegments();
+    TestParserSaveState();
+    TestParserBufferManagement();
+    TestParserPool();
+    TestReader();
+    TestReaderMultipleDocuments();
+    TestReaderReferencesInput();
 #endif
 
 #ifndef JSON_NO_WRITER
@@ -5060,6 +8200,7 @@ int main(int argc, char* argv[])
     TestWriterSetInvalidSettings();
     TestWriterSetHandlers();
     TestWriterReset();
+    TestWriterPool();
     TestWriterMisbehaveInCallbacks();
     TestWriterAbortInCallbacks();
     TestWriterStackMallocFailure();
@@ -5079,8 +8220,19 @@ int main(int argc, char* argv[])
 
     TestLibraryVersion();
     TestErrorStrings();
+    TestArenaCreate();
+    TestArenaAllocation();
+    TestArenaAlignment();
+#ifndef JSON_NO_PARSER
+    TestArenaParser();
+#endif
+#ifndef JSON_NO_WRITER
+    TestArenaWriter();
+#endif
     TestNativeUTF16Encoding();
     TestNativeUTF32Encoding();
+    TestFindRecordBoundary();
+    TestFindArrayItemBoundary();
     TestNoLeaks();
 
     if (s_failureCount)